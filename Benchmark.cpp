@@ -0,0 +1,447 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "simdjson.h"
+#include "FileBackedAllocator.h"
+#include "HugePageAllocator.h"
+#include "NdjsonDocument.h"
+#include "NumericSeries.h"
+#include "OverlappedReader.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+	using Clock = std::chrono::steady_clock;
+	constexpr uintptr_t PAGE_SIZE_BYTES = 4096;
+
+	// Page faults of the current process so far (major faults are those that needed I/O)
+	struct FaultCounters {
+		long minor = 0;
+		long major = 0;
+	};
+
+	FaultCounters read_fault_counters() {
+		FaultCounters counters;
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS pmc;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+			counters.minor = long(pmc.PageFaultCount);
+		}
+#else
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) == 0) {
+			counters.minor = usage.ru_minflt;
+			counters.major = usage.ru_majflt;
+		}
+#endif
+		return counters;
+	}
+
+	// Result of one measured phase
+	struct PhaseResult {
+		double seconds = 0;
+		size_t operations = 0;
+		size_t pagesTouched = 0;
+		FaultCounters faults;
+	};
+
+	// Measures the time, faults and distinct pages touched by 'phase', which reports the addresses it reads through
+	// the callback it receives and returns its number of operations
+	template<typename Phase>
+	PhaseResult measure(Phase&& phase) {
+		std::unordered_set<uintptr_t> pages;
+		auto touch = [&pages](const void* address) {
+			pages.insert(reinterpret_cast<uintptr_t>(address) / PAGE_SIZE_BYTES);
+		};
+		PhaseResult result;
+		const FaultCounters before = read_fault_counters();
+		const auto start = Clock::now();
+		result.operations = phase(touch);
+		result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		const FaultCounters after = read_fault_counters();
+		result.faults.minor = after.minor - before.minor;
+		result.faults.major = after.major - before.major;
+		result.pagesTouched = pages.size();
+		return result;
+	}
+
+	// Tape helpers: the index following the value at 'i', and the type character of a tape word
+	inline char tape_type(const uint64_t* tape, size_t i) {
+		return char(tape[i] >> 56);
+	}
+
+	inline size_t tape_after(const uint64_t* tape, size_t i) {
+		switch (tape_type(tape, i)) {
+		case '{':
+		case '[':
+			return size_t(tape[i] & 0xFFFFFFFF);
+		case 'l':
+		case 'u':
+		case 'd':
+			return i + 2;
+		default:
+			return i + 1;
+		}
+	}
+
+	// Touches the tape word of a value and, for strings, its bytes in the string buffer
+	template<typename Touch>
+	void read_value(const simdjson::dom::document& doc, size_t i, Touch& touch) {
+		touch(&doc.tape[i]);
+		if (tape_type(doc.tape.get(), i) == '"') {
+			const uint8_t* str = doc.string_buf.get() + (doc.tape[i] & simdjson::internal::JSON_VALUE_MASK);
+			uint32_t length;
+			std::memcpy(&length, str, sizeof(length));
+			touch(str);
+			touch(str + sizeof(length) + length);
+		}
+	}
+
+	// Simulates browsing: each expand reads every child of a container (keys and values) and descends into a
+	// random container child. At dead ends the walk backs up one level and picks another child, as a user would.
+	template<typename Touch>
+	size_t browse(const simdjson::dom::document& doc, size_t expands, Touch& touch) {
+		const uint64_t* tape = doc.tape.get();
+		std::mt19937_64 rng(42);
+
+		// Container children of each expanded level along the current path
+		std::vector<std::vector<size_t>> path;
+		size_t current = 1;
+		for (size_t n = 0; n < expands; n++) {
+			const char type = tape_type(tape, current);
+			std::vector<size_t> containers;
+			if (type == '{' || type == '[') {
+				const size_t end = tape_after(tape, current) - 1;
+				for (size_t i = current + 1; i < end; i = tape_after(tape, i)) {
+					if (type == '{') {
+						read_value(doc, i, touch);
+						i = tape_after(tape, i);
+					}
+					read_value(doc, i, touch);
+					if (tape_type(tape, i) == '{' || tape_type(tape, i) == '[') {
+						containers.push_back(i);
+					}
+				}
+			}
+			path.push_back(std::move(containers));
+			while (!path.empty() && path.back().empty()) {
+				path.pop_back();
+			}
+			if (path.empty()) {
+				return n + 1;
+			}
+			current = path.back()[rng() % path.back().size()];
+		}
+		return expands;
+	}
+
+	// Simulates a search that finds nothing: every string on the tape is read once
+	template<typename Touch>
+	size_t search_all(const simdjson::dom::document& doc, Touch& touch) {
+		const uint64_t* tape = doc.tape.get();
+		const size_t end = size_t(tape[0] & simdjson::internal::JSON_VALUE_MASK);
+		size_t strings = 0;
+		for (size_t i = 1; i < end; ) {
+			if (tape_type(tape, i) == '"') {
+				read_value(doc, i, touch);
+				strings++;
+			}
+			else {
+				touch(&tape[i]);
+			}
+			const char type = tape_type(tape, i);
+			i += (type == 'l' || type == 'u' || type == 'd') ? 2 : 1;
+		}
+		return strings;
+	}
+
+	// Asks the OS to drop the file from the page cache so that the next read is cold. Only effective on Linux;
+	// elsewhere the following measurements are warm.
+	bool evict_from_page_cache(const std::string& path) {
+#ifdef __linux__
+		const int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		fdatasync(fd);
+		const bool evicted = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+		close(fd);
+		return evicted;
+#else
+		(void)path;
+		return false;
+#endif
+	}
+
+	void print_phase(std::ostream& out, const char* name, const PhaseResult& result) {
+		out << "  " << name << ": " << result.seconds * 1000.0 << " ms, "
+			<< result.operations << " ops, "
+			<< result.pagesTouched << " pages touched ("
+			<< (result.operations ? double(result.pagesTouched) / double(result.operations) : 0.0) << " per op), "
+			<< result.faults.minor << " minor / " << result.faults.major << " major faults\n";
+	}
+}
+
+// Method: Runs parse, browse and search in the in-memory and out-of-core modes and prints both reports
+int run_locality_benchmark(const std::string& path, std::ostream& out) {
+	std::error_code ec;
+	const size_t size = size_t(std::filesystem::file_size(path, ec));
+	if (ec) {
+		out << "Cannot open " << path << "\n";
+		return 1;
+	}
+
+	// Temporary files next to the input, which is on disk, rather than in a temporary directory that may be in RAM
+	FileBackedAllocator fileBacked(std::filesystem::absolute(path, ec).parent_path().string());
+	for (const bool outOfCore : { false, true }) {
+		simdjson::dom::parser parser;
+		if (outOfCore) {
+			parser.doc.set_allocator(fileBacked.get());
+		}
+
+		simdjson::dom::element root;
+		simdjson::error_code error = simdjson::SUCCESS;
+		PhaseResult parse = measure([&](auto&) {
+			error = outOfCore ? fileBacked.load(parser, path).get(root) : parser.load(path).get(root);
+			return size_t(1);
+		});
+		if (error) {
+			out << "Parse error: " << error << "\n";
+			return 1;
+		}
+
+		PhaseResult browsing = measure([&](auto& touch) { return browse(parser.doc, 10000, touch); });
+		PhaseResult searching = measure([&](auto& touch) { return search_all(parser.doc, touch); });
+
+		out << (outOfCore ? "out-of-core" : "in-memory") << " (" << size << " bytes";
+		if (outOfCore) {
+			out << ", " << fileBacked.allocated_bytes() << " bytes file-backed";
+		}
+		out << ")\n";
+		print_phase(out, "parse", parse);
+		print_phase(out, "browse", browsing);
+		print_phase(out, "search", searching);
+	}
+	return 0;
+}
+
+// Method: Loads the file twice with default buffers and twice with huge-page buffers and prints both reports
+int run_hugepage_benchmark(const std::string& path, std::ostream& out) {
+	HugePageAllocator hugePages;
+	for (const bool useHugePages : { false, true }) {
+		simdjson::dom::parser parser;
+		if (useHugePages) {
+			parser.doc.set_allocator(hugePages.get());
+		}
+
+		simdjson::dom::element root;
+		simdjson::error_code error = simdjson::SUCCESS;
+		auto load = [&](auto&) {
+			simdjson::error_code loadError = useHugePages ? hugePages.load(parser, path).get(root) : parser.load(path).get(root);
+			if (loadError) {
+				error = loadError;
+			}
+			return size_t(1);
+		};
+		PhaseResult first = measure(load);
+		PhaseResult second = measure(load);
+		if (error) {
+			out << "Parse error: " << error << "\n";
+			return 1;
+		}
+
+		out << (useHugePages ? "huge pages + parallel pre-fault" : "default buffers") << "\n";
+		print_phase(out, "first load", first);
+		print_phase(out, "second load", second);
+	}
+	return 0;
+}
+
+// Method: Times reading alone, parsing alone, and reading plus parsing sequentially and overlapped, each from a cold page cache
+int run_read_benchmark(const std::string& path, std::ostream& out) {
+	const bool ndjson = NdjsonDocument::has_ndjson_extension(path);
+	simdjson::error_code error = simdjson::SUCCESS;
+	auto keep_error = [&error](simdjson::error_code result) {
+		if (result) {
+			error = result;
+		}
+	};
+
+	// Parses an in-memory input the way the chosen mode does
+	auto parse_input = [&](simdjson::dom::parser& parser, const simdjson::padded_string& input) {
+		if (ndjson) {
+			NdjsonDocument document;
+			keep_error(document.parse(input));
+		}
+		else {
+			simdjson::dom::element root;
+			keep_error(parser.parse(input).get(root));
+		}
+	};
+
+	const bool cold = evict_from_page_cache(path);
+	PhaseResult readOnly = measure([&](auto&) {
+		OverlappedReader reader;
+		keep_error(reader.open(path));
+		reader.wait_for(reader.size());
+		keep_error(reader.error());
+		return size_t(1);
+	});
+
+	simdjson::padded_string input;
+	keep_error(simdjson::padded_string::load(path).get(input));
+	simdjson::dom::parser parser;
+	PhaseResult parseOnly = measure([&](auto&) {
+		parse_input(parser, input);
+		return size_t(1);
+	});
+	if (error) {
+		out << "Error: " << error << "\n";
+		return 1;
+	}
+
+	out << (ndjson ? "NDJSON" : "single document") << " (" << input.size() << " bytes, "
+		<< (cold ? "cold page cache" : "page cache not evicted") << ")\n";
+	out << "  read only: " << readOnly.seconds * 1000.0 << " ms\n";
+	out << "  parse only: " << parseOnly.seconds * 1000.0 << " ms\n";
+
+	const char* names[] = { "read, then parse", "overlapped, blocking reads", "overlapped, io_uring" };
+	for (int mode = 0; mode < 3; mode++) {
+		evict_from_page_cache(path);
+		simdjson::dom::parser modeParser;
+		bool usedIoUring = false;
+		PhaseResult result = measure([&](auto&) {
+			if (mode == 0) {
+				simdjson::padded_string loaded;
+				keep_error(simdjson::padded_string::load(path).get(loaded));
+				parse_input(modeParser, loaded);
+			}
+			else if (ndjson) {
+				NdjsonDocument document;
+				keep_error(document.load(path, mode == 2));
+			}
+			else {
+				simdjson::dom::element root;
+				keep_error(OverlappedReader::load(modeParser, path, mode == 2).get(root));
+			}
+			return size_t(1);
+		});
+		if (mode == 2) {
+			OverlappedReader probe;
+			if (!probe.open(path)) {
+				probe.wait_for(probe.size());
+				usedIoUring = probe.used_io_uring();
+			}
+		}
+		if (error) {
+			out << "Error: " << error << "\n";
+			return 1;
+		}
+		out << "  " << names[mode] << ": " << result.seconds * 1000.0 << " ms";
+		if (mode == 2 && !usedIoUring) {
+			out << " (io_uring unavailable, blocking reads used)";
+		}
+		out << "\n";
+	}
+	return 0;
+}
+
+// Method: Extracts the series twice to compare thread counts, then times downsampling ranges of random positions and
+// lengths; the first queries are compared with a plain scan of their values
+int run_plot_benchmark(const std::string& path, const std::string& fieldPath, std::ostream& out) {
+	constexpr size_t COLUMNS = 2000;
+	constexpr size_t QUERIES = 1000;
+	constexpr size_t CHECKED_QUERIES = 20;
+
+	std::string arrayPointer, fieldPointer;
+	if (!NumericSeries::split_path(fieldPath, arrayPointer, fieldPointer)) {
+		out << "Error: the path needs a \"*\" token for the array elements\n";
+		return 1;
+	}
+	const bool ndjson = NdjsonDocument::has_ndjson_extension(path);
+	NdjsonDocument records;
+	simdjson::dom::parser parser;
+	simdjson::dom::element array;
+	simdjson::error_code error = simdjson::SUCCESS;
+	const auto loadStart = Clock::now();
+	if (ndjson) {
+		error = records.load(path);
+	}
+	else {
+		simdjson::dom::element root;
+		error = parser.load(path).get(root);
+		if (!error) {
+			error = root.at_pointer(arrayPointer).get(array);
+		}
+	}
+	const double loadSeconds = std::chrono::duration<double>(Clock::now() - loadStart).count();
+	if (error) {
+		out << "Error: " << error << "\n";
+		return 1;
+	}
+
+	out << (ndjson ? "NDJSON" : "single document") << ", loaded in " << loadSeconds * 1000.0 << " ms\n";
+
+	NumericSeries series;
+	const unsigned threadCounts[] = { 1, 0 };
+	for (const unsigned threads : threadCounts) {
+		error = ndjson ? series.extract(records, fieldPointer, threads) : series.extract(array, fieldPointer, threads);
+		if (error) {
+			out << "Error: " << error << "\n";
+			return 1;
+		}
+		const unsigned used = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+		out << "  extract, " << used << (used == 1 ? " thread: " : " threads: ") << series.seconds() * 1000.0 << " ms\n";
+	}
+	out << "  " << series.size() << " values, " << series.missing() << " missing or not numbers\n";
+	if (series.size() == 0) {
+		return 0;
+	}
+
+	std::mt19937_64 rng(42);
+	std::vector<NumericSeries::Span> spans;
+	size_t mismatches = 0;
+	double checkedSeconds = 0;
+	const auto start = Clock::now();
+	for (size_t query = 0; query < QUERIES; query++) {
+		// Zoom levels from the whole series down to a few columns' worth of values
+		const size_t length = std::max<size_t>(1, size_t(double(series.size()) / std::pow(2.0, double(rng() % 24))));
+		const size_t first = rng() % (series.size() - std::min(length, series.size()) + 1);
+		const size_t last = std::min(series.size(), first + length);
+		series.downsample(first, last, COLUMNS, spans);
+		if (query < CHECKED_QUERIES) {
+			const auto checkStart = Clock::now();
+			for (size_t column = 0; column < COLUMNS; column++) {
+				NumericSeries::Span expected{ std::nan(""), std::nan("") };
+				for (size_t i = first + (last - first) * column / COLUMNS; i < first + (last - first) * (column + 1) / COLUMNS; i++) {
+					expected.min = std::fmin(expected.min, series.value(i));
+					expected.max = std::fmax(expected.max, series.value(i));
+				}
+				auto same = [](double a, double b) { return a == b || (std::isnan(a) && std::isnan(b)); };
+				mismatches += same(spans[column].min, expected.min) && same(spans[column].max, expected.max) ? 0 : 1;
+			}
+			checkedSeconds += std::chrono::duration<double>(Clock::now() - checkStart).count();
+		}
+	}
+	const double seconds = std::chrono::duration<double>(Clock::now() - start).count() - checkedSeconds;
+	out << "  " << QUERIES << " random ranges at " << COLUMNS << " columns: " << seconds * 1000.0 / double(QUERIES)
+		<< " ms per range\n";
+	out << "  " << CHECKED_QUERIES << " ranges checked against a scan: " << mismatches << " mismatched columns\n";
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <ostream>
+#include <string>
+
+// Command-line benchmarks, run with "JsonReader --bench-<name> <file>" instead of opening the window.
+// Each prints a small report to 'out' and returns a process exit code.
+
+// Compares the in-memory and out-of-core (file-backed tape and string buffer) modes: parse time, page faults,
+// and the number of distinct pages touched while browsing (random expand walks) and searching (full string scan).
+int run_locality_benchmark(const std::string& path, std::ostream& out);
+
+// Compares loading with default parser buffers against huge-page, pre-faulted buffers (HugePageAllocator):
+// time and page faults of a first load, which allocates the buffers, and of a second load reusing them.
+int run_hugepage_benchmark(const std::string& path, std::ostream& out);
+
+// Compares reading a file and then parsing it against the overlapped read pipeline (OverlappedReader), with
+// blocking reads and with io_uring, each starting from a cold page cache where the OS allows evicting the file.
+// Files with an NDJSON extension are parsed as NDJSON.
+int run_read_benchmark(const std::string& path, std::ostream& out);
+
+// Extracts a numeric field ("/events/*/latency": "*" marks the array, or the records of an NDJSON file) with one
+// thread and with one per core, then times drawing random zoom and pan ranges from the min/max pyramid
+// (NumericSeries) at a typical chart width, and checks a sample of them against a scan of the values.
+int run_plot_benchmark(const std::string& path, const std::string& fieldPath, std::ostream& out);
@@ -0,0 +1,540 @@
+#include "CompactTree.h"
+#include <algorithm>
+#include <charconv>
+
+namespace {
+
+	// Number of bits covered by one leaf of the range-min tree
+	constexpr uint64_t BLOCK_BITS = 256;
+
+	// Population count of a 64-bit word
+	inline int popcount64(uint64_t x) {
+#if defined(_MSC_VER) && !defined(__clang__)
+		return int(__popcnt64(x));
+#else
+		return __builtin_popcountll(x);
+#endif
+	}
+
+	// Per-byte excess table: the total excess of the 8 parentheses in a byte and the minimum running excess
+	// reached while reading them (LSB first)
+	struct ByteExcessTable {
+		int8_t total[256];
+		int8_t minPrefix[256];
+
+		ByteExcessTable() {
+			for (int byte = 0; byte < 256; byte++) {
+				int excess = 0;
+				int minimum = 8;
+				for (int i = 0; i < 8; i++) {
+					excess += ((byte >> i) & 1) ? 1 : -1;
+					minimum = std::min(minimum, excess);
+				}
+				total[byte] = int8_t(excess);
+				minPrefix[byte] = int8_t(minimum);
+			}
+		}
+	};
+	const ByteExcessTable byteExcess;
+
+	// Characters that may appear between two tokens of a valid JSON document
+	inline bool is_separator(char c) {
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == ',' || c == ':' || c == ']' || c == '}';
+	}
+
+	// Characters that end a number or literal token
+	inline bool is_delimiter(char c) {
+		return is_separator(c) || c == '"' || c == '[' || c == '{';
+	}
+
+	// Appends a code point to 'out' as UTF-8
+	void append_utf8(std::string& out, uint32_t cp) {
+		if (cp < 0x80) {
+			out += char(cp);
+		}
+		else if (cp < 0x800) {
+			out += char(0xC0 | (cp >> 6));
+			out += char(0x80 | (cp & 0x3F));
+		}
+		else if (cp < 0x10000) {
+			out += char(0xE0 | (cp >> 12));
+			out += char(0x80 | ((cp >> 6) & 0x3F));
+			out += char(0x80 | (cp & 0x3F));
+		}
+		else {
+			out += char(0xF0 | (cp >> 18));
+			out += char(0x80 | ((cp >> 12) & 0x3F));
+			out += char(0x80 | ((cp >> 6) & 0x3F));
+			out += char(0x80 | (cp & 0x3F));
+		}
+	}
+
+	// Reads four hex digits at 'p'
+	uint32_t read_hex4(const char* p) {
+		uint32_t value = 0;
+		std::from_chars(p, p + 4, value, 16);
+		return value;
+	}
+
+	// Unescapes the contents of a JSON string literal (without the surrounding quotes)
+	std::string unescape_json_string(std::string_view text) {
+		std::string out;
+		out.reserve(text.size());
+		for (size_t i = 0; i < text.size(); i++) {
+			char c = text[i];
+			if (c != '\\' || i + 1 >= text.size()) {
+				out += c;
+				continue;
+			}
+			char escaped = text[++i];
+			switch (escaped) {
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u': {
+				if (i + 4 >= text.size()) {
+					return out;
+				}
+				uint32_t cp = read_hex4(text.data() + i + 1);
+				i += 4;
+				// Combine UTF-16 surrogate pairs
+				if (cp >= 0xD800 && cp < 0xDC00 && i + 6 < text.size() && text[i + 1] == '\\' && text[i + 2] == 'u') {
+					uint32_t low = read_hex4(text.data() + i + 3);
+					if (low >= 0xDC00 && low < 0xE000) {
+						cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+						i += 6;
+					}
+				}
+				append_utf8(out, cp);
+				break;
+			}
+			default: out += escaped; break;
+			}
+		}
+		return out;
+	}
+
+	// Finds the first leaf at or after 'fromBlock' whose minimum excess is at most 'target'
+	uint64_t search_min_tree(const std::vector<uint32_t>& tree, size_t node, uint64_t lo, uint64_t hi, uint64_t fromBlock, uint32_t target) {
+		if (hi <= fromBlock || tree[node] > target) {
+			return CompactTree::npos;
+		}
+		if (hi - lo == 1) {
+			return lo;
+		}
+		uint64_t mid = lo + (hi - lo) / 2;
+		uint64_t found = search_min_tree(tree, 2 * node, lo, mid, fromBlock, target);
+		if (found != CompactTree::npos) {
+			return found;
+		}
+		return search_min_tree(tree, 2 * node + 1, mid, hi, fromBlock, target);
+	}
+}
+
+namespace {
+
+	// Source over a contiguous buffer, such as a memory-mapped file
+	class PlainSource : public CompactTree::Source {
+	public:
+		explicit PlainSource(std::string_view bytes) : bytes(bytes) {}
+		uint64_t size() const override { return bytes.size(); }
+		Block block_at(uint64_t) const override { return Block{ bytes, 0, nullptr }; }
+
+	private:
+		std::string_view bytes;
+	};
+}
+
+class CompactTree::Cursor {
+public:
+	Cursor(const Source& source, uint64_t offset) : source(source), end(source.size()) { seek(offset); }
+
+	uint64_t offset() const { return pos; }
+	bool at_end() const { return pos >= end; }
+
+	// Current byte; only valid when not at the end
+	char get() const { return block.bytes[size_t(pos - block.start)]; }
+
+	void advance() { seek(pos + 1); }
+
+	void seek(uint64_t offset) {
+		pos = offset;
+		if (pos < end && (pos < block.start || pos - block.start >= block.bytes.size())) {
+			block = source.block_at(pos);
+		}
+	}
+
+	// Moves to the next byte equal to 'a' or 'b', or to the end. Returns false at the end.
+	bool find_either(char a, char b) {
+		while (pos < end) {
+			const std::string_view bytes = block.bytes;
+			for (size_t i = size_t(pos - block.start); i < bytes.size(); i++) {
+				if (bytes[i] == a || bytes[i] == b) {
+					pos = block.start + i;
+					return true;
+				}
+			}
+			seek(block.start + bytes.size());
+		}
+		return false;
+	}
+
+	// Appends the bytes from the current position up to 'until' to 'out'
+	void copy_to(uint64_t until, std::string& out) {
+		while (pos < until && pos < end) {
+			const uint64_t blockEnd = std::min<uint64_t>(block.start + block.bytes.size(), until);
+			out.append(block.bytes.substr(size_t(pos - block.start), size_t(blockEnd - pos)));
+			seek(blockEnd);
+		}
+	}
+
+private:
+	const Source& source;
+	const uint64_t end;
+	uint64_t pos = 0;
+	Source::Block block;
+};
+
+// Method: Builds the balanced parentheses, kinds and sampled offsets by walking the tape and the source in lockstep
+simdjson::error_code CompactTree::build(const simdjson::dom::document& doc, std::string_view input) {
+	using simdjson::internal::JSON_VALUE_MASK;
+
+	*this = CompactTree();
+	source = std::make_shared<PlainSource>(input);
+	const uint64_t* tape = doc.tape.get();
+	if (tape == nullptr) {
+		return simdjson::UNINITIALIZED;
+	}
+	// tape[0] points just past the closing root word, which ends the walk
+	const uint64_t rootEnd = (tape[0] & JSON_VALUE_MASK) - 1;
+
+	// Each open scope remembers whether it is an object and, if so, whether the next string is a key
+	struct Scope {
+		bool isObject;
+		bool expectKey;
+	};
+	std::vector<Scope> scopes;
+
+	Cursor cursor(*source, 0);
+
+	auto push_bit = [&](bool open) {
+		if ((bitCount & 63) == 0) {
+			bits.push_back(0);
+		}
+		if (open) {
+			bits.back() |= uint64_t(1) << (bitCount & 63);
+		}
+		bitCount++;
+	};
+
+	// Appends a node, records its sampled offset and moves 'cursor' past its token
+	auto add_node = [&](NodeKind nodeKind, char expected) {
+		skip_separators(cursor);
+		if (cursor.at_end() || (expected != 0 && cursor.get() != expected)) {
+			return false;
+		}
+		if (nodeCount % OFFSET_SAMPLE_RATE == 0) {
+			sampledOffsets.push_back(cursor.offset());
+		}
+		if (nodeCount % 2 == 0) {
+			kinds.push_back(uint8_t(nodeKind));
+		}
+		else {
+			kinds.back() |= uint8_t(uint8_t(nodeKind) << 4);
+		}
+		nodeCount++;
+		push_bit(true);
+		skip_token(cursor, nodeKind);
+		if (!scopes.empty() && scopes.back().isObject) {
+			scopes.back().expectKey = nodeKind != NodeKind::KEY;
+		}
+		return true;
+	};
+
+	for (uint64_t i = 1; i < rootEnd; ) {
+		const char type = char(tape[i] >> 56);
+		bool ok = true;
+		switch (type) {
+		case '{':
+		case '[':
+			ok = add_node(type == '{' ? NodeKind::OBJECT : NodeKind::ARRAY, type);
+			scopes.push_back({ type == '{', true });
+			i++;
+			break;
+		case '}':
+		case ']':
+			scopes.pop_back();
+			push_bit(false);
+			i++;
+			break;
+		case '"': {
+			bool isKey = !scopes.empty() && scopes.back().isObject && scopes.back().expectKey;
+			ok = add_node(isKey ? NodeKind::KEY : NodeKind::STRING, '"');
+			push_bit(false);
+			i++;
+			break;
+		}
+		case 'l':
+		case 'u':
+		case 'd':
+			ok = add_node(type == 'l' ? NodeKind::INT64 : type == 'u' ? NodeKind::UINT64 : NodeKind::DOUBLE, 0);
+			push_bit(false);
+			i += 2;
+			break;
+		case 't':
+		case 'f':
+		case 'n':
+			ok = add_node(type == 't' ? NodeKind::TRUE_VALUE : type == 'f' ? NodeKind::FALSE_VALUE : NodeKind::NULL_VALUE, type);
+			push_bit(false);
+			i++;
+			break;
+		default:
+			ok = false;
+			break;
+		}
+		if (!ok) {
+			*this = CompactTree();
+			return simdjson::TAPE_ERROR;
+		}
+	}
+
+	// Keep one spare word so that rank queries at the very end stay in bounds
+	bits.push_back(0);
+
+	// Rank directory
+	uint64_t opens = 0;
+	for (size_t w = 0; w < bits.size(); w++) {
+		if (w % 8 == 0) {
+			superRank.push_back(opens);
+		}
+		wordRank.push_back(uint16_t(opens - superRank.back()));
+		opens += uint64_t(popcount64(bits[w]));
+	}
+
+	// Range-min tree: leaves hold the minimum excess reached inside each block
+	leafCount = (bitCount + BLOCK_BITS - 1) / BLOCK_BITS;
+	uint64_t treeLeaves = 1;
+	while (treeLeaves < std::max<uint64_t>(leafCount, 1)) {
+		treeLeaves *= 2;
+	}
+	minTree.assign(2 * treeLeaves, UINT32_MAX);
+	int64_t excess = 0;
+	for (uint64_t block = 0; block < leafCount; block++) {
+		int64_t minimum = INT64_MAX;
+		const uint64_t blockEnd = std::min((block + 1) * BLOCK_BITS, bitCount);
+		for (uint64_t pos = block * BLOCK_BITS; pos < blockEnd; pos++) {
+			excess += bit(pos) ? 1 : -1;
+			minimum = std::min(minimum, excess);
+		}
+		minTree[treeLeaves + block] = uint32_t(minimum);
+	}
+	for (uint64_t node = treeLeaves - 1; node >= 1; node--) {
+		minTree[node] = std::min(minTree[2 * node], minTree[2 * node + 1]);
+	}
+
+	bits.shrink_to_fit();
+	kinds.shrink_to_fit();
+	sampledOffsets.shrink_to_fit();
+	return simdjson::SUCCESS;
+}
+
+// Method: Number of open parentheses strictly before 'pos'
+uint64_t CompactTree::rank1(uint64_t pos) const {
+	const uint64_t word = pos >> 6;
+	const uint64_t mask = (uint64_t(1) << (pos & 63)) - 1;
+	return superRank[word >> 3] + wordRank[word] + uint64_t(popcount64(bits[word] & mask));
+}
+
+// Method: Scans from 'from' to the end of its block for the first position where the excess drops to 'target'.
+// 'excess' is the excess before 'from'. Whole bytes are skipped when they cannot reach the target.
+uint64_t CompactTree::scan_block_for_close(uint64_t from, int64_t excess, int64_t target) const {
+	const uint64_t blockEnd = std::min((from / BLOCK_BITS + 1) * BLOCK_BITS, bitCount);
+	uint64_t pos = from;
+	while (pos < blockEnd) {
+		if ((pos & 7) == 0 && pos + 8 <= blockEnd) {
+			const uint8_t byte = uint8_t(bits[pos >> 6] >> (pos & 63));
+			if (excess + byteExcess.minPrefix[byte] > target) {
+				excess += byteExcess.total[byte];
+				pos += 8;
+				continue;
+			}
+		}
+		excess += bit(pos) ? 1 : -1;
+		if (excess == target) {
+			return pos;
+		}
+		pos++;
+	}
+	return npos;
+}
+
+// Method: Finds the first block at or after 'fromBlock' whose minimum excess is at most 'target'
+uint64_t CompactTree::first_block_at_most(uint64_t fromBlock, uint32_t target) const {
+	if (fromBlock >= leafCount) {
+		return npos;
+	}
+	const uint64_t treeLeaves = minTree.size() / 2;
+	return search_min_tree(minTree, 1, 0, treeLeaves, fromBlock, target);
+}
+
+// Method: Position of the closing parenthesis matching the node's opening parenthesis
+uint64_t CompactTree::find_close(uint64_t node) const {
+	const int64_t target = excess_before(node);
+	uint64_t found = scan_block_for_close(node + 1, target + 1, target);
+	if (found != npos) {
+		return found;
+	}
+	const uint64_t block = first_block_at_most(node / BLOCK_BITS + 1, uint32_t(target));
+	if (block == npos) {
+		return npos;
+	}
+	return scan_block_for_close(block * BLOCK_BITS, excess_before(block * BLOCK_BITS), target);
+}
+
+// Method: First child of a node, or npos for leaves and empty containers
+uint64_t CompactTree::first_child(uint64_t node) const {
+	return node + 1 < bitCount && bit(node + 1) ? node + 1 : npos;
+}
+
+// Method: Next sibling of a node, or npos if it is the last child
+uint64_t CompactTree::next_sibling(uint64_t node) const {
+	const uint64_t next = find_close(node) + 1;
+	return next < bitCount && bit(next) ? next : npos;
+}
+
+CompactTree::NodeKind CompactTree::kind(uint64_t node) const {
+	return kind_at(rank1(node));
+}
+
+// Method: Maps the node kind to the simdjson element type used for display. Keys are reported as strings.
+simdjson::dom::element_type CompactTree::element_type(uint64_t node) const {
+	using simdjson::dom::element_type;
+	switch (kind(node)) {
+	case NodeKind::OBJECT: return element_type::OBJECT;
+	case NodeKind::ARRAY: return element_type::ARRAY;
+	case NodeKind::INT64: return element_type::INT64;
+	case NodeKind::UINT64: return element_type::UINT64;
+	case NodeKind::DOUBLE: return element_type::DOUBLE;
+	case NodeKind::TRUE_VALUE:
+	case NodeKind::FALSE_VALUE: return element_type::BOOL;
+	case NodeKind::NULL_VALUE: return element_type::NULL_VALUE;
+	default: return element_type::STRING;
+	}
+}
+
+bool CompactTree::is_container(uint64_t node) const {
+	const NodeKind nodeKind = kind(node);
+	return nodeKind == NodeKind::OBJECT || nodeKind == NodeKind::ARRAY;
+}
+
+// Method: Skips whitespace, commas, colons and closing brackets
+void CompactTree::skip_separators(Cursor& cursor) {
+	while (!cursor.at_end() && is_separator(cursor.get())) {
+		cursor.advance();
+	}
+}
+
+// Method: Moves the cursor just past the token it is on
+void CompactTree::skip_token(Cursor& cursor, NodeKind nodeKind) {
+	switch (nodeKind) {
+	case NodeKind::OBJECT:
+	case NodeKind::ARRAY:
+		cursor.advance();
+		return;
+	case NodeKind::KEY:
+	case NodeKind::STRING:
+		// Stop after the first quote that is not escaped; an escape always spans two bytes
+		cursor.advance();
+		while (cursor.find_either('"', '\\')) {
+			const bool quote = cursor.get() == '"';
+			cursor.advance();
+			if (quote) {
+				return;
+			}
+			cursor.advance();
+		}
+		return;
+	default:
+		while (!cursor.at_end() && !is_delimiter(cursor.get())) {
+			cursor.advance();
+		}
+		return;
+	}
+}
+
+// Method: Locates a node's token by starting at the nearest sampled offset and skipping forward
+uint64_t CompactTree::token_offset(uint64_t preorder) const {
+	const uint64_t sample = preorder / OFFSET_SAMPLE_RATE;
+	Cursor cursor(*source, sampledOffsets[sample]);
+	for (uint64_t k = sample * OFFSET_SAMPLE_RATE; k < preorder; k++) {
+		skip_token(cursor, kind_at(k));
+		skip_separators(cursor);
+	}
+	return cursor.offset();
+}
+
+std::string CompactTree::raw_token(uint64_t node) const {
+	const uint64_t preorder = rank1(node);
+	const uint64_t start = token_offset(preorder);
+	Cursor cursor(*source, start);
+	skip_token(cursor, kind_at(preorder));
+	const uint64_t end = cursor.offset();
+
+	std::string token;
+	cursor.seek(start);
+	cursor.copy_to(end, token);
+	return token;
+}
+
+// Method: Unescaped contents of a string or key node
+std::string CompactTree::string_value(uint64_t node) const {
+	const std::string token = raw_token(node);
+	if (token.size() < 2) {
+		return std::string();
+	}
+	return unescape_json_string(std::string_view(token).substr(1, token.size() - 2));
+}
+
+// Method: Value text as shown in the tree, formatted the same way as for DOM elements
+std::string CompactTree::display_value(uint64_t node) const {
+	switch (kind(node)) {
+	case NodeKind::OBJECT: return "OBJECT";
+	case NodeKind::ARRAY: return "ARRAY";
+	case NodeKind::TRUE_VALUE: return "true";
+	case NodeKind::FALSE_VALUE: return "false";
+	case NodeKind::NULL_VALUE: return "null";
+	case NodeKind::KEY:
+	case NodeKind::STRING: return string_value(node);
+	case NodeKind::INT64: {
+		const std::string token = raw_token(node);
+		int64_t value = 0;
+		std::from_chars(token.data(), token.data() + token.size(), value);
+		return std::to_string(value);
+	}
+	case NodeKind::UINT64: {
+		const std::string token = raw_token(node);
+		uint64_t value = 0;
+		std::from_chars(token.data(), token.data() + token.size(), value);
+		return std::to_string(value);
+	}
+	case NodeKind::DOUBLE: {
+		const std::string token = raw_token(node);
+		double value = 0;
+		std::from_chars(token.data(), token.data() + token.size(), value);
+		return std::to_string(value);
+	}
+	}
+	return "UNKNOWN_TYPE";
+}
+
+// Method: Bytes held by the tree, excluding the source it references
+size_t CompactTree::memory_usage() const {
+	return bits.capacity() * sizeof(uint64_t)
+		+ superRank.capacity() * sizeof(uint64_t)
+		+ wordRank.capacity() * sizeof(uint16_t)
+		+ minTree.capacity() * sizeof(uint32_t)
+		+ kinds.capacity()
+		+ sampledOffsets.capacity() * sizeof(uint64_t);
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "simdjson.h"
+
+// CompactTree class, a read-only succinct representation of a parsed JSON document used for viewing-only sessions.
+// The structure is stored as a balanced-parentheses bit vector with rank and min-excess directories, node kinds
+// are packed into four bits per node, and values are never copied: every OFFSET_SAMPLE_RATE-th node records its
+// byte offset in the original input and values are re-read from there on demand. This costs roughly one byte per
+// node, compared to 8-16 bytes per node plus a string buffer copy for the simdjson tape.
+class CompactTree
+{
+public:
+    // Byte access to the input the tree was built from. Sources hand out the input in blocks so that it does not
+    // have to be contiguous or even resident (see CompressedSource).
+    class Source {
+    public:
+        // A contiguous run of input bytes starting at 'start'. 'owner' keeps the bytes alive while in use.
+        struct Block {
+            std::string_view bytes;
+            uint64_t start = 0;
+            std::shared_ptr<const void> owner;
+        };
+
+        virtual ~Source() = default;
+        virtual uint64_t size() const = 0;
+
+        // Returns the block containing 'offset', which must be less than size()
+        virtual Block block_at(uint64_t offset) const = 0;
+    };
+
+    // Kinds of nodes kept in the tree. Inside objects every value is preceded by a KEY node.
+    enum class NodeKind : uint8_t {
+        OBJECT, ARRAY, KEY, STRING, INT64, UINT64, DOUBLE, TRUE_VALUE, FALSE_VALUE, NULL_VALUE
+    };
+
+    // Returned by navigation functions when the requested node does not exist
+    static constexpr uint64_t npos = ~uint64_t(0);
+
+    // One byte offset into the input is sampled for every OFFSET_SAMPLE_RATE nodes (in preorder)
+    static constexpr uint64_t OFFSET_SAMPLE_RATE = 32;
+
+    CompactTree() = default;
+
+    // Builds the tree from the tape of a parsed document. 'source' must hold exactly the bytes that were parsed
+    // and must outlive the tree (typically a memory-mapped file), since values are read back from it.
+    simdjson::error_code build(const simdjson::dom::document& doc, std::string_view source);
+
+    // Replaces the source values are read from. The new source must hold the same bytes.
+    void set_source(std::shared_ptr<const Source> newSource) { source = std::move(newSource); }
+    const Source& get_source() const { return *source; }
+
+    // Navigation. A node is identified by the position of its opening parenthesis.
+    uint64_t root() const { return nodeCount ? 0 : npos; }
+    uint64_t first_child(uint64_t node) const;
+    uint64_t next_sibling(uint64_t node) const;
+    uint64_t find_close(uint64_t node) const;
+    uint64_t subtree_size(uint64_t node) const { return (find_close(node) - node + 1) / 2; }
+
+    // Node properties
+    NodeKind kind(uint64_t node) const;
+    simdjson::dom::element_type element_type(uint64_t node) const;
+    bool is_container(uint64_t node) const;
+
+    // Value access. 'raw_token' returns the JSON text of a scalar or key, including quotes for strings.
+    std::string raw_token(uint64_t node) const;
+    std::string string_value(uint64_t node) const;
+    std::string display_value(uint64_t node) const;
+
+    // Statistics
+    uint64_t size() const { return nodeCount; }
+    size_t memory_usage() const;
+
+private:
+    // Balanced parentheses, one bit per parenthesis (1 = open), LSB first within each word
+    std::vector<uint64_t> bits;
+    uint64_t bitCount = 0;
+    uint64_t nodeCount = 0;
+
+    // Rank directory: opens before each 512-bit superblock, and before each word relative to its superblock
+    std::vector<uint64_t> superRank;
+    std::vector<uint16_t> wordRank;
+
+    // Range-min tree over 256-bit blocks holding the minimum excess reached inside each range
+    std::vector<uint32_t> minTree;
+    uint64_t leafCount = 0;
+
+    // Node kinds, two per byte, indexed by preorder number
+    std::vector<uint8_t> kinds;
+
+    // Sampled byte offsets into 'source', one per OFFSET_SAMPLE_RATE nodes in preorder
+    std::vector<uint64_t> sampledOffsets;
+    std::shared_ptr<const Source> source;
+
+    // Sequential reader over the source, crossing block boundaries as needed
+    class Cursor;
+
+    bool bit(uint64_t pos) const { return (bits[pos >> 6] >> (pos & 63)) & 1; }
+    uint64_t rank1(uint64_t pos) const;
+    int64_t excess_before(uint64_t pos) const { return int64_t(2 * rank1(pos)) - int64_t(pos); }
+    uint64_t first_block_at_most(uint64_t fromBlock, uint32_t target) const;
+    uint64_t scan_block_for_close(uint64_t from, int64_t excess, int64_t target) const;
+    NodeKind kind_at(uint64_t preorder) const { return NodeKind((kinds[preorder >> 1] >> ((preorder & 1) * 4)) & 0xF); }
+    uint64_t token_offset(uint64_t preorder) const;
+    static void skip_separators(Cursor& cursor);
+    static void skip_token(Cursor& cursor, NodeKind kind);
+};
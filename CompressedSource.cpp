@@ -0,0 +1,243 @@
+#include "CompressedSource.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+	// LZ4 block format constants: minimum match length, literals required at the end of a block, and the
+	// distance from the end within which no match may start
+	constexpr size_t MIN_MATCH = 4;
+	constexpr size_t LAST_LITERALS = 5;
+	constexpr size_t MATCH_FIND_LIMIT = 12;
+	constexpr size_t MAX_OFFSET = 65535;
+	constexpr int HASH_BITS = 12;
+
+	inline uint32_t read32(const char* p) {
+		uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline uint32_t hash32(uint32_t sequence) {
+		return (sequence * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	// Writes an LZ4 length continuation (a run of 255 bytes and a final remainder)
+	void write_length(std::string& out, size_t length) {
+		while (length >= 255) {
+			out += char(255);
+			length -= 255;
+		}
+		out += char(length);
+	}
+
+	// Greedy single-pass LZ4 block compressor
+	std::string lz4_compress(std::string_view input) {
+		std::string out;
+		out.reserve(input.size() / 2 + 16);
+		const char* src = input.data();
+		const size_t n = input.size();
+
+		auto emit = [&](size_t anchor, size_t literalEnd, size_t offset, size_t matchLength) {
+			const size_t literals = literalEnd - anchor;
+			const size_t matchCode = matchLength ? matchLength - MIN_MATCH : 0;
+			out += char((std::min<size_t>(literals, 15) << 4) | std::min<size_t>(matchCode, 15));
+			if (literals >= 15) {
+				write_length(out, literals - 15);
+			}
+			out.append(src + anchor, literals);
+			if (matchLength) {
+				out += char(offset & 0xFF);
+				out += char(offset >> 8);
+				if (matchCode >= 15) {
+					write_length(out, matchCode - 15);
+				}
+			}
+		};
+
+		size_t anchor = 0;
+		if (n > MATCH_FIND_LIMIT) {
+			std::vector<uint32_t> table(size_t(1) << HASH_BITS, UINT32_MAX);
+			const size_t matchStartLimit = n - MATCH_FIND_LIMIT;
+			const size_t matchEndLimit = n - LAST_LITERALS;
+			size_t ip = 0;
+			while (ip < matchStartLimit) {
+				const uint32_t sequence = read32(src + ip);
+				const uint32_t h = hash32(sequence);
+				const uint32_t ref = table[h];
+				table[h] = uint32_t(ip);
+				if (ref == UINT32_MAX || ip - ref > MAX_OFFSET || read32(src + ref) != sequence) {
+					ip++;
+					continue;
+				}
+				size_t matchLength = MIN_MATCH;
+				while (ip + matchLength < matchEndLimit && src[ref + matchLength] == src[ip + matchLength]) {
+					matchLength++;
+				}
+				emit(anchor, ip, ip - ref, matchLength);
+				ip += matchLength;
+				anchor = ip;
+			}
+		}
+		emit(anchor, n, 0, 0);
+		return out;
+	}
+
+	// LZ4 block decompressor. Returns false if the block is malformed or does not expand to 'out.size()' bytes.
+	bool lz4_decompress(std::string_view input, std::string& out) {
+		const uint8_t* ip = reinterpret_cast<const uint8_t*>(input.data());
+		const uint8_t* const ipEnd = ip + input.size();
+		size_t op = 0;
+
+		auto read_length = [&](size_t length) {
+			if (length != 15) {
+				return length;
+			}
+			uint8_t byte;
+			do {
+				if (ip >= ipEnd) {
+					return SIZE_MAX;
+				}
+				byte = *ip++;
+				length += byte;
+			} while (byte == 255);
+			return length;
+		};
+
+		while (ip < ipEnd) {
+			const uint8_t token = *ip++;
+			const size_t literals = read_length(token >> 4);
+			if (literals == SIZE_MAX || literals > size_t(ipEnd - ip) || literals > out.size() - op) {
+				return false;
+			}
+			std::memcpy(&out[op], ip, literals);
+			ip += literals;
+			op += literals;
+			if (ip == ipEnd) {
+				break;
+			}
+			if (ipEnd - ip < 2) {
+				return false;
+			}
+			const size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+			ip += 2;
+			size_t matchLength = read_length(token & 15);
+			if (matchLength == SIZE_MAX || offset == 0 || offset > op) {
+				return false;
+			}
+			matchLength += MIN_MATCH;
+			if (matchLength > out.size() - op) {
+				return false;
+			}
+			// Byte by byte, since matches may overlap their own output
+			for (size_t i = 0; i < matchLength; i++, op++) {
+				out[op] = out[op - offset];
+			}
+		}
+		return op == out.size();
+	}
+}
+
+CompressedSource::CompressedSource(std::string_view input, size_t blockSize, size_t cacheBlocks)
+	: inputSize(input.size()), blockSize(blockSize), cacheBlocks(std::max<size_t>(cacheBlocks, 1))
+{
+	// Compress blocks in parallel, interleaved across worker threads
+	const size_t blockCount = (input.size() + blockSize - 1) / blockSize;
+	std::vector<std::string> blocks(blockCount);
+	const size_t workers = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), blockCount));
+	std::vector<std::thread> threads;
+	for (size_t worker = 0; worker < workers; worker++) {
+		threads.emplace_back([&, worker]() {
+			for (size_t i = worker; i < blockCount; i += workers) {
+				blocks[i] = lz4_compress(input.substr(i * blockSize, blockSize));
+			}
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	// Concatenate, keeping blocks that did not shrink uncompressed
+	size_t total = 0;
+	for (size_t i = 0; i < blockCount; i++) {
+		total += std::min(blocks[i].size(), input.substr(i * blockSize, blockSize).size());
+	}
+	compressed.reserve(total);
+	blockOffsets.reserve(blockCount + 1);
+	blockStored.reserve(blockCount);
+	for (size_t i = 0; i < blockCount; i++) {
+		const std::string_view raw = input.substr(i * blockSize, blockSize);
+		const bool stored = blocks[i].size() >= raw.size();
+		blockOffsets.push_back(compressed.size());
+		blockStored.push_back(stored);
+		if (stored) {
+			compressed.append(raw);
+		}
+		else {
+			compressed.append(blocks[i]);
+		}
+		std::string().swap(blocks[i]);
+	}
+	blockOffsets.push_back(compressed.size());
+}
+
+// Method: Returns the decompressed block containing 'offset', from the LRU or by decompressing it
+CompactTree::Source::Block CompressedSource::block_at(uint64_t offset) const {
+	const uint64_t index = offset / blockSize;
+	const uint64_t start = index * blockSize;
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	useCounter++;
+	for (CachedBlock& cached : cache) {
+		if (cached.index == index) {
+			cached.lastUse = useCounter;
+			hits++;
+			return Block{ *cached.bytes, start, cached.bytes };
+		}
+	}
+	misses++;
+
+	const std::string_view packed(compressed.data() + blockOffsets[index], size_t(blockOffsets[index + 1] - blockOffsets[index]));
+	auto bytes = std::make_shared<std::string>(size_t(std::min<uint64_t>(blockSize, inputSize - start)), '\0');
+	if (blockStored[index]) {
+		bytes->assign(packed);
+	}
+	else if (!lz4_decompress(packed, *bytes)) {
+		// Blocks come from the constructor, so this only guards against corruption; blanks read as separators
+		bytes->assign(bytes->size(), ' ');
+	}
+
+	// Replace the least recently used block once the cache is full
+	if (cache.size() < cacheBlocks) {
+		cache.push_back({ index, bytes, useCounter });
+	}
+	else {
+		auto oldest = std::min_element(cache.begin(), cache.end(), [](const CachedBlock& a, const CachedBlock& b) {
+			return a.lastUse < b.lastUse;
+		});
+		*oldest = { index, bytes, useCounter };
+	}
+	return Block{ *bytes, start, bytes };
+}
+
+uint64_t CompressedSource::cache_hits() const {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	return hits;
+}
+
+uint64_t CompressedSource::cache_misses() const {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	return misses;
+}
+
+// Method: Empties the LRU. Blocks still in use by a caller stay alive through their shared pointer.
+size_t CompressedSource::trim_cache() const {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	size_t bytes = 0;
+	for (const CachedBlock& cached : cache) {
+		bytes += cached.bytes->size();
+	}
+	cache.clear();
+	return bytes;
+}
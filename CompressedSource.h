@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "CompactTree.h"
+
+// CompressedSource class, a CompactTree source that keeps the input in independently compressed blocks.
+// Blocks are compressed in parallel with an LZ4-compatible block codec and decompressed on demand for rendering,
+// searching and export; a small LRU of recently used decompressed blocks keeps scrolling cheap. For documents
+// dominated by long string payloads this replaces the resident input with a fraction of its size.
+class CompressedSource : public CompactTree::Source
+{
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+    static constexpr size_t DEFAULT_CACHE_BLOCKS = 16;
+
+    // Compresses 'input', which is not referenced afterwards
+    explicit CompressedSource(std::string_view input, size_t blockSize = DEFAULT_BLOCK_SIZE, size_t cacheBlocks = DEFAULT_CACHE_BLOCKS);
+
+    uint64_t size() const override { return inputSize; }
+    Block block_at(uint64_t offset) const override;
+
+    // Statistics
+    size_t compressed_bytes() const { return compressed.size() + blockOffsets.size() * sizeof(uint64_t) + blockStored.size(); }
+    uint64_t cache_hits() const;
+    uint64_t cache_misses() const;
+
+    // Drops the decompressed blocks, which are decompressed again when next read. Returns the bytes released.
+    size_t trim_cache() const;
+
+private:
+    uint64_t inputSize = 0;
+    size_t blockSize;
+    size_t cacheBlocks;
+
+    // All blocks back to back; block i spans [blockOffsets[i], blockOffsets[i + 1]) and is stored as-is if it
+    // did not compress
+    std::string compressed;
+    std::vector<uint64_t> blockOffsets;
+    std::vector<uint8_t> blockStored;
+
+    // LRU of decompressed blocks
+    struct CachedBlock {
+        uint64_t index;
+        std::shared_ptr<const std::string> bytes;
+        uint64_t lastUse;
+    };
+    mutable std::mutex cacheMutex;
+    mutable std::vector<CachedBlock> cache;
+    mutable uint64_t useCounter = 0;
+    mutable uint64_t hits = 0;
+    mutable uint64_t misses = 0;
+};
@@ -0,0 +1,392 @@
+#include "DocumentMinimap.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+	using simdjson::internal::JSON_VALUE_MASK;
+
+	// Estimated width of a double written out; the tape keeps its value, not its digits
+	constexpr uint64_t DOUBLE_BYTES = 10;
+
+	// Tape words scanned between checks of the cancellation flag
+	constexpr uint64_t CANCEL_CHECK_INTERVAL = 65536;
+
+	uint64_t digits(uint64_t value) {
+		uint64_t count = 1;
+		while (value >= 10) {
+			value /= 10;
+			count++;
+		}
+		return count;
+	}
+
+	inline char lower(char c) {
+		return c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c;
+	}
+
+	bool contains(std::string_view text, std::string_view needle, bool caseSensitive) {
+		if (caseSensitive) {
+			return text.find(needle) != std::string_view::npos;
+		}
+		return std::search(text.begin(), text.end(), needle.begin(), needle.end(), [](char a, char b) { return lower(a) == b; }) != text.end();
+	}
+
+	std::string escape_token(std::string_view key) {
+		std::string token;
+		for (const char c : key) {
+			if (c == '~') {
+				token += "~0";
+			}
+			else if (c == '/') {
+				token += "~1";
+			}
+			else {
+				token += c;
+			}
+		}
+		return token;
+	}
+
+	// Reads a pointer token as an array index: digits without leading zeros
+	bool parse_index(std::string_view token, uint64_t& index) {
+		if (token.empty() || token.size() > 19 || (token.size() > 1 && token[0] == '0')) {
+			return false;
+		}
+		index = 0;
+		for (const char c : token) {
+			if (c < '0' || c > '9') {
+				return false;
+			}
+			index = index * 10 + uint64_t(c - '0');
+		}
+		return true;
+	}
+}
+
+uint64_t DocumentMinimap::after(uint64_t index) const {
+	const uint64_t word = document->tape[index];
+	switch (char(word >> 56)) {
+	case '{':
+	case '[':
+		return uint32_t(word);
+	case 'l':
+	case 'u':
+	case 'd':
+		return index + 2;
+	default:
+		return index + 1;
+	}
+}
+
+std::string_view DocumentMinimap::string_at(uint64_t index) const {
+	const uint8_t* text = document->string_buf.get() + (document->tape[index] & JSON_VALUE_MASK);
+	uint32_t length;
+	std::memcpy(&length, text, sizeof(length));
+	return std::string_view(reinterpret_cast<const char*>(text + sizeof(length)), length);
+}
+
+// Method: Walks the tape once, adding up the bytes each word would take written minified. Buckets are sized for the
+// hint and merged at the end if the document turned out larger.
+simdjson::error_code DocumentMinimap::build(const simdjson::dom::document& doc, uint64_t sizeHint) {
+	const auto start = std::chrono::steady_clock::now();
+	*this = DocumentMinimap();
+	const uint64_t* tape = doc.tape.get();
+	if (tape == nullptr) {
+		return simdjson::UNINITIALIZED;
+	}
+	document = &doc;
+	const uint64_t rootEnd = (tape[0] & JSON_VALUE_MASK) - 1;
+	const uint64_t hint = std::max<uint64_t>(sizeHint != 0 ? sizeHint : rootEnd * 8, 1);
+	bucketSize = (hint + BUCKETS - 1) / BUCKETS;
+
+	// Each open scope remembers whether it is an object, whether the next string is a key, and whether a separator
+	// comes before the next entry
+	struct Scope {
+		bool isObject;
+		bool expectKey;
+		bool first;
+	};
+	std::vector<Scope> scopes;
+	uint64_t offset = 0;
+
+	auto begin_value = [&](uint64_t index) {
+		if (!scopes.empty()) {
+			Scope& scope = scopes.back();
+			if (scope.isObject) {
+				scope.expectKey = true;
+			}
+			else {
+				offset += scope.first ? 0 : 1;
+				scope.first = false;
+			}
+		}
+		const size_t bucket = size_t(offset / bucketSize);
+		while (bucketList.size() <= bucket) {
+			bucketList.emplace_back();
+			bucketList.back().tapeIndex = index;
+		}
+		Bucket& current = bucketList[bucket];
+		current.nodes++;
+		current.maxDepth = std::max(current.maxDepth, uint32_t(scopes.size()));
+		current.depthSum += scopes.size();
+	};
+
+	for (uint64_t i = 1; i < rootEnd; ) {
+		const char type = char(tape[i] >> 56);
+		switch (type) {
+		case '{':
+		case '[':
+			begin_value(i);
+			scopes.push_back({ type == '{', true, true });
+			offset++;
+			i++;
+			break;
+		case '}':
+		case ']':
+			if (scopes.empty()) {
+				return simdjson::TAPE_ERROR;
+			}
+			scopes.pop_back();
+			offset++;
+			i++;
+			break;
+		case '"': {
+			const uint64_t length = string_at(i).size();
+			if (!scopes.empty() && scopes.back().isObject && scopes.back().expectKey) {
+				Scope& scope = scopes.back();
+				offset += (scope.first ? 0 : 1) + length + 3;
+				scope.first = false;
+				scope.expectKey = false;
+			}
+			else {
+				begin_value(i);
+				offset += length + 2;
+			}
+			i++;
+			break;
+		}
+		case 'l': {
+			begin_value(i);
+			const int64_t value = int64_t(tape[i + 1]);
+			offset += value < 0 ? 1 + digits(0 - uint64_t(value)) : digits(uint64_t(value));
+			i += 2;
+			break;
+		}
+		case 'u':
+			begin_value(i);
+			offset += digits(tape[i + 1]);
+			i += 2;
+			break;
+		case 'd':
+			begin_value(i);
+			offset += DOUBLE_BYTES;
+			i += 2;
+			break;
+		case 't':
+		case 'n':
+			begin_value(i);
+			offset += 4;
+			i++;
+			break;
+		case 'f':
+			begin_value(i);
+			offset += 5;
+			i++;
+			break;
+		default:
+			*this = DocumentMinimap();
+			return simdjson::TAPE_ERROR;
+		}
+	}
+	totalBytes = offset;
+	while (bucketList.size() * bucketSize < totalBytes) {
+		bucketList.emplace_back();
+		bucketList.back().tapeIndex = rootEnd;
+	}
+
+	// Merges runs of buckets when the document is larger than the hint
+	if (bucketList.size() > BUCKETS) {
+		const size_t factor = (bucketList.size() + BUCKETS - 1) / BUCKETS;
+		std::vector<Bucket> merged;
+		for (size_t i = 0; i < bucketList.size(); i += factor) {
+			Bucket bucket = bucketList[i];
+			for (size_t j = i + 1; j < std::min(i + factor, bucketList.size()); j++) {
+				bucket.nodes += bucketList[j].nodes;
+				bucket.maxDepth = std::max(bucket.maxDepth, bucketList[j].maxDepth);
+				bucket.depthSum += bucketList[j].depthSum;
+			}
+			merged.push_back(bucket);
+		}
+		bucketList = std::move(merged);
+		bucketSize *= factor;
+	}
+	for (const Bucket& bucket : bucketList) {
+		maxNodes = std::max(maxNodes, bucket.nodes);
+		maxDepth = std::max(maxDepth, bucket.maxDepth);
+	}
+	elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return simdjson::SUCCESS;
+}
+
+// Method: Buckets without a value of their own hold the index of the next one, so the last bucket whose index is
+// not past 'tapeIndex' is the one where it starts
+size_t DocumentMinimap::bucket_of(uint64_t tapeIndex) const {
+	const auto found = std::upper_bound(bucketList.begin(), bucketList.end(), tapeIndex, [](uint64_t index, const Bucket& bucket) {
+		return index < bucket.tapeIndex;
+	});
+	return found == bucketList.begin() ? 0 : size_t(found - bucketList.begin() - 1);
+}
+
+bool DocumentMinimap::value_range(std::string_view pointer, uint64_t& start, uint64_t& end) const {
+	if (document == nullptr || (!pointer.empty() && pointer[0] != '/')) {
+		return false;
+	}
+	uint64_t current = 1;
+	size_t position = 0;
+	while (position < pointer.size()) {
+		size_t next = pointer.find('/', position + 1);
+		if (next == std::string_view::npos) {
+			next = pointer.size();
+		}
+		std::string token;
+		for (size_t i = position + 1; i < next; i++) {
+			if (pointer[i] == '~' && i + 1 < next && (pointer[i + 1] == '0' || pointer[i + 1] == '1')) {
+				token += pointer[++i] == '1' ? '/' : '~';
+			}
+			else {
+				token += pointer[i];
+			}
+		}
+		position = next;
+
+		const char type = char(document->tape[current] >> 56);
+		const uint64_t close = after(current) - 1;
+		uint64_t child = 0;
+		if (type == '{') {
+			for (uint64_t i = current + 1; i < close; i = after(i + 1)) {
+				if (string_at(i) == token) {
+					child = i + 1;
+					break;
+				}
+			}
+		}
+		else if (type == '[') {
+			uint64_t index;
+			if (!parse_index(token, index)) {
+				return false;
+			}
+			uint64_t i = current + 1;
+			for (; i < close && index > 0; index--) {
+				i = after(i);
+			}
+			child = i < close ? i : 0;
+		}
+		if (child == 0) {
+			return false;
+		}
+		current = child;
+	}
+	start = current;
+	end = after(current);
+	return true;
+}
+
+std::string DocumentMinimap::pointer_at(size_t bucket) const {
+	std::string pointer;
+	if (document == nullptr || bucket >= bucketList.size()) {
+		return pointer;
+	}
+	const uint64_t target = bucketList[bucket].tapeIndex;
+	uint64_t current = 1;
+	while (current != target) {
+		const char type = char(document->tape[current] >> 56);
+		const uint64_t close = after(current) - 1;
+		uint64_t child = 0;
+		if (type == '{') {
+			for (uint64_t i = current + 1; i < close && child == 0; i = after(i + 1)) {
+				if (i + 1 <= target && target < after(i + 1)) {
+					pointer += "/" + escape_token(string_at(i));
+					child = i + 1;
+				}
+			}
+		}
+		else if (type == '[') {
+			uint64_t index = 0;
+			for (uint64_t i = current + 1; i < close && child == 0; i = after(i), index++) {
+				if (i <= target && target < after(i)) {
+					pointer += "/" + std::to_string(index);
+					child = i;
+				}
+			}
+		}
+		if (child == 0) {
+			break;
+		}
+		current = child;
+	}
+	return pointer;
+}
+
+// Method: Scans the tape in order, moving to the next bucket as its first value is reached. Numbers are only
+// formatted when the text could be part of one.
+std::vector<uint32_t> DocumentMinimap::count_hits(std::string_view text, bool caseSensitive, const std::atomic<bool>& cancelled) const {
+	std::vector<uint32_t> hits(bucketList.size(), 0);
+	if (document == nullptr || text.empty() || bucketList.empty()) {
+		return hits;
+	}
+	std::string needle(text);
+	if (!caseSensitive) {
+		std::transform(needle.begin(), needle.end(), needle.begin(), lower);
+	}
+	const bool numeric = needle.find_first_not_of("0123456789.-") == std::string::npos;
+	const bool matchesTrue = contains("true", needle, caseSensitive);
+	const bool matchesFalse = contains("false", needle, caseSensitive);
+	const bool matchesNull = contains("null", needle, caseSensitive);
+
+	const uint64_t* tape = document->tape.get();
+	const uint64_t rootEnd = (tape[0] & JSON_VALUE_MASK) - 1;
+	size_t bucket = 0;
+	for (uint64_t i = 1; i < rootEnd; ) {
+		if (i % CANCEL_CHECK_INTERVAL < 2 && cancelled.load(std::memory_order_relaxed)) {
+			return {};
+		}
+		while (bucket + 1 < bucketList.size() && bucketList[bucket + 1].tapeIndex <= i) {
+			bucket++;
+		}
+		bool hit = false;
+		const char type = char(tape[i] >> 56);
+		switch (type) {
+		case '"':
+			hit = contains(string_at(i), needle, caseSensitive);
+			break;
+		case 'l':
+			hit = numeric && contains(std::to_string(int64_t(tape[i + 1])), needle, true);
+			break;
+		case 'u':
+			hit = numeric && contains(std::to_string(tape[i + 1]), needle, true);
+			break;
+		case 'd': {
+			double value;
+			std::memcpy(&value, &tape[i + 1], sizeof(value));
+			hit = numeric && contains(std::to_string(value), needle, true);
+			break;
+		}
+		case 't':
+			hit = matchesTrue;
+			break;
+		case 'f':
+			hit = matchesFalse;
+			break;
+		case 'n':
+			hit = matchesNull;
+			break;
+		default:
+			break;
+		}
+		hits[bucket] += hit ? 1 : 0;
+		i += type == 'l' || type == 'u' || type == 'd' ? 2 : 1;
+	}
+	return hits;
+}
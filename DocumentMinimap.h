@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "simdjson.h"
+
+// DocumentMinimap class, aggregates of a parsed document over its byte range, for a minimap of its structure. The
+// range is that of the document written minified, estimated from the tape (string lengths, number digits and
+// punctuation), which follows the file closely enough to place things without reading it again. One pass over the
+// tape fills at most BUCKETS buckets with the number of values starting in each and their depth, so that a view can
+// be drawn from a few kilobytes whatever the size of the document. Values are located by their tape index, which
+// JSON Pointers are resolved to and back without a DOM.
+class DocumentMinimap
+{
+public:
+    // Largest number of buckets; smaller documents get fewer, down to a byte each
+    static constexpr size_t BUCKETS = 1024;
+
+    // A bucket: the tape index of the first value starting in it (or of the next value, if none does), the number
+    // of values starting in it, and their greatest and summed depth (the root is at depth 0)
+    struct Bucket {
+        uint64_t tapeIndex = 0;
+        uint32_t nodes = 0;
+        uint32_t maxDepth = 0;
+        uint64_t depthSum = 0;
+    };
+
+    // Aggregates the tape of 'doc', which must stay valid while the minimap is used. 'sizeHint' is the expected
+    // size (that of the file, for instance), which only saves merging buckets at the end when close.
+    simdjson::error_code build(const simdjson::dom::document& doc, uint64_t sizeHint = 0);
+
+    const std::vector<Bucket>& buckets() const { return bucketList; }
+
+    // Estimated size of the document written minified, and bytes per bucket
+    uint64_t bytes() const { return totalBytes; }
+    uint64_t bucket_bytes() const { return bucketSize; }
+
+    // Largest aggregates of a bucket, for scaling
+    uint32_t max_nodes() const { return maxNodes; }
+    uint32_t max_depth() const { return maxDepth; }
+
+    // The bucket in which the value at a tape index starts
+    size_t bucket_of(uint64_t tapeIndex) const;
+
+    // The tape range [start, end) of the value at a JSON Pointer; false if there is none
+    bool value_range(std::string_view pointer, uint64_t& start, uint64_t& end) const;
+
+    // JSON Pointer of the first value starting in a bucket, or of the value spanning it
+    std::string pointer_at(size_t bucket) const;
+
+    // Values whose text as shown in the tree (keys, strings, numbers and literals) contains 'text', per bucket.
+    // Case-insensitive matching folds ASCII only. Returns an empty list if 'cancelled' is set meanwhile.
+    std::vector<uint32_t> count_hits(std::string_view text, bool caseSensitive, const std::atomic<bool>& cancelled) const;
+
+    // Duration of the build in seconds
+    double seconds() const { return elapsed; }
+
+private:
+    const simdjson::dom::document* document = nullptr;
+    std::vector<Bucket> bucketList;
+    uint64_t totalBytes = 0;
+    uint64_t bucketSize = 1;
+    uint32_t maxNodes = 0;
+    uint32_t maxDepth = 0;
+    double elapsed = 0;
+
+    // Tape index following the value at 'index'
+    uint64_t after(uint64_t index) const;
+
+    // The string of a string word of the tape
+    std::string_view string_at(uint64_t index) const;
+};
@@ -0,0 +1,557 @@
+#include "EmbeddedJson.h"
+#include <algorithm>
+#include <array>
+#include <functional>
+
+namespace {
+
+	bool is_blank(char c) {
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	std::string_view trim(std::string_view text) {
+		while (!text.empty() && is_blank(text.front())) {
+			text.remove_prefix(1);
+		}
+		while (!text.empty() && is_blank(text.back())) {
+			text.remove_suffix(1);
+		}
+		return text;
+	}
+
+	// Value of a base64 digit (standard or URL-safe alphabet), or -1
+	int base64_digit(char c) {
+		if (c >= 'A' && c <= 'Z') return c - 'A';
+		if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+		if (c >= '0' && c <= '9') return c - '0' + 52;
+		if (c == '+' || c == '-') return 62;
+		if (c == '/' || c == '_') return 63;
+		return -1;
+	}
+
+	// Whether 'text', trimmed, starts and ends like an object or an array. The character after an opening brace
+	// must start a key and the one after a bracket a value, which sets apart log prefixes such as "[INFO] ... [ok]".
+	bool looks_like_container(std::string_view text) {
+		text = trim(text);
+		if (text.size() < 2) {
+			return false;
+		}
+		const std::string_view inner = trim(text.substr(1, text.size() - 2));
+		const char next = inner.empty() ? '\0' : inner.front();
+		if (text.front() == '{' && text.back() == '}') {
+			return inner.empty() || next == '"';
+		}
+		if (text.front() == '[' && text.back() == ']') {
+			return inner.empty() || std::string_view("{[\"-0123456789tfn").find(next) != std::string_view::npos;
+		}
+		return false;
+	}
+
+	const std::array<uint32_t, 256>& crc_table() {
+		static const std::array<uint32_t, 256> table = []() {
+			std::array<uint32_t, 256> entries{};
+			for (uint32_t n = 0; n < 256; n++) {
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++) {
+					c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				}
+				entries[n] = c;
+			}
+			return entries;
+		}();
+		return table;
+	}
+
+	uint32_t crc32(std::string_view data) {
+		const auto& table = crc_table();
+		uint32_t c = 0xFFFFFFFFu;
+		for (unsigned char byte : data) {
+			c = table[(c ^ byte) & 0xFF] ^ (c >> 8);
+		}
+		return c ^ 0xFFFFFFFFu;
+	}
+
+	// Inflater class, a DEFLATE (RFC 1951) decoder with canonical Huffman tables decoded a bit at a time, as in
+	// zlib's reference decoder "puff"
+	class Inflater {
+	public:
+		Inflater(std::string_view in, std::string& out, size_t limit) : in(in), out(out), limit(limit) {}
+
+		// Returns SUCCESS, INCORRECT_TYPE for corrupt data or CAPACITY past the limit; 'consumed' is set to the
+		// bytes of input read
+		simdjson::error_code run(size_t& consumed) {
+			bool last;
+			do {
+				last = bits(1) == 1;
+				const int type = bits(2);
+				if (type == 0) {
+					stored();
+				}
+				else if (type == 1) {
+					fixed();
+				}
+				else if (type == 2) {
+					dynamic();
+				}
+				else {
+					error = simdjson::INCORRECT_TYPE;
+				}
+			} while (!last && !error);
+			consumed = position;
+			return error;
+		}
+
+	private:
+		static constexpr int MAX_BITS = 15;
+
+		struct Huffman {
+			std::array<short, MAX_BITS + 1> count{};
+			std::array<short, 288> symbol{};
+		};
+
+		std::string_view in;
+		std::string& out;
+		size_t limit;
+		size_t position = 0;
+		uint32_t bitBuffer = 0;
+		int bitCount = 0;
+		simdjson::error_code error = simdjson::SUCCESS;
+
+		int bits(int need) {
+			uint32_t value = bitBuffer;
+			while (bitCount < need) {
+				if (position >= in.size()) {
+					error = simdjson::INCORRECT_TYPE;
+					return 0;
+				}
+				value |= uint32_t(static_cast<unsigned char>(in[position++])) << bitCount;
+				bitCount += 8;
+			}
+			bitBuffer = value >> need;
+			bitCount -= need;
+			return int(value & ((1u << need) - 1));
+		}
+
+		bool put(char c) {
+			if (out.size() >= limit) {
+				error = simdjson::CAPACITY;
+				return false;
+			}
+			out += c;
+			return true;
+		}
+
+		void stored() {
+			bitBuffer = 0;
+			bitCount = 0;
+			if (position + 4 > in.size()) {
+				error = simdjson::INCORRECT_TYPE;
+				return;
+			}
+			const unsigned length = static_cast<unsigned char>(in[position]) | (static_cast<unsigned char>(in[position + 1]) << 8);
+			const unsigned check = static_cast<unsigned char>(in[position + 2]) | (static_cast<unsigned char>(in[position + 3]) << 8);
+			position += 4;
+			if (length != (~check & 0xFFFF) || position + length > in.size()) {
+				error = simdjson::INCORRECT_TYPE;
+				return;
+			}
+			if (out.size() + length > limit) {
+				error = simdjson::CAPACITY;
+				return;
+			}
+			out.append(in.data() + position, length);
+			position += length;
+		}
+
+		// Builds the table for the code lengths of 'n' symbols; false if they are over-subscribed
+		static bool build(Huffman& h, const short* lengths, int n) {
+			h.count.fill(0);
+			for (int s = 0; s < n; s++) {
+				h.count[lengths[s]]++;
+			}
+			if (h.count[0] == n) {
+				return true;
+			}
+			int left = 1;
+			for (int len = 1; len <= MAX_BITS; len++) {
+				left <<= 1;
+				left -= h.count[len];
+				if (left < 0) {
+					return false;
+				}
+			}
+			std::array<short, MAX_BITS + 1> offsets{};
+			for (int len = 1; len < MAX_BITS; len++) {
+				offsets[len + 1] = short(offsets[len] + h.count[len]);
+			}
+			for (int s = 0; s < n; s++) {
+				if (lengths[s] != 0) {
+					h.symbol[offsets[lengths[s]]++] = short(s);
+				}
+			}
+			return true;
+		}
+
+		int decode(const Huffman& h) {
+			int code = 0, first = 0, index = 0;
+			for (int len = 1; len <= MAX_BITS; len++) {
+				code |= bits(1);
+				if (error) {
+					return -1;
+				}
+				const int count = h.count[len];
+				if (code - count < first) {
+					return h.symbol[index + (code - first)];
+				}
+				index += count;
+				first += count;
+				first <<= 1;
+				code <<= 1;
+			}
+			error = simdjson::INCORRECT_TYPE;
+			return -1;
+		}
+
+		void codes(const Huffman& lengthCodes, const Huffman& distanceCodes) {
+			static const short lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+			static const short lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+			static const short distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+			static const short distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+			while (!error) {
+				int symbol = decode(lengthCodes);
+				if (symbol < 0) {
+					return;
+				}
+				if (symbol < 256) {
+					if (!put(char(symbol))) {
+						return;
+					}
+					continue;
+				}
+				if (symbol == 256) {
+					return;
+				}
+				symbol -= 257;
+				if (symbol >= 29) {
+					error = simdjson::INCORRECT_TYPE;
+					return;
+				}
+				const int length = lengthBase[symbol] + bits(lengthExtra[symbol]);
+				const int distanceSymbol = decode(distanceCodes);
+				if (distanceSymbol < 0 || distanceSymbol >= 30) {
+					error = simdjson::INCORRECT_TYPE;
+					return;
+				}
+				const size_t distance = size_t(distanceBase[distanceSymbol] + bits(distanceExtra[distanceSymbol]));
+				if (error || distance > out.size()) {
+					error = error ? error : simdjson::INCORRECT_TYPE;
+					return;
+				}
+				for (int i = 0; i < length; i++) {
+					if (!put(out[out.size() - distance])) {
+						return;
+					}
+				}
+			}
+		}
+
+		void fixed() {
+			static Huffman lengthCodes, distanceCodes;
+			static const bool built = []() {
+				short lengths[288];
+				int s = 0;
+				for (; s < 144; s++) lengths[s] = 8;
+				for (; s < 256; s++) lengths[s] = 9;
+				for (; s < 280; s++) lengths[s] = 7;
+				for (; s < 288; s++) lengths[s] = 8;
+				build(lengthCodes, lengths, 288);
+				for (s = 0; s < 30; s++) lengths[s] = 5;
+				build(distanceCodes, lengths, 30);
+				return true;
+			}();
+			(void)built;
+			codes(lengthCodes, distanceCodes);
+		}
+
+		void dynamic() {
+			static const short order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+			const int lengthCount = bits(5) + 257;
+			const int distanceCount = bits(5) + 1;
+			const int codeCount = bits(4) + 4;
+			if (error || lengthCount > 286 || distanceCount > 30) {
+				error = simdjson::INCORRECT_TYPE;
+				return;
+			}
+			short lengths[320] = {};
+			for (int i = 0; i < codeCount; i++) {
+				lengths[order[i]] = short(bits(3));
+			}
+			Huffman lengthCodes, distanceCodes;
+			if (error || !build(lengthCodes, lengths, 19)) {
+				error = simdjson::INCORRECT_TYPE;
+				return;
+			}
+			int index = 0;
+			while (index < lengthCount + distanceCount && !error) {
+				int symbol = decode(lengthCodes);
+				if (symbol < 0) {
+					return;
+				}
+				if (symbol < 16) {
+					lengths[index++] = short(symbol);
+					continue;
+				}
+				short repeated = 0;
+				int times;
+				if (symbol == 16) {
+					if (index == 0) {
+						error = simdjson::INCORRECT_TYPE;
+						return;
+					}
+					repeated = lengths[index - 1];
+					times = 3 + bits(2);
+				}
+				else if (symbol == 17) {
+					times = 3 + bits(3);
+				}
+				else {
+					times = 11 + bits(7);
+				}
+				if (index + times > lengthCount + distanceCount) {
+					error = simdjson::INCORRECT_TYPE;
+					return;
+				}
+				while (times--) {
+					lengths[index++] = repeated;
+				}
+			}
+			if (error || lengths[256] == 0 || !build(lengthCodes, lengths, lengthCount) || !build(distanceCodes, lengths + lengthCount, distanceCount)) {
+				error = error ? error : simdjson::INCORRECT_TYPE;
+				return;
+			}
+			codes(lengthCodes, distanceCodes);
+		}
+	};
+}
+
+bool EmbeddedJson::looks_embedded(std::string_view text, bool unwrap) {
+	if (looks_like_container(text)) {
+		return true;
+	}
+	if (!unwrap || text.size() < MIN_BASE64_LENGTH) {
+		return false;
+	}
+
+	// The first four digits give the first three bytes
+	std::string head;
+	if (!decode_base64(text.substr(0, 4), head) || head.size() < 2) {
+		return false;
+	}
+	const bool gzip = static_cast<unsigned char>(head[0]) == 0x1F && static_cast<unsigned char>(head[1]) == 0x8B;
+	if (!gzip && head[0] != '{' && head[0] != '[') {
+		return false;
+	}
+	size_t end = text.size();
+	while (end > 0 && text[end - 1] == '=') {
+		end--;
+	}
+	return text.size() - end <= 2 && std::all_of(text.begin(), text.begin() + end, [](char c) { return base64_digit(c) >= 0; });
+}
+
+// Method: The cache is looked up by the string's hash, and a hit is confirmed by comparing the string itself, whose
+// copy counts towards the cache's memory; the string is decoded and parsed outside the locks, so that a long parse
+// does not hold up other threads
+simdjson::error_code EmbeddedJson::parse(std::string_view text, bool unwrap, std::shared_ptr<const Document>& document) {
+	const size_t hash = std::hash<std::string_view>()(text);
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+		for (CachedDocument& cached : cache) {
+			if (cached.hash == hash && cached.unwrap == unwrap && cached.text == text) {
+				cached.lastUse = ++useCounter;
+				hits++;
+				document = cached.document;
+				return simdjson::SUCCESS;
+			}
+		}
+		misses++;
+	}
+
+	auto parsed = std::make_shared<Document>();
+	std::string decoded;
+	std::string_view input = trim(text);
+	if (!looks_like_container(input)) {
+		if (!unwrap || !decode_base64(text, decoded)) {
+			return simdjson::INCORRECT_TYPE;
+		}
+		parsed->wrapping |= BASE64;
+		if (decoded.size() >= 2 && static_cast<unsigned char>(decoded[0]) == 0x1F && static_cast<unsigned char>(decoded[1]) == 0x8B) {
+			std::string inflated;
+			simdjson::error_code error = gunzip(decoded, inflated, MAX_DECODED_BYTES);
+			if (error) {
+				return error;
+			}
+			decoded.swap(inflated);
+			parsed->wrapping |= GZIP;
+		}
+		input = decoded;
+	}
+	if (input.size() > MAX_DECODED_BYTES) {
+		return simdjson::CAPACITY;
+	}
+	parsed->decodedBytes = input.size();
+
+	std::unique_ptr<simdjson::dom::parser> parser;
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+		if (!parsers.empty()) {
+			parser = std::move(parsers.back());
+			parsers.pop_back();
+		}
+	}
+	if (!parser) {
+		parser = std::make_unique<simdjson::dom::parser>();
+	}
+	simdjson::dom::element root;
+	simdjson::error_code error = parser->parse(input.data(), input.size(), true).get(root);
+	if (!error && !root.is_object() && !root.is_array()) {
+		error = simdjson::INCORRECT_TYPE;
+	}
+	if (!error) {
+		parsed->doc = std::move(parser->doc);
+		parsed->root = parsed->doc.root();
+		// A moved-from document keeps its capacity, which would keep the parser from allocating a new one
+		simdjson::error_code released = parser->doc.allocate(0);
+		(void)released;
+	}
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+		if (parsers.size() < POOL_SIZE) {
+			parsers.push_back(std::move(parser));
+		}
+	}
+	if (error) {
+		return error;
+	}
+
+	// Cache the document, evicting the least recently used ones past CACHE_BYTES
+	document = parsed;
+	const size_t bytes = document_bytes(parsed->decodedBytes) + text.size();
+	std::string key(text);
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	cache.push_back(CachedDocument{ hash, std::move(key), unwrap, parsed, bytes, ++useCounter });
+	cacheBytes += bytes;
+	while (cacheBytes > CACHE_BYTES && cache.size() > 1) {
+		auto oldest = std::min_element(cache.begin(), cache.end(), [](const CachedDocument& a, const CachedDocument& b) { return a.lastUse < b.lastUse; });
+		cacheBytes -= oldest->bytes;
+		cache.erase(oldest);
+	}
+	return simdjson::SUCCESS;
+}
+
+size_t EmbeddedJson::trim_cache() {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	size_t released = 0;
+	for (auto it = cache.begin(); it != cache.end(); ) {
+		if (it->document.use_count() == 1) {
+			released += it->bytes;
+			cacheBytes -= it->bytes;
+			it = cache.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+	return released;
+}
+
+uint64_t EmbeddedJson::cache_hits() const {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	return hits;
+}
+
+uint64_t EmbeddedJson::cache_misses() const {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	return misses;
+}
+
+bool EmbeddedJson::decode_base64(std::string_view text, std::string& out) {
+	out.clear();
+	size_t end = text.size();
+	while (end > 0 && text[end - 1] == '=') {
+		end--;
+	}
+	if (text.size() - end > 2 || end % 4 == 1) {
+		return false;
+	}
+	out.reserve(end * 3 / 4);
+	uint32_t accumulator = 0;
+	int pending = 0;
+	for (size_t i = 0; i < end; i++) {
+		const int digit = base64_digit(text[i]);
+		if (digit < 0) {
+			return false;
+		}
+		accumulator = (accumulator << 6) | uint32_t(digit);
+		pending += 6;
+		if (pending >= 8) {
+			pending -= 8;
+			out += char((accumulator >> pending) & 0xFF);
+		}
+	}
+	return true;
+}
+
+// Method: Skips the optional header fields, inflates the members and checks the CRC and size in their trailers
+simdjson::error_code EmbeddedJson::gunzip(std::string_view data, std::string& out, size_t limit) {
+	out.clear();
+	size_t position = 0;
+	while (position < data.size()) {
+		std::string_view member = data.substr(position);
+		if (member.size() < 18 || static_cast<unsigned char>(member[0]) != 0x1F || static_cast<unsigned char>(member[1]) != 0x8B || member[2] != 8) {
+			return simdjson::INCORRECT_TYPE;
+		}
+		const unsigned flags = static_cast<unsigned char>(member[3]);
+		size_t header = 10;
+		if (flags & 4) {
+			if (header + 2 > member.size()) {
+				return simdjson::INCORRECT_TYPE;
+			}
+			header += 2 + (static_cast<unsigned char>(member[header]) | (static_cast<unsigned char>(member[header + 1]) << 8));
+		}
+		for (unsigned field : { 8u, 16u }) {
+			if (flags & field) {
+				const size_t zero = member.find('\0', header);
+				if (zero == std::string_view::npos) {
+					return simdjson::INCORRECT_TYPE;
+				}
+				header = zero + 1;
+			}
+		}
+		header += flags & 2 ? 2 : 0;
+		if (header >= member.size()) {
+			return simdjson::INCORRECT_TYPE;
+		}
+
+		const size_t start = out.size();
+		size_t consumed = 0;
+		Inflater inflater(member.substr(header), out, limit);
+		simdjson::error_code error = inflater.run(consumed);
+		if (error) {
+			return error;
+		}
+		const size_t trailer = header + consumed;
+		if (trailer + 8 > member.size()) {
+			return simdjson::INCORRECT_TYPE;
+		}
+		auto read32 = [&](size_t at) {
+			return uint32_t(static_cast<unsigned char>(member[at])) | uint32_t(static_cast<unsigned char>(member[at + 1])) << 8
+				| uint32_t(static_cast<unsigned char>(member[at + 2])) << 16 | uint32_t(static_cast<unsigned char>(member[at + 3])) << 24;
+		};
+		const std::string_view inflated(out.data() + start, out.size() - start);
+		if (read32(trailer) != crc32(inflated) || read32(trailer + 4) != uint32_t(inflated.size())) {
+			return simdjson::INCORRECT_TYPE;
+		}
+		position += trailer + 8;
+	}
+	return simdjson::SUCCESS;
+}
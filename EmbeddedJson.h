@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "simdjson.h"
+
+// EmbeddedJson class, parses JSON documents held in string values, such as log fields with escaped JSON, so that they
+// can be shown as subtrees. Strings are recognized cheaply when their rows are built (looks_embedded) and parsed only
+// when expanded. Optionally, base64 strings are decoded, and gzip data inside them inflated, before parsing.
+// Parsing reuses a small pool of parsers, whose internal buffers survive from one string to the next, and each
+// document is moved out of its parser into a shared Document. The documents parsed last are cached by content, so
+// that expanding a string again, or an equal string elsewhere, does not parse it again; a Document stays valid while
+// it is referenced, also once evicted.
+class EmbeddedJson
+{
+public:
+    // How the JSON was found in the string, as flags
+    enum Wrapping : uint8_t { PLAIN = 0, BASE64 = 1, GZIP = 2 };
+
+    // Shortest base64 string considered
+    static constexpr size_t MIN_BASE64_LENGTH = 16;
+
+    // Largest decoded document parsed, which also stops gzip data that inflates without bounds
+    static constexpr size_t MAX_DECODED_BYTES = size_t(256) * 1024 * 1024;
+
+    // Memory the cached documents may take, and parsers kept in the pool
+    static constexpr size_t CACHE_BYTES = size_t(64) * 1024 * 1024;
+    static constexpr size_t POOL_SIZE = 2;
+
+    // A parsed document and what was decoded to get to it. 'root' is an object or an array.
+    struct Document {
+        simdjson::dom::document doc;
+        simdjson::dom::element root;
+        uint8_t wrapping = PLAIN;
+        size_t decodedBytes = 0;
+    };
+
+    // Whether a string may hold a JSON object or array: it does if it starts and ends like one, or, with 'unwrap',
+    // if it is base64 whose first bytes start one or a gzip stream. Only the ends of the string are looked at, except
+    // for base64, whose alphabet is checked throughout.
+    static bool looks_embedded(std::string_view text, bool unwrap);
+
+    // Parses the JSON in a string. Returns INCORRECT_TYPE if it does not hold an object or an array, CAPACITY if it
+    // decodes to more than MAX_DECODED_BYTES, or the parse error.
+    simdjson::error_code parse(std::string_view text, bool unwrap, std::shared_ptr<const Document>& document);
+
+    // Drops the cached documents not referenced elsewhere. Returns the bytes released (estimated).
+    size_t trim_cache();
+
+    // Statistics
+    uint64_t cache_hits() const;
+    uint64_t cache_misses() const;
+
+private:
+    // Parsers not in use
+    std::mutex poolMutex;
+    std::vector<std::unique_ptr<simdjson::dom::parser>> parsers;
+
+    // Documents by their string, found by its hash and then compared in full, least recently used first out
+    struct CachedDocument {
+        size_t hash;
+        std::string text;
+        bool unwrap;
+        std::shared_ptr<const Document> document;
+        size_t bytes;
+        uint64_t lastUse;
+    };
+    mutable std::mutex cacheMutex;
+    std::vector<CachedDocument> cache;
+    size_t cacheBytes = 0;
+    uint64_t useCounter = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    // Decodes standard or URL-safe base64, with or without padding; false if 'text' is not base64
+    static bool decode_base64(std::string_view text, std::string& out);
+
+    // Inflates a gzip stream (RFC 1952) and checks its CRC. Returns INCORRECT_TYPE if it is corrupt and CAPACITY if
+    // it inflates past 'limit'.
+    static simdjson::error_code gunzip(std::string_view data, std::string& out, size_t limit);
+
+    // Approximate memory of a parsed document: its tape and string buffer, sized for its input
+    static size_t document_bytes(size_t inputBytes) { return inputBytes * 10 + 1024; }
+};
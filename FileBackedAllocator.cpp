@@ -0,0 +1,104 @@
+#include "FileBackedAllocator.h"
+#include <filesystem>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+FileBackedAllocator::FileBackedAllocator(std::string directory)
+	: directory(std::move(directory))
+{
+	std::error_code ec;
+	fallbackDirectory = std::filesystem::temp_directory_path(ec).string();
+}
+
+#ifdef _WIN32
+
+// Method: Creates a delete-on-close temporary file of 'bytes' bytes, in the temporary directory if it cannot be
+// created in the chosen one, and maps it read-write
+void* FileBackedAllocator::allocate(size_t bytes) {
+	HANDLE file = INVALID_HANDLE_VALUE;
+	for (const std::string* candidate : { &directory, &fallbackDirectory }) {
+		char path[MAX_PATH];
+		if (candidate->empty() || GetTempFileNameA(candidate->c_str(), "jsr", 0, path) == 0) {
+			continue;
+		}
+		file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+			FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+		if (file != INVALID_HANDLE_VALUE) {
+			break;
+		}
+		DeleteFileA(path);
+	}
+	if (file == INVALID_HANDLE_VALUE) {
+		return nullptr;
+	}
+	const uint64_t size = bytes;
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, DWORD(size >> 32), DWORD(size & 0xFFFFFFFF), nullptr);
+	void* ptr = mapping ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes) : nullptr;
+
+	// The view keeps the file alive; it is deleted once the view is unmapped
+	if (mapping) {
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+	if (ptr != nullptr) {
+		allocatedBytes += bytes;
+	}
+	return ptr;
+}
+
+void FileBackedAllocator::deallocate(void* ptr, size_t bytes) {
+	if (ptr != nullptr) {
+		UnmapViewOfFile(ptr);
+		allocatedBytes -= bytes;
+	}
+}
+
+#else
+
+// Method: Creates an unlinked temporary file of 'bytes' bytes, in the temporary directory if it cannot be created in
+// the chosen one, and maps it read-write (shared, so pages are file-backed)
+void* FileBackedAllocator::allocate(size_t bytes) {
+	int fd = -1;
+	for (const std::string* candidate : { &directory, &fallbackDirectory }) {
+		if (candidate->empty()) {
+			continue;
+		}
+		std::string pattern = (std::filesystem::path(*candidate) / "jsonreader-XXXXXX").string();
+		fd = mkstemp(pattern.data());
+		if (fd >= 0) {
+			unlink(pattern.c_str());
+			break;
+		}
+	}
+	if (fd < 0) {
+		return nullptr;
+	}
+	if (ftruncate(fd, off_t(bytes)) != 0) {
+		close(fd);
+		return nullptr;
+	}
+	void* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ptr == MAP_FAILED) {
+		return nullptr;
+	}
+	allocatedBytes += bytes;
+	return ptr;
+}
+
+void FileBackedAllocator::deallocate(void* ptr, size_t bytes) {
+	if (ptr != nullptr) {
+		munmap(ptr, bytes);
+		allocatedBytes -= bytes;
+	}
+}
+
+#endif
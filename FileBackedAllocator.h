@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include "ParserBufferAllocator.h"
+
+// FileBackedAllocator class, places parser buffers in memory-mapped temporary files instead of anonymous memory.
+// Pages of such buffers are backed by the file, so under memory pressure the OS can write cold parts out and
+// drop them instead of swapping or failing, which lets documents larger than RAM be parsed and browsed.
+// Temporary files are deleted as soon as their mapping is released (or immediately, where the OS allows it). They
+// only help if they are on disk: the system temporary directory is often RAM-backed (tmpfs), so it is only used
+// when no other directory is set or files cannot be created there.
+class FileBackedAllocator : public ParserBufferAllocator
+{
+public:
+    // 'directory' is where temporary files are created, such as the directory of the file being parsed
+    explicit FileBackedAllocator(std::string directory = std::string());
+
+    // Changes the directory of the files created from now on; not while a parse is using this allocator
+    void set_directory(std::string newDirectory) { directory = std::move(newDirectory); }
+    const std::string& get_directory() const { return directory; }
+
+    // Maps 'bytes' of a new temporary file, or returns nullptr on failure
+    void* allocate(size_t bytes) override;
+
+    // Releases a mapping returned by allocate()
+    void deallocate(void* ptr, size_t bytes) override;
+
+private:
+    std::string directory;
+    std::string fallbackDirectory;
+};
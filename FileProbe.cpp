@@ -0,0 +1,272 @@
+#include "FileProbe.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define FILE_PROBE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+	inline int popcount64(uint64_t x) {
+#if defined(_MSC_VER) && !defined(__clang__)
+		return int(__popcnt64(x));
+#else
+		return __builtin_popcountll(x);
+#endif
+	}
+
+	inline int trailing_zeros64(uint64_t x) {
+#if defined(_MSC_VER) && !defined(__clang__)
+		unsigned long index;
+		_BitScanForward64(&index, x);
+		return int(index);
+#else
+		return __builtin_ctzll(x);
+#endif
+	}
+
+	// Bit i of each mask is set if byte i of the 64-byte block is of that class
+	struct BlockMasks {
+		uint64_t quote;
+		uint64_t backslash;
+		uint64_t open;
+		uint64_t close;
+		uint64_t comma;
+		uint64_t colon;
+		uint64_t whitespace;
+	};
+
+#ifdef FILE_PROBE_SSE2
+	inline uint64_t equal_mask(const __m128i (&chunks)[4], char c) {
+		const __m128i pattern = _mm_set1_epi8(c);
+		uint64_t mask = 0;
+		for (int i = 0; i < 4; i++) {
+			mask |= uint64_t(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(chunks[i], pattern)))) << (16 * i);
+		}
+		return mask;
+	}
+
+	BlockMasks classify(const uint8_t* block) {
+		__m128i chunks[4];
+		__m128i folded[4];
+		for (int i = 0; i < 4; i++) {
+			chunks[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+			// '[' and '{', and ']' and '}', only differ in bit 5
+			folded[i] = _mm_or_si128(chunks[i], _mm_set1_epi8(0x20));
+		}
+		BlockMasks masks;
+		masks.quote = equal_mask(chunks, '"');
+		masks.backslash = equal_mask(chunks, '\\');
+		masks.open = equal_mask(folded, '{');
+		masks.close = equal_mask(folded, '}');
+		masks.comma = equal_mask(chunks, ',');
+		masks.colon = equal_mask(chunks, ':');
+		masks.whitespace = equal_mask(chunks, ' ') | equal_mask(chunks, '\n') | equal_mask(chunks, '\r') | equal_mask(chunks, '\t');
+		return masks;
+	}
+#else
+	BlockMasks classify(const uint8_t* block) {
+		BlockMasks masks{};
+		for (int i = 0; i < 64; i++) {
+			const uint64_t bit = uint64_t(1) << i;
+			switch (block[i]) {
+			case '"': masks.quote |= bit; break;
+			case '\\': masks.backslash |= bit; break;
+			case '{': case '[': masks.open |= bit; break;
+			case '}': case ']': masks.close |= bit; break;
+			case ',': masks.comma |= bit; break;
+			case ':': masks.colon |= bit; break;
+			case ' ': case '\n': case '\r': case '\t': masks.whitespace |= bit; break;
+			default: break;
+			}
+		}
+		return masks;
+	}
+#endif
+
+	// Characters escaped by a backslash, carrying an escape across blocks (simdjson's odd-length sequence method)
+	inline uint64_t find_escaped(uint64_t backslash, uint64_t& escapeCarry) {
+		backslash &= ~escapeCarry;
+		const uint64_t followsEscape = (backslash << 1) | escapeCarry;
+		const uint64_t evenBits = 0x5555555555555555ULL;
+		const uint64_t oddSequenceStarts = backslash & ~evenBits & ~followsEscape;
+		const uint64_t sequencesStartingOnEvenBits = oddSequenceStarts + backslash;
+		escapeCarry = sequencesStartingOnEvenBits < oddSequenceStarts ? 1 : 0;
+		const uint64_t invertMask = sequencesStartingOnEvenBits << 1;
+		return (evenBits ^ invertMask) & followsEscape;
+	}
+
+	// Bit i set if an odd number of bits at or below i are set
+	inline uint64_t prefix_xor(uint64_t x) {
+		x ^= x << 1;
+		x ^= x << 2;
+		x ^= x << 4;
+		x ^= x << 8;
+		x ^= x << 16;
+		x ^= x << 32;
+		return x;
+	}
+
+	// Bits strictly below 'bit'
+	inline uint64_t below(int bit) {
+		return bit >= 64 ? ~uint64_t(0) : (uint64_t(1) << bit) - 1;
+	}
+}
+
+// Method: Streams the file through the block scan. Only the first root value's members are counted; every
+// container closed back to depth 0 counts as a root value.
+simdjson::error_code FileProbe::run(const std::string& path) {
+	*this = FileProbe();
+	const auto start = std::chrono::steady_clock::now();
+	std::error_code ec;
+	fileSize = uint64_t(std::filesystem::file_size(path, ec));
+	if (ec) {
+		return simdjson::IO_ERROR;
+	}
+	std::FILE* fp = std::fopen(path.c_str(), "rb");
+	if (fp == nullptr) {
+		return simdjson::IO_ERROR;
+	}
+
+	std::vector<uint8_t> buffer(READ_SIZE);
+	uint64_t escapeCarry = 0;
+	uint64_t inStringCarry = 0;
+	uint64_t depth = 0;
+	uint64_t firstRootCommas = 0;
+	bool rootSeen = false;
+	bool awaitingRootContent = false;
+	bool rootEmpty = false;
+
+	size_t bytesRead;
+	while ((bytesRead = std::fread(buffer.data(), 1, buffer.size(), fp)) > 0) {
+		// Pad the last block with spaces
+		const size_t padded = (bytesRead + 63) / 64 * 64;
+		std::fill(buffer.begin() + bytesRead, buffer.begin() + padded, uint8_t(' '));
+
+		for (size_t offset = 0; offset < padded; offset += 64) {
+			const uint8_t* block = buffer.data() + offset;
+			const BlockMasks masks = classify(block);
+			const uint64_t quotes = masks.quote & ~find_escaped(masks.backslash, escapeCarry);
+			const uint64_t inString = prefix_xor(quotes) ^ inStringCarry;
+			inStringCarry = uint64_t(int64_t(inString) >> 63);
+
+			const uint64_t outside = ~inString;
+			const uint64_t opens = masks.open & outside;
+			const uint64_t closes = masks.close & outside;
+			const uint64_t commaBits = masks.comma & outside;
+			stringBytes += uint64_t(popcount64(inString) + popcount64(quotes & outside));
+			commas += uint64_t(popcount64(commaBits));
+			colons += uint64_t(popcount64(masks.colon & outside));
+			structuralBytes += uint64_t(popcount64(opens | closes | commaBits | (masks.colon & outside)));
+			containers += uint64_t(popcount64(opens));
+
+			// The first non-blank byte decides the root type; the next one whether the root container is empty
+			const uint64_t content = ~masks.whitespace;
+			uint64_t rootOpenBits = 0;
+			if (!rootSeen && content != 0) {
+				const int first = trailing_zeros64(content);
+				rootSeen = true;
+				if (block[first] == '{' || block[first] == '[') {
+					rootType = block[first] == '{' ? TopLevelScanner::RootType::OBJECT : TopLevelScanner::RootType::ARRAY;
+					awaitingRootContent = true;
+					rootOpenBits = below(first + 1);
+				}
+				else {
+					rootType = TopLevelScanner::RootType::SCALAR;
+				}
+			}
+			if (awaitingRootContent && (content & ~rootOpenBits) != 0) {
+				const uint8_t next = block[trailing_zeros64(content & ~rootOpenBits)];
+				rootEmpty = next == '}' || next == ']';
+				awaitingRootContent = false;
+			}
+
+			// Track depth over brackets in order; commas of the first root at depth 1 are counted between them
+			uint64_t events = opens | closes;
+			int segmentStart = 0;
+			while (true) {
+				const int bit = events ? trailing_zeros64(events) : 64;
+				if (depth == 1 && rootValues == 0) {
+					firstRootCommas += uint64_t(popcount64(commaBits & below(bit) & ~below(segmentStart)));
+				}
+				if (bit == 64) {
+					break;
+				}
+				if ((opens >> bit) & 1) {
+					depth++;
+					maxDepth = std::max(maxDepth, depth);
+				}
+				else if (depth > 0 && --depth == 0) {
+					rootValues++;
+				}
+				segmentStart = bit + 1;
+				events &= events - 1;
+			}
+		}
+	}
+	const bool readFailed = std::ferror(fp) != 0;
+	std::fclose(fp);
+	if (readFailed) {
+		return simdjson::IO_ERROR;
+	}
+
+	if (rootValues > 1) {
+		topLevelCount = rootValues;
+	}
+	else if (rootType == TopLevelScanner::RootType::OBJECT || rootType == TopLevelScanner::RootType::ARRAY) {
+		topLevelCount = rootEmpty ? 0 : firstRootCommas + 1;
+	}
+	elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return simdjson::SUCCESS;
+}
+
+// Method: Resident memory of a DOM load: the input, a 4-byte stage 1 index entry per structural character and
+// value, about two 8-byte tape words per node, and the string bytes plus a 4-byte length per node at most
+uint64_t FileProbe::estimated_dom_bytes() const {
+	const uint64_t nodes = estimated_nodes();
+	return fileSize + 4 * (structuralBytes + nodes) + 16 * nodes + stringBytes + 4 * nodes;
+}
+
+// Method: About 1.2 bytes per node for the succinct structure (see CompactTree); the input stays in the file
+uint64_t FileProbe::estimated_compact_bytes() const {
+	return estimated_nodes() * 6 / 5;
+}
+
+std::string FileProbe::summary() const {
+	auto megabytes = [](uint64_t bytes) {
+		std::ostringstream text;
+		text.setf(std::ios::fixed);
+		text.precision(1);
+		text << double(bytes) / (1024.0 * 1024.0) << " MB";
+		return text.str();
+	};
+	auto percent = [this](uint64_t bytes) {
+		return std::to_string(fileSize ? bytes * 100 / fileSize : 0) + "%";
+	};
+
+	std::ostringstream text;
+	if (rootValues > 1) {
+		text << rootValues << " root values (NDJSON)";
+	}
+	else {
+		switch (rootType) {
+		case TopLevelScanner::RootType::OBJECT: text << "object, " << topLevelCount << " members"; break;
+		case TopLevelScanner::RootType::ARRAY: text << "array, " << topLevelCount << " elements"; break;
+		case TopLevelScanner::RootType::SCALAR: text << "scalar"; break;
+		default: text << "empty"; break;
+		}
+	}
+	text << ", depth " << maxDepth
+		<< ", " << percent(stringBytes) << " string bytes, " << percent(structuralBytes) << " structural"
+		<< ", ~" << estimated_nodes() << " nodes"
+		<< ", est. " << megabytes(estimated_dom_bytes()) << " DOM / " << megabytes(estimated_compact_bytes()) << " compact"
+		<< ", probed in " << int(elapsed * 1000.0) << " ms";
+	return text.str();
+}
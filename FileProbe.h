@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "simdjson.h"
+#include "TopLevelScanner.h"
+
+// FileProbe class, a quick look at a JSON file before committing to a full parse. The file is streamed through a
+// quote-aware structural scan over 64-byte blocks (SIMD compares turned into bit masks, as in simdjson's stage 1)
+// that builds no tape and keeps no input, and reports the shape of the document and what loading it would cost.
+class FileProbe
+{
+public:
+    // Bytes read and scanned at a time
+    static constexpr size_t READ_SIZE = 4 * 1024 * 1024;
+
+    // Scans the file
+    simdjson::error_code run(const std::string& path);
+
+    // Shape of the input. For a single document, 'top_level_count' is the number of members or elements of the
+    // root; several root values (as in NDJSON) are counted by 'root_values'.
+    TopLevelScanner::RootType root_type() const { return rootType; }
+    uint64_t file_size() const { return fileSize; }
+    uint64_t top_level_count() const { return topLevelCount; }
+    uint64_t root_values() const { return rootValues; }
+    uint64_t max_depth() const { return maxDepth; }
+
+    // Bytes inside strings (quotes included) and structural characters ({}[]:,) outside strings
+    uint64_t string_bytes() const { return stringBytes; }
+    uint64_t structural_bytes() const { return structuralBytes; }
+
+    // Estimated number of values and keys, from the separators and containers found
+    uint64_t estimated_nodes() const { return containers + commas + colons + rootValues; }
+
+    // Estimated memory of a DOM parse (input, stage 1 index, tape and string buffer as simdjson allocates them),
+    // and of a compact tree over the mapped file (see CompactTree)
+    uint64_t estimated_dom_bytes() const;
+    uint64_t estimated_compact_bytes() const;
+
+    // Scan time in seconds
+    double seconds() const { return elapsed; }
+
+    // One-line description of the results
+    std::string summary() const;
+
+private:
+    TopLevelScanner::RootType rootType = TopLevelScanner::RootType::UNKNOWN;
+    uint64_t fileSize = 0;
+    uint64_t topLevelCount = 0;
+    uint64_t rootValues = 0;
+    uint64_t maxDepth = 0;
+    uint64_t stringBytes = 0;
+    uint64_t structuralBytes = 0;
+    uint64_t containers = 0;
+    uint64_t commas = 0;
+    uint64_t colons = 0;
+    double elapsed = 0;
+};
@@ -0,0 +1,125 @@
+#include "HugePageAllocator.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+	// Regular page size used as the pre-fault stride, so every page is touched even without huge pages
+	constexpr size_t SMALL_PAGE_SIZE = 4096;
+
+	inline size_t round_up(size_t bytes, size_t alignment) {
+		return (bytes + alignment - 1) / alignment * alignment;
+	}
+}
+
+HugePageAllocator::HugePageAllocator(bool useHugetlbfs, unsigned prefaultThreads)
+	: useHugetlbfs(useHugetlbfs),
+	prefaultThreads(prefaultThreads ? prefaultThreads : std::max(1u, std::thread::hardware_concurrency()))
+{
+}
+
+#ifdef _WIN32
+
+// Method: Allocates with large pages if the process holds SeLockMemoryPrivilege, regular pages otherwise
+void* HugePageAllocator::allocate(size_t bytes) {
+	const size_t largePage = GetLargePageMinimum();
+	void* ptr = nullptr;
+	if (largePage != 0) {
+		ptr = VirtualAlloc(nullptr, round_up(bytes, largePage), MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+	}
+	if (ptr == nullptr) {
+		ptr = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	}
+	if (ptr == nullptr) {
+		return nullptr;
+	}
+	prefault(ptr, bytes);
+	allocatedBytes += bytes;
+	return ptr;
+}
+
+void HugePageAllocator::deallocate(void* ptr, size_t bytes) {
+	if (ptr != nullptr) {
+		VirtualFree(ptr, 0, MEM_RELEASE);
+		allocatedBytes -= bytes;
+	}
+}
+
+#else
+
+// Method: Maps a 2 MB aligned region, backed by hugetlbfs if requested and available, or advised for
+// transparent huge pages otherwise, and pre-faults it
+void* HugePageAllocator::allocate(size_t bytes) {
+	const size_t size = round_up(bytes, HUGE_PAGE_SIZE);
+	void* ptr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+	if (useHugetlbfs) {
+		ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	}
+#endif
+	if (ptr == MAP_FAILED) {
+		// Over-allocate by one huge page and trim, so that the region is huge page aligned
+		void* raw = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (raw == MAP_FAILED) {
+			return nullptr;
+		}
+		const uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+		const uintptr_t aligned = round_up(start, HUGE_PAGE_SIZE);
+		if (aligned > start) {
+			munmap(raw, aligned - start);
+		}
+		const uintptr_t end = start + size + HUGE_PAGE_SIZE;
+		if (end > aligned + size) {
+			munmap(reinterpret_cast<void*>(aligned + size), end - (aligned + size));
+		}
+		ptr = reinterpret_cast<void*>(aligned);
+#ifdef MADV_HUGEPAGE
+		madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+	}
+	prefault(ptr, size);
+	allocatedBytes += bytes;
+	return ptr;
+}
+
+void HugePageAllocator::deallocate(void* ptr, size_t bytes) {
+	if (ptr != nullptr) {
+		munmap(ptr, round_up(bytes, HUGE_PAGE_SIZE));
+		allocatedBytes -= bytes;
+	}
+}
+
+#endif
+
+// Method: Touches every page of the region, splitting it into huge page aligned ranges across threads
+void HugePageAllocator::prefault(void* ptr, size_t bytes) const {
+	char* base = static_cast<char*>(ptr);
+	const size_t pages = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE;
+	const size_t workers = std::min<size_t>(prefaultThreads, pages);
+	auto touch = [=](size_t firstPage, size_t lastPage) {
+		const size_t end = std::min(lastPage * HUGE_PAGE_SIZE, bytes);
+		for (size_t offset = firstPage * HUGE_PAGE_SIZE; offset < end; offset += SMALL_PAGE_SIZE) {
+			base[offset] = 0;
+		}
+	};
+	if (workers <= 1) {
+		touch(0, pages);
+		return;
+	}
+	std::vector<std::thread> threads;
+	const size_t perWorker = (pages + workers - 1) / workers;
+	for (size_t first = 0; first < pages; first += perWorker) {
+		threads.emplace_back(touch, first, std::min(first + perWorker, pages));
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "ParserBufferAllocator.h"
+
+// HugePageAllocator class, allocates parser buffers on huge pages and pre-faults them in parallel.
+// First-touching several GB of tape and string buffer costs one page fault per 4 KB page, all taken on the parsing
+// thread. Buffers from this allocator are backed by 2 MB pages where the OS allows it (transparent huge pages via
+// madvise, or hugetlbfs when requested; large pages on Windows when the process holds the privilege) and are
+// touched by several threads before parsing starts, so the parse itself runs without faults.
+class HugePageAllocator : public ParserBufferAllocator
+{
+public:
+    // 'useHugetlbfs' asks for explicitly reserved huge pages first (Linux MAP_HUGETLB), falling back to
+    // transparent huge pages. 'prefaultThreads' is the number of threads used to pre-fault (0 = one per core).
+    explicit HugePageAllocator(bool useHugetlbfs = false, unsigned prefaultThreads = 0);
+
+    void* allocate(size_t bytes) override;
+    void deallocate(void* ptr, size_t bytes) override;
+
+    // Size of the huge pages buffers are rounded to
+    static constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+private:
+    bool useHugetlbfs;
+    unsigned prefaultThreads;
+
+    void prefault(void* ptr, size_t bytes) const;
+};
@@ -0,0 +1,229 @@
+#include "JsonMimeData.h"
+#include <algorithm>
+#include <climits>
+#include <memory>
+#include <QElapsedTimer>
+#include <QMessageBox>
+#include <QProgressDialog>
+
+namespace {
+
+	const QString JSON_FORMAT = "application/json";
+	const QString TEXT_FORMAT = "text/plain";
+
+	// Values written between checks of the size guard and the progress dialog
+	constexpr size_t CHECK_INTERVAL = 4096;
+
+	// Walks the elements with simdjson's minifying formatter. Its buffer is moved to 'out' at each check, so the
+	// serialization is held only once.
+	class Writer {
+	public:
+		Writer(std::string& out, std::function<bool()> check) : out(out), check(std::move(check)) {}
+
+		// Writes 'element'; 'children', if set, counts the children written at this level
+		bool write(simdjson::dom::element element, int* children = nullptr) {
+			if (++values % CHECK_INTERVAL == 0 && !flush()) {
+				return false;
+			}
+			switch (element.type()) {
+			case simdjson::dom::element_type::ARRAY: {
+				format.start_array();
+				bool first = true;
+				for (simdjson::dom::element value : simdjson::dom::array(element)) {
+					if (!first) {
+						format.comma();
+					}
+					first = false;
+					if (!write(value)) {
+						return false;
+					}
+					if (children) {
+						++*children;
+					}
+				}
+				format.end_array();
+				break;
+			}
+			case simdjson::dom::element_type::OBJECT: {
+				format.start_object();
+				bool first = true;
+				for (auto [key, value] : simdjson::dom::object(element)) {
+					if (!first) {
+						format.comma();
+					}
+					first = false;
+					format.key(key);
+					if (!write(value)) {
+						return false;
+					}
+					if (children) {
+						++*children;
+					}
+				}
+				format.end_object();
+				break;
+			}
+			case simdjson::dom::element_type::INT64:
+				format.number(int64_t(element));
+				break;
+			case simdjson::dom::element_type::UINT64:
+				format.number(uint64_t(element));
+				break;
+			case simdjson::dom::element_type::DOUBLE:
+				format.number(double(element));
+				break;
+			case simdjson::dom::element_type::STRING:
+				format.string(std::string_view(element));
+				break;
+			case simdjson::dom::element_type::BOOL:
+				if (bool(element)) {
+					format.true_atom();
+				}
+				else {
+					format.false_atom();
+				}
+				break;
+			case simdjson::dom::element_type::NULL_VALUE:
+				format.null_atom();
+				break;
+			}
+			return true;
+		}
+
+		void string(const QString& text) { format.string(text.toStdString()); }
+		void start_array() { format.start_array(); }
+		void end_array() { format.end_array(); }
+		void comma() { format.comma(); }
+
+		// Moves the formatted text to 'out' and runs the check; false to stop
+		bool flush() {
+			const std::string_view text = format.str();
+			out.append(text.data(), text.size());
+			format.clear();
+			return out.size() <= JsonMimeData::MAX_BYTES && check();
+		}
+
+	private:
+		simdjson::internal::mini_formatter format;
+		std::string& out;
+		std::function<bool()> check;
+		size_t values = 0;
+	};
+}
+
+std::atomic<int> JsonMimeData::activeCount{ 0 };
+
+JsonMimeData::JsonMimeData(std::vector<Entry> entries, QWidget* progressParent)
+	: entries(std::move(entries)), progressParent(progressParent)
+{
+}
+
+QStringList JsonMimeData::formats() const {
+	return QStringList() << JSON_FORMAT << TEXT_FORMAT;
+}
+
+bool JsonMimeData::hasFormat(const QString& mimeType) const {
+	return mimeType == JSON_FORMAT || mimeType == TEXT_FORMAT;
+}
+
+void JsonMimeData::detach() {
+	if (!serialized && !running) {
+		serialize(false);
+	}
+	entries.clear();
+}
+
+// Method: Serializes on the first request. Requests made while serializing (from the progress dialog's event
+// processing) get nothing.
+QVariant JsonMimeData::retrieveData(const QString& mimeType, QMetaType type) const {
+	Q_UNUSED(type);
+	if (!hasFormat(mimeType) || running) {
+		return QVariant();
+	}
+	if (!serialized && !serialize(true) && tooLarge && progressParent) {
+		QMessageBox::warning(progressParent, "Copy", QString("The selection is larger than %1 MB when written as JSON; select less of it.").arg(MAX_BYTES / (1024 * 1024)));
+	}
+	if (failed) {
+		return QVariant();
+	}
+	if (mimeType == JSON_FORMAT) {
+		return QByteArray(json.data(), qsizetype(json.size()));
+	}
+	return QString::fromUtf8(json.data(), qsizetype(json.size()));
+}
+
+// Method: Counts the entries and the children of container entries as units of progress; the dialog appears only
+// once serializing has taken PROGRESS_DELAY_MS
+bool JsonMimeData::serialize(bool interactive) const {
+	running = true;
+	activeCount++;
+	json.clear();
+	tooLarge = false;
+
+	int total = 0;
+	for (const Entry& entry : entries) {
+		total++;
+		if (entry.hasElement && entry.element.is_array()) {
+			total += int(std::min<size_t>(simdjson::dom::array(entry.element).size(), INT_MAX / 2));
+		}
+		else if (entry.hasElement && entry.element.is_object()) {
+			total += int(std::min<size_t>(simdjson::dom::object(entry.element).size(), INT_MAX / 2));
+		}
+	}
+	int done = 0;
+	QElapsedTimer timer;
+	timer.start();
+	std::unique_ptr<QProgressDialog> progress;
+	auto check = [&]() {
+		if (!interactive || !progressParent) {
+			return true;
+		}
+		if (!progress && timer.elapsed() >= PROGRESS_DELAY_MS) {
+			progress = std::make_unique<QProgressDialog>("Writing the selection as JSON...", "Cancel", 0, total, progressParent);
+			progress->setWindowModality(Qt::WindowModal);
+			progress->setMinimumDuration(0);
+		}
+		if (progress) {
+			progress->setLabelText(QString("Writing the selection as JSON (%1 MB)...").arg(json.size() / (1024.0 * 1024.0), 0, 'f', 0));
+			progress->setValue(std::min(done, total - 1));
+			return !progress->wasCanceled();
+		}
+		return true;
+	};
+
+	// A single value is written as it is, several as an array
+	Writer writer(json, check);
+	bool ok = true;
+	if (entries.size() > 1) {
+		writer.start_array();
+	}
+	for (size_t i = 0; i < entries.size() && ok; i++) {
+		const Entry& entry = entries[i];
+		if (i > 0) {
+			writer.comma();
+		}
+		if (!entry.hasElement) {
+			writer.string(entry.text);
+		}
+		else {
+			ok = writer.write(entry.element, &done);
+		}
+		done++;
+	}
+	if (ok && entries.size() > 1) {
+		writer.end_array();
+	}
+	ok = ok && writer.flush();
+
+	// A cancelled serialization is not kept, so the next request (or detach) writes the selection again
+	failed = !ok;
+	tooLarge = json.size() > MAX_BYTES;
+	serialized = ok || tooLarge;
+	if (failed) {
+		json.clear();
+		json.shrink_to_fit();
+	}
+	running = false;
+	activeCount--;
+	return ok;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include <QMimeData>
+#include <QPointer>
+#include <QWidget>
+#include "simdjson.h"
+
+// JsonMimeData class, clipboard and drag data for selected rows that is serialized only when a consumer asks for it.
+// It advertises JSON and plain text; the selected values are written as minified JSON from their elements on the
+// first request and kept for the following ones. Several values are written as an array; rows without an element
+// (compact and range rows) are written as their displayed text.
+// Serializing stops past MAX_BYTES, and shows a cancellable progress dialog when it takes a while. The elements must
+// stay valid until the data is serialized: detach() serializes it before the documents they belong to are released,
+// and no document may be released while serializing() is true.
+class JsonMimeData : public QMimeData
+{
+    Q_OBJECT
+
+public:
+    // Largest serialization produced; larger selections are refused
+    static constexpr size_t MAX_BYTES = size_t(512) * 1024 * 1024;
+
+    // Time after which a progress dialog is shown, in milliseconds
+    static constexpr int PROGRESS_DELAY_MS = 300;
+
+    // A selected row: its element, or its text if it has none
+    struct Entry {
+        bool hasElement;
+        simdjson::dom::element element;
+        QString text;
+    };
+
+    JsonMimeData(std::vector<Entry> entries, QWidget* progressParent);
+
+    QStringList formats() const override;
+    bool hasFormat(const QString& mimeType) const override;
+
+    // Serializes the data now, so that it no longer refers to the elements
+    void detach();
+
+    // Whether some data is being serialized, in which case no document may be released
+    static bool serializing() { return activeCount > 0; }
+
+protected:
+    QVariant retrieveData(const QString& mimeType, QMetaType type) const override;
+
+private:
+    std::vector<Entry> entries;
+    QPointer<QWidget> progressParent;
+
+    // Result of the serialization, and its state
+    mutable std::string json;
+    mutable bool serialized = false;
+    mutable bool failed = false;
+    mutable bool tooLarge = false;
+    mutable bool running = false;
+
+    static std::atomic<int> activeCount;
+
+    // Writes the entries into 'json'; false if cancelled or too large. 'interactive' allows the progress dialog.
+    bool serialize(bool interactive) const;
+};
@@ -1,66 +1,3097 @@
 #include "JsonReader.h"
 
-JsonReader::JsonReader(QWidget* parent)
-	: QMainWindow(parent)
+JsonReader::JsonReader(QWidget* parent, bool useSession)
+	: QMainWindow(parent), useSession(useSession)
 {
 	ui.setupUi(this);
 	ui.treeWidget->setSelectionMode(QAbstractItemView::ExtendedSelection);
+
+	// Rows can be dragged out to other applications; the drag itself is started from eventFilter
+	ui.treeWidget->setDragEnabled(true);
+	ui.treeWidget->setDragDropMode(QAbstractItemView::DragOnly);
+	ui.treeWidget->viewport()->installEventFilter(this);
+
+	// A second view can be shown next to the tree (see on_actionSplitView_toggled)
+	activeTree = ui.treeWidget;
+	splitter = new QSplitter(Qt::Horizontal, this);
+	ui.gridLayout_2->replaceWidget(ui.treeWidget, splitter);
+	splitter->addWidget(ui.treeWidget);
+	connect(ui.treeWidget, &QTreeWidget::itemSelectionChanged, this, [this]() { activeTree = ui.treeWidget; });
+
+	// Optional structures released under memory pressure, cheapest to rebuild first
+	memoryGovernor.add_evictable("prefetched rows", 0, [this]() { return rowPrefetcher.clear(); });
+	memoryGovernor.add_evictable("decompressed blocks", 0, [this]() { return trim_decompressed_blocks(); });
+	memoryGovernor.add_evictable("embedded documents", 0, [this]() { return embeddedJson.trim_cache(); });
+	memoryGovernor.add_evictable("collapsed subtrees", 1, [this]() { return release_collapsed_subtrees(); });
+	memoryGovernor.add_evictable("parser index", 2, [this]() { return release_parser_index(); });
+	memoryLabel = new QLabel(this);
+	ui.statusBar->addPermanentWidget(memoryLabel);
+	connect(&memoryTimer, &QTimer::timeout, this, &JsonReader::poll_memory);
+	memoryTimer.start(2000);
+	poll_memory();
+
+	// Speculative prefetch follows the mouse (the tree has mouse tracking on) and the scroll direction
+	prefetchLabel = new QLabel(this);
+	ui.statusBar->addPermanentWidget(prefetchLabel);
+	connect(ui.treeWidget->verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int value) { prefetch_scrolled(ui.treeWidget, value); });
+
+	// Files are often rewritten in several steps, so a reload waits until changes have settled
+	reloadTimer.setSingleShot(true);
+	connect(&reloadTimer, &QTimer::timeout, this, &JsonReader::reload_watched_file);
+	connect(&fileWatcher, &QFileSystemWatcher::fileChanged, this, [this]() { reloadTimer.start(RELOAD_DELAY_MS); });
+
+	// Violations of a schema validation are listed in a dock, hidden until a validation is run
+	validationDock = new QDockWidget("Schema violations", this);
+	validationDock->setObjectName("validationDock");
+	validationList = new QListWidget(validationDock);
+	validationDock->setWidget(validationList);
+	addDockWidget(Qt::BottomDockWidgetArea, validationDock);
+	validationDock->hide();
+	connect(validationList, &QListWidget::itemActivated, this, &JsonReader::show_violation);
+
+	// The minimap of the current document is a dock shown from the View menu; it follows the view after a short delay
+	minimapDock = new QDockWidget("Minimap", this);
+	minimapDock->setObjectName("minimapDock");
+	minimapWidget = new MinimapWidget(minimapDock);
+	minimapDock->setWidget(minimapWidget);
+	addDockWidget(Qt::RightDockWidgetArea, minimapDock);
+	minimapDock->hide();
+	minimapDock->toggleViewAction()->setStatusTip("Show the structure of the current document with the search hits and the rows in view");
+	ui.menuView->addAction(minimapDock->toggleViewAction());
+	minimapTimer.setSingleShot(true);
+	connect(&minimapTimer, &QTimer::timeout, this, &JsonReader::update_minimap);
+	connect(minimapDock, &QDockWidget::visibilityChanged, this, [this](bool visible) {
+		if (visible) {
+			schedule_minimap();
+		}
+	});
+	connect(minimapWidget, &MinimapWidget::bucket_clicked, this, &JsonReader::jump_to_bucket);
+	connect(ui.treeWidget->verticalScrollBar(), &QScrollBar::valueChanged, this, &JsonReader::schedule_minimap);
+	connect(ui.treeWidget, &QTreeWidget::itemExpanded, this, &JsonReader::schedule_minimap);
+	connect(ui.treeWidget, &QTreeWidget::itemCollapsed, this, &JsonReader::schedule_minimap);
+	connect(ui.treeWidget, &QTreeWidget::itemSelectionChanged, this, &JsonReader::schedule_minimap);
+
+	// Charts of numeric fields are shown in a dock below the tree, opened by "Plot numeric field..."
+	chartDock = new QDockWidget("Chart", this);
+	chartDock->setObjectName("chartDock");
+	chartWidget = new SeriesChartWidget(chartDock);
+	chartDock->setWidget(chartWidget);
+	addDockWidget(Qt::BottomDockWidgetArea, chartDock);
+	chartDock->hide();
+	connect(chartWidget, &SeriesChartWidget::index_clicked, this, &JsonReader::jump_to_element);
+
+	// Out-of-core files go next to the file being loaded unless another directory was chosen
+	outOfCoreDirectory = QSettings("JsonReader", "JsonReader").value("outOfCore/directory").toString();
+
+	// Tape caches are written in the background once loads have settled, so that exiting only saves the session list
+	cacheTimer.setSingleShot(true);
+	connect(&cacheTimer, &QTimer::timeout, this, &JsonReader::write_next_tape_cache);
+
+	// Reopen the documents of the last session
+	if (useSession) {
+		ui.actionRestoreSession->setChecked(QSettings("JsonReader", "JsonReader").value("session/restore", true).toBool());
+		restore_session();
+	}
+	else {
+		ui.actionRestoreSession->setChecked(false);
+		ui.actionRestoreSession->setEnabled(false);
+	}
+}
+
+JsonReader::~JsonReader() {
+	stop_validation();
+	stop_export();
+	stop_editing();
+	stop_patching();
+	stop_minimap();
+	stop_plotting();
+	stop_progressive();
+	stop_watching();
+	stop_restoring();
+	stop_caching();
+	if (useSession) {
+		save_session();
+	}
+}
+
+// Method: Triggered when the "Load" button is clicked. Opens a file dialog to select a JSON file
+void JsonReader::on_loadBtn_clicked() {
+
+	// Open a dialog for the user to select a JSON file
+	QString filename = QFileDialog::getOpenFileName(
+		this,
+		"Open JSON file",
+		"",
+		"JSON Files (*.json *.ndjson *.jsonl);;All Files (*)"
+	);
+
+	// If the user cancelled the dialog, terminate the method
+	if (filename.isEmpty()) {
+		return;
+	}
+	load_file(filename);
+}
+
+// Method: Loads a file with the strategy chosen in the View menu, or picked by probing it first
+void JsonReader::load_file(const QString& filename) {
+	// A progressive load still running would swap its parser in over this one when it finishes
+	stop_progressive();
+	clear_prefetched_rows();
+	stop_watching();
+
+	// Newline-delimited files hold one document per line and are parsed batch by batch
+	if (NdjsonDocument::has_ndjson_extension(filename.toStdString())) {
+		load_ndjson(filename);
+		return;
+	}
+
+	// Probe the file first to pick a loading strategy for this file; several root values mean NDJSON whatever the
+	// extension
+	LoadStrategy strategy;
+	strategy.outOfCore = ui.actionOutOfCore->isChecked();
+	strategy.hugePages = ui.actionHugePages->isChecked();
+	strategy.compact = ui.actionCompactMode->isChecked();
+	strategy.compressStrings = ui.actionCompressStrings->isChecked();
+	if (ui.actionAutoStrategy->isChecked()) {
+		FileProbe probe;
+		if (!probe.run(filename.toStdString())) {
+			if (probe.root_values() > 1) {
+				load_ndjson(filename);
+				return;
+			}
+			ui.statusBar->showMessage(QString::fromStdString(probe.summary()) + apply_probe_strategy(probe, strategy));
+		}
+	}
+
+	// Choose where the tape and string buffer live. In out-of-core mode they are memory-mapped temporary files,
+	// so the OS can page cold parts out instead of running out of memory; with huge pages they are backed by 2 MB
+	// pages pre-faulted in parallel before parsing. Switching modes releases the current buffers.
+	ParserBufferAllocator* bufferAllocator = nullptr;
+	if (strategy.outOfCore) {
+		fileBackedAllocator.set_directory((outOfCoreDirectory.isEmpty() ? QFileInfo(filename).absolutePath() : outOfCoreDirectory).toStdString());
+		bufferAllocator = &fileBackedAllocator;
+	}
+	else if (strategy.hugePages) {
+		bufferAllocator = &hugePageAllocator;
+	}
+	const simdjson::dom::buffer_allocator* allocator = bufferAllocator ? bufferAllocator->get() : nullptr;
+	if (parser.doc.get_allocator() != allocator) {
+		forget_main_document();
+		parser = simdjson::dom::parser();
+		parser.doc.set_allocator(allocator);
+	}
+
+	// Without a buffer allocator or compact mode, show rows while the file is read and parse it in the background
+	if (bufferAllocator == nullptr && !strategy.compact && ui.actionProgressiveLoading->isChecked()) {
+		load_progressive(filename);
+		return;
+	}
+
+	// Parse the selected JSON file. Overlapped reads allocate the parser's buffers while the file is still being read.
+	forget_main_document();
+	simdjson::dom::element doc;
+	simdjson::error_code error;
+	if (bufferAllocator) {
+		error = bufferAllocator->load(parser, filename.toStdString()).get(doc);
+	}
+	else if (ui.actionOverlappedReads->isChecked()) {
+		error = OverlappedReader::load(parser, filename.toStdString()).get(doc);
+	}
+	else {
+		error = parser.load(filename.toStdString()).get(doc);
+	}
+	if (error) {
+		qInfo() << "Error: " << error;
+		return;
+	}
+
+	// In compact mode, keep a succinct tree over the mapped file instead of the tape
+	if (strategy.compact && load_compact(filename, strategy.compressStrings)) {
+		return;
+	}
+
+	// Add parsed JSON data to the tree widget
+	QTreeWidgetItem* root = new QTreeWidgetItem();
+	add_children_to_item(root, doc);
+	ui.treeWidget->insertTopLevelItem(0, root);
+	register_document(root, filename, &parser.doc, doc, nullptr);
+	watch_file(filename, root);
+}
+
+// Method: Builds a compact tree for the document just parsed, then releases the parser's tape and string buffer.
+// Returns false if the file could not be mapped or the tree could not be built, in which case the DOM is kept.
+bool JsonReader::load_compact(const QString& filename, bool compressStrings) {
+
+	// Map the input file: values are read back from it on demand
+	auto compactDocument = std::make_unique<CompactDocument>();
+	compactDocument->file.setFileName(filename);
+	if (!compactDocument->file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+	const qint64 size = compactDocument->file.size();
+	uchar* data = compactDocument->file.map(0, size);
+	if (data == nullptr) {
+		return false;
+	}
+
+	// Build the tree from the tape
+	auto error = compactDocument->tree.build(parser.doc, std::string_view(reinterpret_cast<const char*>(data), size_t(size)));
+	if (error) {
+		qInfo() << "Error: " << error;
+		return false;
+	}
+
+	// Drop the tape, string buffer and loaded input. The rows of the previous document went with it before the parse
+	// (see forget_main_document) and this one has none yet, so rows of other documents keep their entries.
+	clear_prefetched_rows();
+	const simdjson::dom::buffer_allocator* allocator = parser.doc.get_allocator();
+	parser = simdjson::dom::parser();
+	parser.doc.set_allocator(allocator);
+
+	// Optionally keep the input in compressed blocks instead of the mapping, for string-heavy documents
+	QString status = QString("Compact tree: %1 nodes, %2 MB").arg(compactDocument->tree.size()).arg(compactDocument->tree.memory_usage() / (1024.0 * 1024.0), 0, 'f', 1);
+	if (compressStrings) {
+		auto compressed = std::make_shared<CompressedSource>(std::string_view(reinterpret_cast<const char*>(data), size_t(size)));
+		compactDocument->tree.set_source(compressed);
+		compactDocument->file.unmap(data);
+		compactDocument->file.close();
+		status += QString(", input compressed to %1 MB").arg(compressed->compressed_bytes() / (1024.0 * 1024.0), 0, 'f', 1);
+	}
+
+	// Add the compact document to the tree widget
+	const CompactTree& tree = compactDocument->tree;
+	QTreeWidgetItem* root = new QTreeWidgetItem();
+	add_children_to_item(root, tree, tree.root());
+	ui.treeWidget->insertTopLevelItem(0, root);
+	ui.statusBar->showMessage(status);
+
+	compactDocuments.push_back(std::move(compactDocument));
+	return true;
+}
+
+// Method: Parses a newline-delimited JSON file while it is being read and lists its records under a new root item
+bool JsonReader::load_ndjson(const QString& filename) {
+	auto document = std::make_unique<NdjsonDocument>();
+	auto error = document->load(filename.toStdString(), ui.actionOverlappedReads->isChecked());
+	if (error) {
+		qInfo() << "Error: " << error << " at line " << document->error_line();
+		return false;
+	}
+
+	// Add one child per record; records are expanded lazily like any other element
+	QTreeWidgetItem* root = new QTreeWidgetItem();
+	for (size_t i = 0; i < document->size(); i++) {
+		add_child_to_item(root, std::to_string(i), document->record(i));
+	}
+	ui.treeWidget->insertTopLevelItem(0, root);
+	ui.statusBar->showMessage(QString("NDJSON: %1 records").arg(document->size()));
+	register_document(root, filename, nullptr, simdjson::dom::element(), document.get());
+	documentOwners.insert(root, std::shared_ptr<NdjsonDocument>(std::move(document)));
+	return true;
+}
+
+// Method: Escalates this load to out-of-core mode with a compact tree, compressing the input when it is mostly
+// strings, if the estimated DOM exceeds half the available memory. Otherwise the menu's settings are kept. Returns a
+// note for the status bar.
+QString JsonReader::apply_probe_strategy(const FileProbe& probe, LoadStrategy& strategy) {
+	const uint64_t available = memoryGovernor.available_memory();
+	if (available == 0 || probe.estimated_dom_bytes() < available / 2) {
+		return QString();
+	}
+	strategy.outOfCore = true;
+	strategy.compact = true;
+	if (probe.string_bytes() > probe.file_size() / 2) {
+		strategy.compressStrings = true;
+	}
+	return QString(" - DOM would not fit in %1 MB available, loading out-of-core in compact mode").arg(available / (1024 * 1024));
+}
+
+// Method: Triggered when "Open from clipboard" is chosen. Takes the clipboard's bytes as UTF-8, preferring a JSON
+// format when the source offers one, and parses them in place: the only copy is the one that makes room for the
+// parser's padding, and none is made if the buffer already has it. Several lines of values are loaded as NDJSON.
+void JsonReader::on_actionOpenClipboard_triggered() {
+	const QMimeData* mimeData = QApplication::clipboard()->mimeData();
+	if (mimeData == nullptr) {
+		return;
+	}
+	QByteArray bytes;
+	if (mimeData->hasFormat("application/json")) {
+		bytes = mimeData->data("application/json");
+	}
+	else if (mimeData->hasText()) {
+		bytes = mimeData->data("text/plain;charset=utf-8");
+		if (bytes.isEmpty()) {
+			bytes = mimeData->text().toUtf8();
+		}
+	}
+	if (bytes.trimmed().isEmpty()) {
+		ui.statusBar->showMessage("The clipboard holds no text");
+		return;
+	}
+	QElapsedTimer timer;
+	timer.start();
+	const std::string_view input(bytes.constData(), size_t(bytes.size()));
+
+	if (NdjsonDocument::looks_like_ndjson(input)) {
+		auto document = std::make_unique<NdjsonDocument>();
+		auto error = document->parse(input);
+		if (error) {
+			qInfo() << "Error: " << error << " at line " << document->error_line();
+			ui.statusBar->showMessage(QString("Clipboard: %1 at line %2").arg(simdjson::error_message(error)).arg(document->error_line()));
+			return;
+		}
+		QTreeWidgetItem* root = new QTreeWidgetItem();
+		for (size_t i = 0; i < document->size(); i++) {
+			add_child_to_item(root, std::to_string(i), document->record(i));
+		}
+		ui.treeWidget->insertTopLevelItem(0, root);
+		register_document(root, QString(), nullptr, simdjson::dom::element(), document.get());
+		ui.statusBar->showMessage(QString("Clipboard: %1 NDJSON records in %2 ms").arg(document->size()).arg(timer.elapsed()));
+		documentOwners.insert(root, std::shared_ptr<NdjsonDocument>(std::move(document)));
+		return;
+	}
+
+	// Parse into the main parser, like a regular load
+	stop_progressive();
+	stop_watching();
+	clear_prefetched_rows();
+	forget_main_document();
+	bytes.reserve(bytes.size() + qsizetype(simdjson::SIMDJSON_PADDING));
+	simdjson::dom::element doc;
+	auto error = parser.parse(bytes.constData(), size_t(bytes.size()), false).get(doc);
+	if (error) {
+		qInfo() << "Error: " << error;
+		ui.statusBar->showMessage(QString("Clipboard: %1").arg(simdjson::error_message(error)));
+		return;
+	}
+	QTreeWidgetItem* root = new QTreeWidgetItem();
+	add_children_to_item(root, doc);
+	ui.treeWidget->insertTopLevelItem(0, root);
+	register_document(root, QString(), &parser.doc, doc, nullptr);
+	ui.statusBar->showMessage(QString("Clipboard: %1 MB parsed in %2 ms").arg(bytes.size() / (1024.0 * 1024.0), 0, 'f', 1).arg(timer.elapsed()));
+}
+
+// Method: Triggered when "Out-of-core directory..." is chosen. Asks for the directory of the temporary files of
+// out-of-core mode; they only relieve memory on a disk, which the system temporary directory often is not.
+void JsonReader::on_actionOutOfCoreDirectory_triggered() {
+	bool ok = false;
+	const QString directory = QInputDialog::getText(
+		this,
+		"Out-of-core directory",
+		"Directory of the temporary files of out-of-core mode (empty for the directory of the file being loaded):",
+		QLineEdit::Normal,
+		outOfCoreDirectory,
+		&ok
+	).trimmed();
+	if (!ok) {
+		return;
+	}
+	if (!directory.isEmpty() && !QFileInfo(directory).isDir()) {
+		QMessageBox::warning(this, "Out-of-core directory", QString("%1 is not a directory").arg(directory));
+		return;
+	}
+	outOfCoreDirectory = directory;
+	QSettings("JsonReader", "JsonReader").setValue("outOfCore/directory", outOfCoreDirectory);
+}
+
+// Method: Triggered when "Probe file..." is chosen. Shows the shape of a file without loading it
+void JsonReader::on_actionProbeFile_triggered() {
+	QString filename = QFileDialog::getOpenFileName(
+		this,
+		"Probe JSON file",
+		"",
+		"JSON Files (*.json *.ndjson *.jsonl);;All Files (*)"
+	);
+	if (filename.isEmpty()) {
+		return;
+	}
+
+	FileProbe probe;
+	auto error = probe.run(filename.toStdString());
+	if (error) {
+		qInfo() << "Error: " << error;
+		return;
+	}
+	ui.statusBar->showMessage(QString::fromStdString(probe.summary()));
+}
+
+// Method: Triggered when "Load with projection..." is chosen. Asks for path patterns, then loads only the parts of
+// the file they match; the rest of the input is skipped without being parsed into the DOM.
+void JsonReader::on_actionLoadProjection_triggered() {
+	bool ok = false;
+	QString patterns = QInputDialog::getText(
+		this,
+		"Load with projection",
+		"Paths to keep (JSON Pointers, * matches any member or element, separated by commas):",
+		QLineEdit::Normal,
+		lastProjection,
+		&ok
+	);
+	if (!ok || patterns.trimmed().isEmpty()) {
+		return;
+	}
+	Projection projection;
+	auto error = projection.set_patterns(Projection::split_patterns(patterns.toStdString()));
+	if (error) {
+		qInfo() << "Error: " << error;
+		return;
+	}
+	lastProjection = patterns;
+
+	QString filename = QFileDialog::getOpenFileName(
+		this,
+		"Open JSON file",
+		"",
+		"JSON Files (*.json);;All Files (*)"
+	);
+	if (filename.isEmpty()) {
+		return;
+	}
+
+	// Parse the projection into the main parser, like a regular load
+	stop_progressive();
+	stop_watching();
+	clear_prefetched_rows();
+	forget_main_document();
+	size_t projectedBytes = 0;
+	simdjson::dom::element doc;
+	error = projection.load(parser, filename.toStdString(), projectedBytes).get(doc);
+	if (error) {
+		qInfo() << "Error: " << error;
+		return;
+	}
+
+	// Registered as the main parser's document, so that its rows go when the next one replaces it. It has no path:
+	// its rows are not those of the file, which can neither be edited through them nor reopened in their place.
+	QTreeWidgetItem* root = new QTreeWidgetItem();
+	add_children_to_item(root, doc);
+	ui.treeWidget->insertTopLevelItem(0, root);
+	register_document(root, QString(), &parser.doc, doc, nullptr);
+	ui.statusBar->showMessage(QString("Projected %1 of %2 MB").arg(projectedBytes / (1024.0 * 1024.0), 0, 'f', 1).arg(QFileInfo(filename).size() / (1024.0 * 1024.0), 0, 'f', 1));
+}
+
+// Method: Triggered when "Extract pointer..." is chosen. Asks for a JSON Pointer, then parses only the value it points to;
+// the file is scanned up to the end of that value and everything else is skipped.
+void JsonReader::on_actionExtractPointer_triggered() {
+	bool ok = false;
+	QString pointer = QInputDialog::getText(
+		this,
+		"Extract pointer",
+		"JSON Pointer of the value to load (such as /config/routes):",
+		QLineEdit::Normal,
+		lastPointer,
+		&ok
+	);
+	if (!ok) {
+		return;
+	}
+	lastPointer = pointer;
+
+	QString filename = QFileDialog::getOpenFileName(
+		this,
+		"Open JSON file",
+		"",
+		"JSON Files (*.json);;All Files (*)"
+	);
+	if (filename.isEmpty()) {
+		return;
+	}
+
+	stop_progressive();
+	stop_watching();
+	clear_prefetched_rows();
+	forget_main_document();
+	PointerExtractor extractor;
+	simdjson::dom::element doc;
+	auto error = extractor.load(parser, filename.toStdString(), pointer.toStdString()).get(doc);
+	if (error) {
+		qInfo() << "Error: " << error;
+		ui.statusBar->showMessage(QString("%1: %2").arg(pointer, simdjson::error_message(error)));
+		return;
+	}
+
+	// The document is an object holding the target under its pointer, so the target is the only child of the root.
+	// Like a projection it is the main parser's document, without a path.
+	QTreeWidgetItem* root = new QTreeWidgetItem();
+	add_children_to_item(root, doc);
+	ui.treeWidget->insertTopLevelItem(0, root);
+	register_document(root, QString(), &parser.doc, doc, nullptr);
+	ui.statusBar->showMessage(QString("Extracted %1 KB, scanned %2 MB in %3 ms").arg(extractor.bytes_extracted() / 1024.0, 0, 'f', 1).arg(extractor.bytes_scanned() / (1024.0 * 1024.0), 0, 'f', 1).arg(int(extractor.seconds() * 1000.0)));
+}
+
+// Method: Triggered when "Sample file..." is chosen. Asks for a sample size and a seed, then shows randomly chosen records of
+// a large array or NDJSON file, each labelled with its byte offset. The sample does not depend on the file size.
+void JsonReader::on_actionSampleFile_triggered() {
+	bool ok = false;
+	const int count = QInputDialog::getInt(this, "Sample file", "Number of records:", int(SampledDocument::DEFAULT_COUNT), 1, 10000000, 1, &ok);
+	if (!ok) {
+		return;
+	}
+	const int seed = QInputDialog::getInt(this, "Sample file", "Seed (the same seed picks the same records):", sampleSeed, 0, INT_MAX, 1, &ok);
+	if (!ok) {
+		return;
+	}
+	sampleSeed = seed;
+
+	QString filename = QFileDialog::getOpenFileName(
+		this,
+		"Sample JSON file",
+		"",
+		"JSON Files (*.json *.ndjson *.jsonl);;All Files (*)"
+	);
+	if (filename.isEmpty()) {
+		return;
+	}
+	load_sample(filename, count, seed);
+}
+
+bool JsonReader::load_sample(const QString& filename, int count, int seed) {
+	auto document = std::make_unique<SampledDocument>();
+	auto error = document->load(filename.toStdString(), size_t(count), uint64_t(seed));
+	if (error) {
+		qInfo() << "Error: " << error;
+		return false;
+	}
+
+	QTreeWidgetItem* root = new QTreeWidgetItem();
+	for (size_t i = 0; i < document->size(); i++) {
+		add_child_to_item(root, "@" + std::to_string(document->offset(i)), document->record(i));
+	}
+	ui.treeWidget->insertTopLevelItem(0, root);
+	ui.statusBar->showMessage(QString("Sample of %1 %2 (seed %3%4) in %5 ms - File > Load full file loads everything")
+		.arg(document->size())
+		.arg(document->is_ndjson() ? "records" : "elements")
+		.arg(seed)
+		.arg(document->is_exact() ? "" : ", by byte offset")
+		.arg(int(document->seconds() * 1000.0)));
+
+	documentOwners.insert(root, std::shared_ptr<SampledDocument>(std::move(document)));
+	sampledFile = filename;
+	ui.actionLoadFull->setEnabled(true);
+	return true;
+}
+
+// Method: Triggered when "Close document" is chosen. The current row of either view stands for the document under
+// its root.
+void JsonReader::on_actionCloseDocument_triggered() {
+	QTreeWidgetItem* root = activeTree->currentItem();
+	while (root != nullptr && root->parent() != nullptr) {
+		root = root->parent();
+	}
+	root = splitRootSources.value(root, root);
+	if (root == nullptr) {
+		ui.statusBar->showMessage("Select a row of the document to close");
+		return;
+	}
+	if (pendingRestores.contains(root)) {
+		ui.statusBar->showMessage("The document is still being restored");
+		return;
+	}
+	close_document(root);
+}
+
+// Method: Triggered when "Load full file" is chosen. Loads the file of the last sample like the "Load" button would
+void JsonReader::on_actionLoadFull_triggered() {
+	if (!sampledFile.isEmpty()) {
+		load_file(sampledFile);
+	}
+}
+
+// Method: Starts reading the file in the background and adds a root item whose entries are found by a structural
+// scan as the bytes arrive. The reading thread parses the whole input once it is read; until then, rows whose
+// range is complete are parsed on their own when expanded.
+void JsonReader::load_progressive(const QString& filename) {
+	stop_progressive();
+	auto reader = std::make_shared<OverlappedReader>();
+	auto error = reader->open(filename.toStdString(), ui.actionOverlappedReads->isChecked());
+	if (error) {
+		qInfo() << "Error: " << error;
+		return;
+	}
+
+	progressiveReader = reader;
+	progressiveFile = filename;
+	progressiveAvailable = 0;
+	progressiveTimer.start();
+	firstRowMs = -1;
+	progressiveRoot = new QTreeWidgetItem();
+	ui.treeWidget->insertTopLevelItem(0, progressiveRoot);
+	watch_file(filename, progressiveRoot);
+	ProgressiveScan rootScan;
+	rootScan.item = progressiveRoot;
+	rootScan.base = 0;
+	progressiveScans.push_back(std::move(rootScan));
+
+	// Progress and the parse result are posted back to the UI thread; stale posts of an earlier load are ignored
+	const uint64_t generation = ++progressiveGeneration;
+	progressiveCancelled = false;
+	progressiveThread = std::thread([this, reader, generation]() {
+		size_t available = 0;
+		while (available < reader->size() && !progressiveCancelled) {
+			const size_t previous = available;
+			available = reader->wait_for(available + OverlappedReader::CHUNK_SIZE);
+			if (available == previous) {
+				break;
+			}
+			QMetaObject::invokeMethod(this, [this, generation, available]() {
+				if (generation == progressiveGeneration) {
+					progressive_read(available);
+				}
+			}, Qt::QueuedConnection);
+		}
+		if (progressiveCancelled) {
+			return;
+		}
+
+		auto fullParser = std::make_shared<simdjson::dom::parser>();
+		simdjson::error_code parseError = reader->error();
+		if (!parseError) {
+			parseError = available == reader->size() ? fullParser->parse(reader->data(), reader->size(), false).error() : simdjson::IO_ERROR;
+		}
+
+		// The input is at hand here, so the hashes of the version shown are taken from it for auto-reload
+		auto keys = std::make_shared<std::vector<std::string>>();
+		auto hashes = std::make_shared<std::vector<uint64_t>>();
+		if (!parseError) {
+			hash_top_level(reinterpret_cast<const char*>(reader->data()), reader->size(), *keys, *hashes);
+		}
+		QMetaObject::invokeMethod(this, [this, generation, fullParser, parseError, keys, hashes]() {
+			if (generation == progressiveGeneration) {
+				progressive_parsed(fullParser, parseError, std::move(*keys), std::move(*hashes));
+			}
+		}, Qt::QueuedConnection);
+	});
+}
+
+void JsonReader::stop_progressive() {
+	progressiveCancelled = true;
+	if (progressiveThread.joinable()) {
+		progressiveThread.join();
+	}
+	progressiveGeneration++;
+	progressiveScans.clear();
+	progressiveReader.reset();
+
+	// A root whose full parse did not finish was never registered, and its rows refer to the range parsers
+	if (progressiveRoot != nullptr && !sessionDocuments.contains(progressiveRoot)) {
+		if (progressiveRoot == watchedRoot) {
+			stop_watching();
+		}
+		remove_document_rows(progressiveRoot);
+	}
+	progressiveRoot = nullptr;
+	itemRangeMap.clear();
+	rangeParsers.clear();
+}
+
+// Method: Runs the active scans over the newly read bytes
+void JsonReader::progressive_read(size_t available) {
+	progressiveAvailable = available;
+	for (size_t i = 0; i < progressiveScans.size(); i++) {
+		feed_progressive_scan(progressiveScans[i]);
+	}
+	ui.statusBar->showMessage(QString("Reading: %1 of %2 MB").arg(available / (1024.0 * 1024.0), 0, 'f', 0).arg(progressiveReader->size() / (1024.0 * 1024.0), 0, 'f', 0));
+}
+
+void JsonReader::feed_progressive_scan(ProgressiveScan& scan) {
+	const char* data = reinterpret_cast<const char*>(progressiveReader->data());
+	scan.scanner.feed(data + scan.base, progressiveAvailable - scan.base, progressiveAvailable == progressiveReader->size());
+
+	// The open row, if any, is the first of the new entries; it only needs its end
+	const std::vector<TopLevelScanner::Entry>& entries = scan.scanner.entries();
+	for (size_t i = scan.completeRows; i < entries.size(); i++) {
+		if (i < scan.rows) {
+			itemRangeMap[scan.openRow].end = scan.base + entries[i].end;
+			scan.openRow = nullptr;
+		}
+		else {
+			add_range_child(scan, entries[i], false);
+		}
+	}
+	scan.completeRows = entries.size();
+
+	// A container still being read gets its row already, so that it can be expanded while the rest arrives
+	const TopLevelScanner::Entry* open = scan.scanner.open_entry();
+	if (open != nullptr && scan.rows == entries.size() && open->start < progressiveAvailable - scan.base) {
+		const char first = data[scan.base + open->start];
+		if (first == '{' || first == '[') {
+			scan.openRow = add_range_child(scan, *open, true);
+		}
+	}
+}
+
+// Method: Adds the row of an entry. Keys with escapes and scalar values are decoded by parsing them on their own.
+QTreeWidgetItem* JsonReader::add_range_child(ProgressiveScan& scan, const TopLevelScanner::Entry& entry, bool open) {
+	const char* data = reinterpret_cast<const char*>(progressiveReader->data());
+	const int index = int(scan.rows++);
+	const bool isObject = scan.scanner.root_type() == TopLevelScanner::RootType::OBJECT;
+
+	std::string key = isObject ? entry.key : std::to_string(index);
+	if (isObject && key.find('\\') != std::string::npos) {
+		const simdjson::padded_string quoted("\"" + entry.key + "\"");
+		std::string_view decoded;
+		if (!rangeParser.parse(quoted).get(decoded)) {
+			key = std::string(decoded);
+		}
+	}
+
+	const size_t start = scan.base + entry.start;
+	const size_t end = open ? 0 : scan.base + entry.end;
+	const char first = data[start];
+	QTreeWidgetItem* child;
+	if (first == '{' || first == '[') {
+		const auto type = first == '{' ? simdjson::dom::element_type::OBJECT : simdjson::dom::element_type::ARRAY;
+		child = new QTreeWidgetItem(QStringList() << QString::fromStdString(key + (first == '{' ? ": OBJECT" : ": ARRAY")));
+		child->setForeground(0, QBrush(get_element_color(type)));
+		child->addChild(new QTreeWidgetItem());
+		itemRangeMap.insert(child, RangeRef{ scan.item, index, start, end, false });
+	}
+	else {
+		simdjson::dom::element value;
+		if (rangeParser.parse(reinterpret_cast<const uint8_t*>(data) + start, end - start, false).get(value)) {
+			child = new QTreeWidgetItem(QStringList() << QString::fromStdString(key + ": " + std::string(data + start, end - start)));
+		}
+		else {
+			JsonElementDisplay elementDisplay = get_json_element_display(value);
+			child = new QTreeWidgetItem(QStringList() << QString::fromStdString(key + ": " + elementDisplay.value));
+			child->setForeground(0, QBrush(elementDisplay.color));
+		}
+	}
+	scan.item->addChild(child);
+
+	if (firstRowMs < 0) {
+		firstRowMs = progressiveTimer.elapsed();
+	}
+	return child;
+}
+
+// Method: Expands a range row before the full parse has finished
+void JsonReader::expand_range_item(QTreeWidgetItem* item) {
+	RangeRef& ref = itemRangeMap[item];
+	ref.expanded = true;
+	if (item->childCount() == 1 && item->child(0)->text(0) == "") {
+		delete item->takeChild(0);
+	}
+
+	// The end is not known yet: discover the children as the bytes arrive, like the root's
+	if (ref.end == 0) {
+		ProgressiveScan scan;
+		scan.item = item;
+		scan.base = ref.start;
+		progressiveScans.push_back(std::move(scan));
+		feed_progressive_scan(progressiveScans.back());
+		return;
+	}
+
+	auto rangeParserForItem = std::make_unique<simdjson::dom::parser>();
+	simdjson::dom::element element;
+	auto error = rangeParserForItem->parse(progressiveReader->data() + ref.start, ref.end - ref.start, false).get(element);
+	if (error) {
+		qInfo() << "Error: " << error;
+		return;
+	}
+	add_children_to_item(item, element);
+	expandedElementMap.insert(item, element);
+	rangeParsers.push_back(std::move(rangeParserForItem));
+}
+
+// Method: Takes over the parser of the finished background parse. Rows still known only by range are resolved to
+// their elements, and containers still being scanned get their remaining children from the document.
+void JsonReader::progressive_parsed(std::shared_ptr<simdjson::dom::parser> fullParser, simdjson::error_code error, std::vector<std::string> keys, std::vector<uint64_t> hashes) {
+	// The document shown so far may be referenced by copied data being written out
+	if (JsonMimeData::serializing()) {
+		QTimer::singleShot(RELOAD_DELAY_MS, this, [this, fullParser, error, keys, hashes, generation = progressiveGeneration]() {
+			if (generation == progressiveGeneration) {
+				progressive_parsed(fullParser, error, keys, hashes);
+			}
+		});
+		return;
+	}
+	if (progressiveThread.joinable()) {
+		progressiveThread.join();
+	}
+	if (error) {
+		qInfo() << "Error: " << error;
+		ui.statusBar->showMessage(QString("Parse failed; rows found so far remain available"));
+		progressiveScans.clear();
+		return;
+	}
+	clear_prefetched_rows();
+	forget_main_document();
+	parser = std::move(*fullParser);
+
+	// Elements of range rows, found through their parent's children; children lists are built once per parent
+	QHash<QTreeWidgetItem*, std::vector<simdjson::dom::element>> childrenOf;
+	std::function<simdjson::dom::element(QTreeWidgetItem*)> element_of = [&](QTreeWidgetItem* item) {
+		if (item == progressiveRoot) {
+			return parser.doc.root();
+		}
+		const RangeRef& ref = itemRangeMap[item];
+		auto found = childrenOf.find(ref.parent);
+		if (found == childrenOf.end()) {
+			std::vector<simdjson::dom::element> children;
+			const simdjson::dom::element parentElement = element_of(ref.parent);
+			if (parentElement.type() == simdjson::dom::element_type::OBJECT) {
+				for (auto [key, value] : simdjson::dom::object(parentElement)) {
+					children.push_back(value);
+				}
+			}
+			else if (parentElement.type() == simdjson::dom::element_type::ARRAY) {
+				for (auto value : simdjson::dom::array(parentElement)) {
+					children.push_back(value);
+				}
+			}
+			found = childrenOf.insert(ref.parent, std::move(children));
+		}
+		return found->at(size_t(ref.index));
+	};
+
+	// Rows the scans have not reached yet
+	for (ProgressiveScan& scan : progressiveScans) {
+		const simdjson::dom::element element = element_of(scan.item);
+		size_t index = 0;
+		if (element.type() == simdjson::dom::element_type::OBJECT) {
+			for (auto [key, value] : simdjson::dom::object(element)) {
+				if (index++ >= scan.rows) {
+					add_child_to_item(scan.item, std::string(key), value);
+				}
+			}
+		}
+		else if (element.type() == simdjson::dom::element_type::ARRAY) {
+			for (auto value : simdjson::dom::array(element)) {
+				if (index >= scan.rows) {
+					add_child_to_item(scan.item, std::to_string(index), value);
+				}
+				index++;
+			}
+		}
+	}
+
+	// Unexpanded range rows become ordinary lazily expanded elements; expanded ones are known by their element too,
+	// so that their children can be released and rebuilt, and located by path when the file is reloaded. Rows
+	// below them that were parsed from their range are pointed at the full document, so the range parsers can go.
+	for (auto it = itemRangeMap.begin(); it != itemRangeMap.end(); ++it) {
+		if (!it.value().expanded) {
+			itemElementMap.insert(it.key(), element_of(it.key()));
+		}
+		else {
+			expandedElementMap.insert(it.key(), element_of(it.key()));
+			rebind_item(it.key(), element_of(it.key()));
+		}
+	}
+
+	register_document(progressiveRoot, progressiveFile, &parser.doc, parser.doc.root(), nullptr);
+	if (progressiveRoot == watchedRoot) {
+		watchedKeys = std::move(keys);
+		watchedHashes = std::move(hashes);
+	}
+	ui.statusBar->showMessage(QString("Parsed in %1 ms, first rows after %2 ms").arg(progressiveTimer.elapsed()).arg(firstRowMs));
+	progressiveScans.clear();
+	progressiveReader.reset();
+	progressiveRoot = nullptr;
+	itemRangeMap.clear();
+	rangeParsers.clear();
+}
+
+// Method: Starts watching the file shown under 'root'. The top-level hashes of the version shown are computed from
+// the file in the background, and only if it still has the size and modification time it had when loaded; without
+// them the first reload rebuilds every row. A progressive load, whose root is registered later, hashes its own input.
+void JsonReader::watch_file(const QString& filename, QTreeWidgetItem* root) {
+	stop_watching();
+	if (!ui.actionAutoReload->isChecked()) {
+		return;
+	}
+	watchedFile = filename;
+	watchedRoot = root;
+	fileWatcher.addPath(filename);
+	const SessionDocument* document = session_document(root);
+	if (document == nullptr) {
+		return;
+	}
+
+	const uint64_t generation = ++reloadGeneration;
+	reloadThread = std::thread([this, generation, path = document->path, size = document->size, modified = document->modified]() {
+		auto keys = std::make_shared<std::vector<std::string>>();
+		auto hashes = std::make_shared<std::vector<uint64_t>>();
+		simdjson::padded_string input;
+		if (!simdjson::padded_string::load(path.toStdString()).get(input)) {
+			const QFileInfo info(path);
+			if (info.size() == size && info.lastModified() == modified) {
+				hash_top_level(input.data(), input.size(), *keys, *hashes);
+			}
+		}
+		QMetaObject::invokeMethod(this, [this, generation, keys, hashes]() {
+			if (generation == reloadGeneration) {
+				if (reloadThread.joinable()) {
+					reloadThread.join();
+				}
+				watchedKeys = std::move(*keys);
+				watchedHashes = std::move(*hashes);
+			}
+		}, Qt::QueuedConnection);
+	});
+}
+
+void JsonReader::stop_watching() {
+	reloadTimer.stop();
+	if (reloadThread.joinable()) {
+		reloadThread.join();
+	}
+	reloadGeneration++;
+	if (!watchedFile.isEmpty()) {
+		fileWatcher.removePath(watchedFile);
+	}
+	watchedFile.clear();
+	watchedRoot = nullptr;
+	watchedKeys.clear();
+	watchedHashes.clear();
+}
+
+// Method: Reparses the watched file in the background; the view is updated once the new version has parsed
+void JsonReader::reload_watched_file() {
+	if (watchedRoot == nullptr || progressiveThread.joinable()) {
+		return;
+	}
+	if (reloadThread.joinable()) {
+		reloadTimer.start(RELOAD_DELAY_MS);
+		return;
+	}
+
+	// Files replaced by a rename are no longer watched under their name
+	if (!fileWatcher.files().contains(watchedFile)) {
+		fileWatcher.addPath(watchedFile);
+	}
+
+	// The new version's tape and string buffer come from the same place as the current one's (see load_file)
+	const uint64_t generation = ++reloadGeneration;
+	const std::string path = watchedFile.toStdString();
+	const simdjson::dom::buffer_allocator* allocator = parser.doc.get_allocator();
+	reloadThread = std::thread([this, generation, path, allocator]() {
+		auto newParser = std::make_shared<simdjson::dom::parser>();
+		newParser->doc.set_allocator(allocator);
+		auto keys = std::make_shared<std::vector<std::string>>();
+		auto hashes = std::make_shared<std::vector<uint64_t>>();
+		simdjson::padded_string input;
+		simdjson::error_code error = simdjson::padded_string::load(path).get(input);
+		if (!error) {
+			error = newParser->parse(input).error();
+		}
+		if (!error) {
+			hash_top_level(input.data(), input.size(), *keys, *hashes);
+		}
+		QMetaObject::invokeMethod(this, [this, generation, newParser, keys, hashes, error]() {
+			if (generation == reloadGeneration) {
+				reload_parsed(newParser, error, std::move(*keys), std::move(*hashes));
+			}
+		}, Qt::QueuedConnection);
+	});
+}
+
+// Method: Hashes the bytes of each member or element of the root as they are in the input, found by a structural
+// scan, so that reloads can tell which changed without serializing the elements. Keys are kept raw, escapes and
+// all; a value only reformatted counts as changed. Nothing is hashed if the scan fails.
+void JsonReader::hash_top_level(const char* input, size_t length, std::vector<std::string>& keys, std::vector<uint64_t>& hashes) {
+	keys.clear();
+	hashes.clear();
+	TopLevelScanner scanner;
+	scanner.feed(input, length, true);
+	if (scanner.failed()) {
+		return;
+	}
+	for (const TopLevelScanner::Entry& entry : scanner.entries()) {
+		keys.push_back(entry.key);
+		hashes.push_back(uint64_t(std::hash<std::string_view>()(std::string_view(input + entry.start, entry.end - entry.start))));
+	}
+}
+
+// Method: Swaps in the new version. Members or elements of the root whose key and hash are unchanged keep their items,
+// rebound to the new elements, so their expansion and rows are reused; the others are rebuilt and re-expanded from
+// the paths saved beforehand, and the selection and scroll position are restored by path.
+void JsonReader::reload_parsed(std::shared_ptr<simdjson::dom::parser> newParser, simdjson::error_code error, std::vector<std::string> keys, std::vector<uint64_t> hashes) {
+	if (JsonMimeData::serializing()) {
+		QTimer::singleShot(RELOAD_DELAY_MS, this, [this, newParser, error, keys, hashes, generation = reloadGeneration]() {
+			if (generation == reloadGeneration) {
+				reload_parsed(newParser, error, keys, hashes);
+			}
+		});
+		return;
+	}
+	if (reloadThread.joinable()) {
+		reloadThread.join();
+	}
+	if (error) {
+		// The file may still be being written; the next change triggers another attempt
+		ui.statusBar->showMessage(QString("Reload failed (%1), keeping the current version").arg(simdjson::error_message(error)));
+		return;
+	}
+
+	// Save the view state as paths while the old elements are still valid
+	const QStringList expandedPaths = expanded_pointers(watchedRoot);
+	QString currentPath;
+	QString topPath;
+	const bool hasCurrent = item_pointer(ui.treeWidget->currentItem(), currentPath) == watchedRoot;
+	const bool hasTop = item_pointer(ui.treeWidget->itemAt(0, 0), topPath) == watchedRoot;
+
+	// Replace the document; prefetched rows and copied data refer to the old one
+	clear_prefetched_rows();
+	detach_mime_data();
+	if (validationDoc == &parser.doc) {
+		stop_validation();
+	}
+	if (exportDoc == &parser.doc) {
+		stop_export();
+	}
+	if (minimapDoc == &parser.doc) {
+		reset_minimap();
+	}
+	if (plotDoc == &parser.doc) {
+		stop_plotting();
+	}
+	if (patchDoc == &parser.doc) {
+		stop_patching();
+	}
+	if (cacheDoc == &parser.doc) {
+		stop_caching();
+	}
+	parser = std::move(*newParser);
+	const simdjson::dom::element root = parser.doc.root();
+	register_document(watchedRoot, watchedFile, &parser.doc, root, nullptr);
+	std::vector<std::string> names;
+	std::vector<simdjson::dom::element> values;
+	if (root.type() == simdjson::dom::element_type::OBJECT) {
+		for (auto [key, value] : simdjson::dom::object(root)) {
+			names.emplace_back(key);
+			values.push_back(value);
+		}
+	}
+	else if (root.type() == simdjson::dom::element_type::ARRAY) {
+		for (simdjson::dom::element value : simdjson::dom::array(root)) {
+			names.push_back(std::to_string(names.size()));
+			values.push_back(value);
+		}
+	}
+
+	// Reuse unchanged rows in place and rebuild the others in order
+	QList<QTreeWidgetItem*> oldChildren = watchedRoot->takeChildren();
+	size_t reused = 0;
+	for (size_t i = 0; i < values.size(); i++) {
+		const bool unchanged = i < size_t(oldChildren.size()) && i < watchedKeys.size() && i < keys.size()
+			&& watchedKeys[i] == keys[i] && watchedHashes[i] == hashes[i];
+		if (unchanged) {
+			watchedRoot->addChild(oldChildren[int(i)]);
+			rebind_item(oldChildren[int(i)], values[i]);
+			oldChildren[int(i)] = nullptr;
+			reused++;
+		}
+		else {
+			add_child_to_item(watchedRoot, names[i], values[i]);
+		}
+	}
+	for (QTreeWidgetItem* child : oldChildren) {
+		if (child != nullptr) {
+			forget_children(child);
+			itemElementMap.remove(child);
+			expandedElementMap.remove(child);
+			itemEmbeddedMap.remove(child);
+			release_embedded_document(child);
+			itemRangeMap.remove(child);
+			rowPrefetcher.forget(child);
+			if (child == lastMatch) {
+				lastMatch = nullptr;
+			}
+			delete child;
+		}
+	}
+	watchedKeys = std::move(keys);
+	watchedHashes = std::move(hashes);
+
+	// Restore the view state; rows that were kept are already expanded
+	for (const QString& path : expandedPaths) {
+		item_at_pointer(watchedRoot, path, true);
+	}
+	if (hasCurrent) {
+		if (QTreeWidgetItem* item = item_at_pointer(watchedRoot, currentPath, false)) {
+			ui.treeWidget->setCurrentItem(item);
+		}
+	}
+	if (hasTop) {
+		if (QTreeWidgetItem* item = item_at_pointer(watchedRoot, topPath, false)) {
+			ui.treeWidget->scrollToItem(item, QAbstractItemView::PositionAtTop);
+		}
+	}
+	ui.statusBar->showMessage(QString("Reloaded: %1 of %2 top-level rows unchanged").arg(reused).arg(values.size()));
+}
+
+// Method: Points the items of an unchanged subtree at the new document. The subtree has the same shape as before,
+// so the children of an expanded item are the children of its element in order.
+void JsonReader::rebind_item(QTreeWidgetItem* item, simdjson::dom::element element) {
+	// The subtree of an expanded string refers to its own document, which is unchanged
+	if (itemEmbeddedMap.contains(item)) {
+		itemEmbeddedMap.insert(item, element);
+	}
+	if (embeddedDocuments.contains(item)) {
+		return;
+	}
+	if (itemElementMap.contains(item)) {
+		itemElementMap.insert(item, element);
+	}
+	if (!expandedElementMap.contains(item)) {
+		return;
+	}
+	expandedElementMap.insert(item, element);
+	int index = 0;
+	if (element.type() == simdjson::dom::element_type::OBJECT) {
+		for (auto [key, value] : simdjson::dom::object(element)) {
+			if (index < item->childCount()) {
+				rebind_item(item->child(index++), value);
+			}
+		}
+	}
+	else if (element.type() == simdjson::dom::element_type::ARRAY) {
+		for (simdjson::dom::element value : simdjson::dom::array(element)) {
+			if (index < item->childCount()) {
+				rebind_item(item->child(index++), value);
+			}
+		}
+	}
+}
+
+// Method: Builds the JSON Pointer of an item from the keys of its ancestors' elements. Records of an NDJSON document
+// are addressed by their index.
+QTreeWidgetItem* JsonReader::item_pointer(QTreeWidgetItem* item, QString& pointer) {
+	if (item == nullptr) {
+		return nullptr;
+	}
+	QStringList tokens;
+	for (; item->parent() != nullptr; item = item->parent()) {
+		QTreeWidgetItem* parent = item->parent();
+		const int index = parent->indexOfChild(item);
+		simdjson::dom::element element;
+		OverlayRef overlay;
+		const bool patched = overlay_node(parent, overlay);
+		if (patched && overlay.overlay->kind(overlay.node) != PatchOverlay::Kind::VALUE) {
+			std::string_view key;
+			overlay.overlay->child_at(overlay.node, size_t(index), &key);
+			tokens.prepend(overlay.overlay->kind(overlay.node) == PatchOverlay::Kind::OBJECT
+				? QString::fromUtf8(key.data(), int(key.size())).replace("~", "~0").replace("/", "~1")
+				: QString::number(index));
+			continue;
+		}
+		if (parent->parent() == nullptr) {
+			const SessionDocument* document = session_document(parent);
+			if (document == nullptr) {
+				return nullptr;
+			}
+			if (document->ndjson != nullptr) {
+				tokens.prepend(QString::number(index));
+				continue;
+			}
+			element = patched ? overlay.overlay->element(overlay.node) : document->root;
+		}
+		else if (expandedElementMap.contains(parent)) {
+			element = expandedElementMap.value(parent);
+		}
+		else {
+			return nullptr;
+		}
+
+		if (element.type() == simdjson::dom::element_type::OBJECT) {
+			int i = 0;
+			for (auto [key, value] : simdjson::dom::object(element)) {
+				if (i++ == index) {
+					tokens.prepend(QString::fromUtf8(key.data(), int(key.size())).replace("~", "~0").replace("/", "~1"));
+					break;
+				}
+			}
+		}
+		else {
+			tokens.prepend(QString::number(index));
+		}
+	}
+	if (session_document(item) == nullptr) {
+		return nullptr;
+	}
+	pointer = tokens.isEmpty() ? QString() : "/" + tokens.join("/");
+	return item;
+}
+
+// Method: Finds the item at a JSON Pointer under 'root', expanding the items on the way if 'expand' is set.
+// Returns nullptr if the path no longer exists, or goes through an item that is not expanded. Strings expanded as
+// JSON are stepped into, their tokens following those of the string.
+QTreeWidgetItem* JsonReader::item_at_pointer(QTreeWidgetItem* root, const QString& pointer, bool expand) {
+	const SessionDocument* found = session_document(root);
+	if (found == nullptr) {
+		return nullptr;
+	}
+	const SessionDocument document = *found;
+	QTreeWidgetItem* item = root;
+	simdjson::dom::element element = document.root;
+	OverlayRef overlay;
+	bool patched = overlay_node(root, overlay);
+	if (patched && overlay.overlay->kind(overlay.node) == PatchOverlay::Kind::VALUE) {
+		element = overlay.overlay->element(overlay.node);
+		patched = false;
+	}
+	const QStringList tokens = pointer.isEmpty() ? QStringList() : pointer.mid(1).split('/');
+	for (int t = 0; t < tokens.size() && item != nullptr; t++) {
+		const std::string token = QString(tokens[t]).replace("~1", "/").replace("~0", "~").toStdString();
+
+		// Containers copied into the overlay of a patched document are stepped through the overlay
+		if (patched) {
+			size_t position = 0;
+			const PatchOverlay::NodeId child = overlay.overlay->find(overlay.node, token, position);
+			if (child == PatchOverlay::npos) {
+				return nullptr;
+			}
+			if (item != root && !item->isExpanded()) {
+				if (!expand) {
+					return nullptr;
+				}
+				item->setExpanded(true);
+			}
+			item = position < size_t(item->childCount()) ? item->child(int(position)) : nullptr;
+			overlay.node = child;
+			patched = overlay.overlay->kind(child) != PatchOverlay::Kind::VALUE;
+			element = overlay.overlay->element(child);
+			continue;
+		}
+		if (element.type() == simdjson::dom::element_type::STRING && item != root) {
+			if (itemEmbeddedMap.contains(item)) {
+				if (!expand) {
+					return nullptr;
+				}
+				item->setExpanded(true);
+			}
+			if (!embeddedDocuments.contains(item)) {
+				return nullptr;
+			}
+			element = embeddedDocuments.value(item)->root;
+		}
+		int index = -1;
+		simdjson::dom::element child;
+		if (item == root && document.ndjson != nullptr) {
+			bool ok = false;
+			index = QString::fromStdString(token).toInt(&ok);
+			if (!ok || index < 0 || size_t(index) >= document.ndjson->size()) {
+				index = -1;
+			}
+			else {
+				child = document.ndjson->record(size_t(index));
+			}
+		}
+		else if (element.type() == simdjson::dom::element_type::OBJECT) {
+			int i = 0;
+			for (auto [key, value] : simdjson::dom::object(element)) {
+				if (key == token) {
+					index = i;
+					child = value;
+					break;
+				}
+				i++;
+			}
+		}
+		else if (element.type() == simdjson::dom::element_type::ARRAY) {
+			bool ok = false;
+			index = QString::fromStdString(token).toInt(&ok);
+			if (!ok || element.at(size_t(index)).get(child)) {
+				index = -1;
+			}
+		}
+		if (index < 0) {
+			return nullptr;
+		}
+
+		if (item != root && !item->isExpanded()) {
+			if (!expand) {
+				return nullptr;
+			}
+			item->setExpanded(true);
+		}
+		item = index < item->childCount() ? item->child(index) : nullptr;
+		element = child;
+	}
+	if (item != nullptr && expand && item != root) {
+		item->setExpanded(true);
+	}
+	return item;
+}
+
+// Method: Resolves an item's element from the maps, or from its parent's element and its index among the children.
+// Records of an NDJSON document are its root's children.
+bool JsonReader::item_element(QTreeWidgetItem* item, simdjson::dom::element& element) {
+	if (item == nullptr) {
+		return false;
+	}
+	if (itemElementMap.contains(item)) {
+		element = itemElementMap.value(item);
+		return true;
+	}
+	if (expandedElementMap.contains(item)) {
+		element = expandedElementMap.value(item);
+		return true;
+	}
+	QTreeWidgetItem* parent = item->parent();
+
+	// Containers copied into the overlay of a patched document have no element; their values do
+	OverlayRef overlay;
+	if (overlay_node(item, overlay)) {
+		element = overlay.overlay->element(overlay.node);
+		return overlay.overlay->kind(overlay.node) == PatchOverlay::Kind::VALUE;
+	}
+	if (parent != nullptr && overlay_node(parent, overlay) && overlay.overlay->kind(overlay.node) != PatchOverlay::Kind::VALUE) {
+		const PatchOverlay::NodeId child = overlay.overlay->child_at(overlay.node, size_t(parent->indexOfChild(item)));
+		if (child == PatchOverlay::npos || overlay.overlay->kind(child) != PatchOverlay::Kind::VALUE) {
+			return false;
+		}
+		element = overlay.overlay->element(child);
+		return true;
+	}
+	if (parent == nullptr) {
+		const SessionDocument* document = session_document(item);
+		if (document == nullptr || document->ndjson != nullptr) {
+			return false;
+		}
+		element = document->root;
+		return true;
+	}
+
+	const int index = parent->indexOfChild(item);
+	const SessionDocument* document = parent->parent() == nullptr ? session_document(parent) : nullptr;
+	if (document != nullptr && document->ndjson != nullptr) {
+		if (size_t(index) >= document->ndjson->size()) {
+			return false;
+		}
+		element = document->ndjson->record(size_t(index));
+		return true;
+	}
+	simdjson::dom::element parentElement;
+	if (!item_element(parent, parentElement)) {
+		return false;
+	}
+	if (parentElement.type() == simdjson::dom::element_type::OBJECT) {
+		int i = 0;
+		for (auto [key, value] : simdjson::dom::object(parentElement)) {
+			if (i++ == index) {
+				element = value;
+				return true;
+			}
+		}
+		return false;
+	}
+	return parentElement.type() == simdjson::dom::element_type::ARRAY && !parentElement.at(size_t(index)).get(element);
+}
+
+// Method: Lists the expanded items under 'root' depth first, so that expanding them in order restores them
+QStringList JsonReader::expanded_pointers(QTreeWidgetItem* root) {
+	QStringList pointers;
+	std::function<void(QTreeWidgetItem*)> collect_expanded = [&](QTreeWidgetItem* item) {
+		for (int i = 0; i < item->childCount(); i++) {
+			QTreeWidgetItem* child = item->child(i);
+			if (child->isExpanded()) {
+				QString pointer;
+				if (item_pointer(child, pointer) == root) {
+					pointers << pointer;
+				}
+				collect_expanded(child);
+			}
+		}
+	};
+	collect_expanded(root);
+	return pointers;
+}
+
+void JsonReader::register_document(QTreeWidgetItem* root, const QString& path, const simdjson::dom::document* doc, simdjson::dom::element element, const NdjsonDocument* ndjson) {
+	const QFileInfo info(path);
+	SessionDocument document;
+	document.path = path.isEmpty() ? QString() : info.absoluteFilePath();
+	document.size = info.size();
+	document.modified = info.lastModified();
+	document.doc = doc;
+	document.root = element;
+	document.ndjson = ndjson;
+	sessionDocuments.insert(root, document);
+	add_split_root(root);
+	schedule_minimap();
+	if (doc != nullptr && !document.path.isEmpty()) {
+		schedule_tape_cache(root);
+	}
+}
+
+// Method: The main parser holds one document at a time; rows of the previous one can no longer be located or saved
+void JsonReader::forget_main_document() {
+	detach_mime_data();
+	if (validationDoc == &parser.doc) {
+		stop_validation();
+		validationRoot = nullptr;
+		validationDoc = nullptr;
+	}
+	if (exportDoc == &parser.doc) {
+		stop_export();
+	}
+	if (patchDoc == &parser.doc) {
+		stop_patching();
+	}
+	if (minimapDoc == &parser.doc) {
+		reset_minimap();
+	}
+	if (plotDoc == &parser.doc) {
+		stop_plotting();
+	}
+	for (auto it = sessionDocuments.begin(); it != sessionDocuments.end(); ) {
+		if (it->doc == &parser.doc) {
+			QTreeWidgetItem* root = it.key();
+			remove_split_root(root);
+			remove_overlay(root);
+			it = sessionDocuments.erase(it);
+			remove_document_rows(root);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+// Method: The rows of a document refer to its elements, so they go with it rather than staying for the rest of the
+// session; a value being located for an edit may be shown in them, so that is stopped first
+void JsonReader::remove_document_rows(QTreeWidgetItem* root) {
+	stop_editing();
+	if (root == cacheRoot) {
+		stop_caching();
+	}
+	pendingCaches.removeAll(root);
+	forget_children(root);
+	itemElementMap.remove(root);
+	expandedElementMap.remove(root);
+	itemOverlayMap.remove(root);
+	expandedOverlayMap.remove(root);
+	rowPrefetcher.forget(root);
+	if (root == lastMatch) {
+		lastMatch = nullptr;
+	}
+	if (root == plotRoot) {
+		plotRoot = nullptr;
+	}
+	delete root;
+	documentOwners.remove(root);
+}
+
+// Method: Jobs reading the document are stopped and the data handed out of its rows written out before the rows
+// and what they refer to go
+void JsonReader::close_document(QTreeWidgetItem* root) {
+	if (root == progressiveRoot && !sessionDocuments.contains(root)) {
+		// Its full parse has not finished, and stopping it removes the root
+		stop_progressive();
+		return;
+	}
+	if (root == watchedRoot) {
+		stop_watching();
+	}
+	detach_mime_data();
+	clear_prefetched_rows();
+	const bool registered = sessionDocuments.contains(root);
+	const simdjson::dom::document* doc = registered ? sessionDocuments[root].doc : nullptr;
+	if (root == validationRoot) {
+		stop_validation();
+		validationRoot = nullptr;
+		validationDoc = nullptr;
+	}
+	if (root == exportRoot) {
+		stop_export();
+	}
+	if (doc != nullptr && patchDoc == doc) {
+		stop_patching();
+	}
+	if (root == minimapRoot) {
+		reset_minimap();
+	}
+	if (root == plotRoot) {
+		stop_plotting();
+	}
+	if (registered) {
+		remove_split_root(root);
+		remove_overlay(root);
+		sessionDocuments.remove(root);
+	}
+	remove_document_rows(root);
+	schedule_minimap();
+}
+
+// Method: Queues the document for a tape cache and waits for CACHE_DELAY_MS without further loads before writing
+void JsonReader::schedule_tape_cache(QTreeWidgetItem* root) {
+	if (!useSession) {
+		return;
+	}
+	if (!pendingCaches.contains(root)) {
+		pendingCaches.append(root);
+	}
+	cacheTimer.start(CACHE_DELAY_MS);
+}
+
+// Method: Writes the cache of the next queued document on a background thread, unless a load, reload or restore is
+// running or copied data is being written out, in which case it waits again. The thread checks that the file is
+// unchanged since it was loaded and has no valid cache yet, so documents restored from their cache are skipped.
+void JsonReader::write_next_tape_cache() {
+	if (!ui.actionRestoreSession->isChecked()) {
+		pendingCaches.clear();
+		return;
+	}
+	if (cacheThread.joinable()) {
+		return;
+	}
+	if (progressiveThread.joinable() || reloadThread.joinable() || !restoreThreads.empty() || JsonMimeData::serializing()) {
+		cacheTimer.start(CACHE_DELAY_MS);
+		return;
+	}
+	while (!pendingCaches.isEmpty()) {
+		QTreeWidgetItem* root = pendingCaches.takeFirst();
+		const SessionDocument* document = session_document(root);
+		if (document == nullptr || document->doc == nullptr || document->path.isEmpty()) {
+			continue;
+		}
+
+		cacheRoot = root;
+		cacheDoc = document->doc;
+		cacheCancelled = false;
+		const uint64_t generation = ++cacheGeneration;
+		const std::string cacheDirectory = tape_cache_directory().toStdString();
+		cacheThread = std::thread([this, generation, cacheDirectory, doc = cacheDoc, path = document->path, size = document->size, modified = document->modified]() {
+			simdjson::error_code error = simdjson::SUCCESS;
+			const std::string sourcePath = path.toStdString();
+			const std::string cachePath = TapeCache::cache_path(cacheDirectory, sourcePath);
+			const QFileInfo info(path);
+			if (info.size() == size && info.lastModified() == modified && !TapeCache::is_valid(cachePath, sourcePath)) {
+				error = TapeCache::save(*doc, sourcePath, cachePath, &cacheCancelled);
+			}
+			QMetaObject::invokeMethod(this, [this, generation, error]() {
+				if (generation == cacheGeneration) {
+					tape_cache_written(error);
+				}
+			}, Qt::QueuedConnection);
+		});
+		return;
+	}
+}
+
+void JsonReader::tape_cache_written(simdjson::error_code error) {
+	if (cacheThread.joinable()) {
+		cacheThread.join();
+	}
+	cacheRoot = nullptr;
+	cacheDoc = nullptr;
+	if (error) {
+		qInfo() << "Error: " << error;
+	}
+	if (!pendingCaches.isEmpty()) {
+		cacheTimer.start(CACHE_DELAY_MS);
+	}
+}
+
+// Method: A cache interrupted while being written is removed by TapeCache::save
+void JsonReader::stop_caching() {
+	cacheCancelled = true;
+	if (cacheThread.joinable()) {
+		cacheThread.join();
+	}
+	cacheGeneration++;
+	cacheRoot = nullptr;
+	cacheDoc = nullptr;
+}
+
+QString JsonReader::tape_cache_directory() {
+	return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/JsonReader/tapes";
+}
+
+// Method: Saves the registered documents in the order they are shown, with their expanded rows, the current and top
+// rows and the search text. Tape caches were written in the background (see write_next_tape_cache); those of files
+// no longer in the session are removed.
+void JsonReader::save_session() {
+	QSettings settings("JsonReader", "JsonReader");
+	settings.remove("session");
+	settings.setValue("session/restore", ui.actionRestoreSession->isChecked());
+	if (!ui.actionRestoreSession->isChecked()) {
+		return;
+	}
+
+	QString currentPath;
+	QString topPath;
+	QTreeWidgetItem* currentRoot = item_pointer(ui.treeWidget->currentItem(), currentPath);
+	QTreeWidgetItem* topRoot = item_pointer(ui.treeWidget->itemAt(0, 0), topPath);
+	const std::string cacheDirectory = tape_cache_directory().toStdString();
+	QSet<QString> caches;
+
+	settings.beginWriteArray("session/documents");
+	int written = 0;
+	for (int i = 0; i < ui.treeWidget->topLevelItemCount(); i++) {
+		QTreeWidgetItem* root = ui.treeWidget->topLevelItem(i);
+		SavedDocument saved;
+		if (pendingRestores.contains(root)) {
+			saved = pendingRestores.value(root);
+		}
+		else if (sessionDocuments.contains(root) && !sessionDocuments[root].path.isEmpty()) {
+			const SessionDocument& document = sessionDocuments[root];
+			saved.path = document.path;
+			saved.ndjson = document.ndjson != nullptr;
+			saved.expanded = expanded_pointers(root);
+			saved.hasCurrent = currentRoot == root;
+			saved.current = currentPath;
+			saved.hasTop = topRoot == root;
+			saved.top = topPath;
+
+			if (document.doc != nullptr) {
+				caches.insert(QFileInfo(QString::fromStdString(TapeCache::cache_path(cacheDirectory, document.path.toStdString()))).fileName());
+			}
+		}
+		else {
+			continue;
+		}
+
+		settings.setArrayIndex(written++);
+		settings.setValue("path", saved.path);
+		settings.setValue("ndjson", saved.ndjson);
+		settings.setValue("expanded", saved.expanded);
+		if (saved.hasCurrent) {
+			settings.setValue("current", saved.current);
+		}
+		if (saved.hasTop) {
+			settings.setValue("top", saved.top);
+		}
+		if (pendingRestores.contains(root) && !saved.ndjson) {
+			caches.insert(QFileInfo(QString::fromStdString(TapeCache::cache_path(cacheDirectory, saved.path.toStdString()))).fileName());
+		}
+	}
+	settings.endArray();
+	settings.setValue("session/searchText", ui.textEdit->toPlainText());
+	settings.setValue("session/caseSensitive", ui.radioCapital->isChecked());
+
+	QDir directory(tape_cache_directory());
+	for (const QString& name : directory.entryList(QStringList() << "*.tape", QDir::Files)) {
+		if (!caches.contains(name)) {
+			directory.remove(name);
+		}
+	}
+}
+
+// Method: Adds a placeholder root per saved document, in the saved order, and loads each document on its own thread:
+// DOM documents from their tape cache if it matches the file, or by parsing the file otherwise
+void JsonReader::restore_session() {
+	if (!ui.actionRestoreSession->isChecked()) {
+		return;
+	}
+	QSettings settings("JsonReader", "JsonReader");
+
+	// The search text is restored without searching; "Search next" continues from the restored current row
+	{
+		const QSignalBlocker textBlocker(ui.textEdit);
+		const QSignalBlocker radioBlocker(ui.radioCapital);
+		ui.textEdit->setPlainText(settings.value("session/searchText").toString());
+		ui.radioCapital->setChecked(settings.value("session/caseSensitive", false).toBool());
+	}
+	lastSearchText = ui.textEdit->toPlainText();
+
+	const int count = settings.beginReadArray("session/documents");
+	const std::string cacheDirectory = tape_cache_directory().toStdString();
+	const bool overlappedReads = ui.actionOverlappedReads->isChecked();
+	restoreTimer.start();
+	restoredFromCache = 0;
+	for (int i = 0; i < count; i++) {
+		settings.setArrayIndex(i);
+		auto job = std::make_unique<RestoreJob>();
+		job->saved.path = settings.value("path").toString();
+		job->saved.ndjson = settings.value("ndjson").toBool();
+		job->saved.expanded = settings.value("expanded").toStringList();
+		job->saved.hasCurrent = settings.contains("current");
+		job->saved.current = settings.value("current").toString();
+		job->saved.hasTop = settings.contains("top");
+		job->saved.top = settings.value("top").toString();
+		if (!QFileInfo::exists(job->saved.path)) {
+			continue;
+		}
+		if (job->saved.ndjson) {
+			job->ndjson = std::make_unique<NdjsonDocument>();
+		}
+		else {
+			job->parser = std::make_unique<simdjson::dom::parser>();
+		}
+		job->root = new QTreeWidgetItem(QStringList() << "Restoring " + QFileInfo(job->saved.path).fileName() + "...");
+		ui.treeWidget->addTopLevelItem(job->root);
+		pendingRestores.insert(job->root, job->saved);
+
+		RestoreJob* restoring = job.get();
+		restoreJobs.push_back(std::move(job));
+		restoreThreads.emplace_back([this, restoring, cacheDirectory, overlappedReads]() {
+			const std::string path = restoring->saved.path.toStdString();
+			if (restoring->ndjson) {
+				restoring->error = restoring->ndjson->load(path, overlappedReads);
+			}
+			else {
+				restoring->fromCache = !TapeCache::load(restoring->parser->doc, path, TapeCache::cache_path(cacheDirectory, path));
+				if (!restoring->fromCache) {
+					restoring->error = restoring->parser->load(path).error();
+				}
+			}
+			QMetaObject::invokeMethod(this, [this, restoring]() { restore_loaded(restoring); }, Qt::QueuedConnection);
+		});
+	}
+	settings.endArray();
+}
+
+// Method: Fills the placeholder root of a restored document, then restores its expanded rows, and the current and
+// top rows if they were its own. Once every document is in, the threads are joined.
+void JsonReader::restore_loaded(RestoreJob* job) {
+	QTreeWidgetItem* root = job->root;
+	pendingRestores.remove(root);
+	root->setText(0, QString());
+	if (job->error) {
+		qInfo() << "Error: " << job->error;
+		ui.statusBar->showMessage(QString("Could not restore %1: %2").arg(job->saved.path, simdjson::error_message(job->error)));
+		if (root == lastMatch) {
+			lastMatch = nullptr;
+		}
+		delete root;
+	}
+	else {
+		if (job->ndjson) {
+			for (size_t i = 0; i < job->ndjson->size(); i++) {
+				add_child_to_item(root, std::to_string(i), job->ndjson->record(i));
+			}
+			register_document(root, job->saved.path, nullptr, simdjson::dom::element(), job->ndjson.get());
+			documentOwners.insert(root, std::shared_ptr<NdjsonDocument>(std::move(job->ndjson)));
+		}
+		else {
+			add_children_to_item(root, job->parser->doc.root());
+			register_document(root, job->saved.path, &job->parser->doc, job->parser->doc.root(), nullptr);
+			documentOwners.insert(root, std::shared_ptr<simdjson::dom::parser>(std::move(job->parser)));
+			restoredFromCache += job->fromCache ? 1 : 0;
+		}
+
+		for (const QString& pointer : job->saved.expanded) {
+			item_at_pointer(root, pointer, true);
+		}
+		if (job->saved.hasCurrent) {
+			if (QTreeWidgetItem* item = item_at_pointer(root, job->saved.current, false)) {
+				ui.treeWidget->setCurrentItem(item);
+				lastMatch = item;
+			}
+		}
+		if (job->saved.hasTop) {
+			if (QTreeWidgetItem* item = item_at_pointer(root, job->saved.top, false)) {
+				ui.treeWidget->scrollToItem(item, QAbstractItemView::PositionAtTop);
+			}
+		}
+	}
+
+	if (pendingRestores.isEmpty()) {
+		const int restored = int(restoreJobs.size());
+		stop_restoring();
+		ui.statusBar->showMessage(QString("Session restored: %1 documents in %2 ms, %3 from tape caches").arg(restored).arg(restoreTimer.elapsed()).arg(restoredFromCache));
+	}
+}
+
+// Method: Waits for the restoring threads. Documents they have not handed over are dropped with their jobs.
+void JsonReader::stop_restoring() {
+	for (std::thread& thread : restoreThreads) {
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+	restoreThreads.clear();
+	restoreJobs.clear();
+}
+
+// Method: Polls the memory governor, reports evictions in the status bar and shows the budget next to it
+void JsonReader::poll_memory() {
+	if (!ui.actionMemoryGovernor->isChecked()) {
+		memoryLabel->clear();
+		return;
+	}
+
+	for (const MemoryGovernor::Eviction& eviction : memoryGovernor.poll()) {
+		ui.statusBar->showMessage(QString("Memory pressure: released %1 (%2 MB)").arg(QString::fromStdString(eviction.name)).arg(eviction.bytes / (1024.0 * 1024.0), 0, 'f', 1), 5000);
+	}
+
+	const MemoryGovernor::Budget& budget = memoryGovernor.last_budget();
+	if (!budget.known) {
+		memoryLabel->setText("Memory budget unknown");
+		return;
+	}
+	QString text = QString("Memory %1").arg(budget.current / (1024.0 * 1024.0), 0, 'f', 0);
+	text += budget.limit ? QString(" / %1 MB").arg(budget.limit / (1024.0 * 1024.0), 0, 'f', 0) : QString(" MB (no limit)");
+	text += QString(", pressure %1%").arg(budget.pressureSome, 0, 'f', 1);
+	memoryLabel->setText(text);
+
+	// The tooltip lists the latest evictions, most recent first
+	QStringList evicted;
+	const auto& history = memoryGovernor.history();
+	for (auto it = history.rbegin(); it != history.rend() && evicted.size() < 10; ++it) {
+		evicted << QString("%1 (%2 MB)").arg(QString::fromStdString(it->name)).arg(it->bytes / (1024.0 * 1024.0), 0, 'f', 1);
+	}
+	memoryLabel->setToolTip(evicted.isEmpty() ? QString("Nothing evicted") : "Evicted: " + evicted.join(", "));
+}
+
+// Method: Empties the decompressed block caches of compact documents with compressed input
+size_t JsonReader::trim_decompressed_blocks() {
+	size_t bytes = 0;
+	for (const auto& compactDocument : compactDocuments) {
+		if (auto compressed = dynamic_cast<const CompressedSource*>(&compactDocument->tree.get_source())) {
+			bytes += compressed->trim_cache();
+		}
+	}
+	return bytes;
+}
+
+// Method: Replaces the children of expanded items that are collapsed again with a placeholder, so that they are
+// rebuilt on the next expand. Items on the path to the current item are kept.
+size_t JsonReader::release_collapsed_subtrees() {
+	QSet<QTreeWidgetItem*> keep;
+	for (QTreeWidgetItem* item = ui.treeWidget->currentItem(); item != nullptr; item = item->parent()) {
+		keep.insert(item);
+	}
+	for (QTreeWidgetItem* item = splitTree ? splitTree->currentItem() : nullptr; item != nullptr; item = item->parent()) {
+		keep.insert(item);
+	}
+
+	size_t released = 0;
+	const QList<QTreeWidgetItem*> candidates = expandedElementMap.keys() + expandedCompactMap.keys();
+	for (QTreeWidgetItem* item : candidates) {
+		// Items released together with an ancestor are no longer in the maps
+		const bool isElement = expandedElementMap.contains(item);
+		if ((!isElement && !expandedCompactMap.contains(item)) || item->isExpanded() || keep.contains(item)) {
+			continue;
+		}
+		released += forget_children(item);
+		qDeleteAll(item->takeChildren());
+		item->addChild(new QTreeWidgetItem());
+		if (isElement) {
+			itemElementMap.insert(item, expandedElementMap.take(item));
+		}
+		else {
+			itemCompactMap.insert(item, expandedCompactMap.take(item));
+		}
+	}
+	return released * ITEM_BYTES_ESTIMATE;
+}
+
+// Method: Releases the parser's stage 1 index, which the next parse allocates again
+size_t JsonReader::release_parser_index() {
+	const size_t bytes = parser.capacity() * sizeof(uint32_t);
+	if (bytes == 0 || parser.allocate(0, parser.max_depth())) {
+		return 0;
+	}
+	return bytes;
+}
+
+size_t JsonReader::forget_children(QTreeWidgetItem* item) {
+	size_t count = 0;
+	for (int i = 0; i < item->childCount(); i++) {
+		QTreeWidgetItem* child = item->child(i);
+		count += 1 + forget_children(child);
+		itemElementMap.remove(child);
+		itemCompactMap.remove(child);
+		itemEmbeddedMap.remove(child);
+		release_embedded_document(child);
+		rowPrefetcher.forget(child);
+		expandedElementMap.remove(child);
+		expandedCompactMap.remove(child);
+		itemOverlayMap.remove(child);
+		expandedOverlayMap.remove(child);
+		if (child == lastMatch) {
+			lastMatch = nullptr;
+		}
+	}
+	return count;
+}
+
+// Method: Triggered when the "Copy" button is clicked. Puts the selected items on the clipboard; their JSON is only
+// written when it is pasted
+void JsonReader::on_copyBtn_clicked() {
+	if (activeTree->selectedItems().isEmpty()) {
+		return;
+	}
+	QApplication::clipboard()->setMimeData(selection_mime_data(activeTree));
+	ui.statusBar->showMessage(QString("Copied %1 rows").arg(activeTree->selectedItems().size()), 3000);
+}
+
+// Method: Describes each selected item by its element, or by the text of its subtree for rows without one
+JsonMimeData* JsonReader::selection_mime_data(QTreeWidget* tree) {
+	std::vector<JsonMimeData::Entry> entries;
+	for (QTreeWidgetItem* item : tree->selectedItems()) {
+		JsonMimeData::Entry entry{ false, simdjson::dom::element(), QString() };
+		entry.hasElement = item_element(item, entry.element);
+		if (!entry.hasElement) {
+			entry.text = copy_recursive(item).join(", ");
+		}
+		entries.push_back(entry);
+	}
+
+	JsonMimeData* data = new JsonMimeData(std::move(entries), this);
+	lazyMimeData.removeAll(QPointer<JsonMimeData>());
+	lazyMimeData.append(data);
+	return data;
+}
+
+// Method: Serializes the data still on the clipboard or being dragged, so that it survives the documents it refers to
+void JsonReader::detach_mime_data() {
+	for (const QPointer<JsonMimeData>& data : lazyMimeData) {
+		if (data) {
+			data->detach();
+		}
+	}
+	lazyMimeData.clear();
+}
+
+// Method: Triggered when "Validate against schema..." is chosen. Validates the document of the current row (or the
+// last one opened) on a background thread; NDJSON documents are validated record by record.
+void JsonReader::on_actionValidateSchema_triggered() {
+	QTreeWidgetItem* root = current_document_root();
+	const SessionDocument* document = session_document(root);
+	if (document == nullptr) {
+		ui.statusBar->showMessage("Open a document before validating it");
+		return;
+	}
+	QString filename = QFileDialog::getOpenFileName(
+		this,
+		"Open JSON Schema",
+		"",
+		"JSON Schema (*.json);;All files (*)"
+	);
+	if (filename.isEmpty()) {
+		return;
+	}
+
+	stop_validation();
+	simdjson::error_code error = schemaValidator.compile(filename.toStdString());
+	if (error) {
+		qInfo() << "Error: " << error;
+		QMessageBox::warning(this, "Validate against schema", QString("The schema cannot be used: %1").arg(QString::fromStdString(schemaValidator.message())));
+		return;
+	}
+
+	validationRoot = root;
+	validationDoc = document->doc;
+	validationList->clear();
+	validationDock->show();
+	ui.statusBar->showMessage("Validating...");
+	std::vector<simdjson::dom::element> records;
+	if (document->ndjson != nullptr) {
+		records.reserve(document->ndjson->size());
+		for (size_t i = 0; i < document->ndjson->size(); i++) {
+			records.push_back(document->ndjson->record(i));
+		}
+	}
+	const simdjson::dom::element element = document->root;
+	const bool ndjson = document->ndjson != nullptr;
+	const qint64 bytes = document->path.isEmpty() ? 0 : document->size;
+	const uint64_t generation = ++validationGeneration;
+	validationThread = std::thread([this, generation, records = std::move(records), element, ndjson, bytes]() {
+		auto violations = std::make_shared<std::vector<SchemaValidator::Violation>>(
+			ndjson ? schemaValidator.validate_each(records) : schemaValidator.validate(element));
+		QMetaObject::invokeMethod(this, [this, generation, violations, bytes]() {
+			if (generation == validationGeneration) {
+				validation_finished(std::move(*violations), bytes);
+			}
+		}, Qt::QueuedConnection);
+	});
+}
+
+void JsonReader::validation_finished(std::vector<SchemaValidator::Violation> violations, qint64 bytes) {
+	if (validationThread.joinable()) {
+		validationThread.join();
+	}
+	for (const SchemaValidator::Violation& violation : violations) {
+		const QString pointer = QString::fromStdString(violation.pointer);
+		QListWidgetItem* entry = new QListWidgetItem(QString("%1: %2").arg(pointer.isEmpty() ? "(root)" : pointer, QString::fromStdString(violation.message)), validationList);
+		entry->setData(Qt::UserRole, pointer);
+	}
+	const double seconds = schemaValidator.seconds();
+	QString message = violations.empty()
+		? QString("The document is valid")
+		: QString("%1%2 violations").arg(violations.size()).arg(schemaValidator.truncated() ? "+" : "");
+	message += QString(" (validated in %1 ms").arg(qint64(seconds * 1000));
+	if (bytes > 0 && seconds > 0) {
+		message += QString(", %1 MB/s").arg(bytes / (1024.0 * 1024.0) / seconds, 0, 'f', 0);
+	}
+	ui.statusBar->showMessage(message + ")");
+}
+
+void JsonReader::stop_validation() {
+	schemaValidator.cancel();
+	if (validationThread.joinable()) {
+		validationThread.join();
+	}
+	validationGeneration++;
+}
+
+// Method: Locates the value by its pointer, expanding the rows on the way, as the document may have been reloaded or
+// its rows collapsed since it was validated
+void JsonReader::show_violation(QListWidgetItem* entry) {
+	if (validationRoot == nullptr || !sessionDocuments.contains(validationRoot)) {
+		ui.statusBar->showMessage("The validated document is no longer open");
+		return;
+	}
+	const QString pointer = entry->data(Qt::UserRole).toString();
+	QTreeWidgetItem* item = pointer.isEmpty() ? validationRoot : item_at_pointer(validationRoot, pointer, true);
+	if (item == nullptr) {
+		ui.statusBar->showMessage(QString("%1 is no longer in the document").arg(pointer));
+		return;
+	}
+	ui.treeWidget->clearSelection();
+	ui.treeWidget->setCurrentItem(item);
+	item->setSelected(true);
+	ui.treeWidget->scrollToItem(item, QAbstractItemView::PositionAtCenter);
+}
+
+// Method: Triggered when "Export redacted..." is chosen. Asks for the rules and the file to write, then exports the
+// document of the current row on a background thread; NDJSON documents are written as NDJSON.
+void JsonReader::on_actionExportRedacted_triggered() {
+	QTreeWidgetItem* root = current_document_root();
+	const SessionDocument* document = session_document(root);
+	if (document == nullptr) {
+		ui.statusBar->showMessage("Open a document before exporting it");
+		return;
+	}
+	QString rulesFile = QFileDialog::getOpenFileName(
+		this,
+		"Open redaction rules",
+		"",
+		"Redaction rules (*.txt *.rules);;All files (*)"
+	);
+	if (rulesFile.isEmpty()) {
+		return;
+	}
+	auto redactor = std::make_shared<Redactor>();
+	simdjson::error_code error = redactor->load_rules(rulesFile.toStdString());
+	if (error) {
+		qInfo() << "Error: " << error;
+		QMessageBox::warning(this, "Export redacted", QString("The rules cannot be used: %1").arg(QString::fromStdString(redactor->message())));
+		return;
+	}
+	const bool ndjson = document->ndjson != nullptr;
+	QString filename = QFileDialog::getSaveFileName(
+		this,
+		"Export redacted",
+		"",
+		ndjson ? "NDJSON files (*.ndjson *.jsonl);;All files (*)" : "JSON files (*.json);;All files (*)"
+	);
+	if (filename.isEmpty()) {
+		return;
+	}
+
+	stop_export();
+	std::vector<simdjson::dom::element> records;
+	if (ndjson) {
+		records.reserve(document->ndjson->size());
+		for (size_t i = 0; i < document->ndjson->size(); i++) {
+			records.push_back(document->ndjson->record(i));
+		}
+	}
+	else {
+		records.push_back(document->root);
+	}
+	exportRedactor = redactor;
+	exportDoc = document->doc;
+	exportRoot = root;
+	ui.statusBar->showMessage("Exporting...");
+	const uint64_t generation = ++exportGeneration;
+	exportThread = std::thread([this, generation, redactor, records = std::move(records), ndjson, filename]() {
+		const std::string path = filename.toStdString();
+		simdjson::error_code error = ndjson ? redactor->write_each(records, path) : redactor->write(records.front(), path);
+		QMetaObject::invokeMethod(this, [this, generation, redactor, error, filename]() {
+			if (generation == exportGeneration) {
+				export_finished(redactor, error, filename);
+			}
+		}, Qt::QueuedConnection);
+	});
+}
+
+void JsonReader::export_finished(std::shared_ptr<Redactor> redactor, simdjson::error_code error, QString filename) {
+	if (exportThread.joinable()) {
+		exportThread.join();
+	}
+	exportRedactor.reset();
+	exportDoc = nullptr;
+	exportRoot = nullptr;
+	if (error) {
+		qInfo() << "Error: " << error;
+		QMessageBox::warning(this, "Export redacted", QString("%1 could not be written.").arg(filename));
+		return;
+	}
+	const double megabytes = redactor->bytes_written() / (1024.0 * 1024.0);
+	ui.statusBar->showMessage(QString("Exported %1 MB in %2 ms (%3 MB/s): %4 values dropped, %5 hashed, %6 masked")
+		.arg(megabytes, 0, 'f', 1)
+		.arg(qint64(redactor->seconds() * 1000))
+		.arg(redactor->seconds() > 0 ? megabytes / redactor->seconds() : 0.0, 0, 'f', 0)
+		.arg(redactor->dropped())
+		.arg(redactor->hashed())
+		.arg(redactor->masked()));
+}
+
+void JsonReader::stop_export() {
+	if (exportRedactor) {
+		exportRedactor->cancel();
+	}
+	if (exportThread.joinable()) {
+		exportThread.join();
+	}
+	exportRedactor.reset();
+	exportDoc = nullptr;
+	exportRoot = nullptr;
+	exportGeneration++;
+}
+
+QTreeWidgetItem* JsonReader::current_document_root() {
+	QString pointer;
+	QTreeWidgetItem* root = item_pointer(activeTree->currentItem(), pointer);
+	if (root == nullptr && ui.treeWidget->topLevelItemCount() > 0) {
+		root = ui.treeWidget->topLevelItem(ui.treeWidget->topLevelItemCount() - 1);
+	}
+	return splitRootSources.value(root, root);
+}
+
+// Method: Only documents opened from a JSON file can be edited, as the edits are located in the file
+std::shared_ptr<PatchJournal> JsonReader::journal_for(QTreeWidgetItem* root) {
+	const SessionDocument* document = root != nullptr ? session_document(root) : nullptr;
+	if (document == nullptr || document->ndjson != nullptr || document->path.isEmpty()) {
+		ui.statusBar->showMessage("Only values of documents opened from a JSON file can be edited");
+		return nullptr;
+	}
+	if (patchOverlays.contains(root)) {
+		ui.statusBar->showMessage("Values of a document shown with a patch applied cannot be edited in its file");
+		return nullptr;
+	}
+	std::shared_ptr<PatchJournal>& journal = patchJournals[document->path];
+	if (!journal) {
+		journal = std::make_shared<PatchJournal>();
+		simdjson::error_code error = journal->set_source(document->path.toStdString());
+		if (error) {
+			qInfo() << "Error: " << error;
+			ui.statusBar->showMessage(QString::fromStdString(journal->message()));
+			patchJournals.remove(document->path);
+			return nullptr;
+		}
+	}
+	return journal;
+}
+
+// Method: Triggered when "Edit value..." is chosen. Asks for the new JSON text of the current row's value, and
+// locates the old one in the file in the background.
+void JsonReader::on_actionEditValue_triggered() {
+	QTreeWidgetItem* item = activeTree->currentItem();
+	QString pointer;
+	QTreeWidgetItem* root = item_pointer(item, pointer);
+	if (item == nullptr || item == root) {
+		ui.statusBar->showMessage("Select the row of a value to edit");
+		return;
+	}
+	root = splitRootSources.value(root, root);
+	std::shared_ptr<PatchJournal> journal = journal_for(root);
+	if (!journal) {
+		return;
+	}
+	if (editThread.joinable()) {
+		ui.statusBar->showMessage("The previous edit is still being located");
+		return;
+	}
+
+	QString current;
+	simdjson::dom::element element;
+	if (const PatchJournal::Edit* edit = journal->find(pointer.toStdString())) {
+		current = QString::fromStdString(edit->value);
+	}
+	else if (item_element(item, element)) {
+		const std::string text = simdjson::minify(element);
+		current = text.size() <= MAX_EDITED_TEXT ? QString::fromStdString(text) : QString();
+	}
+	bool ok = false;
+	const QString text = QInputDialog::getMultiLineText(this, "Edit value", QString("New JSON value of %1:").arg(pointer), current, &ok);
+	if (!ok || text == current) {
+		return;
+	}
+
+	ui.statusBar->showMessage(QString("Locating %1...").arg(pointer));
+	const uint64_t generation = ++editGeneration;
+	editThread = std::thread([this, generation, root, journal, pointer, text]() {
+		PatchJournal::Edit edit;
+		std::string message;
+		const simdjson::error_code error = journal->locate(pointer.toStdString(), text.toStdString(), edit, message);
+		QMetaObject::invokeMethod(this, [this, generation, root, journal, edit = std::move(edit), error, message]() {
+			if (generation == editGeneration) {
+				edit_located(root, journal, edit, error, QString::fromStdString(message));
+			}
+		}, Qt::QueuedConnection);
+	});
+}
+
+void JsonReader::edit_located(QTreeWidgetItem* root, std::shared_ptr<PatchJournal> journal, PatchJournal::Edit edit, simdjson::error_code error, QString message) {
+	if (editThread.joinable()) {
+		editThread.join();
+	}
+	if (!error) {
+		error = journal->add(edit);
+		message = QString::fromStdString(journal->message());
+	}
+	if (error) {
+		qInfo() << "Error: " << error;
+		QMessageBox::warning(this, "Edit value", message);
+		return;
+	}
+	const QString pointer = QString::fromStdString(edit.pointer);
+	for (QTreeWidgetItem* view : { root, splitRoots.value(root) }) {
+		if (QTreeWidgetItem* item = view != nullptr ? item_at_pointer(view, pointer, false) : nullptr) {
+			show_edit(item, pointer, edit.value);
+		}
+	}
+	ui.statusBar->showMessage(QString("%1 replaced (bytes %2 to %3 of the file); %4 edits not saved")
+		.arg(pointer).arg(edit.start).arg(edit.end).arg(journal->edits().size()));
+}
+
+// Method: Triggered when "Undo edit" is chosen. Removes the last edit of the current row's document.
+void JsonReader::on_actionUndoEdit_triggered() {
+	QTreeWidgetItem* root = current_document_root();
+	const SessionDocument* document = root != nullptr ? session_document(root) : nullptr;
+	std::shared_ptr<PatchJournal> journal = document != nullptr ? patchJournals.value(document->path) : nullptr;
+	if (!journal || journal->empty() || editThread.joinable()) {
+		ui.statusBar->showMessage("No edit to undo");
+		return;
+	}
+	const QString pointer = QString::fromStdString(journal->edits().back().pointer);
+	journal->undo();
+	for (QTreeWidgetItem* view : { root, splitRoots.value(root) }) {
+		if (QTreeWidgetItem* item = view != nullptr ? item_at_pointer(view, pointer, false) : nullptr) {
+			restore_row(item, pointer);
+		}
+	}
+	ui.statusBar->showMessage(QString("Edit of %1 undone; %2 edits not saved").arg(pointer).arg(journal->edits().size()));
+}
+
+// Method: Triggered when "Save edits..." is chosen. Writes the file of the current row's document with its edits,
+// to the same file by default.
+void JsonReader::on_actionSaveEdits_triggered() {
+	QTreeWidgetItem* root = current_document_root();
+	const SessionDocument* document = root != nullptr ? session_document(root) : nullptr;
+	std::shared_ptr<PatchJournal> journal = document != nullptr ? patchJournals.value(document->path) : nullptr;
+	if (!journal || journal->empty()) {
+		ui.statusBar->showMessage("No edits to save");
+		return;
+	}
+	if (editThread.joinable()) {
+		ui.statusBar->showMessage("An edit is still being located");
+		return;
+	}
+	QString filename = QFileDialog::getSaveFileName(
+		this,
+		"Save edits",
+		document->path,
+		"JSON files (*.json);;All files (*)"
+	);
+	if (filename.isEmpty()) {
+		return;
+	}
+
+	ui.statusBar->showMessage("Saving...");
+	const uint64_t generation = ++editGeneration;
+	editThread = std::thread([this, generation, journal, filename]() {
+		const simdjson::error_code error = journal->save(filename.toStdString());
+		QMetaObject::invokeMethod(this, [this, generation, journal, error, filename]() {
+			if (generation == editGeneration) {
+				edits_saved(journal, error, filename);
+			}
+		}, Qt::QueuedConnection);
+	});
+}
+
+// Method: Once the source itself is saved, its offsets no longer hold and the journal is dropped; the edited rows
+// keep their values until the file is reloaded
+void JsonReader::edits_saved(std::shared_ptr<PatchJournal> journal, simdjson::error_code error, QString filename) {
+	if (editThread.joinable()) {
+		editThread.join();
+	}
+	if (error) {
+		qInfo() << "Error: " << error;
+		QMessageBox::warning(this, "Save edits", QString("%1 could not be written, or %2 has changed since it was loaded.")
+			.arg(filename).arg(QString::fromStdString(journal->source())));
+		return;
+	}
+	const QString source = QString::fromStdString(journal->source());
+	if (QFileInfo(filename).absoluteFilePath() == source) {
+		patchJournals.remove(source);
+	}
+	ui.statusBar->showMessage(QString("Saved %1 edits to %2: %3 MB copied%4, %5 bytes replaced")
+		.arg(journal->edits().size())
+		.arg(filename)
+		.arg(journal->bytes_copied() / (1024.0 * 1024.0), 0, 'f', 1)
+		.arg(journal->kernel_copies() ? " by the kernel" : "")
+		.arg(journal->bytes_replaced()));
+}
+
+// Method: Triggered when "Export patch..." is chosen. Writes the edits of the current row's document as a JSON Patch.
+void JsonReader::on_actionExportPatch_triggered() {
+	QTreeWidgetItem* root = current_document_root();
+	const SessionDocument* document = root != nullptr ? session_document(root) : nullptr;
+	std::shared_ptr<PatchJournal> journal = document != nullptr ? patchJournals.value(document->path) : nullptr;
+	if (!journal || journal->empty()) {
+		ui.statusBar->showMessage("No edits to export");
+		return;
+	}
+	QString filename = QFileDialog::getSaveFileName(
+		this,
+		"Export patch",
+		"",
+		"JSON Patch files (*.json-patch *.json);;All files (*)"
+	);
+	if (filename.isEmpty()) {
+		return;
+	}
+	simdjson::error_code error = journal->export_patch(filename.toStdString());
+	if (error) {
+		qInfo() << "Error: " << error;
+		QMessageBox::warning(this, "Export patch", QString("%1 could not be written.").arg(filename));
+		return;
+	}
+	ui.statusBar->showMessage(QString("Exported %1 edits to %2").arg(journal->edits().size()).arg(filename));
+}
+
+// Method: Triggered when "Import patch..." is chosen. Applies the "replace" operations of a JSON Patch to a copy of
+// the journal in the background, and swaps it in if they all apply.
+void JsonReader::on_actionImportPatch_triggered() {
+	QTreeWidgetItem* root = current_document_root();
+	std::shared_ptr<PatchJournal> journal = journal_for(root);
+	if (!journal) {
+		return;
+	}
+	if (editThread.joinable()) {
+		ui.statusBar->showMessage("An edit is still being located");
+		return;
+	}
+	QString filename = QFileDialog::getOpenFileName(
+		this,
+		"Import patch",
+		"",
+		"JSON Patch files (*.json-patch *.json);;All files (*)"
+	);
+	if (filename.isEmpty()) {
+		return;
+	}
+
+	ui.statusBar->showMessage("Applying the patch...");
+	auto patched = std::make_shared<PatchJournal>(*journal);
+	const uint64_t generation = ++editGeneration;
+	editThread = std::thread([this, generation, root, patched, filename]() {
+		const simdjson::error_code error = patched->import_patch(filename.toStdString());
+		QMetaObject::invokeMethod(this, [this, generation, root, patched, error]() {
+			if (generation == editGeneration) {
+				patch_imported(root, patched, error);
+			}
+		}, Qt::QueuedConnection);
+	});
 }
 
-JsonReader::~JsonReader() {}
+void JsonReader::patch_imported(QTreeWidgetItem* root, std::shared_ptr<PatchJournal> journal, simdjson::error_code error) {
+	if (editThread.joinable()) {
+		editThread.join();
+	}
+	if (error) {
+		qInfo() << "Error: " << error;
+		QMessageBox::warning(this, "Import patch", QString::fromStdString(journal->message()));
+		return;
+	}
+	patchJournals.insert(QString::fromStdString(journal->source()), journal);
+	for (QTreeWidgetItem* view : { root, splitRoots.value(root) }) {
+		for (const PatchJournal::Edit& edit : journal->edits()) {
+			const QString pointer = QString::fromStdString(edit.pointer);
+			if (QTreeWidgetItem* item = view != nullptr ? item_at_pointer(view, pointer, false) : nullptr) {
+				show_edit(item, pointer, edit.value);
+			}
+		}
+	}
+	ui.statusBar->showMessage(QString("Patch applied; %1 edits not saved").arg(journal->edits().size()));
+}
 
-// Method: Triggered when the "Load" button is clicked. Opens a file dialog to select a JSON file
-void JsonReader::on_loadBtn_clicked() {
+void JsonReader::stop_editing() {
+	if (editThread.joinable()) {
+		editThread.join();
+	}
+	editGeneration++;
+}
 
-	// Open a dialog for the user to select a JSON file
+// Method: The row of an edited value shows the new value in italics. Its children showed the old value, so they
+// are removed; a new container can be browsed once saved and reloaded.
+void JsonReader::show_edit(QTreeWidgetItem* item, const QString& pointer, const std::string& value) {
+	simdjson::dom::parser valueParser;
+	simdjson::dom::element element;
+	if (valueParser.parse(value).get(element)) {
+		return;
+	}
+	forget_children(item);
+	qDeleteAll(item->takeChildren());
+	itemElementMap.remove(item);
+	expandedElementMap.remove(item);
+	itemEmbeddedMap.remove(item);
+	release_embedded_document(item);
+	rowPrefetcher.forget(item);
+
+	const JsonElementDisplay elementDisplay = get_json_element_display(element);
+	const QString key = pointer.mid(pointer.lastIndexOf('/') + 1).replace("~1", "/").replace("~0", "~");
+	item->setText(0, key + ": " + QString::fromStdString(elementDisplay.value));
+	item->setForeground(0, QBrush(elementDisplay.color));
+	QFont font = item->font(0);
+	font.setItalic(true);
+	item->setFont(0, font);
+	item->setToolTip(0, "Edited");
+}
+
+void JsonReader::show_edits(QTreeWidgetItem* item) {
+	if (patchJournals.isEmpty()) {
+		return;
+	}
+	QString pointer;
+	QTreeWidgetItem* root = item_pointer(item, pointer);
+	const SessionDocument* document = root != nullptr ? session_document(root) : nullptr;
+	std::shared_ptr<PatchJournal> journal = document != nullptr ? patchJournals.value(document->path) : nullptr;
+	if (!journal || patchOverlays.contains(splitRootSources.value(root, root))) {
+		return;
+	}
+	for (const PatchJournal::Edit& edit : journal->edits()) {
+		const QString editPointer = QString::fromStdString(edit.pointer);
+		if (editPointer.startsWith(pointer + "/") && editPointer.indexOf('/', pointer.size() + 1) < 0) {
+			if (QTreeWidgetItem* child = item_at_pointer(root, editPointer, false)) {
+				show_edit(child, editPointer, edit.value);
+			}
+		}
+	}
+}
+
+void JsonReader::restore_row(QTreeWidgetItem* item, const QString& pointer) {
+	simdjson::dom::element element;
+	if (!item_element(item, element)) {
+		return;
+	}
+	const JsonElementDisplay elementDisplay = get_json_element_display(element);
+	const QString key = pointer.mid(pointer.lastIndexOf('/') + 1).replace("~1", "/").replace("~0", "~");
+	item->setText(0, key + ": " + QString::fromStdString(elementDisplay.value));
+	item->setForeground(0, QBrush(elementDisplay.color));
+	QFont font = item->font(0);
+	font.setItalic(false);
+	item->setFont(0, font);
+	item->setToolTip(0, QString());
+	if (element.type() == simdjson::dom::element_type::OBJECT || element.type() == simdjson::dom::element_type::ARRAY) {
+		item->addChild(new QTreeWidgetItem());
+		itemElementMap.insert(item, element);
+	}
+}
+
+// Method: Triggered when "Apply patch to view..." is chosen. Applies a JSON Patch or a JSON Merge Patch to the
+// current document, or to the patches already applied to it, on a copy of its overlay in the background.
+void JsonReader::on_actionApplyPatch_triggered() {
+	QTreeWidgetItem* root = current_document_root();
+	const SessionDocument* document = root != nullptr ? session_document(root) : nullptr;
+	if (document == nullptr || document->ndjson != nullptr) {
+		ui.statusBar->showMessage("Patches can only be applied to a JSON document");
+		return;
+	}
+	if (patchThread.joinable()) {
+		ui.statusBar->showMessage("A patch is still being applied");
+		return;
+	}
 	QString filename = QFileDialog::getOpenFileName(
 		this,
-		"Open JSON file",
+		"Apply patch to view",
 		"",
-		"JSON Files (*.json);;All Files (*)"
+		"JSON Patch files (*.json-patch *.merge-patch *.json);;All files (*)"
 	);
+	if (filename.isEmpty()) {
+		return;
+	}
 
-	// If the user cancelled the dialog, terminate the method
+	ui.statusBar->showMessage("Applying the patch...");
+	std::shared_ptr<const PatchOverlay> current = patchOverlays.value(root);
+	auto patched = current ? std::make_shared<PatchOverlay>(*current) : std::make_shared<PatchOverlay>(document->root);
+	patchDoc = document->doc;
+	const uint64_t generation = ++patchGeneration;
+	patchThread = std::thread([this, generation, root, patched, filename]() {
+		const simdjson::error_code error = patched->apply_file(filename.toStdString());
+		QMetaObject::invokeMethod(this, [this, generation, root, patched, error]() {
+			if (generation == patchGeneration) {
+				patch_applied(root, patched, error);
+			}
+		}, Qt::QueuedConnection);
+	});
+}
+
+// Method: Rebuilds the rows of the document from the new overlay, in both views. The watched file is no longer
+// reloaded, as its new versions would replace the patched rows.
+void JsonReader::patch_applied(QTreeWidgetItem* root, std::shared_ptr<const PatchOverlay> overlay, simdjson::error_code error) {
+	if (patchThread.joinable()) {
+		patchThread.join();
+	}
+	if (error) {
+		qInfo() << "Error: " << error;
+		QMessageBox::warning(this, "Apply patch", QString("The patch was not applied: %1").arg(QString::fromStdString(overlay->message())));
+		return;
+	}
+	if (root == watchedRoot) {
+		stop_watching();
+	}
+	forget_children(root);
+	qDeleteAll(root->takeChildren());
+	remove_overlay(root);
+	patchOverlays.insert(root, overlay);
+	const OverlayRef ref{ overlay, overlay->root() };
+	if (overlay->kind(ref.node) == PatchOverlay::Kind::VALUE) {
+		add_children_to_item(root, overlay->element(ref.node));
+	}
+	else {
+		add_children_to_item(root, ref);
+	}
+	add_split_root(root);
+	ui.statusBar->showMessage(QString("Patch applied in %1 ms: %2 operations in all, %3 containers copied (%4 MB)")
+		.arg(overlay->seconds() * 1000, 0, 'f', 0)
+		.arg(overlay->operations())
+		.arg(overlay->copied_containers())
+		.arg(overlay->memory_usage() / (1024.0 * 1024.0), 0, 'f', 1));
+}
+
+// Method: Triggered when "Save patched document..." is chosen. Writes the patched document of the current row as
+// minified JSON in the background.
+void JsonReader::on_actionSavePatched_triggered() {
+	QTreeWidgetItem* root = current_document_root();
+	std::shared_ptr<const PatchOverlay> overlay = root != nullptr ? patchOverlays.value(root) : nullptr;
+	if (!overlay) {
+		ui.statusBar->showMessage("No patch applied to this document");
+		return;
+	}
+	if (patchThread.joinable()) {
+		ui.statusBar->showMessage("A patch is still being applied");
+		return;
+	}
+	QString filename = QFileDialog::getSaveFileName(
+		this,
+		"Save patched document",
+		"",
+		"JSON files (*.json);;All files (*)"
+	);
 	if (filename.isEmpty()) {
 		return;
 	}
 
-	// Parse the selected JSON file
-	simdjson::dom::element doc;
-	auto error = parser.load(filename.toStdString()).get(doc);
+	ui.statusBar->showMessage("Saving...");
+	patchDoc = session_document(root)->doc;
+	const uint64_t generation = ++patchGeneration;
+	patchThread = std::thread([this, generation, overlay, filename]() {
+		const simdjson::error_code error = overlay->write(filename.toStdString());
+		QMetaObject::invokeMethod(this, [this, generation, overlay, error, filename]() {
+			if (generation == patchGeneration) {
+				patched_saved(overlay, error, filename);
+			}
+		}, Qt::QueuedConnection);
+	});
+}
+
+void JsonReader::patched_saved(std::shared_ptr<const PatchOverlay> overlay, simdjson::error_code error, QString filename) {
+	if (patchThread.joinable()) {
+		patchThread.join();
+	}
 	if (error) {
 		qInfo() << "Error: " << error;
+		QMessageBox::warning(this, "Save patched document", QString("%1 could not be written.").arg(filename));
 		return;
 	}
+	ui.statusBar->showMessage(QString("Saved the document with %1 patch operations to %2").arg(overlay->operations()).arg(filename));
+}
 
-	// Add parsed JSON data to the tree widget
-	QTreeWidgetItem* root = new QTreeWidgetItem();
-	add_children_to_item(root, doc);
-	ui.treeWidget->insertTopLevelItem(0, root);
+void JsonReader::stop_patching() {
+	if (patchThread.joinable()) {
+		patchThread.join();
+	}
+	patchGeneration++;
+	patchDoc = nullptr;
 }
 
-// Method: Triggered when the "Copy" button is clicked. Copies selected items to the clipboard
-void JsonReader::on_copyBtn_clicked() {
+// Method: Rows may refer to values of the overlay's patches, so the data handed out and the prefetched rows are
+// released with it
+void JsonReader::remove_overlay(QTreeWidgetItem* root) {
+	if (patchOverlays.remove(root) > 0) {
+		detach_mime_data();
+		rowPrefetcher.clear();
+	}
+}
+
+bool JsonReader::overlay_node(QTreeWidgetItem* item, OverlayRef& ref) const {
+	if (itemOverlayMap.contains(item)) {
+		ref = itemOverlayMap.value(item);
+		return true;
+	}
+	if (expandedOverlayMap.contains(item)) {
+		ref = expandedOverlayMap.value(item);
+		return true;
+	}
+	if (item->parent() == nullptr) {
+		std::shared_ptr<const PatchOverlay> overlay = patchOverlays.value(splitRootSources.value(item, item));
+		if (overlay) {
+			ref = OverlayRef{ overlay, overlay->root() };
+			return true;
+		}
+	}
+	return false;
+}
+
+void JsonReader::add_children_to_item(QTreeWidgetItem* item, const OverlayRef& ref) {
+	const bool isObject = ref.overlay->kind(ref.node) == PatchOverlay::Kind::OBJECT;
+	int index = 0;
+	ref.overlay->for_each_child(ref.node, [&](std::string_view key, PatchOverlay::NodeId child) {
+		const std::string name = isObject ? std::string(key) : std::to_string(index++);
+		if (ref.overlay->kind(child) == PatchOverlay::Kind::VALUE) {
+			add_child_to_item(item, name, ref.overlay->element(child));
+			return;
+		}
+		const bool isChildObject = ref.overlay->kind(child) == PatchOverlay::Kind::OBJECT;
+		QTreeWidgetItem* childItem = new QTreeWidgetItem(QStringList() << QString::fromStdString(name + (isChildObject ? ": OBJECT" : ": ARRAY")));
+		childItem->setForeground(0, QBrush(get_element_color(isChildObject ? simdjson::dom::element_type::OBJECT : simdjson::dom::element_type::ARRAY)));
+		childItem->setToolTip(0, "Patched");
+		childItem->addChild(new QTreeWidgetItem());
+		item->addChild(childItem);
+		itemOverlayMap.insert(childItem, OverlayRef{ ref.overlay, child });
+	});
+}
+
+void JsonReader::schedule_minimap() {
+	if (minimapDock->isVisible() && !minimapTimer.isActive()) {
+		minimapTimer.start(MINIMAP_DELAY_MS);
+	}
+}
+
+// Method: Builds the minimap of the current document when it has changed, or frames the rows in view. Only DOM
+// documents have a tape to build it from.
+void JsonReader::update_minimap() {
+	if (!minimapDock->isVisible()) {
+		return;
+	}
+	QTreeWidgetItem* root = current_document_root();
+	const SessionDocument* document = root != nullptr ? session_document(root) : nullptr;
+	if (document == nullptr || document->doc == nullptr) {
+		if (minimapRoot != nullptr) {
+			reset_minimap();
+		}
+		return;
+	}
+	if (root == minimapRoot && document->doc == minimapDoc) {
+		if (minimapWidget->minimap()) {
+			update_minimap_viewport();
+		}
+		return;
+	}
+
+	stop_minimap();
+	minimapWidget->set_minimap(nullptr);
+	minimapRoot = root;
+	minimapDoc = document->doc;
+	const simdjson::dom::document* doc = document->doc;
+	const uint64_t sizeHint = uint64_t(std::max<qint64>(0, document->size));
+	const uint64_t generation = ++minimapGeneration;
+	minimapThread = std::thread([this, generation, root, doc, sizeHint]() {
+		auto minimap = std::make_shared<DocumentMinimap>();
+		const simdjson::error_code error = minimap->build(*doc, sizeHint);
+		std::shared_ptr<const DocumentMinimap> built = error ? nullptr : minimap;
+		QMetaObject::invokeMethod(this, [this, generation, root, built]() {
+			if (generation == minimapGeneration) {
+				minimap_built(root, built);
+			}
+		}, Qt::QueuedConnection);
+	});
+}
+
+void JsonReader::minimap_built(QTreeWidgetItem* root, std::shared_ptr<const DocumentMinimap> minimap) {
+	if (minimapThread.joinable()) {
+		minimapThread.join();
+	}
+	if (!minimap) {
+		ui.statusBar->showMessage("The minimap could not be built from this document");
+		return;
+	}
+	minimapWidget->set_minimap(minimap);
+	minimapDock->setToolTip(QString("%1 MB in %2 buckets, built in %3 ms")
+		.arg(minimap->bytes() / (1024.0 * 1024.0), 0, 'f', 1)
+		.arg(minimap->buckets().size())
+		.arg(minimap->seconds() * 1000, 0, 'f', 0));
+	if (root == minimapRoot) {
+		update_minimap_viewport();
+	}
+	count_minimap_hits();
+}
+
+// Method: Counts in the background, after cancelling a count still running; a minimap being built counts once built
+void JsonReader::count_minimap_hits() {
+	std::shared_ptr<const DocumentMinimap> minimap = minimapWidget->minimap();
+	if (!minimap) {
+		return;
+	}
+	const std::string text = ui.textEdit->toPlainText().toStdString();
+	stop_minimap();
+	if (text.empty()) {
+		minimapWidget->set_hits({});
+		return;
+	}
+	const bool caseSensitive = ui.radioCapital->isChecked();
+	minimapCancelled = false;
+	const uint64_t generation = ++minimapGeneration;
+	minimapThread = std::thread([this, generation, minimap, text, caseSensitive]() {
+		std::vector<uint32_t> hits = minimap->count_hits(text, caseSensitive, minimapCancelled);
+		QMetaObject::invokeMethod(this, [this, generation, minimap, hits = std::move(hits)]() {
+			if (generation == minimapGeneration) {
+				minimap_hits_counted(minimap, hits);
+			}
+		}, Qt::QueuedConnection);
+	});
+}
+
+void JsonReader::minimap_hits_counted(std::shared_ptr<const DocumentMinimap> minimap, std::vector<uint32_t> hits) {
+	if (minimapThread.joinable()) {
+		minimapThread.join();
+	}
+	if (minimap == minimapWidget->minimap()) {
+		minimapWidget->set_hits(std::move(hits));
+	}
+}
+
+// Method: Frames the buckets from the first row in view to the end of the last one. Rows of other documents at
+// either end extend the frame to that end of the document.
+void JsonReader::update_minimap_viewport() {
+	std::shared_ptr<const DocumentMinimap> minimap = minimapWidget->minimap();
+	QTreeWidget* tree = activeTree;
+	QTreeWidgetItem* top = tree->itemAt(0, 0);
+	if (!minimap || top == nullptr) {
+		minimapWidget->clear_viewport();
+		return;
+	}
+	QTreeWidgetItem* bottom = top;
+	for (QTreeWidgetItem* next = top; next != nullptr && tree->visualItemRect(next).top() < tree->viewport()->height(); next = tree->itemBelow(next)) {
+		bottom = next;
+	}
+
+	QString topPointer;
+	QString bottomPointer;
+	QTreeWidgetItem* topRoot = item_pointer(top, topPointer);
+	QTreeWidgetItem* bottomRoot = item_pointer(bottom, bottomPointer);
+	uint64_t start = 0, end = 0;
+	const bool hasTop = topRoot != nullptr && splitRootSources.value(topRoot, topRoot) == minimapRoot
+		&& minimap->value_range(topPointer.toStdString(), start, end);
+	const size_t first = hasTop ? minimap->bucket_of(start) : 0;
+	const bool hasBottom = bottomRoot != nullptr && splitRootSources.value(bottomRoot, bottomRoot) == minimapRoot
+		&& minimap->value_range(bottomPointer.toStdString(), start, end);
+	const size_t last = hasBottom ? minimap->bucket_of(end - 1) : minimap->buckets().size() - 1;
+	if (!hasTop && !hasBottom) {
+		minimapWidget->clear_viewport();
+		return;
+	}
+	minimapWidget->set_viewport(first, last);
+}
+
+// Method: The value is located in the view the minimap follows, expanding the rows on the way
+void JsonReader::jump_to_bucket(size_t bucket) {
+	std::shared_ptr<const DocumentMinimap> minimap = minimapWidget->minimap();
+	if (!minimap || minimapRoot == nullptr) {
+		return;
+	}
+	const QString pointer = QString::fromStdString(minimap->pointer_at(bucket));
+	QTreeWidgetItem* root = activeTree == splitTree && splitRoots.contains(minimapRoot) ? splitRoots.value(minimapRoot) : minimapRoot;
+	QTreeWidgetItem* item = item_at_pointer(root, pointer, true);
+	if (item == nullptr) {
+		ui.statusBar->showMessage(QString("%1 is not shown in the tree").arg(pointer));
+		return;
+	}
+	activeTree->setCurrentItem(item);
+	activeTree->scrollToItem(item, QAbstractItemView::PositionAtTop);
+	ui.statusBar->showMessage(pointer.isEmpty() ? QString("(root)") : pointer, 3000);
+}
+
+void JsonReader::stop_minimap() {
+	minimapCancelled = true;
+	if (minimapThread.joinable()) {
+		minimapThread.join();
+	}
+	minimapGeneration++;
+}
+
+void JsonReader::reset_minimap() {
+	stop_minimap();
+	minimapRoot = nullptr;
+	minimapDoc = nullptr;
+	minimapWidget->set_minimap(nullptr);
+	schedule_minimap();
+}
+
+// Method: Triggered when "Plot numeric field..." is chosen. Asks for the path of the field with "*" for the elements,
+// suggested from the current row by replacing its first index, then extracts the values on a background thread. In
+// NDJSON documents the records are the elements, as in "/*/latency".
+void JsonReader::on_actionPlotField_triggered() {
+	QString pointer;
+	QTreeWidgetItem* root = item_pointer(activeTree->currentItem(), pointer);
+	root = root != nullptr ? splitRootSources.value(root, root) : current_document_root();
+	const SessionDocument* document = root != nullptr ? session_document(root) : nullptr;
+	if (document == nullptr) {
+		ui.statusBar->showMessage("Open a document before plotting its values");
+		return;
+	}
+	QString suggestion = plotPath;
+	QStringList tokens = pointer.split('/');
+	for (int i = 1; i < tokens.size(); i++) {
+		bool isIndex = false;
+		tokens[i].toULongLong(&isIndex);
+		if (isIndex) {
+			tokens[i] = "*";
+			suggestion = tokens.join('/');
+			break;
+		}
+	}
+	bool ok = false;
+	const QString path = QInputDialog::getText(
+		this,
+		"Plot numeric field",
+		"Path of the field, with * for the elements of the array (such as /events/*/latency):",
+		QLineEdit::Normal,
+		suggestion,
+		&ok
+	).trimmed();
+	if (!ok || path.isEmpty()) {
+		return;
+	}
+
+	std::string arrayPointer, fieldPointer;
+	if (!NumericSeries::split_path(path.toStdString(), arrayPointer, fieldPointer)) {
+		QMessageBox::warning(this, "Plot numeric field", "The path needs a \"*\" token standing for the elements of an array");
+		return;
+	}
+	simdjson::dom::element array;
+	if (document->ndjson != nullptr) {
+		if (!arrayPointer.empty()) {
+			QMessageBox::warning(this, "Plot numeric field", "The records of an NDJSON document are plotted with a path starting with /*");
+			return;
+		}
+	}
+	else {
+		simdjson::error_code error = document->root.at_pointer(arrayPointer).get(array);
+		if (error) {
+			qInfo() << "Error: " << error;
+			QMessageBox::warning(this, "Plot numeric field", QString("%1 is not in the document").arg(QString::fromStdString(arrayPointer)));
+			return;
+		}
+	}
+
+	stop_plotting();
+	plotPath = path;
+	plotRoot = root;
+	plotDoc = document->doc;
+	plotCancelled = false;
+	chartDock->show();
+	ui.statusBar->showMessage("Extracting values...");
+	const NdjsonDocument* records = document->ndjson;
+	const uint64_t generation = ++plotGeneration;
+	plotThread = std::thread([this, generation, array, records, fieldPointer, path]() {
+		auto series = std::make_shared<NumericSeries>();
+		const simdjson::error_code error = records != nullptr
+			? series->extract(*records, fieldPointer, 0, &plotCancelled)
+			: series->extract(array, fieldPointer, 0, &plotCancelled);
+		std::shared_ptr<const NumericSeries> extracted = series;
+		QMetaObject::invokeMethod(this, [this, generation, extracted, error, path]() {
+			if (generation == plotGeneration) {
+				series_extracted(extracted, error, path);
+			}
+		}, Qt::QueuedConnection);
+	});
+}
+
+// Method: The series holds its own copy of the values, so the document can be replaced from now on
+void JsonReader::series_extracted(std::shared_ptr<const NumericSeries> series, simdjson::error_code error, QString path) {
+	if (plotThread.joinable()) {
+		plotThread.join();
+	}
+	plotDoc = nullptr;
+	if (error) {
+		qInfo() << "Error: " << error;
+		QMessageBox::warning(this, "Plot numeric field", QString("%1 does not point into an array").arg(path));
+		return;
+	}
+	chartWidget->set_series(series, path);
+	chartDock->setWindowTitle(QString("Chart: %1").arg(path));
+	QString message = QString("%1 values extracted in %2 ms").arg(series->size()).arg(series->seconds() * 1000, 0, 'f', 0);
+	if (series->missing() > 0) {
+		message += QString(", %1 elements without a number").arg(series->missing());
+	}
+	ui.statusBar->showMessage(message);
+}
+
+// Method: The element is located by its pointer, expanding the rows on the way, as the document may have been
+// collapsed or reloaded since it was plotted
+void JsonReader::jump_to_element(size_t index) {
+	std::string arrayPointer, fieldPointer;
+	if (plotRoot == nullptr || !sessionDocuments.contains(plotRoot) || !NumericSeries::split_path(plotPath.toStdString(), arrayPointer, fieldPointer)) {
+		ui.statusBar->showMessage("The plotted document is no longer open");
+		return;
+	}
+	const QString pointer = QString::fromStdString(arrayPointer) + "/" + QString::number(index);
+	QTreeWidgetItem* item = item_at_pointer(plotRoot, pointer, true);
+	if (item == nullptr) {
+		ui.statusBar->showMessage(QString("%1 is no longer in the document").arg(pointer));
+		return;
+	}
+	ui.treeWidget->clearSelection();
+	ui.treeWidget->setCurrentItem(item);
+	item->setSelected(true);
+	ui.treeWidget->scrollToItem(item, QAbstractItemView::PositionAtCenter);
+	ui.statusBar->showMessage(pointer, 3000);
+}
+
+void JsonReader::stop_plotting() {
+	plotCancelled = true;
+	if (plotThread.joinable()) {
+		plotThread.join();
+	}
+	plotGeneration++;
+}
+
+// Method: Triggered when "Split view" is toggled. Shows a second tree next to the main one with a root per document
+// of the main tree, or removes it with its items.
+void JsonReader::on_actionSplitView_toggled(bool checked) {
+	if (checked && splitTree == nullptr) {
+		splitTree = new QTreeWidget(splitter);
+		splitTree->setHeaderLabel("Split:");
+		splitTree->setSelectionMode(QAbstractItemView::ExtendedSelection);
+		splitTree->setMouseTracking(true);
+		splitTree->setDragEnabled(true);
+		splitTree->setDragDropMode(QAbstractItemView::DragOnly);
+		splitTree->viewport()->installEventFilter(this);
+		connect(splitTree, &QTreeWidget::itemExpanded, this, &JsonReader::split_item_expanded);
+		connect(splitTree, &QTreeWidget::itemEntered, this, [this](QTreeWidgetItem* item) { prefetch_item(item); });
+		connect(splitTree, &QTreeWidget::itemSelectionChanged, this, [this]() { activeTree = splitTree; });
+		connect(splitTree->verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int value) { prefetch_scrolled(splitTree, value); });
+		connect(splitTree->verticalScrollBar(), &QScrollBar::valueChanged, this, &JsonReader::schedule_minimap);
+		connect(splitTree, &QTreeWidget::itemExpanded, this, &JsonReader::schedule_minimap);
+		connect(splitTree, &QTreeWidget::itemCollapsed, this, &JsonReader::schedule_minimap);
+		connect(splitTree, &QTreeWidget::itemSelectionChanged, this, &JsonReader::schedule_minimap);
+		for (int i = 0; i < ui.treeWidget->topLevelItemCount(); i++) {
+			add_split_root(ui.treeWidget->topLevelItem(i));
+		}
+	}
+	else if (!checked && splitTree != nullptr) {
+		for (QTreeWidgetItem* root : splitRoots.keys()) {
+			remove_split_root(root);
+		}
+		activeTree = ui.treeWidget;
+		lastScrollValues.remove(splitTree);
+		delete splitTree;
+		splitTree = nullptr;
+	}
+}
+
+// Method: Mirrors a root of the main tree in the split view, collapsed, so that its rows are only built when expanded
+// there. A mirror whose document has been replaced is collapsed and emptied, since its items refer to the old one.
+void JsonReader::add_split_root(QTreeWidgetItem* root) {
+	const SessionDocument* document = session_document(root);
+	if (splitTree == nullptr || document == nullptr) {
+		return;
+	}
+	QTreeWidgetItem* mirror = splitRoots.value(root);
+	if (mirror == nullptr) {
+		mirror = new QTreeWidgetItem(QStringList() << (document->path.isEmpty() ? QString("Clipboard") : QFileInfo(document->path).fileName()));
+		int index = 0;
+		for (int i = 0; i < ui.treeWidget->indexOfTopLevelItem(root); i++) {
+			index += splitRoots.contains(ui.treeWidget->topLevelItem(i)) ? 1 : 0;
+		}
+		splitTree->insertTopLevelItem(index, mirror);
+		splitRoots.insert(root, mirror);
+		splitRootSources.insert(mirror, root);
+	}
+	else {
+		mirror->setExpanded(false);
+		forget_children(mirror);
+		qDeleteAll(mirror->takeChildren());
+		expandedElementMap.remove(mirror);
+		itemOverlayMap.remove(mirror);
+		expandedOverlayMap.remove(mirror);
+		rowPrefetcher.forget(mirror);
+	}
+	mirror->addChild(new QTreeWidgetItem());
+	std::shared_ptr<const PatchOverlay> overlay = patchOverlays.value(root);
+	if (overlay && overlay->kind(overlay->root()) != PatchOverlay::Kind::VALUE) {
+		itemOverlayMap.insert(mirror, OverlayRef{ overlay, overlay->root() });
+	}
+	else if (document->ndjson == nullptr) {
+		itemElementMap.insert(mirror, overlay ? overlay->element(overlay->root()) : document->root);
+	}
+}
 
-	// Get a list of all currently selected items
-	QList<QTreeWidgetItem*> selectedItems = ui.treeWidget->selectedItems();
-	QStringList pairs;
+void JsonReader::remove_split_root(QTreeWidgetItem* root) {
+	QTreeWidgetItem* mirror = splitRoots.take(root);
+	if (mirror == nullptr) {
+		return;
+	}
+	splitRootSources.remove(mirror);
+	forget_children(mirror);
+	itemElementMap.remove(mirror);
+	expandedElementMap.remove(mirror);
+	itemOverlayMap.remove(mirror);
+	expandedOverlayMap.remove(mirror);
+	rowPrefetcher.forget(mirror);
+	delete mirror;
+}
 
-	// Iterate over selected items and add their data to 'pairs'
-	for (const auto& item : selectedItems) {
-		QStringList itemPairs = copy_recursive(item);
-		for (const QString& itemPair : itemPairs) {
-			pairs.append(itemPair);
+// Method: NDJSON mirrors have no element of their own; their records are added on the first expand
+void JsonReader::split_item_expanded(QTreeWidgetItem* item) {
+	const SessionDocument* document = splitRootSources.contains(item) ? session_document(item) : nullptr;
+	if (document != nullptr && document->ndjson != nullptr && item->childCount() == 1 && item->child(0)->text(0) == "") {
+		delete item->takeChild(0);
+		for (size_t i = 0; i < document->ndjson->size(); i++) {
+			add_child_to_item(item, std::to_string(i), document->ndjson->record(i));
 		}
 	}
+	on_treeWidget_itemExpanded(item);
+}
+
+const JsonReader::SessionDocument* JsonReader::session_document(QTreeWidgetItem* root) const {
+	const auto found = sessionDocuments.constFind(splitRootSources.value(root, root));
+	return found == sessionDocuments.constEnd() ? nullptr : &found.value();
+}
 
-	// Copy 'pairs' to the clipboard
-	QApplication::clipboard()->setText(pairs.join(", "));
+// Method: Starts a drag once the mouse has moved far enough from a press on a selected row. The tree's own drag
+// support is enabled only so that pressing a selected row keeps the rest of the selection.
+bool JsonReader::eventFilter(QObject* watched, QEvent* event) {
+	QTreeWidget* tree = watched == ui.treeWidget->viewport() ? ui.treeWidget : (splitTree && watched == splitTree->viewport() ? splitTree : nullptr);
+	if (tree != nullptr) {
+		if (event->type() == QEvent::MouseButtonPress) {
+			QMouseEvent* mouseEvent = static_cast<QMouseEvent*>(event);
+			dragStart = mouseEvent->position().toPoint();
+			dragPending = mouseEvent->button() == Qt::LeftButton;
+		}
+		else if (event->type() == QEvent::MouseButtonRelease) {
+			dragPending = false;
+		}
+		else if (event->type() == QEvent::MouseMove && dragPending) {
+			QMouseEvent* mouseEvent = static_cast<QMouseEvent*>(event);
+			if (!(mouseEvent->buttons() & Qt::LeftButton)) {
+				dragPending = false;
+			}
+			else if ((mouseEvent->position().toPoint() - dragStart).manhattanLength() >= QApplication::startDragDistance()) {
+				dragPending = false;
+				QTreeWidgetItem* item = tree->itemAt(dragStart);
+				if (item != nullptr && item->isSelected()) {
+					QDrag* drag = new QDrag(this);
+					drag->setMimeData(selection_mime_data(tree));
+					drag->exec(Qt::CopyAction);
+					return true;
+				}
+			}
+		}
+	}
+	return QMainWindow::eventFilter(watched, event);
 }
 
 // Method: Triggered when a tree widget item is expanded. Updates the tree widget to show the item's children
 void JsonReader::on_treeWidget_itemExpanded(QTreeWidgetItem* item) {
 
+	// Strings holding JSON are parsed first, and then expanded like elements
+	if (itemEmbeddedMap.contains(item)) {
+		expand_embedded_item(item);
+	}
+
 	// Check if the expanded item is in 'itemElementMap'
 	if (itemElementMap.contains(item)) {
 
@@ -69,18 +3100,148 @@ void JsonReader::on_treeWidget_itemExpanded(QTreeWidgetItem* item) {
 			delete item->takeChild(0);
 		}
 
-		// Add the item's real children to the tree widget
+		// Add the item's real children to the tree widget, from rows prefetched in the background if there are some
 		simdjson::dom::element element = itemElementMap.value(item);
-		add_children_to_item(item, element);
+		std::vector<RowPrefetcher::Row> rows;
+		if (ui.actionPrefetchRows->isChecked() && rowPrefetcher.take(item, rows)) {
+			for (const RowPrefetcher::Row& row : rows) {
+				add_row_to_item(item, row.text, row.element);
+			}
+		}
+		else {
+			add_children_to_item(item, element);
+		}
+		if (ui.actionPrefetchRows->isChecked()) {
+			prefetchLabel->setText(QString("Prefetch %1% hits (%2 of %3)")
+				.arg(100 * rowPrefetcher.hits() / std::max<uint64_t>(1, rowPrefetcher.hits() + rowPrefetcher.misses()))
+				.arg(rowPrefetcher.hits())
+				.arg(rowPrefetcher.hits() + rowPrefetcher.misses()));
+		}
 
-		// Remove the item from 'itemElementMap' to prevent it from being parsed again
+		// Remove the item from 'itemElementMap' to prevent it from being parsed again, and remember it in case its
+		// children are released under memory pressure
+		expandedElementMap.insert(item, element);
 		itemElementMap.remove(item);
+		show_edits(item);
+	}
+
+	// Rows of a progressive load not parsed yet
+	if (itemRangeMap.contains(item) && !itemRangeMap[item].expanded) {
+		expand_range_item(item);
+	}
+
+	// Containers of a patched document copied into its overlay
+	if (itemOverlayMap.contains(item)) {
+		if (item->childCount() == 1 && item->child(0)->text(0) == "") {
+			delete item->takeChild(0);
+		}
+		const OverlayRef ref = itemOverlayMap.take(item);
+		add_children_to_item(item, ref);
+		expandedOverlayMap.insert(item, ref);
+	}
+
+	// Same for items of documents loaded in compact mode
+	if (itemCompactMap.contains(item)) {
+		if (item->childCount() == 1 && item->child(0)->text(0) == "") {
+			delete item->takeChild(0);
+		}
+		CompactNodeRef ref = itemCompactMap.value(item);
+		add_children_to_item(item, *ref.tree, ref.node);
+		expandedCompactMap.insert(item, ref);
+		itemCompactMap.remove(item);
+	}
+}
+
+// Method: Parses the string when the item is first expanded. The document usually comes from the cache when the
+// string was expanded before, or another item holds the same string.
+void JsonReader::expand_embedded_item(QTreeWidgetItem* item) {
+	const simdjson::dom::element value = itemEmbeddedMap.take(item);
+	if (item->childCount() == 1 && item->child(0)->text(0) == "") {
+		delete item->takeChild(0);
+	}
+
+	std::shared_ptr<const EmbeddedJson::Document> document;
+	const simdjson::error_code error = embeddedJson.parse(std::string_view(value), ui.actionEmbeddedWrapped->isChecked(), document);
+	if (error) {
+		QTreeWidgetItem* child = new QTreeWidgetItem(QStringList() << QString("Not JSON: %1").arg(simdjson::error_message(error)));
+		child->setForeground(0, QBrush(QColor(128, 128, 128)));
+		item->addChild(child);
+		return;
+	}
+	embeddedDocuments.insert(item, document);
+	itemElementMap.insert(item, document->root);
+
+	QStringList decoded;
+	if (document->wrapping & EmbeddedJson::BASE64) {
+		decoded << "base64";
+	}
+	if (document->wrapping & EmbeddedJson::GZIP) {
+		decoded << "gzip";
+	}
+	item->setToolTip(0, decoded.isEmpty() ? QString("JSON in a string") : QString("JSON in a string (%1, %2 bytes decoded)").arg(decoded.join(", ")).arg(document->decodedBytes));
+}
+
+// Method: Forgets the document of an expanded string. Once no other row holds it, only the embedded JSON cache may,
+// which frees it when trimmed or evicted; the prefetcher may be formatting rows of that document and copied data may
+// refer to its elements, so both are dealt with before this reference goes.
+void JsonReader::release_embedded_document(QTreeWidgetItem* item) {
+	std::shared_ptr<const EmbeddedJson::Document> document = embeddedDocuments.take(item);
+	if (document && document.use_count() <= 2) {
+		rowPrefetcher.clear();
+		detach_mime_data();
+	}
+}
+
+// Method: Triggered when the mouse enters an item (the tree has mouse tracking on). Prefetches its children.
+void JsonReader::on_treeWidget_itemEntered(QTreeWidgetItem* item, int column) {
+	Q_UNUSED(column);
+	prefetch_item(item);
+}
+
+void JsonReader::prefetch_item(QTreeWidgetItem* item) {
+	if (ui.actionPrefetchRows->isChecked() && item != nullptr && !item->isExpanded() && itemElementMap.contains(item)) {
+		rowPrefetcher.request(item, itemElementMap.value(item));
+	}
+}
+
+// Method: Prefetches the unexpanded items of the next pages in the direction of the scroll, nearest first
+void JsonReader::prefetch_scrolled(QTreeWidget* tree, int value) {
+	const bool down = value >= lastScrollValues.value(tree);
+	lastScrollValues.insert(tree, value);
+	if (!ui.actionPrefetchRows->isChecked()) {
+		return;
+	}
+	const QRect viewport = tree->viewport()->rect();
+	QTreeWidgetItem* edge = tree->itemAt(down ? viewport.bottomLeft() : viewport.topLeft());
+	if (edge == nullptr) {
+		return;
+	}
+	const int rowHeight = std::max(1, tree->visualItemRect(edge).height());
+	const int count = PREFETCH_PAGES * viewport.height() / rowHeight;
+
+	// Requests are served newest first, so the farthest rows are requested first
+	std::vector<QTreeWidgetItem*> ahead;
+	for (QTreeWidgetItem* item = edge; item != nullptr && int(ahead.size()) < count; ) {
+		item = down ? tree->itemBelow(item) : tree->itemAbove(item);
+		if (item != nullptr) {
+			ahead.push_back(item);
+		}
 	}
+	for (auto it = ahead.rbegin(); it != ahead.rend(); ++it) {
+		prefetch_item(*it);
+	}
+}
+
+void JsonReader::clear_prefetched_rows() {
+	rowPrefetcher.clear();
 }
 
 // Method: Triggered when the content of 'textEdit' changes. Starts a new search from the current selection
 void JsonReader::on_textEdit_textChanged() {
 
+	// The minimap counts the hits in the whole document, expanded or not
+	count_minimap_hits();
+
 	// Get the search text from 'textEdit'
 	QString searchText = ui.textEdit->toPlainText();
 	if (searchText.isEmpty()) {
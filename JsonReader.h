@@ -3,11 +3,46 @@
 #include <QDebug>
 #include <QApplication>
 #include <QClipboard>
+#include <QDockWidget>
+#include <QDrag>
 #include <QtCore>
 #include <QFileDialog>
+#include <QFileSystemWatcher>
+#include <QInputDialog>
+#include <QLabel>
+#include <QListWidget>
+#include <QMessageBox>
+#include <QMouseEvent>
+#include <QScrollBar>
+#include <QSettings>
+#include <QSplitter>
+#include <QStandardPaths>
+#include <QTimer>
 #include <QtWidgets/QMainWindow>
 #include <QTreeWidgetItem>
 #include "simdjson.h"
+#include "CompactTree.h"
+#include "CompressedSource.h"
+#include "EmbeddedJson.h"
+#include "FileBackedAllocator.h"
+#include "FileProbe.h"
+#include "HugePageAllocator.h"
+#include "JsonMimeData.h"
+#include "MemoryGovernor.h"
+#include "MinimapWidget.h"
+#include "NdjsonDocument.h"
+#include "OverlappedReader.h"
+#include "PatchJournal.h"
+#include "PatchOverlay.h"
+#include "PointerExtractor.h"
+#include "Projection.h"
+#include "Redactor.h"
+#include "RowPrefetcher.h"
+#include "SampledDocument.h"
+#include "SchemaValidator.h"
+#include "SeriesChartWidget.h"
+#include "TapeCache.h"
+#include "TopLevelScanner.h"
 #include "ui_JsonReader.h"
 
 // JsonReader class, inherits from QMainWindow, and serves as the main class for JSON file reading and parsing.
@@ -16,24 +51,160 @@ class JsonReader : public QMainWindow
     Q_OBJECT
 
 public:
-    // Default constructor and destructor
-    JsonReader(QWidget* parent = nullptr);
+    // Default constructor and destructor. Without 'useSession' the last session is neither restored nor saved, for
+    // windows driven by a harness (see SoakTest).
+    JsonReader(QWidget* parent = nullptr, bool useSession = true);
     ~JsonReader();
 
+protected:
+    // Starts dragging the selected rows out of the tree
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
 private slots:
     // Declaration of Qt slots which correspond to various user interactions
     void on_loadBtn_clicked();               // Triggered when load button is clicked
     void on_treeWidget_itemExpanded(QTreeWidgetItem* item); // Triggered when a tree widget item is expanded
+    void on_treeWidget_itemEntered(QTreeWidgetItem* item, int column); // Triggered when the mouse enters an item
     void on_textEdit_textChanged();          // Triggered when text edit content changes
     void on_searchNextBtn_clicked();         // Triggered when the "search next" button is clicked
     void on_radioCapital_toggled(bool checked); // Triggered when the case sensitive radio button is toggled
     void on_copyBtn_clicked();               // Triggered when the copy button is clicked
+    void on_actionOpenClipboard_triggered(); // Triggered when "Open from clipboard" is chosen
+    void on_actionProbeFile_triggered();     // Triggered when "Probe file..." is chosen
+    void on_actionLoadProjection_triggered(); // Triggered when "Load with projection..." is chosen
+    void on_actionExtractPointer_triggered(); // Triggered when "Extract pointer..." is chosen
+    void on_actionSampleFile_triggered();    // Triggered when "Sample file..." is chosen
+    void on_actionLoadFull_triggered();      // Triggered when "Load full file" is chosen
+    void on_actionCloseDocument_triggered(); // Triggered when "Close document" is chosen
+    void on_actionSplitView_toggled(bool checked); // Triggered when "Split view" is toggled
+    void on_actionValidateSchema_triggered(); // Triggered when "Validate against schema..." is chosen
+    void on_actionExportRedacted_triggered(); // Triggered when "Export redacted..." is chosen
+    void on_actionEditValue_triggered();     // Triggered when "Edit value..." is chosen
+    void on_actionUndoEdit_triggered();      // Triggered when "Undo edit" is chosen
+    void on_actionSaveEdits_triggered();     // Triggered when "Save edits..." is chosen
+    void on_actionExportPatch_triggered();   // Triggered when "Export patch..." is chosen
+    void on_actionImportPatch_triggered();   // Triggered when "Import patch..." is chosen
+    void on_actionApplyPatch_triggered();    // Triggered when "Apply patch to view..." is chosen
+    void on_actionSavePatched_triggered();   // Triggered when "Save patched document..." is chosen
+    void on_actionPlotField_triggered();     // Triggered when "Plot numeric field..." is chosen
+    void on_actionOutOfCoreDirectory_triggered(); // Triggered when "Out-of-core directory..." is chosen
 
 private:
+    // Drives the window through the same slots as the user
+    friend class SoakTest;
+
     // Declaration of private data members
     Ui::JsonReaderClass ui; // Instance of UI class
+    const bool useSession; // Whether the session is restored on startup and saved on exit
+    FileBackedAllocator fileBackedAllocator; // Temporary-file storage for parser buffers in out-of-core mode (must outlive 'parser')
+    QString outOfCoreDirectory; // Directory of those files; empty for the directory of the file being loaded
+    HugePageAllocator hugePageAllocator; // Huge-page, pre-faulted parser buffers (must outlive 'parser')
     simdjson::dom::parser parser; // Instance of simdjson parser
 
+    // Where a load keeps the document: the View menu's choices, possibly overridden for one file by its probe
+    struct LoadStrategy {
+        bool outOfCore = false;
+        bool hugePages = false;
+        bool compact = false;
+        bool compressStrings = false;
+    };
+
+    // Loads a file with the strategy chosen in the View menu
+    void load_file(const QString& filename);
+
+    // Replaces the tape of the document just parsed with a compact tree (see CompactTree), optionally keeping the
+    // input in compressed blocks
+    bool load_compact(const QString& filename, bool compressStrings);
+
+    // Loads a newline-delimited JSON file as a list of records (see NdjsonDocument)
+    bool load_ndjson(const QString& filename);
+
+    // Shows 'count' randomly chosen records of a large array or NDJSON file under a new root (see SampledDocument)
+    bool load_sample(const QString& filename, int count, int seed);
+
+    // Switches 'strategy' to file-backed buffers and a compact tree when a probe shows that the DOM would not fit in
+    // memory; the View menu is left as it is
+    QString apply_probe_strategy(const FileProbe& probe, LoadStrategy& strategy);
+
+    // Shows the top-level entries of a file while it is read and parses it in the background (see load_progressive)
+    void load_progressive(const QString& filename);
+
+    // Stops a progressive load still running; its rows stay as they are
+    void stop_progressive();
+
+    // Called on the UI thread as more of the input has been read, and when the background parse has finished
+    void progressive_read(size_t available);
+    void progressive_parsed(std::shared_ptr<simdjson::dom::parser> fullParser, simdjson::error_code error, std::vector<std::string> keys, std::vector<uint64_t> hashes);
+
+    // A row of a progressive load known only by the byte range of its value. 'end' is 0 while the end has not been
+    // found yet. 'parent' and 'index' locate the value in the full document once it has been parsed.
+    struct RangeRef {
+        QTreeWidgetItem* parent;
+        int index;
+        size_t start;
+        size_t end;
+        bool expanded;
+    };
+    QMap<QTreeWidgetItem*, RangeRef> itemRangeMap;
+
+    // A container whose entries are being discovered as the input is read: the root, or a range row expanded
+    // before its end was read
+    struct ProgressiveScan {
+        QTreeWidgetItem* item;
+        size_t base;
+        TopLevelScanner scanner;
+        size_t rows = 0;            // Rows added, including the open row
+        size_t completeRows = 0;    // Rows whose range is complete
+        QTreeWidgetItem* openRow = nullptr;
+    };
+    std::vector<ProgressiveScan> progressiveScans;
+
+    // State of the progressive load
+    std::shared_ptr<OverlappedReader> progressiveReader;
+    QTreeWidgetItem* progressiveRoot = nullptr;
+    std::thread progressiveThread;
+    QString progressiveFile;
+    std::atomic<bool> progressiveCancelled{ false };
+    uint64_t progressiveGeneration = 0;
+    size_t progressiveAvailable = 0;
+    QElapsedTimer progressiveTimer;
+    qint64 firstRowMs = -1;
+
+    // Parsers of ranges expanded before the full parse finished, released once the rows below them are pointed at
+    // the full document; and a parser reused for scalars and keys
+    std::vector<std::unique_ptr<simdjson::dom::parser>> rangeParsers;
+    simdjson::dom::parser rangeParser;
+
+    // Feeds a scan with the bytes read so far and adds rows for the entries it found
+    void feed_progressive_scan(ProgressiveScan& scan);
+    QTreeWidgetItem* add_range_child(ProgressiveScan& scan, const TopLevelScanner::Entry& entry, bool open);
+
+    // Expands a range row: its bytes are parsed on their own, or scanned as they arrive if its end is not known yet
+    void expand_range_item(QTreeWidgetItem* item);
+
+    // Memory governor, polled by 'memoryTimer', and the status bar label showing its budget
+    MemoryGovernor memoryGovernor;
+    QTimer memoryTimer;
+    QLabel* memoryLabel = nullptr;
+
+    // Approximate size of a tree widget item with its text, used to estimate what releasing items frees
+    static constexpr size_t ITEM_BYTES_ESTIMATE = 160;
+
+    // Polls the memory governor and updates the memory label
+    void poll_memory();
+
+    // Evictable structures (see MemoryGovernor). Each returns an estimate of the bytes released.
+    size_t trim_decompressed_blocks();
+    size_t release_collapsed_subtrees();
+    size_t release_parser_index();
+
+    // Removes the descendants of 'item' from the item maps before they are deleted; returns their number
+    size_t forget_children(QTreeWidgetItem* item);
+
+    // Patterns of the last projected load and the last extracted pointer, offered again next time
+    QString lastProjection;
+    QString lastPointer;
+
     // Variables to hold last search text and last matched item in the tree widget
     QString lastSearchText;
     QTreeWidgetItem* lastMatch = nullptr;
@@ -41,57 +212,429 @@ private:
     // Map to store relationship between QTreeWidgetItems and their corresponding JSON elements
     QMap<QTreeWidgetItem*, simdjson::dom::element> itemElementMap;
 
+    // A document loaded in compact mode: the memory-mapped input and the succinct tree referencing it
+    struct CompactDocument {
+        QFile file;
+        CompactTree tree;
+    };
+    std::vector<std::unique_ptr<CompactDocument>> compactDocuments;
+
+    // Reference to a node of a compact tree, used for items of documents loaded in compact mode
+    struct CompactNodeRef {
+        const CompactTree* tree;
+        uint64_t node;
+    };
+    QMap<QTreeWidgetItem*, CompactNodeRef> itemCompactMap;
+
+    // Items whose children have been materialized, so they can be released while collapsed and rebuilt on expand
+    QMap<QTreeWidgetItem*, simdjson::dom::element> expandedElementMap;
+    QMap<QTreeWidgetItem*, CompactNodeRef> expandedCompactMap;
+
+    // JSON held in string values: strings that look like it, by item, parsed when their item is expanded, and the
+    // documents parsed, which the items' children refer to
+    EmbeddedJson embeddedJson;
+    QMap<QTreeWidgetItem*, simdjson::dom::element> itemEmbeddedMap;
+    QMap<QTreeWidgetItem*, std::shared_ptr<const EmbeddedJson::Document>> embeddedDocuments;
+
+    // Parses the string of an item of 'itemEmbeddedMap' and adds the document to 'itemElementMap', or a row telling
+    // why it could not
+    void expand_embedded_item(QTreeWidgetItem* item);
+    void release_embedded_document(QTreeWidgetItem* item);
+
+    // What the rows under a root refer to when it is not the main parser: an NDJSON document, a restored parser or a
+    // sampled preview, by root item. Released with the root's rows (see remove_document_rows).
+    QMap<QTreeWidgetItem*, std::shared_ptr<void>> documentOwners;
+
+    // File of the last sampled preview (loaded in full on request) and its seed
+    QString sampledFile;
+    int sampleSeed = 1;
+
+    // Rows formatted ahead of expansion for items under the mouse and in the pages scrolled towards. Declared after
+    // the documents, so that its thread stops before they are released.
+    RowPrefetcher rowPrefetcher{ [](const std::string& key, simdjson::dom::element value) {
+        return QString::fromStdString(key + ": " + get_json_element_display(value).value);
+    } };
+    QLabel* prefetchLabel = nullptr;
+    QMap<QTreeWidget*, int> lastScrollValues;
+
+    // Auto-reload of the last file loaded as a DOM: the watcher, the file and its root item, the raw keys and hashes
+    // of the input bytes of the root's members or elements in the version shown, and the background hash or reparse
+    QFileSystemWatcher fileWatcher;
+    QString watchedFile;
+    QTreeWidgetItem* watchedRoot = nullptr;
+    std::vector<std::string> watchedKeys;
+    std::vector<uint64_t> watchedHashes;
+    QTimer reloadTimer;
+    std::thread reloadThread;
+    uint64_t reloadGeneration = 0;
+
+    // Time without further changes before the file is reloaded, in milliseconds
+    static constexpr int RELOAD_DELAY_MS = 300;
+
+    // Starts and stops watching a file shown under 'root'
+    void watch_file(const QString& filename, QTreeWidgetItem* root);
+    void stop_watching();
+
+    // Reparses the watched file in the background, and swaps the new version in once parsed
+    void reload_watched_file();
+    void reload_parsed(std::shared_ptr<simdjson::dom::parser> newParser, simdjson::error_code error, std::vector<std::string> keys, std::vector<uint64_t> hashes);
+    static void hash_top_level(const char* input, size_t length, std::vector<std::string>& keys, std::vector<uint64_t>& hashes);
+    void rebind_item(QTreeWidgetItem* item, simdjson::dom::element element);
+
+    // Documents whose rows can be located by JSON Pointer and saved with the session, by root item: their file
+    // (with its size and modification time when loaded), and their root element or NDJSON records
+    struct SessionDocument {
+        QString path;
+        qint64 size = 0;
+        QDateTime modified;
+        const simdjson::dom::document* doc = nullptr;
+        simdjson::dom::element root;
+        const NdjsonDocument* ndjson = nullptr;
+    };
+    QMap<QTreeWidgetItem*, SessionDocument> sessionDocuments;
+
+    // Registers a document shown under 'root', and forgets the one held by the main parser before it is replaced
+    void register_document(QTreeWidgetItem* root, const QString& path, const simdjson::dom::document* doc, simdjson::dom::element element, const NdjsonDocument* ndjson);
+    void forget_main_document();
+
+    // Deletes the rows of a document that is no longer registered, with their entries in the item maps and what
+    // they refer to
+    void remove_document_rows(QTreeWidgetItem* root);
+
+    // Stops the jobs reading the document shown under 'root', unregisters it and removes its rows
+    void close_document(QTreeWidgetItem* root);
+
+    // Converts between items of registered documents and JSON Pointers. item_pointer() returns the item's root,
+    // or nullptr if the item is not under a registered document or under an item whose element is not known.
+    QTreeWidgetItem* item_pointer(QTreeWidgetItem* item, QString& pointer);
+    QTreeWidgetItem* item_at_pointer(QTreeWidgetItem* root, const QString& pointer, bool expand);
+
+    // Second view of the registered documents, next to the main tree in a splitter. Its items have their own
+    // expansion and selection but refer to the same elements, go through the same item maps and share the row
+    // prefetcher, so it costs only the items it shows. Each of its roots mirrors a root of the main tree.
+    QSplitter* splitter = nullptr;
+    QTreeWidget* splitTree = nullptr;
+    QMap<QTreeWidgetItem*, QTreeWidgetItem*> splitRoots;
+    QMap<QTreeWidgetItem*, QTreeWidgetItem*> splitRootSources;
+
+    // The view whose selection the copy button and drags use: the one selected in last
+    QTreeWidget* activeTree = nullptr;
+
+    // Adds or resets the mirror of a main root, and removes it
+    void add_split_root(QTreeWidgetItem* root);
+    void remove_split_root(QTreeWidgetItem* root);
+
+    // Fills a mirror root when it is first expanded; other items are expanded as in the main tree
+    void split_item_expanded(QTreeWidgetItem* item);
+
+    // The document shown under a root of either view, or nullptr
+    const SessionDocument* session_document(QTreeWidgetItem* root) const;
+
+    // Finds the element shown by an item through its parent's element; false for rows without one
+    bool item_element(QTreeWidgetItem* item, simdjson::dom::element& element);
+
+    // Clipboard and drag data of the selected rows, serialized when pasted or dropped. The data handed out is kept
+    // track of so that it can be serialized before the documents it refers to are released.
+    JsonMimeData* selection_mime_data(QTreeWidget* tree);
+    void detach_mime_data();
+    QList<QPointer<JsonMimeData>> lazyMimeData;
+
+    // Press position of a possible drag, in viewport coordinates
+    QPoint dragStart;
+    bool dragPending = false;
+
+    // Pointers of the expanded items under 'root', parents first
+    QStringList expanded_pointers(QTreeWidgetItem* root);
+
+    // A document saved with the session: its file, kind, expanded rows, and the current and top rows if they are its own
+    struct SavedDocument {
+        QString path;
+        bool ndjson = false;
+        QStringList expanded;
+        bool hasCurrent = false;
+        QString current;
+        bool hasTop = false;
+        QString top;
+    };
+
+    // A document being restored in the background, under a placeholder root. The thread fills the parser or the
+    // NDJSON document, which the UI thread then takes over.
+    struct RestoreJob {
+        SavedDocument saved;
+        QTreeWidgetItem* root = nullptr;
+        std::unique_ptr<simdjson::dom::parser> parser;
+        std::unique_ptr<NdjsonDocument> ndjson;
+        simdjson::error_code error = simdjson::SUCCESS;
+        bool fromCache = false;
+    };
+    std::vector<std::unique_ptr<RestoreJob>> restoreJobs;
+    std::vector<std::thread> restoreThreads;
+    QMap<QTreeWidgetItem*, SavedDocument> pendingRestores;
+    QElapsedTimer restoreTimer;
+    int restoredFromCache = 0;
+
+    // Saves the open documents, their view state and the search state
+    void save_session();
+
+    // Loads the documents of the saved session in parallel, from their tape caches when still valid
+    void restore_session();
+    void restore_loaded(RestoreJob* job);
+    void stop_restoring();
+
+    // Directory of the tape caches (see TapeCache)
+    static QString tape_cache_directory();
+
+    // Tape caches of DOM documents, written one at a time in the background once the view has been without new
+    // loads for CACHE_DELAY_MS: the documents waiting, and the one being written with its root
+    QList<QTreeWidgetItem*> pendingCaches;
+    QTreeWidgetItem* cacheRoot = nullptr;
+    const simdjson::dom::document* cacheDoc = nullptr;
+    std::thread cacheThread;
+    uint64_t cacheGeneration = 0;
+    std::atomic<bool> cacheCancelled{ false };
+    QTimer cacheTimer;
+
+    static constexpr int CACHE_DELAY_MS = 2000;
+
+    // Queues the cache of a registered document, and writes the next one queued
+    void schedule_tape_cache(QTreeWidgetItem* root);
+    void write_next_tape_cache();
+
+    // Called on the UI thread when a cache has been written or found valid
+    void tape_cache_written(simdjson::error_code error);
+
+    // Cancels a cache being written, and waits for the thread
+    void stop_caching();
+
+    // Schema validation of a registered document in the background (see SchemaValidator): the validated root and
+    // document, and the dock listing the violations found
+    SchemaValidator schemaValidator;
+    std::thread validationThread;
+    uint64_t validationGeneration = 0;
+    QTreeWidgetItem* validationRoot = nullptr;
+    const simdjson::dom::document* validationDoc = nullptr;
+    QDockWidget* validationDock = nullptr;
+    QListWidget* validationList = nullptr;
+
+    // Called on the UI thread when the validation has finished; 'bytes' is the size of the validated file, if any
+    void validation_finished(std::vector<SchemaValidator::Violation> violations, qint64 bytes);
+
+    // Cancels a validation still running, and waits for its thread
+    void stop_validation();
+
+    // Expands the tree down to the value of a violation and selects it
+    void show_violation(QListWidgetItem* entry);
+
+    // Redacted export of a registered document in the background (see Redactor), and the document exported with
+    // its root
+    std::shared_ptr<Redactor> exportRedactor;
+    std::thread exportThread;
+    uint64_t exportGeneration = 0;
+    const simdjson::dom::document* exportDoc = nullptr;
+    QTreeWidgetItem* exportRoot = nullptr;
+
+    // Called on the UI thread when the export has finished
+    void export_finished(std::shared_ptr<Redactor> redactor, simdjson::error_code error, QString filename);
+
+    // Cancels an export still running, and waits for its thread; the partial file is removed
+    void stop_export();
+
+    // Root of the document of the current row of the active view, or of the last document opened; nullptr if none
+    QTreeWidgetItem* current_document_root();
+
+    // Edits of the files shown, by path (see PatchJournal), and the background job locating an edit, applying an
+    // imported patch or saving. Jobs run one at a time, and the journals are only changed on the UI thread.
+    QMap<QString, std::shared_ptr<PatchJournal>> patchJournals;
+    std::thread editThread;
+    uint64_t editGeneration = 0;
+
+    // Longest current value offered for editing; larger values start from an empty text
+    static constexpr size_t MAX_EDITED_TEXT = 1024 * 1024;
+
+    // The journal of the document under 'root', created on first use; nullptr, with a message, if it cannot be edited
+    std::shared_ptr<PatchJournal> journal_for(QTreeWidgetItem* root);
+
+    // Called on the UI thread when a job has finished
+    void edit_located(QTreeWidgetItem* root, std::shared_ptr<PatchJournal> journal, PatchJournal::Edit edit, simdjson::error_code error, QString message);
+    void patch_imported(QTreeWidgetItem* root, std::shared_ptr<PatchJournal> journal, simdjson::error_code error);
+    void edits_saved(std::shared_ptr<PatchJournal> journal, simdjson::error_code error, QString filename);
+
+    // Waits for a job still running
+    void stop_editing();
+
+    // Shows an edited value in its row, the edits of the children of an item just expanded, and the value of the
+    // document again once an edit is undone
+    void show_edit(QTreeWidgetItem* item, const QString& pointer, const std::string& value);
+    void show_edits(QTreeWidgetItem* item);
+    void restore_row(QTreeWidgetItem* item, const QString& pointer);
+
+    // Patches applied to the documents shown, by root item (see PatchOverlay). The rows of a patched document are
+    // built from its overlay: containers copied into the overlay are expanded through 'itemOverlayMap', values it
+    // shares with the base document are rows like any other. A patch is applied to a copy of the overlay in the
+    // background, and the copy swapped in only if every operation applied.
+    struct OverlayRef {
+        std::shared_ptr<const PatchOverlay> overlay;
+        PatchOverlay::NodeId node;
+    };
+    QMap<QTreeWidgetItem*, std::shared_ptr<const PatchOverlay>> patchOverlays;
+    QMap<QTreeWidgetItem*, OverlayRef> itemOverlayMap;
+    QMap<QTreeWidgetItem*, OverlayRef> expandedOverlayMap;
+    std::thread patchThread;
+    uint64_t patchGeneration = 0;
+    const simdjson::dom::document* patchDoc = nullptr;
+
+    // Called on the UI thread when a patch has been applied, and when the patched document has been written
+    void patch_applied(QTreeWidgetItem* root, std::shared_ptr<const PatchOverlay> overlay, simdjson::error_code error);
+    void patched_saved(std::shared_ptr<const PatchOverlay> overlay, simdjson::error_code error, QString filename);
+
+    // Waits for a patch still being applied or written
+    void stop_patching();
+
+    // Drops the overlay of a root, once its rows no longer refer to it
+    void remove_overlay(QTreeWidgetItem* root);
+
+    // The overlay node shown by an item: a container of 'itemOverlayMap', or the root of a patched document
+    bool overlay_node(QTreeWidgetItem* item, OverlayRef& ref) const;
+
+    // Fills the rows of an item from an overlay node; children copied into the overlay are expanded lazily
+    void add_children_to_item(QTreeWidgetItem* item, const OverlayRef& ref);
+
+    // Minimap of the current DOM document in a dock (see DocumentMinimap), built in the background when another
+    // document becomes current, with the hits of the search text counted on the same thread. The rows in view are
+    // framed after scrolling or expanding, at most every MINIMAP_DELAY_MS.
+    QDockWidget* minimapDock = nullptr;
+    MinimapWidget* minimapWidget = nullptr;
+    QTreeWidgetItem* minimapRoot = nullptr;
+    const simdjson::dom::document* minimapDoc = nullptr;
+    std::thread minimapThread;
+    uint64_t minimapGeneration = 0;
+    std::atomic<bool> minimapCancelled{ false };
+    QTimer minimapTimer;
+
+    static constexpr int MINIMAP_DELAY_MS = 50;
+
+    // Follows the current document and the rows in view, soon after a change
+    void schedule_minimap();
+    void update_minimap();
+    void update_minimap_viewport();
+
+    // Called on the UI thread when a minimap has been built, and when the hits of the search text have been counted
+    void minimap_built(QTreeWidgetItem* root, std::shared_ptr<const DocumentMinimap> minimap);
+    void count_minimap_hits();
+    void minimap_hits_counted(std::shared_ptr<const DocumentMinimap> minimap, std::vector<uint32_t> hits);
+
+    // Expands the tree down to the first value of a bucket and selects it
+    void jump_to_bucket(size_t bucket);
+
+    // Cancels a count still running, and waits for the thread; reset_minimap() also drops the minimap shown
+    void stop_minimap();
+    void reset_minimap();
+
+    // Chart of a numeric field in a dock (see NumericSeries), extracted on a background thread. 'plotPath' is the
+    // last path plotted, with "*" for the elements, and 'plotRoot' the document it was read from.
+    QDockWidget* chartDock = nullptr;
+    SeriesChartWidget* chartWidget = nullptr;
+    QString plotPath;
+    QTreeWidgetItem* plotRoot = nullptr;
+    const simdjson::dom::document* plotDoc = nullptr;
+    std::thread plotThread;
+    uint64_t plotGeneration = 0;
+    std::atomic<bool> plotCancelled{ false };
+
+    // Called on the UI thread when the values of a field have been extracted
+    void series_extracted(std::shared_ptr<const NumericSeries> series, simdjson::error_code error, QString path);
+
+    // Selects the element of a point clicked in the chart
+    void jump_to_element(size_t index);
+
+    // Cancels an extraction still running, and waits for the thread
+    void stop_plotting();
+
+    // Pages of rows past the visible range whose containers are prefetched while scrolling
+    static constexpr int PREFETCH_PAGES = 2;
+
+    // Requests the children of an unexpanded item, and of the items in the pages the view is scrolling towards
+    void prefetch_item(QTreeWidgetItem* item);
+    void prefetch_scrolled(QTreeWidget* tree, int value);
+
+    // Drops prefetched rows before the elements they refer to are released
+    void clear_prefetched_rows();
+
     // Structure to hold the JSON element's value and its associated color for display
     struct JsonElementDisplay {
         std::string value;
         QColor color;
     };
 
+    // Function to get the display color associated with a JSON element type.
+    static QColor get_element_color(simdjson::dom::element_type type) {
+        using simdjson::dom::element_type;
+        switch (type) {
+        case element_type::INT64:
+        case element_type::UINT64:
+            return QColor(0, 0, 255);
+        case element_type::DOUBLE:
+            return QColor(0, 103, 156);
+        case element_type::STRING:
+            return QColor(128, 128, 255);
+        case element_type::BOOL:
+            return QColor(255, 0, 255);
+        case element_type::NULL_VALUE:
+            return QColor(128, 128, 128);
+        case element_type::ARRAY:
+            return QColor(255, 0, 0);
+        case element_type::OBJECT:
+            return QColor(48, 186, 143);
+        default:
+            return QColor(0, 0, 0);
+        }
+    }
+
     // Function to get a JsonElementDisplay object for a given JSON element.
     // This function identifies the type of the JSON element and assigns appropriate value and color properties
     // to a JsonElementDisplay object.
-    JsonElementDisplay get_json_element_display(simdjson::dom::element value) {
+    static JsonElementDisplay get_json_element_display(simdjson::dom::element value) {
         using namespace simdjson;
         using dom::element_type;
         JsonElementDisplay elementDisplay;
         switch (value.type()) {
         case element_type::INT64:
             elementDisplay.value = std::to_string(value.get<int64_t>().value());
-            elementDisplay.color = QColor(0, 0, 255);
             break;
         case element_type::UINT64:
             elementDisplay.value = std::to_string(value.get<uint64_t>().value());
-            elementDisplay.color = QColor(0, 0, 255);
             break;
         case element_type::DOUBLE:
             elementDisplay.value = std::to_string(value.get<double>().value());
-            elementDisplay.color = QColor(0, 103, 156);
             break;
         case element_type::STRING:
             elementDisplay.value = std::string(value.get<std::string_view>().value());
-            elementDisplay.color = QColor(128, 128, 255);
             break;
         case element_type::BOOL:
             elementDisplay.value = value.get<bool>().value() ? "true" : "false";
-            elementDisplay.color = QColor(255, 0, 255);
             break;
         case element_type::NULL_VALUE:
             elementDisplay.value = "null";
-            elementDisplay.color = QColor(128, 128, 128);
             break;
         case element_type::ARRAY:
             elementDisplay.value = "ARRAY";
-            elementDisplay.color = QColor(255, 0, 0);
             break;
         case element_type::OBJECT:
             elementDisplay.value = "OBJECT";
-            elementDisplay.color = QColor(48, 186, 143);
             break;
         default:
             elementDisplay.value = "UNKNOWN_TYPE";
-            elementDisplay.color = QColor(0, 0, 0);
             break;
         }
+        elementDisplay.color = get_element_color(value.type());
+        return elementDisplay;
+    }
+
+    // Function to get a JsonElementDisplay object for a node of a compact tree, formatted like DOM elements.
+    JsonElementDisplay get_compact_element_display(const CompactTree& tree, uint64_t node) {
+        JsonElementDisplay elementDisplay;
+        elementDisplay.value = tree.display_value(node);
+        elementDisplay.color = get_element_color(tree.element_type(node));
         return elementDisplay;
     }
 
@@ -112,28 +655,42 @@ private:
         return pairs;
     }
 
-    // Function to populate a QTreeWidgetItem with children items. The children items are created based on the given JSON element.
-    void add_children_to_item(QTreeWidgetItem* item, simdjson::dom::element element) {
+    // Function to add a child item with a key and a value to the parent item.
+    void add_child_to_item(QTreeWidgetItem* item, const std::string& key, const simdjson::dom::element& value) {
+        // Get display properties for the JSON element
+        JsonReader::JsonElementDisplay elementDisplay = get_json_element_display(value);
+        add_row_to_item(item, QString::fromStdString(key + ": " + elementDisplay.value), value);
+    }
 
-        // Inner function to add a child item with a key and a value to the parent item.
-        auto add_child = [&](const auto& key, const simdjson::dom::element& value) {
-            // Get display properties for the JSON element
-            JsonReader::JsonElementDisplay elementDisplay = get_json_element_display(value);
+    // Function to add a child item with already formatted text (see RowPrefetcher) to the parent item.
+    void add_row_to_item(QTreeWidgetItem* item, const QString& text, const simdjson::dom::element& value) {
+        // Create a child item with the key-value pair as its text
+        QTreeWidgetItem* child = new QTreeWidgetItem(QStringList() << text);
 
-            // Create a child item with the key-value pair as its text
-            QTreeWidgetItem* child = new QTreeWidgetItem(QStringList() << QString::fromStdString(key + ": " + elementDisplay.value));
+        // Set the color of the child item
+        child->setForeground(0, QBrush(get_element_color(value.type())));
 
-            // Set the color of the child item
-            child->setForeground(0, QBrush(elementDisplay.color));
+        // Add the child item to the parent item
+        item->addChild(child);
 
-            // Add the child item to the parent item
-            item->addChild(child);
+        // If the JSON element is an array or an object, add it to the item-element map and add a dummy child to it so it can be expanded
+        if (value.type() == simdjson::dom::element_type::OBJECT || value.type() == simdjson::dom::element_type::ARRAY) {
+            child->addChild(new QTreeWidgetItem());
+            itemElementMap.insert(child, value);
+        }
+        // Strings that may hold JSON can be expanded too, and are parsed then
+        else if (value.type() == simdjson::dom::element_type::STRING && ui.actionEmbeddedJson->isChecked()
+            && EmbeddedJson::looks_embedded(std::string_view(value), ui.actionEmbeddedWrapped->isChecked())) {
+            child->addChild(new QTreeWidgetItem());
+            child->setToolTip(0, "Expand to show the JSON in this string");
+            itemEmbeddedMap.insert(child, value);
+        }
+    }
 
-            // If the JSON element is an array or an object, add it to the item-element map and add a dummy child to it so it can be expanded
-            if (value.type() == simdjson::dom::element_type::OBJECT || value.type() == simdjson::dom::element_type::ARRAY) {
-                child->addChild(new QTreeWidgetItem());
-                itemElementMap.insert(child, value);
-            }
+    // Function to populate a QTreeWidgetItem with children items. The children items are created based on the given JSON element.
+    void add_children_to_item(QTreeWidgetItem* item, simdjson::dom::element element) {
+        auto add_child = [&](const std::string& key, const simdjson::dom::element& value) {
+            add_child_to_item(item, key, value);
         };
 
         // If the JSON element is an object, add each of its members as a child of the item
@@ -153,6 +710,34 @@ private:
         }
     }
 
+    // Function to populate a QTreeWidgetItem with the children of a compact tree node.
+    // Object members are stored as a KEY node followed by the value node.
+    void add_children_to_item(QTreeWidgetItem* item, const CompactTree& tree, uint64_t node) {
+        bool isObject = tree.kind(node) == CompactTree::NodeKind::OBJECT;
+        int index = 0;
+        for (uint64_t child = tree.first_child(node); child != CompactTree::npos; child = tree.next_sibling(child)) {
+            std::string key;
+            if (isObject) {
+                key = tree.string_value(child);
+                child = tree.next_sibling(child);
+            }
+            else {
+                key = std::to_string(index++);
+            }
+
+            JsonReader::JsonElementDisplay elementDisplay = get_compact_element_display(tree, child);
+            QTreeWidgetItem* childItem = new QTreeWidgetItem(QStringList() << QString::fromStdString(key + ": " + elementDisplay.value));
+            childItem->setForeground(0, QBrush(elementDisplay.color));
+            item->addChild(childItem);
+
+            // Containers get a dummy child so they can be expanded, and are resolved lazily like DOM elements
+            if (tree.is_container(child)) {
+                childItem->addChild(new QTreeWidgetItem());
+                itemCompactMap.insert(childItem, CompactNodeRef{ &tree, child });
+            }
+        }
+    }
+
     // Function to search the tree widget for items that contain a given text. 
     // The search can start from the currently selected item or from the beginning.
     bool searchTree(QTreeWidgetItem* item, const QString& searchText, bool startFromCurrent, bool searchArrays = false) {
@@ -189,7 +774,8 @@ private:
             }
 
             // Load children if not already loaded
-            if (itemElementMap.contains(current)) {
+            if (itemElementMap.contains(current) || itemCompactMap.contains(current) || itemOverlayMap.contains(current) || (itemRangeMap.contains(current) && !itemRangeMap[current].expanded)
+                || (ui.actionSearchEmbedded->isChecked() && itemEmbeddedMap.contains(current))) {
                 this->on_treeWidget_itemExpanded(current);
             }
 
@@ -0,0 +1,186 @@
+#include "MemoryGovernor.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace {
+
+	// Reads the first line of a file, empty if it cannot be read
+	std::string read_line(const std::string& path) {
+		std::ifstream file(path);
+		std::string line;
+		std::getline(file, line);
+		return line;
+	}
+
+	// Reads a cgroup memory limit file: a byte count or "max". Returns 0 when unlimited or unreadable.
+	uint64_t read_limit(const std::string& path) {
+		const std::string line = read_line(path);
+		if (line.empty() || line == "max") {
+			return 0;
+		}
+		return std::strtoull(line.c_str(), nullptr, 10);
+	}
+
+	// Mount point of the cgroup v2 hierarchy: /sys/fs/cgroup, or its "unified" subdirectory on hybrid setups
+	std::string cgroup_root() {
+		for (const char* root : { "/sys/fs/cgroup", "/sys/fs/cgroup/unified" }) {
+			if (std::ifstream(std::string(root) + "/cgroup.controllers")) {
+				return root;
+			}
+		}
+		return std::string();
+	}
+
+	// Path of the process's cgroup v2 directory under 'root'
+	std::string own_cgroup(const std::string& root) {
+		std::ifstream file("/proc/self/cgroup");
+		std::string line;
+		while (std::getline(file, line)) {
+			if (line.compare(0, 3, "0::") == 0) {
+				std::string path = root + line.substr(3);
+				while (path.size() > root.size() && path.back() == '/') {
+					path.pop_back();
+				}
+				return path;
+			}
+		}
+		return std::string();
+	}
+
+	// Parses the avg10 fields of the "some" and "full" lines of a PSI file
+	bool read_pressure(const std::string& path, double& some, double& full) {
+		std::ifstream file(path);
+		if (!file) {
+			return false;
+		}
+		std::string line;
+		while (std::getline(file, line)) {
+			std::istringstream fields(line);
+			std::string kind, field;
+			fields >> kind;
+			while (fields >> field) {
+				if (field.compare(0, 6, "avg10=") == 0) {
+					const double value = std::strtod(field.c_str() + 6, nullptr);
+					(kind == "full" ? full : some) = value;
+				}
+			}
+		}
+		return true;
+	}
+}
+
+void MemoryGovernor::add_evictable(const std::string& name, int priority, std::function<size_t()> evict) {
+	auto position = std::upper_bound(evictables.begin(), evictables.end(), priority, [](int value, const Evictable& evictable) {
+		return value < evictable.priority;
+	});
+	evictables.insert(position, Evictable{ name, priority, std::move(evict) });
+}
+
+// Method: Reads limits along the cgroup path up to the root, and usage and PSI of the process's cgroup
+MemoryGovernor::Budget MemoryGovernor::read_budget() const {
+	Budget budget;
+#ifdef __linux__
+	const std::string root = cgroup_root();
+	const std::string cgroup = root.empty() ? std::string() : own_cgroup(root);
+	bool pressureRead = false;
+	if (!cgroup.empty()) {
+		// memory.current is missing when the memory controller is not enabled for this cgroup
+		const std::string current = read_line(cgroup + "/memory.current");
+		if (!current.empty()) {
+			budget.known = true;
+			budget.current = std::strtoull(current.c_str(), nullptr, 10);
+
+			// The effective limit is the smallest one on the way up; memory.high throttles before memory.max kills
+			for (std::string path = cgroup; path.size() > root.size(); path.erase(path.rfind('/'))) {
+				for (const char* file : { "/memory.max", "/memory.high" }) {
+					const uint64_t limit = read_limit(path + file);
+					if (limit != 0 && (budget.limit == 0 || limit < budget.limit)) {
+						budget.limit = limit;
+					}
+				}
+			}
+		}
+		pressureRead = read_pressure(cgroup + "/memory.pressure", budget.pressureSome, budget.pressureFull);
+	}
+
+	// Without a cgroup pressure file (PSI disabled, the root cgroup or no v2 hierarchy) use the system-wide one
+	if (!pressureRead) {
+		pressureRead = read_pressure("/proc/pressure/memory", budget.pressureSome, budget.pressureFull);
+	}
+	budget.known = budget.known || pressureRead;
+#endif
+	return budget;
+}
+
+// Method: Reads MemAvailable on Linux and the available physical memory on Windows
+uint64_t MemoryGovernor::available_memory() const {
+	uint64_t available = 0;
+#ifdef _WIN32
+	MEMORYSTATUSEX status;
+	status.dwLength = sizeof(status);
+	if (GlobalMemoryStatusEx(&status)) {
+		available = status.ullAvailPhys;
+	}
+#elif defined(__linux__)
+	std::ifstream file("/proc/meminfo");
+	std::string name;
+	uint64_t kilobytes;
+	std::string unit;
+	while (file >> name >> kilobytes) {
+		std::getline(file, unit);
+		if (name == "MemAvailable:") {
+			available = kilobytes * 1024;
+			break;
+		}
+	}
+#endif
+	const Budget budget = read_budget();
+	if (budget.limit != 0) {
+		const uint64_t headroom = budget.limit > budget.current ? budget.limit - budget.current : 0;
+		available = available ? std::min(available, headroom) : headroom;
+	}
+	return available;
+}
+
+bool MemoryGovernor::under_pressure(const Budget& budget) {
+	if (!budget.known) {
+		return false;
+	}
+	if (budget.limit != 0 && double(budget.current) > USAGE_THRESHOLD * double(budget.limit)) {
+		return true;
+	}
+	return budget.pressureSome > PRESSURE_THRESHOLD;
+}
+
+// Method: Evicts at most one structure per call, so that the effect of each eviction shows in the next reading
+std::vector<MemoryGovernor::Eviction> MemoryGovernor::poll() {
+	std::vector<Eviction> released;
+	lastBudget = read_budget();
+	if (!under_pressure(lastBudget)) {
+		nextEvictable = 0;
+		return released;
+	}
+	while (nextEvictable < evictables.size()) {
+		const Evictable& evictable = evictables[nextEvictable++];
+		const size_t bytes = evictable.evict();
+		if (bytes != 0) {
+			released.push_back(Eviction{ evictable.name, bytes });
+			evictions.push_back(released.back());
+			if (evictions.size() > MAX_HISTORY) {
+				evictions.erase(evictions.begin());
+			}
+			return released;
+		}
+	}
+
+	// Everything has been released; structures re-created since are candidates again from the next poll on
+	nextEvictable = 0;
+	return released;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// MemoryGovernor class, watches the memory budget of the process and releases optional structures when it runs
+// short. On Linux the budget is the cgroup v2 limit (memory.max / memory.high of the process's cgroup and its
+// ancestors) and pressure comes from PSI (memory.pressure, or /proc/pressure/memory); elsewhere no budget is known
+// and nothing is evicted.
+// Evictable structures are registered with a priority and released lowest priority first, one per poll while the
+// pressure lasts. Their owners re-create them lazily when they are needed again.
+class MemoryGovernor
+{
+public:
+    // Usage above this fraction of the limit counts as pressure
+    static constexpr double USAGE_THRESHOLD = 0.9;
+
+    // PSI "some" average over 10 seconds, in percent, above which memory counts as under pressure
+    static constexpr double PRESSURE_THRESHOLD = 10.0;
+
+    // Number of evictions kept in history()
+    static constexpr size_t MAX_HISTORY = 100;
+
+    // Current budget as read from the cgroup
+    struct Budget {
+        bool known = false;         // Whether cgroup v2 memory accounting or PSI was found
+        uint64_t limit = 0;         // Smallest memory.max / memory.high on the path to the root, 0 if unlimited
+        uint64_t current = 0;       // memory.current of the process's cgroup
+        double pressureSome = 0;    // PSI "some" avg10 in percent
+        double pressureFull = 0;    // PSI "full" avg10 in percent
+    };
+
+    // A released structure
+    struct Eviction {
+        std::string name;
+        size_t bytes;
+    };
+
+    // Registers a structure. 'evict' releases it and returns the approximate number of bytes freed (0 if there
+    // was nothing to release). Lower priorities are evicted first.
+    void add_evictable(const std::string& name, int priority, std::function<size_t()> evict);
+
+    // Reads the current budget
+    Budget read_budget() const;
+
+    // Memory that can be allocated without causing pressure: available physical memory, further limited by the
+    // headroom below the cgroup limit. Returns 0 if unknown.
+    uint64_t available_memory() const;
+
+    // Whether 'budget' is under pressure
+    static bool under_pressure(const Budget& budget);
+
+    // Reads the budget and, under pressure, evicts the next structure that releases something. Once the pressure
+    // is gone, the next episode starts again from the lowest priority, since structures are re-created meanwhile.
+    std::vector<Eviction> poll();
+
+    // Budget read by the last poll, and the latest evictions, oldest first
+    const Budget& last_budget() const { return lastBudget; }
+    const std::vector<Eviction>& history() const { return evictions; }
+
+private:
+    struct Evictable {
+        std::string name;
+        int priority;
+        std::function<size_t()> evict;
+    };
+    std::vector<Evictable> evictables;
+    size_t nextEvictable = 0;
+    Budget lastBudget;
+    std::vector<Eviction> evictions;
+};
@@ -0,0 +1,170 @@
+#include "MinimapWidget.h"
+#include <algorithm>
+#include <cmath>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QToolTip>
+
+namespace {
+
+	const QColor SPARSE_COLOR(205, 220, 240);
+	const QColor DENSE_COLOR(25, 65, 150);
+	const QColor HIT_COLOR(255, 140, 0);
+	const QColor VIEWPORT_FILL(0, 0, 0, 40);
+	const QColor VIEWPORT_FRAME(0, 0, 0, 160);
+
+	QColor blend(const QColor& from, const QColor& to, double ratio) {
+		return QColor(
+			int(from.red() + (to.red() - from.red()) * ratio),
+			int(from.green() + (to.green() - from.green()) * ratio),
+			int(from.blue() + (to.blue() - from.blue()) * ratio));
+	}
+}
+
+MinimapWidget::MinimapWidget(QWidget* parent)
+	: QWidget(parent)
+{
+	setMouseTracking(true);
+	setMinimumWidth(3 * HIT_MARK_WIDTH);
+}
+
+QSize MinimapWidget::sizeHint() const {
+	return QSize(80, 400);
+}
+
+void MinimapWidget::set_minimap(std::shared_ptr<const DocumentMinimap> newMinimap) {
+	shown = std::move(newMinimap);
+	hits.clear();
+	hasViewport = false;
+	render_structure();
+	update();
+}
+
+void MinimapWidget::set_hits(std::vector<uint32_t> newHits) {
+	hits = std::move(newHits);
+	update();
+}
+
+void MinimapWidget::set_viewport(size_t first, size_t last) {
+	if (hasViewport && first == viewportFirst && last == viewportLast) {
+		return;
+	}
+	hasViewport = true;
+	viewportFirst = first;
+	viewportLast = std::max(first, last);
+	update();
+}
+
+void MinimapWidget::clear_viewport() {
+	if (hasViewport) {
+		hasViewport = false;
+		update();
+	}
+}
+
+void MinimapWidget::buckets_at(int y, size_t& first, size_t& last) const {
+	const size_t count = shown ? shown->buckets().size() : 0;
+	const size_t rows = size_t(std::max(1, height()));
+	const size_t row = size_t(std::max(0, y));
+	first = std::min(count - 1, row * count / rows);
+	const size_t end = std::min(count, (row + 1) * count / rows);
+	last = end > first ? end - 1 : first;
+}
+
+int MinimapWidget::row_of(size_t bucket) const {
+	const size_t count = shown ? shown->buckets().size() : 0;
+	return count == 0 ? 0 : int(bucket * size_t(height()) / count);
+}
+
+// Method: Each row shows the deepest value of its buckets as the bar length and their mean number of values as its
+// shade; the shade follows the square root of the density so that sparse parts stay visible
+void MinimapWidget::render_structure() {
+	const int width = std::max(1, this->width() - HIT_MARK_WIDTH);
+	structure = QImage(width, std::max(1, height()), QImage::Format_RGB32);
+	structure.fill(palette().color(QPalette::Base));
+	if (!shown || shown->buckets().empty()) {
+		return;
+	}
+	const std::vector<DocumentMinimap::Bucket>& buckets = shown->buckets();
+	QPainter painter(&structure);
+	for (int y = 0; y < structure.height(); y++) {
+		size_t first, last;
+		buckets_at(y, first, last);
+		uint64_t nodes = 0;
+		uint32_t depth = 0;
+		for (size_t i = first; i <= last; i++) {
+			nodes += buckets[i].nodes;
+			depth = std::max(depth, buckets[i].maxDepth);
+		}
+		if (nodes == 0) {
+			continue;
+		}
+		const double density = double(nodes) / double(last - first + 1) / double(std::max<uint32_t>(1, shown->max_nodes()));
+		const int length = std::max(1, int(width * double(depth + 1) / double(shown->max_depth() + 1)));
+		painter.setPen(blend(SPARSE_COLOR, DENSE_COLOR, std::sqrt(std::min(1.0, density))));
+		painter.drawLine(0, y, length - 1, y);
+	}
+}
+
+void MinimapWidget::paintEvent(QPaintEvent* event) {
+	Q_UNUSED(event);
+	QPainter painter(this);
+	painter.fillRect(rect(), palette().color(QPalette::Base));
+	painter.drawImage(0, 0, structure);
+	if (!shown || shown->buckets().empty()) {
+		return;
+	}
+
+	for (size_t i = 0; i < hits.size(); i++) {
+		if (hits[i] > 0) {
+			painter.fillRect(width() - HIT_MARK_WIDTH, row_of(i), HIT_MARK_WIDTH, std::max(1, row_of(i + 1) - row_of(i)), HIT_COLOR);
+		}
+	}
+
+	if (hasViewport) {
+		const int top = row_of(viewportFirst);
+		const int bottom = std::max(top + 2, row_of(viewportLast + 1));
+		const QRect frame(0, top, width() - 1, bottom - top - 1);
+		painter.fillRect(frame, VIEWPORT_FILL);
+		painter.setPen(VIEWPORT_FRAME);
+		painter.drawRect(frame);
+	}
+}
+
+void MinimapWidget::resizeEvent(QResizeEvent* event) {
+	QWidget::resizeEvent(event);
+	render_structure();
+}
+
+void MinimapWidget::mousePressEvent(QMouseEvent* event) {
+	if (event->button() != Qt::LeftButton || !shown || shown->buckets().empty()) {
+		QWidget::mousePressEvent(event);
+		return;
+	}
+	size_t first, last;
+	buckets_at(event->position().toPoint().y(), first, last);
+	emit bucket_clicked(first);
+}
+
+// Method: Describes the buckets under the mouse in a tooltip
+void MinimapWidget::mouseMoveEvent(QMouseEvent* event) {
+	if (!shown || shown->buckets().empty()) {
+		return;
+	}
+	size_t first, last;
+	buckets_at(event->position().toPoint().y(), first, last);
+	uint64_t nodes = 0;
+	uint32_t depth = 0;
+	uint64_t hitCount = 0;
+	for (size_t i = first; i <= last; i++) {
+		nodes += shown->buckets()[i].nodes;
+		depth = std::max(depth, shown->buckets()[i].maxDepth);
+		hitCount += i < hits.size() ? hits[i] : 0;
+	}
+	const double megabytes = double(first * shown->bucket_bytes()) / (1024 * 1024);
+	QString text = QString("At %1 MB: %2 values, depth up to %3").arg(megabytes, 0, 'f', 1).arg(nodes).arg(depth);
+	if (hitCount > 0) {
+		text += QString(", %1 hits").arg(hitCount);
+	}
+	QToolTip::showText(event->globalPosition().toPoint(), text, this);
+}
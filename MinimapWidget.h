@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <QImage>
+#include <QWidget>
+#include "DocumentMinimap.h"
+
+// MinimapWidget class, draws a DocumentMinimap as a vertical strip from the top of the document to its end. Each
+// pixel row covers a run of buckets: the length of its bar is their greatest depth, and its shade the number of
+// values starting in them. Search hits are marked along the right edge and the rows shown in the tree by a frame.
+// The strip is drawn from the buckets only, into an image kept until the size or the minimap changes, so painting
+// costs the same for any document. Clicking or dragging reports the bucket under the mouse.
+class MinimapWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    // Width of the search hit marks, in pixels
+    static constexpr int HIT_MARK_WIDTH = 6;
+
+    explicit MinimapWidget(QWidget* parent = nullptr);
+
+    // Shows a minimap, or nothing; clears the hits and the viewport
+    void set_minimap(std::shared_ptr<const DocumentMinimap> newMinimap);
+    const std::shared_ptr<const DocumentMinimap>& minimap() const { return shown; }
+
+    // Search hits per bucket, as returned by DocumentMinimap::count_hits(); empty for none
+    void set_hits(std::vector<uint32_t> newHits);
+
+    // Buckets of the first and last rows shown in the tree, or none
+    void set_viewport(size_t first, size_t last);
+    void clear_viewport();
+
+    QSize sizeHint() const override;
+
+signals:
+    void bucket_clicked(size_t bucket);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+
+private:
+    std::shared_ptr<const DocumentMinimap> shown;
+    std::vector<uint32_t> hits;
+    bool hasViewport = false;
+    size_t viewportFirst = 0;
+    size_t viewportLast = 0;
+
+    // The depth and density bars, drawn for the current size
+    QImage structure;
+
+    void render_structure();
+
+    // Buckets drawn in a pixel row, and the pixel row of a bucket
+    void buckets_at(int y, size_t& first, size_t& last) const;
+    int row_of(size_t bucket) const;
+};
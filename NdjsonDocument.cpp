@@ -0,0 +1,203 @@
+#include "NdjsonDocument.h"
+#include <algorithm>
+#include <cctype>
+#include "OverlappedReader.h"
+
+namespace {
+
+	// Whether the structural characters of a line, outside strings, keep it to a single value: a container closed
+	// by the last character of the line, or a scalar holding none of them. The parse of the batch checks the rest.
+	bool holds_one_value(std::string_view line) {
+		const bool container = line.front() == '[' || line.front() == '{';
+		int depth = 0;
+		bool inString = false;
+		for (size_t i = 0; i < line.size(); i++) {
+			const char c = line[i];
+			if (inString) {
+				if (c == '\\') {
+					i++;
+				}
+				else if (c == '"') {
+					inString = false;
+				}
+				continue;
+			}
+			switch (c) {
+			case '"':
+				inString = true;
+				break;
+			case '[':
+			case '{':
+				if (!container) {
+					return false;
+				}
+				depth++;
+				break;
+			case ']':
+			case '}':
+				if (!container || --depth < 0 || (depth == 0 && i + 1 != line.size())) {
+					return false;
+				}
+				break;
+			case ',':
+				if (depth == 0) {
+					return false;
+				}
+				break;
+			}
+		}
+		return depth == 0;
+	}
+}
+
+// Method: Reads the file in the background and parses batches as their lines become available
+simdjson::error_code NdjsonDocument::load(const std::string& path, bool useIoUring) {
+	OverlappedReader reader;
+	simdjson::error_code error = reader.open(path, useIoUring);
+	if (error) {
+		return error;
+	}
+	error = parse_batches(reinterpret_cast<const char*>(reader.data()), reader.size(), [&reader](size_t bytes) {
+		return reader.wait_for(bytes);
+	});
+	const simdjson::error_code readError = reader.error();
+	return readError ? readError : error;
+}
+
+simdjson::error_code NdjsonDocument::parse(std::string_view input) {
+	return parse_batches(input.data(), input.size(), [&input](size_t) { return input.size(); });
+}
+
+bool NdjsonDocument::has_ndjson_extension(const std::string& path) {
+	std::string lower(path);
+	std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+	auto ends_with = [&lower](std::string_view suffix) {
+		return lower.size() >= suffix.size() && lower.compare(lower.size() - suffix.size(), suffix.size(), suffix) == 0;
+	};
+	return ends_with(".ndjson") || ends_with(".jsonl");
+}
+
+// Method: The first line of NDJSON is a complete value with more lines after it. The first line of a pretty-printed
+// document is not a complete value, and a minified document has a single line.
+bool NdjsonDocument::looks_like_ndjson(std::string_view input) {
+	const size_t start = input.find_first_not_of(" \t\r\n");
+	if (start == std::string_view::npos) {
+		return false;
+	}
+	const size_t lineBreak = input.find('\n', start);
+	if (lineBreak == std::string_view::npos || input.find_first_not_of(" \t\r\n", lineBreak) == std::string_view::npos) {
+		return false;
+	}
+	simdjson::dom::parser lineParser;
+	return !lineParser.parse(input.data() + start, lineBreak - start).error();
+}
+
+// Method: Cuts the input into batches of about BATCH_SIZE bytes ending at a line break. While the input is still
+// arriving only complete lines are parsed; a batch waits for more input if it holds no line break yet.
+template<typename WaitFor>
+simdjson::error_code NdjsonDocument::parse_batches(const char* data, size_t length, WaitFor&& wait_for) {
+	size_t parsed = 0;
+	size_t target = std::min(length, BATCH_SIZE);
+	while (parsed < length) {
+		const size_t available = wait_for(target);
+		size_t end = available;
+		if (available < length) {
+			const size_t newline = std::string_view(data + parsed, available - parsed).rfind('\n');
+			if (newline == std::string_view::npos) {
+				if (available < target) {
+					// Reading stopped before the end of the file
+					return simdjson::IO_ERROR;
+				}
+				target = std::min(length, target + BATCH_SIZE);
+				continue;
+			}
+			end = parsed + newline + 1;
+		}
+
+		simdjson::error_code error = add_batch(std::string_view(data + parsed, end - parsed));
+		if (error) {
+			return error;
+		}
+		parsed = end;
+		target = std::min(length, std::max(target, parsed + BATCH_SIZE));
+	}
+	return simdjson::SUCCESS;
+}
+
+// Method: Joins the non-blank lines into a JSON array, parses it with a parser of its own and keeps the records.
+// Each line is first checked to hold a single value, so that the commas joining them are the only ones between
+// records; a line failing that check or the parse is then parsed on its own for its error and line number.
+simdjson::error_code NdjsonDocument::add_batch(std::string_view lines) {
+	const size_t firstLine = linesParsed + 1;
+	auto line_error = [&](simdjson::error_code batchError) {
+		simdjson::dom::parser lineParser;
+		size_t number = firstLine;
+		for (size_t start = 0; start < lines.size(); number++) {
+			const size_t end = std::min(lines.size(), lines.find('\n', start));
+			const std::string_view line = lines.substr(start, end - start);
+			start = end + 1;
+			if (line.find_first_not_of(" \t\r") == std::string_view::npos) {
+				continue;
+			}
+			const simdjson::error_code error = lineParser.parse(line.data(), line.size()).error();
+			if (error) {
+				errorLine = number;
+				return error;
+			}
+		}
+		return batchError;
+	};
+
+	std::string array;
+	array.reserve(lines.size() + 2 + simdjson::SIMDJSON_PADDING);
+	array += '[';
+	size_t start = 0;
+	while (start < lines.size()) {
+		size_t end = lines.find('\n', start);
+		if (end == std::string_view::npos) {
+			end = lines.size();
+		}
+		std::string_view line = lines.substr(start, end - start);
+		while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) {
+			line.remove_suffix(1);
+		}
+		while (!line.empty() && (line.front() == ' ' || line.front() == '\t')) {
+			line.remove_prefix(1);
+		}
+		linesParsed++;
+		if (!line.empty()) {
+			if (!holds_one_value(line)) {
+				return line_error(simdjson::TAPE_ERROR);
+			}
+			if (array.size() > 1) {
+				array += ',';
+			}
+			array.append(line);
+		}
+		start = end + 1;
+	}
+	if (array.size() == 1) {
+		return simdjson::SUCCESS;
+	}
+	array += ']';
+
+	// The string keeps SIMDJSON_PADDING bytes of spare capacity, so the parser reads it in place
+	auto parser = std::make_unique<simdjson::dom::parser>();
+	simdjson::dom::array batch;
+	simdjson::error_code error = parser->parse(array).get(batch);
+	if (error) {
+		return line_error(error);
+	}
+	records.reserve(records.size() + batch.size());
+	for (simdjson::dom::element record : batch) {
+		records.push_back(record);
+	}
+
+	// The stage 1 index is only needed while parsing
+	error = parser->allocate(0, parser->max_depth());
+	if (error) {
+		return error;
+	}
+	parsers.push_back(std::move(parser));
+	return simdjson::SUCCESS;
+}
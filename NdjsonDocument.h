@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "simdjson.h"
+
+// NdjsonDocument class, holds a newline-delimited JSON file (one record per line) as a sequence of records.
+// The input is parsed in batches of complete lines, each rewritten as a JSON array and parsed by its own parser,
+// so records stay valid while later batches are parsed and a batch can be parsed as soon as its bytes are read.
+// A line must hold exactly one value; a line that does not fails the load with its own error and line number.
+class NdjsonDocument
+{
+public:
+    // Approximate number of input bytes parsed at once
+    static constexpr size_t BATCH_SIZE = 16 * 1024 * 1024;
+
+    // Reads and parses 'path' through an OverlappedReader, parsing each batch while the following ones are read
+    simdjson::error_code load(const std::string& path, bool useIoUring = true);
+
+    // Parses an input that is already in memory
+    simdjson::error_code parse(std::string_view input);
+
+    // Line number, from 1, of the line whose error load() or parse() returned; 0 if the error is not tied to a line
+    size_t error_line() const { return errorLine; }
+
+    // Records, in file order
+    size_t size() const { return records.size(); }
+    simdjson::dom::element record(size_t index) const { return records[index]; }
+
+    // Whether a file name has an NDJSON extension (.ndjson or .jsonl)
+    static bool has_ndjson_extension(const std::string& path);
+
+    // Whether an input in memory holds several values on separate lines, judging by its first line only
+    static bool looks_like_ndjson(std::string_view input);
+
+private:
+    std::vector<std::unique_ptr<simdjson::dom::parser>> parsers;
+    std::vector<simdjson::dom::element> records;
+    size_t linesParsed = 0;
+    size_t errorLine = 0;
+
+    // Parses the complete lines of 'data' batch by batch; 'wait_for' returns how many leading bytes are available
+    template<typename WaitFor>
+    simdjson::error_code parse_batches(const char* data, size_t length, WaitFor&& wait_for);
+    simdjson::error_code add_batch(std::string_view lines);
+};
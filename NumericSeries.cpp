@@ -0,0 +1,200 @@
+#include "NumericSeries.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+namespace {
+
+	constexpr double NO_VALUE = std::numeric_limits<double>::quiet_NaN();
+
+	// fmin and fmax ignore NaN, so ranges without values stay NaN and others skip them
+	inline void widen(NumericSeries::Span& span, double min, double max) {
+		span.min = std::fmin(span.min, min);
+		span.max = std::fmax(span.max, max);
+	}
+}
+
+bool NumericSeries::split_path(std::string_view path, std::string& arrayPointer, std::string& fieldPointer) {
+	if (path.empty() || path[0] != '/') {
+		return false;
+	}
+	for (size_t position = 0; position < path.size(); ) {
+		size_t next = path.find('/', position + 1);
+		if (next == std::string_view::npos) {
+			next = path.size();
+		}
+		if (path.substr(position + 1, next - position - 1) == "*") {
+			arrayPointer = std::string(path.substr(0, position));
+			fieldPointer = std::string(path.substr(next));
+			return true;
+		}
+		position = next;
+	}
+	return false;
+}
+
+bool NumericSeries::store(simdjson::dom::element element, std::string_view fieldPointer, size_t index) {
+	simdjson::dom::element field;
+	if (element.at_pointer(fieldPointer).get(field)) {
+		return false;
+	}
+	switch (field.type()) {
+	case simdjson::dom::element_type::INT64:
+		values[index] = double(int64_t(field));
+		return true;
+	case simdjson::dom::element_type::UINT64:
+		values[index] = double(uint64_t(field));
+		return true;
+	case simdjson::dom::element_type::DOUBLE:
+		values[index] = double(field);
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Method: Arrays can only be walked in order, so the start of every chunk is found in a first walk, which skips
+// over the elements without reading them
+simdjson::error_code NumericSeries::extract(simdjson::dom::element value, std::string_view fieldPointer, unsigned threads, const std::atomic<bool>* cancelled) {
+	const auto start = std::chrono::steady_clock::now();
+	simdjson::dom::array array;
+	if (value.get(array)) {
+		return simdjson::INCORRECT_TYPE;
+	}
+	std::vector<simdjson::dom::array::iterator> starts;
+	size_t count = 0;
+	for (auto it = array.begin(); it != array.end(); ++it) {
+		if (count % CHUNK_SIZE == 0) {
+			starts.push_back(it);
+		}
+		count++;
+	}
+	const simdjson::dom::array::iterator end = array.end();
+	const simdjson::error_code error = run(count, starts.size(), threads, cancelled, [&](size_t chunk) {
+		size_t missed = 0;
+		size_t index = chunk * CHUNK_SIZE;
+		const size_t chunkEnd = std::min(count, index + CHUNK_SIZE);
+		for (auto it = starts[chunk]; it != end && index < chunkEnd; ++it, ++index) {
+			missed += store(*it, fieldPointer, index) ? 0 : 1;
+		}
+		return missed;
+	});
+	elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return error;
+}
+
+simdjson::error_code NumericSeries::extract(const NdjsonDocument& records, std::string_view fieldPointer, unsigned threads, const std::atomic<bool>* cancelled) {
+	const auto start = std::chrono::steady_clock::now();
+	const size_t count = records.size();
+	const simdjson::error_code error = run(count, (count + CHUNK_SIZE - 1) / CHUNK_SIZE, threads, cancelled, [&](size_t chunk) {
+		size_t missed = 0;
+		for (size_t index = chunk * CHUNK_SIZE; index < std::min(count, (chunk + 1) * CHUNK_SIZE); index++) {
+			missed += store(records.record(index), fieldPointer, index) ? 0 : 1;
+		}
+		return missed;
+	});
+	elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return error;
+}
+
+// Method: Each thread also fills the first level of the pyramid for its chunks, which CHUNK_SIZE aligns on blocks;
+// the levels above are a fraction of its size and built after
+template <typename ExtractChunk>
+simdjson::error_code NumericSeries::run(size_t count, size_t chunks, unsigned threads, const std::atomic<bool>* cancelled, ExtractChunk&& extract_chunk) {
+	values.assign(count, NO_VALUE);
+	levels.assign(1, std::vector<Span>((count + BASE_BLOCK - 1) / BASE_BLOCK, Span{ NO_VALUE, NO_VALUE }));
+	missingCount = 0;
+
+	std::atomic<size_t> nextChunk{ 0 };
+	std::atomic<size_t> missed{ 0 };
+	std::atomic<bool> stopped{ false };
+	auto work = [&]() {
+		std::vector<Span>& base = levels[0];
+		for (size_t chunk = nextChunk++; chunk < chunks; chunk = nextChunk++) {
+			if (cancelled != nullptr && cancelled->load(std::memory_order_relaxed)) {
+				stopped = true;
+				return;
+			}
+			missed += extract_chunk(chunk);
+			const size_t blockEnd = std::min(base.size(), (chunk + 1) * CHUNK_SIZE / BASE_BLOCK);
+			for (size_t block = chunk * CHUNK_SIZE / BASE_BLOCK; block < blockEnd; block++) {
+				for (size_t i = block * BASE_BLOCK; i < std::min(count, (block + 1) * BASE_BLOCK); i++) {
+					widen(base[block], values[i], values[i]);
+				}
+			}
+		}
+	};
+	threads = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+	std::vector<std::thread> workers;
+	for (size_t i = 1; i < std::min<size_t>(threads, chunks); i++) {
+		workers.emplace_back(work);
+	}
+	work();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	if (stopped) {
+		values.clear();
+		levels.clear();
+		return simdjson::SUCCESS;
+	}
+	missingCount = missed;
+
+	while (levels.back().size() > 1) {
+		const std::vector<Span>& below = levels.back();
+		std::vector<Span> level((below.size() + FANOUT - 1) / FANOUT, Span{ NO_VALUE, NO_VALUE });
+		for (size_t i = 0; i < below.size(); i++) {
+			widen(level[i / FANOUT], below[i].min, below[i].max);
+		}
+		levels.push_back(std::move(level));
+	}
+	return simdjson::SUCCESS;
+}
+
+// Method: Values outside whole blocks are read one by one; the blocks are then covered from the edges inwards,
+// moving up a level once both ends are aligned on the blocks above
+NumericSeries::Span NumericSeries::range(size_t first, size_t last) const {
+	Span span{ NO_VALUE, NO_VALUE };
+	last = std::min(last, values.size());
+	while (first < last && first % BASE_BLOCK != 0) {
+		widen(span, values[first], values[first]);
+		first++;
+	}
+	while (first < last && last % BASE_BLOCK != 0) {
+		last--;
+		widen(span, values[last], values[last]);
+	}
+	size_t a = first / BASE_BLOCK;
+	size_t b = last / BASE_BLOCK;
+	for (size_t level = 0; a < b && level < levels.size(); level++) {
+		const std::vector<Span>& spans = levels[level];
+		if (level + 1 == levels.size()) {
+			for (; a < b; a++) {
+				widen(span, spans[a].min, spans[a].max);
+			}
+			break;
+		}
+		while (a < b && a % FANOUT != 0) {
+			widen(span, spans[a].min, spans[a].max);
+			a++;
+		}
+		while (a < b && b % FANOUT != 0) {
+			b--;
+			widen(span, spans[b].min, spans[b].max);
+		}
+		a /= FANOUT;
+		b /= FANOUT;
+	}
+	return span;
+}
+
+void NumericSeries::downsample(size_t first, size_t last, size_t columns, std::vector<Span>& spans) const {
+	spans.resize(columns);
+	last = std::max(first, std::min(last, values.size()));
+	const size_t length = last - first;
+	for (size_t column = 0; column < columns; column++) {
+		spans[column] = range(first + length * column / columns, first + length * (column + 1) / columns);
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "simdjson.h"
+#include "NdjsonDocument.h"
+
+// NumericSeries class, the values of a numeric field across the elements of an array or the records of an NDJSON
+// document, for plotting. Values are extracted on several threads, each taking chunks of CHUNK_SIZE elements, and
+// kept as doubles (NaN where the field is missing or not a number). A min/max pyramid over them (blocks of
+// BASE_BLOCK values, then FANOUT blocks at a time) answers the extremes of any range by visiting a few blocks per
+// level, so a chart of any width is drawn from its columns' extremes without touching every value. Min/max keeps the
+// spikes that averaging or point-picking (LTTB) downsampling may drop, which is what latency plots are read for.
+class NumericSeries
+{
+public:
+    // Values per block of the first level of the pyramid, and blocks of a level per block of the next
+    static constexpr size_t BASE_BLOCK = 16;
+    static constexpr size_t FANOUT = 4;
+
+    // Elements per chunk of the parallel extraction; a multiple of BASE_BLOCK
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    // Extremes of a range; both NaN if it has no value
+    struct Span {
+        double min;
+        double max;
+    };
+
+    // Splits a path such as "/events/*/latency" at its "*" token, into the pointer of the array and the pointer of
+    // the field in each element. False if there is no "*" token.
+    static bool split_path(std::string_view path, std::string& arrayPointer, std::string& fieldPointer);
+
+    // Extracts the field at 'fieldPointer' of each element, on 'threads' threads (0 for one per core). Returns
+    // INCORRECT_TYPE if 'value' is not an array; leaves the series empty if 'cancelled' is set meanwhile.
+    simdjson::error_code extract(simdjson::dom::element value, std::string_view fieldPointer, unsigned threads = 0, const std::atomic<bool>* cancelled = nullptr);
+    simdjson::error_code extract(const NdjsonDocument& records, std::string_view fieldPointer, unsigned threads = 0, const std::atomic<bool>* cancelled = nullptr);
+
+    size_t size() const { return values.size(); }
+    double value(size_t index) const { return values[index]; }
+
+    // Elements without a numeric field
+    size_t missing() const { return missingCount; }
+
+    // Extremes of [first, last)
+    Span range(size_t first, size_t last) const;
+
+    // Extremes of [first, last) split into 'columns' consecutive ranges of (nearly) equal length
+    void downsample(size_t first, size_t last, size_t columns, std::vector<Span>& spans) const;
+
+    // Duration of the last extraction, with the pyramid, in seconds
+    double seconds() const { return elapsed; }
+
+private:
+    std::vector<double> values;
+    std::vector<std::vector<Span>> levels;
+    size_t missingCount = 0;
+    double elapsed = 0;
+
+    // Runs 'extract_chunk' for each chunk on 'threads' threads and builds the pyramid
+    template <typename ExtractChunk>
+    simdjson::error_code run(size_t count, size_t chunks, unsigned threads, const std::atomic<bool>* cancelled, ExtractChunk&& extract_chunk);
+
+    // Stores the field of an element at 'index'; false if it is missing
+    bool store(simdjson::dom::element element, std::string_view fieldPointer, size_t index);
+};
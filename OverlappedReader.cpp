@@ -0,0 +1,430 @@
+#include "OverlappedReader.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+	// Minimal io_uring instance driven through the raw system calls, holding the mapped submission and completion
+	// rings. Only one thread uses it, so the ring indices it owns are plain loads and the shared ones use atomics.
+	class Ring {
+	public:
+		~Ring() {
+			if (sqes != nullptr) {
+				munmap(sqes, sqesSize);
+			}
+			if (cqRing != nullptr && cqRing != sqRing) {
+				munmap(cqRing, cqRingSize);
+			}
+			if (sqRing != nullptr) {
+				munmap(sqRing, sqRingSize);
+			}
+			if (fd >= 0) {
+				close(fd);
+			}
+		}
+
+		bool init(unsigned entries) {
+			io_uring_params params;
+			std::memset(&params, 0, sizeof(params));
+			fd = int(syscall(__NR_io_uring_setup, entries, &params));
+			if (fd < 0) {
+				return false;
+			}
+
+			// Map the rings; newer kernels share one mapping for both
+			sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+			cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+			const bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+			if (singleMapping) {
+				sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+			}
+			sqRing = map(sqRingSize, IORING_OFF_SQ_RING);
+			if (sqRing == nullptr) {
+				return false;
+			}
+			cqRing = singleMapping ? sqRing : map(cqRingSize, IORING_OFF_CQ_RING);
+			if (cqRing == nullptr) {
+				return false;
+			}
+			sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+			sqes = static_cast<io_uring_sqe*>(map(sqesSize, IORING_OFF_SQES));
+			if (sqes == nullptr) {
+				return false;
+			}
+
+			char* sq = static_cast<char*>(sqRing);
+			sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+			sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+			sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+			char* cq = static_cast<char*>(cqRing);
+			cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+			cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+			cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+			cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+			return true;
+		}
+
+		// Queues a read of 'bytes' bytes at 'offset' of 'file' into 'target'
+		void queue_read(int file, void* target, unsigned bytes, uint64_t offset, uint64_t userData) {
+			const unsigned tail = *sqTail;
+			const unsigned index = tail & sqMask;
+			io_uring_sqe& sqe = sqes[index];
+			std::memset(&sqe, 0, sizeof(sqe));
+			sqe.opcode = IORING_OP_READ;
+			sqe.fd = file;
+			sqe.addr = uint64_t(reinterpret_cast<uintptr_t>(target));
+			sqe.len = bytes;
+			sqe.off = offset;
+			sqe.user_data = userData;
+			sqArray[index] = index;
+			__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+			queued++;
+		}
+
+		// Queues the cancellation of the request with user data 'target'
+		void queue_cancel(uint64_t target, uint64_t userData) {
+			const unsigned tail = *sqTail;
+			const unsigned index = tail & sqMask;
+			io_uring_sqe& sqe = sqes[index];
+			std::memset(&sqe, 0, sizeof(sqe));
+			sqe.opcode = IORING_OP_ASYNC_CANCEL;
+			sqe.fd = -1;
+			sqe.addr = target;
+			sqe.user_data = userData;
+			sqArray[index] = index;
+			__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+			queued++;
+		}
+
+		// Takes back the entries queued but not yet submitted, newest first, passing the user data of each to
+		// 'dropped'. The kernel only reads the tail when entering, so none of them has been seen.
+		template <typename Dropped>
+		void unqueue(Dropped dropped) {
+			for (; queued > 0; queued--) {
+				const unsigned tail = *sqTail - 1;
+				dropped(sqes[tail & sqMask].user_data);
+				__atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+			}
+		}
+
+		// Submits the queued entries and waits for at least one completion. On failure errno tells why; entries
+		// not submitted stay queued.
+		bool submit_and_wait() {
+			const long submitted = syscall(__NR_io_uring_enter, fd, queued, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+			if (submitted < 0) {
+				return errno == EINTR;
+			}
+			queued -= std::min<unsigned>(queued, unsigned(submitted));
+			return true;
+		}
+
+		// Takes the next completion, if any
+		bool pop(uint64_t& userData, int& result) {
+			const unsigned head = *cqHead;
+			if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+				return false;
+			}
+			const io_uring_cqe& cqe = cqes[head & cqMask];
+			userData = cqe.user_data;
+			result = cqe.res;
+			__atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+			return true;
+		}
+
+	private:
+		int fd = -1;
+		void* sqRing = nullptr;
+		void* cqRing = nullptr;
+		io_uring_sqe* sqes = nullptr;
+		size_t sqRingSize = 0;
+		size_t cqRingSize = 0;
+		size_t sqesSize = 0;
+		unsigned* sqTail = nullptr;
+		unsigned* sqArray = nullptr;
+		unsigned sqMask = 0;
+		unsigned* cqHead = nullptr;
+		unsigned* cqTail = nullptr;
+		unsigned cqMask = 0;
+		io_uring_cqe* cqes = nullptr;
+		unsigned queued = 0;
+
+		void* map(size_t bytes, off_t offset) {
+			void* address = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+			return address == MAP_FAILED ? nullptr : address;
+		}
+	};
+#endif
+}
+
+OverlappedReader::~OverlappedReader() {
+	cancelled = true;
+	if (reader.joinable()) {
+		reader.join();
+	}
+}
+
+// Method: Allocates the padded buffer and starts the reading thread
+simdjson::error_code OverlappedReader::open(const std::string& path, bool useIoUring) {
+	std::error_code ec;
+	const uintmax_t fileSize = std::filesystem::file_size(path, ec);
+	if (ec) {
+		return simdjson::IO_ERROR;
+	}
+	length = size_t(fileSize);
+	buffer.reset(new (std::nothrow) uint8_t[length + simdjson::SIMDJSON_PADDING]);
+	if (!buffer) {
+		return simdjson::MEMALLOC;
+	}
+	std::memset(buffer.get() + length, 0, simdjson::SIMDJSON_PADDING);
+
+#ifdef __linux__
+	if (useIoUring) {
+		const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return simdjson::IO_ERROR;
+		}
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+		reader = std::thread([this, fd]() {
+			simdjson::error_code error = simdjson::SUCCESS;
+			size_t offset = 0;
+			if (read_io_uring(fd, offset, error)) {
+				::close(fd);
+			}
+			else {
+				// io_uring could not be set up, does not support reads here or stopped accepting them: read the
+				// rest with blocking reads
+				std::FILE* fp = fdopen(fd, "rb");
+				if (fp == nullptr) {
+					::close(fd);
+					error = simdjson::IO_ERROR;
+				}
+				else {
+					error = read_blocking(fp, offset);
+					std::fclose(fp);
+				}
+			}
+			finish(error);
+		});
+		return simdjson::SUCCESS;
+	}
+#else
+	(void)useIoUring;
+#endif
+
+	std::FILE* fp = std::fopen(path.c_str(), "rb");
+	if (fp == nullptr) {
+		return simdjson::IO_ERROR;
+	}
+	reader = std::thread([this, fp]() {
+		simdjson::error_code error = read_blocking(fp);
+		std::fclose(fp);
+		finish(error);
+	});
+	return simdjson::SUCCESS;
+}
+
+// Method: Waits until the requested prefix is available or the reading thread has stopped
+size_t OverlappedReader::wait_for(size_t bytes) {
+	bytes = std::min(bytes, length);
+	std::unique_lock<std::mutex> lock(mutex);
+	progress.wait(lock, [&]() { return available >= bytes || finished; });
+	return available;
+}
+
+simdjson::error_code OverlappedReader::error() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return failure;
+}
+
+// Method: Makes the first 'bytes' bytes visible to waiting readers
+void OverlappedReader::publish(size_t bytes) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		available = bytes;
+	}
+	progress.notify_all();
+}
+
+void OverlappedReader::finish(simdjson::error_code error) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		finished = true;
+		failure = error;
+	}
+	progress.notify_all();
+}
+
+// Method: Reads the file chunk by chunk with blocking reads
+simdjson::error_code OverlappedReader::read_blocking(std::FILE* fp, size_t offset) {
+	if (offset != 0 && std::fseek(fp, long(offset), SEEK_SET) != 0) {
+		return simdjson::IO_ERROR;
+	}
+	while (offset < length && !cancelled) {
+		const size_t bytesRead = std::fread(buffer.get() + offset, 1, std::min(CHUNK_SIZE, length - offset), fp);
+		if (bytesRead == 0) {
+			return simdjson::IO_ERROR;
+		}
+		offset += bytesRead;
+		publish(offset);
+	}
+	return simdjson::SUCCESS;
+}
+
+#ifdef __linux__
+// Method: Reads the file with up to QUEUE_DEPTH chunk reads in flight. Chunks complete in any order; the readable
+// prefix advances over completed chunks. Returns false if the rest is to be read with blocking reads from 'offset':
+// 0 if io_uring is not usable, or the readable prefix if submitting failed, once the reads in flight are cancelled
+// and reaped so that the kernel no longer writes to the buffer.
+bool OverlappedReader::read_io_uring(int fd, size_t& offset, simdjson::error_code& error) {
+	static constexpr uint64_t CANCEL = UINT64_MAX;
+	Ring ring;
+	if (!ring.init(QUEUE_DEPTH)) {
+		return false;
+	}
+	ioUring = true;
+
+	const size_t chunkCount = (length + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	std::vector<size_t> chunkRead(chunkCount, 0);
+	std::vector<bool> pending(chunkCount, false);
+	size_t nextChunk = 0;
+	size_t completeChunks = 0;
+	unsigned inFlight = 0;
+	bool stopped = false;
+	bool unsupported = false;
+
+	auto chunk_end = [&](size_t chunk) {
+		return std::min(length, (chunk + 1) * CHUNK_SIZE);
+	};
+	auto queue_chunk = [&](size_t chunk) {
+		const size_t offset = chunk * CHUNK_SIZE + chunkRead[chunk];
+		ring.queue_read(fd, buffer.get() + offset, unsigned(chunk_end(chunk) - offset), offset, chunk);
+		pending[chunk] = true;
+		inFlight++;
+	};
+	auto drain = [&]() {
+		ring.unqueue([&](uint64_t chunk) {
+			pending[size_t(chunk)] = false;
+			inFlight--;
+		});
+		unsigned cancels = 0;
+		for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+			if (pending[chunk]) {
+				ring.queue_cancel(chunk, CANCEL);
+				cancels++;
+			}
+		}
+		while (inFlight + cancels > 0) {
+			if (!ring.submit_and_wait() && errno != EAGAIN && errno != EBUSY) {
+				return false;
+			}
+			uint64_t userData;
+			int result;
+			while (ring.pop(userData, result)) {
+				if (userData == CANCEL) {
+					cancels--;
+				}
+				else {
+					pending[size_t(userData)] = false;
+					inFlight--;
+				}
+			}
+		}
+		return true;
+	};
+
+	while (completeChunks < chunkCount) {
+		while (!stopped && !cancelled && inFlight < QUEUE_DEPTH && nextChunk < chunkCount) {
+			queue_chunk(nextChunk++);
+		}
+		if (inFlight == 0) {
+			break;
+		}
+		if (!ring.submit_and_wait()) {
+			if (!drain()) {
+				// Reads may still land in the buffer, which is given up rather than released under them
+				buffer.release();
+				error = simdjson::IO_ERROR;
+				return true;
+			}
+			offset = completeChunks * CHUNK_SIZE;
+			return false;
+		}
+
+		uint64_t chunk;
+		int result;
+		while (ring.pop(chunk, result)) {
+			pending[size_t(chunk)] = false;
+			inFlight--;
+			if (result <= 0) {
+				// Kernels without IORING_OP_READ reject the first reads; any other failure stops reading
+				unsupported = unsupported || (completeChunks == 0 && (result == -EINVAL || result == -EOPNOTSUPP));
+				stopped = true;
+				continue;
+			}
+			chunkRead[chunk] += size_t(result);
+			if (chunk * CHUNK_SIZE + chunkRead[chunk] < chunk_end(chunk)) {
+				if (!stopped) {
+					queue_chunk(size_t(chunk));
+				}
+				continue;
+			}
+			const size_t before = completeChunks;
+			while (completeChunks < chunkCount && completeChunks * CHUNK_SIZE + chunkRead[completeChunks] == chunk_end(completeChunks)) {
+				completeChunks++;
+			}
+			if (completeChunks != before) {
+				publish(completeChunks == chunkCount ? length : completeChunks * CHUNK_SIZE);
+			}
+		}
+	}
+
+	if (unsupported) {
+		ioUring = false;
+		return false;
+	}
+	if (stopped) {
+		error = simdjson::IO_ERROR;
+	}
+	return true;
+}
+#endif
+
+// Method: Reads and parses a single document, overlapping the parser's allocations with the reads
+simdjson::simdjson_result<simdjson::dom::element> OverlappedReader::load(simdjson::dom::parser& parser, const std::string& path, bool useIoUring) {
+	OverlappedReader reader;
+	simdjson::error_code error = reader.open(path, useIoUring);
+	if (error) {
+		return error;
+	}
+	if (reader.size() > parser.capacity()) {
+		error = parser.allocate(reader.size(), parser.max_depth());
+		if (error) {
+			return error;
+		}
+	}
+	if (reader.size() > parser.doc.capacity()) {
+		error = parser.doc.allocate(reader.size());
+		if (error) {
+			return error;
+		}
+	}
+
+	if (reader.wait_for(reader.size()) != reader.size()) {
+		error = reader.error();
+		return error ? error : simdjson::IO_ERROR;
+	}
+	return parser.parse(reader.data(), reader.size(), false);
+}
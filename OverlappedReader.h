@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "simdjson.h"
+
+// OverlappedReader class, reads a file into a padded buffer in the background so that parsing can start on the
+// leading bytes while later chunks are still being read. On Linux up to QUEUE_DEPTH chunk reads are kept in flight
+// through io_uring; elsewhere, or if io_uring is unavailable, a thread reads the chunks with blocking reads.
+class OverlappedReader
+{
+public:
+    static constexpr size_t CHUNK_SIZE = 4 * 1024 * 1024;
+    static constexpr unsigned QUEUE_DEPTH = 8;
+
+    OverlappedReader() = default;
+    ~OverlappedReader();
+
+    OverlappedReader(const OverlappedReader&) = delete;
+    OverlappedReader& operator=(const OverlappedReader&) = delete;
+
+    // Allocates the buffer and starts reading 'path'. Returns an error if the file cannot be opened or sized.
+    simdjson::error_code open(const std::string& path, bool useIoUring = true);
+
+    // File length and the buffer, which has SIMDJSON_PADDING zero bytes after the file contents. Only the bytes
+    // below a count returned by wait_for() may be read.
+    size_t size() const { return length; }
+    const uint8_t* data() const { return buffer.get(); }
+
+    // Blocks until the first 'bytes' bytes (at most size()) have been read or reading stopped, and returns the
+    // number of leading bytes available
+    size_t wait_for(size_t bytes);
+
+    // Error that stopped reading, if any
+    simdjson::error_code error() const;
+
+    // Whether the reads went through io_uring
+    bool used_io_uring() const { return ioUring.load(); }
+
+    // Counterpart of simdjson::dom::parser::load reading through an OverlappedReader. The parser's buffers are
+    // allocated while the reads are in flight; stage 1 of a single document starts once the whole input is there.
+    static simdjson::simdjson_result<simdjson::dom::element> load(simdjson::dom::parser& parser, const std::string& path, bool useIoUring = true);
+
+private:
+    std::unique_ptr<uint8_t[]> buffer;
+    size_t length = 0;
+    std::atomic<bool> ioUring{ false };
+    std::atomic<bool> cancelled{ false };
+    std::thread reader;
+
+    // Progress shared with the reading thread
+    mutable std::mutex mutex;
+    std::condition_variable progress;
+    size_t available = 0;
+    bool finished = false;
+    simdjson::error_code failure = simdjson::SUCCESS;
+
+    void publish(size_t bytes);
+    void finish(simdjson::error_code error);
+    simdjson::error_code read_blocking(std::FILE* fp, size_t offset = 0);
+#ifdef __linux__
+    bool read_io_uring(int fd, size_t& offset, simdjson::error_code& error);
+#endif
+};
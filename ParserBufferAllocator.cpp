@@ -0,0 +1,56 @@
+#include "ParserBufferAllocator.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+ParserBufferAllocator::ParserBufferAllocator() {
+	allocator.allocate = [](size_t bytes, void* context) {
+		return static_cast<ParserBufferAllocator*>(context)->allocate(bytes);
+	};
+	allocator.deallocate = [](void* ptr, size_t bytes, void* context) {
+		static_cast<ParserBufferAllocator*>(context)->deallocate(ptr, bytes);
+	};
+	allocator.context = this;
+}
+
+// Method: Reads the file into a padded buffer from this allocator and parses it
+simdjson::simdjson_result<simdjson::dom::element> ParserBufferAllocator::load(simdjson::dom::parser& parser, const std::string& path) {
+	std::FILE* fp = std::fopen(path.c_str(), "rb");
+	if (fp == nullptr) {
+		return simdjson::IO_ERROR;
+	}
+	std::error_code ec;
+	const uintmax_t fileSize = std::filesystem::file_size(path, ec);
+	if (ec) {
+		std::fclose(fp);
+		return simdjson::IO_ERROR;
+	}
+	const size_t length = size_t(fileSize);
+	const size_t capacity = length + simdjson::SIMDJSON_PADDING;
+	uint8_t* input = static_cast<uint8_t*>(allocate(capacity));
+	if (input == nullptr) {
+		std::fclose(fp);
+		return simdjson::MEMALLOC;
+	}
+	const size_t bytesRead = std::fread(input, 1, length, fp);
+	std::fclose(fp);
+	if (bytesRead != length) {
+		deallocate(input, capacity);
+		return simdjson::IO_ERROR;
+	}
+	std::memset(input + length, 0, simdjson::SIMDJSON_PADDING);
+
+	simdjson::dom::element root;
+	simdjson::error_code error = parser.parse(input, length, false).get(root);
+	deallocate(input, capacity);
+	if (error) {
+		return error;
+	}
+
+	// The stage 1 index takes four bytes per input byte and is rebuilt by the next parse
+	error = parser.allocate(0, parser.max_depth());
+	if (error) {
+		return error;
+	}
+	return root;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include "simdjson.h"
+
+// ParserBufferAllocator class, base for allocators that place the tape and string buffer of simdjson documents in
+// memory managed by the application (see simdjson::dom::buffer_allocator). Subclasses provide allocate() and
+// deallocate(); this class adapts them to simdjson and provides a load() that places the input buffer there too.
+class ParserBufferAllocator
+{
+public:
+    ParserBufferAllocator();
+    virtual ~ParserBufferAllocator() = default;
+
+    ParserBufferAllocator(const ParserBufferAllocator&) = delete;
+    ParserBufferAllocator& operator=(const ParserBufferAllocator&) = delete;
+
+    // Allocator to pass to simdjson::dom::document::set_allocator
+    const simdjson::dom::buffer_allocator* get() const { return &allocator; }
+
+    // Returns at least 'bytes' bytes aligned for uint64_t, or nullptr on failure
+    virtual void* allocate(size_t bytes) = 0;
+
+    // Releases memory returned by allocate()
+    virtual void deallocate(void* ptr, size_t bytes) = 0;
+
+    // Counterpart of simdjson::dom::parser::load: the input is read into a padded buffer from this allocator,
+    // parsed, and released again together with the parser's stage 1 index, which is only needed while parsing.
+    // Set this allocator on 'parser.doc' first so that the tape and string buffer come from it too.
+    simdjson::simdjson_result<simdjson::dom::element> load(simdjson::dom::parser& parser, const std::string& path);
+
+    // Total bytes currently allocated
+    size_t allocated_bytes() const { return allocatedBytes.load(); }
+
+protected:
+    std::atomic<size_t> allocatedBytes{ 0 };
+
+private:
+    simdjson::dom::buffer_allocator allocator;
+};
@@ -0,0 +1,357 @@
+#include "PatchJournal.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include "PointerExtractor.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+	inline bool is_space(char c) {
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+	}
+
+	// Bytes copied at a time when the kernel cannot copy between the files
+	constexpr size_t COPY_BUFFER_SIZE = 4 * 1024 * 1024;
+
+#ifdef __linux__
+	// Output written with copy_file_range for the unchanged ranges, which stays in the kernel (and shares extents
+	// on filesystems that support it); pread and write when it is not supported between the two files
+	class Splicer {
+	public:
+		~Splicer() {
+			if (in >= 0) {
+				::close(in);
+			}
+			if (out >= 0) {
+				::close(out);
+			}
+		}
+
+		bool open(const std::string& source, const std::string& path) {
+			in = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+			struct stat info;
+			if (in < 0 || fstat(in, &info) != 0) {
+				return false;
+			}
+			out = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, info.st_mode & 0777);
+			return out >= 0;
+		}
+
+		bool copy(uint64_t offset, uint64_t length) {
+			loff_t from = loff_t(offset);
+			while (length > 0 && kernel) {
+				const ssize_t copied = copy_file_range(in, &from, out, nullptr, size_t(std::min<uint64_t>(length, uint64_t(1) << 30)), 0);
+				if (copied > 0) {
+					length -= uint64_t(copied);
+				}
+				else if (copied == 0) {
+					return false;
+				}
+				else if (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP) {
+					kernel = false;
+				}
+				else if (errno != EINTR) {
+					return false;
+				}
+			}
+			if (length > 0 && buffer.empty()) {
+				buffer.resize(COPY_BUFFER_SIZE);
+			}
+			while (length > 0) {
+				const ssize_t bytesRead = pread(in, buffer.data(), size_t(std::min<uint64_t>(length, buffer.size())), from);
+				if (bytesRead <= 0) {
+					if (bytesRead < 0 && errno == EINTR) {
+						continue;
+					}
+					return false;
+				}
+				if (!write(std::string_view(buffer.data(), size_t(bytesRead)))) {
+					return false;
+				}
+				from += bytesRead;
+				length -= uint64_t(bytesRead);
+			}
+			return true;
+		}
+
+		bool write(std::string_view text) {
+			while (!text.empty()) {
+				const ssize_t written = ::write(out, text.data(), text.size());
+				if (written < 0) {
+					if (errno == EINTR) {
+						continue;
+					}
+					return false;
+				}
+				text.remove_prefix(size_t(written));
+			}
+			return true;
+		}
+
+		bool close() {
+			const int fd = out;
+			out = -1;
+			return ::close(fd) == 0;
+		}
+
+		bool kernel = true;
+
+	private:
+		int in = -1;
+		int out = -1;
+		std::vector<char> buffer;
+	};
+#else
+	struct FileCloser {
+		void operator()(std::FILE* fp) const { std::fclose(fp); }
+	};
+
+	// Output written through stdio, reading the source forward and seeking over the replaced ranges
+	class Splicer {
+	public:
+		bool open(const std::string& source, const std::string& path) {
+			in.reset(std::fopen(source.c_str(), "rb"));
+			out.reset(std::fopen(path.c_str(), "wb"));
+			buffer.resize(COPY_BUFFER_SIZE);
+			return in && out;
+		}
+
+		bool copy(uint64_t offset, uint64_t length) {
+			if (offset != position) {
+#ifdef _WIN32
+				const bool moved = _fseeki64(in.get(), int64_t(offset), SEEK_SET) == 0;
+#else
+				const bool moved = fseeko(in.get(), off_t(offset), SEEK_SET) == 0;
+#endif
+				if (!moved) {
+					return false;
+				}
+				position = offset;
+			}
+			while (length > 0) {
+				const size_t bytesRead = std::fread(buffer.data(), 1, size_t(std::min<uint64_t>(length, buffer.size())), in.get());
+				if (bytesRead == 0 || !write(std::string_view(buffer.data(), bytesRead))) {
+					return false;
+				}
+				position += bytesRead;
+				length -= bytesRead;
+			}
+			return true;
+		}
+
+		bool write(std::string_view text) {
+			return std::fwrite(text.data(), 1, text.size(), out.get()) == text.size();
+		}
+
+		bool close() {
+			return std::fclose(out.release()) == 0;
+		}
+
+		bool kernel = false;
+
+	private:
+		std::unique_ptr<std::FILE, FileCloser> in;
+		std::unique_ptr<std::FILE, FileCloser> out;
+		uint64_t position = 0;
+		std::vector<char> buffer;
+	};
+#endif
+}
+
+simdjson::error_code PatchJournal::set_source(const std::string& path) {
+	journal.clear();
+	errorMessage.clear();
+	std::error_code ec;
+	sourcePath = path;
+	sourceSize = std::filesystem::file_size(path, ec);
+	if (ec) {
+		errorMessage = "Cannot read " + path;
+		return simdjson::IO_ERROR;
+	}
+	sourceModified = int64_t(std::filesystem::last_write_time(path, ec).time_since_epoch().count());
+	return ec ? simdjson::IO_ERROR : simdjson::SUCCESS;
+}
+
+bool PatchJournal::source_unchanged() const {
+	std::error_code ec;
+	const uint64_t size = std::filesystem::file_size(sourcePath, ec);
+	if (ec || size != sourceSize) {
+		return false;
+	}
+	const auto modified = std::filesystem::last_write_time(sourcePath, ec);
+	return !ec && int64_t(modified.time_since_epoch().count()) == sourceModified;
+}
+
+simdjson::error_code PatchJournal::replace(const std::string& pointer, std::string_view value) {
+	Edit edit;
+	simdjson::error_code error = locate(pointer, value, edit, errorMessage);
+	return error ? error : add(std::move(edit));
+}
+
+// Method: Checks the value by parsing it, and locates the old one by streaming the file up to it
+simdjson::error_code PatchJournal::locate(const std::string& pointer, std::string_view value, Edit& edit, std::string& message) const {
+	while (!value.empty() && is_space(value.front())) {
+		value.remove_prefix(1);
+	}
+	while (!value.empty() && is_space(value.back())) {
+		value.remove_suffix(1);
+	}
+	simdjson::dom::parser parser;
+	simdjson::error_code error = parser.parse(value.data(), value.size(), true).error();
+	if (error) {
+		message = std::string("Invalid value: ") + simdjson::error_message(error);
+		return error;
+	}
+	if (!source_unchanged()) {
+		message = sourcePath + " has changed since it was loaded";
+		return simdjson::IO_ERROR;
+	}
+
+	PointerExtractor extractor;
+	error = extractor.extract(sourcePath, pointer, [](std::string_view) {});
+	if (error) {
+		message = "Cannot find " + pointer + ": " + simdjson::error_message(error);
+		return error;
+	}
+	edit = Edit{ pointer, extractor.target_offset(), extractor.target_offset() + extractor.bytes_extracted(), std::string(value) };
+	return simdjson::SUCCESS;
+}
+
+// Method: Edits are compared by their ranges rather than their pointers, so that indices written differently still
+// match
+simdjson::error_code PatchJournal::add(Edit edit) {
+	errorMessage.clear();
+	for (const Edit& other : journal) {
+		if (other.start <= edit.start && edit.end <= other.end && !(other.start == edit.start && other.end == edit.end)) {
+			errorMessage = edit.pointer + " is inside " + other.pointer + ", which is already replaced";
+			return simdjson::INCORRECT_TYPE;
+		}
+	}
+	journal.erase(std::remove_if(journal.begin(), journal.end(), [&edit](const Edit& other) {
+		return edit.start <= other.start && other.end <= edit.end;
+	}), journal.end());
+	journal.push_back(std::move(edit));
+	return simdjson::SUCCESS;
+}
+
+bool PatchJournal::undo() {
+	if (journal.empty()) {
+		return false;
+	}
+	journal.pop_back();
+	return true;
+}
+
+const PatchJournal::Edit* PatchJournal::find(std::string_view pointer) const {
+	for (const Edit& edit : journal) {
+		if (edit.pointer == pointer) {
+			return &edit;
+		}
+	}
+	return nullptr;
+}
+
+// Method: Writes to a temporary file next to 'path' and renames it, so that saving over the source never leaves it
+// half written
+simdjson::error_code PatchJournal::save(const std::string& path) const {
+	copiedBytes = 0;
+	replacedBytes = 0;
+	kernelCopies = false;
+	if (!source_unchanged()) {
+		return simdjson::IO_ERROR;
+	}
+	const std::string temporaryPath = path + ".tmp";
+	std::error_code ec;
+	simdjson::error_code error = splice(temporaryPath);
+	if (error) {
+		std::filesystem::remove(temporaryPath, ec);
+		return error;
+	}
+	std::filesystem::rename(temporaryPath, path, ec);
+	if (ec) {
+		std::filesystem::remove(temporaryPath, ec);
+		return simdjson::IO_ERROR;
+	}
+	return simdjson::SUCCESS;
+}
+
+simdjson::error_code PatchJournal::splice(const std::string& path) const {
+	std::vector<const Edit*> sorted;
+	for (const Edit& edit : journal) {
+		sorted.push_back(&edit);
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const Edit* a, const Edit* b) { return a->start < b->start; });
+
+	Splicer splicer;
+	if (!splicer.open(sourcePath, path)) {
+		return simdjson::IO_ERROR;
+	}
+	uint64_t position = 0;
+	for (const Edit* edit : sorted) {
+		if (!splicer.copy(position, edit->start - position) || !splicer.write(edit->value)) {
+			return simdjson::IO_ERROR;
+		}
+		copiedBytes += edit->start - position;
+		replacedBytes += edit->value.size();
+		position = edit->end;
+	}
+	if (!splicer.copy(position, sourceSize - position)) {
+		return simdjson::IO_ERROR;
+	}
+	copiedBytes += sourceSize - position;
+	kernelCopies = splicer.kernel;
+	return splicer.close() ? simdjson::SUCCESS : simdjson::IO_ERROR;
+}
+
+simdjson::error_code PatchJournal::export_patch(const std::string& path) const {
+	std::string text = "[\n";
+	for (size_t i = 0; i < journal.size(); i++) {
+		simdjson::internal::mini_formatter format;
+		format.string(journal[i].pointer);
+		const std::string_view pointer = format.str();
+		text += "  {\"op\": \"replace\", \"path\": ";
+		text.append(pointer.data(), pointer.size());
+		text += ", \"value\": " + journal[i].value + (i + 1 < journal.size() ? "},\n" : "}\n");
+	}
+	text += "]\n";
+
+	std::FILE* fp = std::fopen(path.c_str(), "wb");
+	if (fp == nullptr) {
+		return simdjson::IO_ERROR;
+	}
+	const bool written = std::fwrite(text.data(), 1, text.size(), fp) == text.size();
+	return std::fclose(fp) == 0 && written ? simdjson::SUCCESS : simdjson::IO_ERROR;
+}
+
+simdjson::error_code PatchJournal::import_patch(const std::string& path) {
+	simdjson::dom::parser parser;
+	simdjson::dom::array operations;
+	simdjson::error_code error = parser.load(path).get(operations);
+	if (error) {
+		errorMessage = "Cannot read the patch " + path;
+		return error;
+	}
+	size_t index = 0;
+	for (simdjson::dom::element operation : operations) {
+		std::string_view op, pointer;
+		simdjson::dom::element value;
+		if (operation["op"].get(op) || operation["path"].get(pointer) || op != "replace" || operation["value"].get(value)) {
+			errorMessage = "Operation " + std::to_string(index) + " is not a \"replace\" with a path and a value";
+			return simdjson::INCORRECT_TYPE;
+		}
+		error = replace(std::string(pointer), simdjson::minify(value));
+		if (error) {
+			return error;
+		}
+		index++;
+	}
+	return simdjson::SUCCESS;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "simdjson.h"
+
+// PatchJournal class, records edits of a JSON file as a list of JSON Patch "replace" operations, each with the byte
+// range of the value it replaces in the file, so that a few values of a large file can be changed without
+// serializing the document again. Values are located by streaming the file (see PointerExtractor). Saving copies the
+// file with the edited ranges replaced by the new text: the bytes in between are copied by the kernel where it can
+// (copy_file_range on Linux) and never parsed, so the rest of the file keeps its formatting. The journal can also be
+// written as an RFC 6902 patch, and read back from one.
+class PatchJournal
+{
+public:
+    // An edit: the value at 'pointer', spanning [start, end) of the source file, is replaced by 'value' (JSON text)
+    struct Edit {
+        std::string pointer;
+        uint64_t start;
+        uint64_t end;
+        std::string value;
+    };
+
+    // Sets the file the edits apply to and clears the journal. Returns IO_ERROR if it cannot be read.
+    simdjson::error_code set_source(const std::string& path);
+    const std::string& source() const { return sourcePath; }
+
+    // Replaces the value at 'pointer' by 'value', which must be valid JSON. An edit of the same value is replaced,
+    // and edits inside the value are dropped. Returns the error of the pointer (see PointerExtractor) or of parsing
+    // 'value', INCORRECT_TYPE if the value is inside one already replaced, and IO_ERROR if the source has changed
+    // since set_source().
+    simdjson::error_code replace(const std::string& pointer, std::string_view value);
+
+    // The two steps of replace(): locating the value, which streams the file and may run on another thread while
+    // the journal is read, and adding the edit to the journal
+    simdjson::error_code locate(const std::string& pointer, std::string_view value, Edit& edit, std::string& message) const;
+    simdjson::error_code add(Edit edit);
+
+    // Removes the last edit, if any
+    bool undo();
+
+    // Edits in the order they were made
+    const std::vector<Edit>& edits() const { return journal; }
+    bool empty() const { return journal.empty(); }
+
+    // The edit of the value at 'pointer', or nullptr
+    const Edit* find(std::string_view pointer) const;
+
+    // Writes the source with the edits applied to 'path', which may be the source itself: the output is written
+    // next to it and renamed over it once complete. Returns IO_ERROR if the source has changed since set_source()
+    // or the output cannot be written, in which case 'path' is left as it was.
+    simdjson::error_code save(const std::string& path) const;
+
+    // Writes the edits as an RFC 6902 patch, and applies the "replace" operations of one (other operations give
+    // INCORRECT_TYPE, and those before it stay applied)
+    simdjson::error_code export_patch(const std::string& path) const;
+    simdjson::error_code import_patch(const std::string& path);
+
+    // Statistics of the last save: bytes copied from the source unchanged, bytes of edited values written, and
+    // whether the copies were done by the kernel
+    uint64_t bytes_copied() const { return copiedBytes; }
+    uint64_t bytes_replaced() const { return replacedBytes; }
+    bool kernel_copies() const { return kernelCopies; }
+
+    // Description of the last error
+    const std::string& message() const { return errorMessage; }
+
+private:
+    std::string sourcePath;
+    uint64_t sourceSize = 0;
+    int64_t sourceModified = 0;
+    std::vector<Edit> journal;
+    std::string errorMessage;
+
+    mutable uint64_t copiedBytes = 0;
+    mutable uint64_t replacedBytes = 0;
+    mutable bool kernelCopies = false;
+
+    // Whether the source still has the size and modification time it had when set
+    bool source_unchanged() const;
+
+    // Writes the source with the edits applied to 'path', which is a new file
+    simdjson::error_code splice(const std::string& path) const;
+};
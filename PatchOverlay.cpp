@@ -0,0 +1,792 @@
+#include "PatchOverlay.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+	using simdjson::dom::element_type;
+
+	bool is_number(element_type type) {
+		return type == element_type::INT64 || type == element_type::UINT64 || type == element_type::DOUBLE;
+	}
+
+	// Equality of RFC 6902 "test": numbers by value, objects whatever the order of their members
+	bool equal_elements(simdjson::dom::element a, simdjson::dom::element b) {
+		const element_type typeA = a.type();
+		const element_type typeB = b.type();
+		if (is_number(typeA) && is_number(typeB)) {
+			if (typeA == element_type::DOUBLE || typeB == element_type::DOUBLE) {
+				return double(a) == double(b);
+			}
+			if (typeA != typeB) {
+				// An INT64 is negative or a UINT64 past INT64_MAX, so they differ
+				return false;
+			}
+			return typeA == element_type::INT64 ? int64_t(a) == int64_t(b) : uint64_t(a) == uint64_t(b);
+		}
+		if (typeA != typeB) {
+			return false;
+		}
+		switch (typeA) {
+		case element_type::STRING:
+			return std::string_view(a) == std::string_view(b);
+		case element_type::BOOL:
+			return bool(a) == bool(b);
+		case element_type::NULL_VALUE:
+			return true;
+		case element_type::ARRAY: {
+			simdjson::dom::array arrayB(b);
+			auto it = arrayB.begin();
+			for (simdjson::dom::element value : simdjson::dom::array(a)) {
+				if (it == arrayB.end() || !equal_elements(value, *it)) {
+					return false;
+				}
+				++it;
+			}
+			return it == arrayB.end();
+		}
+		case element_type::OBJECT: {
+			size_t countA = 0, countB = 0;
+			for (auto [key, value] : simdjson::dom::object(a)) {
+				simdjson::dom::element other;
+				if (b.at_key(key).get(other) || !equal_elements(value, other)) {
+					return false;
+				}
+				countA++;
+			}
+			for (auto member : simdjson::dom::object(b)) {
+				(void)member;
+				countB++;
+			}
+			return countA == countB;
+		}
+		default:
+			return false;
+		}
+	}
+
+	// Finds a block and the offset in it for an index of an array split in blocks
+	template <typename Blocks>
+	void locate(Blocks& blocks, size_t index, size_t& block, size_t& offset) {
+		block = 0;
+		while (block + 1 < blocks.size() && index >= blocks[block].size()) {
+			index -= blocks[block].size();
+			block++;
+		}
+		offset = index;
+	}
+}
+
+PatchOverlay::PatchOverlay(simdjson::dom::element base) {
+	rootNode = add_value(base);
+}
+
+PatchOverlay::NodeId PatchOverlay::add_value(simdjson::dom::element value) {
+	nodes.push_back(Node{ Kind::VALUE, 0, value });
+	return NodeId(nodes.size() - 1);
+}
+
+PatchOverlay::NodeId PatchOverlay::add_object() {
+	objects.push_back(std::make_shared<Object>());
+	nodes.push_back(Node{ Kind::OBJECT, uint32_t(objects.size() - 1), simdjson::dom::element() });
+	return NodeId(nodes.size() - 1);
+}
+
+PatchOverlay::NodeId PatchOverlay::add_array() {
+	arrays.push_back(std::make_shared<Array>());
+	nodes.push_back(Node{ Kind::ARRAY, uint32_t(arrays.size() - 1), simdjson::dom::element() });
+	return NodeId(nodes.size() - 1);
+}
+
+PatchOverlay::Object& PatchOverlay::object_for_write(NodeId node) {
+	std::shared_ptr<Object>& object = objects[nodes[node].container];
+	if (object.use_count() > 1) {
+		object = std::make_shared<Object>(*object);
+	}
+	return *object;
+}
+
+PatchOverlay::Array& PatchOverlay::array_for_write(NodeId node) {
+	std::shared_ptr<Array>& array = arrays[nodes[node].container];
+	if (array.use_count() > 1) {
+		array = std::make_shared<Array>(*array);
+	}
+	return *array;
+}
+
+// Method: The children of a copied container are nodes for its values, which are copied in turn only if a path goes
+// through them
+PatchOverlay::NodeId PatchOverlay::materialize(NodeId node) {
+	if (nodes[node].kind != Kind::VALUE) {
+		return node;
+	}
+	const simdjson::dom::element value = nodes[node].element;
+	if (value.type() == element_type::OBJECT) {
+		const NodeId copy = add_object();
+		Object& object = *objects[nodes[copy].container];
+		for (auto [key, child] : simdjson::dom::object(value)) {
+			object.members.push_back(Member{ key, add_value(child), false });
+		}
+		object.live = object.members.size();
+		if (object.members.size() > INDEXED_MEMBERS) {
+			object.index.reserve(object.members.size());
+			for (size_t i = 0; i < object.members.size(); i++) {
+				object.index[object.members[i].key] = uint32_t(i);
+			}
+		}
+		return copy;
+	}
+	if (value.type() == element_type::ARRAY) {
+		const NodeId copy = add_array();
+		Array& array = *arrays[nodes[copy].container];
+		for (simdjson::dom::element child : simdjson::dom::array(value)) {
+			if (array.blocks.empty() || array.blocks.back().size() == ARRAY_BLOCK) {
+				array.blocks.emplace_back();
+				array.blocks.back().reserve(ARRAY_BLOCK);
+			}
+			array.blocks.back().push_back(add_value(child));
+			array.count++;
+		}
+		return copy;
+	}
+	return node;
+}
+
+namespace {
+
+	// Slot of a live member, or SIZE_MAX
+	template <typename Object>
+	size_t find_member(const Object& object, std::string_view key) {
+		if (!object.index.empty()) {
+			const auto found = object.index.find(key);
+			return found == object.index.end() ? SIZE_MAX : found->second;
+		}
+		for (size_t i = 0; i < object.members.size(); i++) {
+			if (!object.members[i].removed && object.members[i].key == key) {
+				return i;
+			}
+		}
+		return SIZE_MAX;
+	}
+}
+
+size_t PatchOverlay::size(NodeId node) const {
+	if (nodes[node].kind == Kind::OBJECT) {
+		return objects[nodes[node].container]->live;
+	}
+	if (nodes[node].kind == Kind::ARRAY) {
+		return arrays[nodes[node].container]->count;
+	}
+	return 0;
+}
+
+void PatchOverlay::for_each_child(NodeId node, const std::function<void(std::string_view key, NodeId child)>& visit) const {
+	if (nodes[node].kind == Kind::OBJECT) {
+		for (const Member& member : objects[nodes[node].container]->members) {
+			if (!member.removed) {
+				visit(member.key, member.value);
+			}
+		}
+	}
+	else if (nodes[node].kind == Kind::ARRAY) {
+		for (const std::vector<NodeId>& block : arrays[nodes[node].container]->blocks) {
+			for (NodeId child : block) {
+				visit(std::string_view(), child);
+			}
+		}
+	}
+}
+
+PatchOverlay::NodeId PatchOverlay::child_at(NodeId node, size_t index, std::string_view* key) const {
+	if (nodes[node].kind == Kind::OBJECT) {
+		for (const Member& member : objects[nodes[node].container]->members) {
+			if (!member.removed && index-- == 0) {
+				if (key != nullptr) {
+					*key = member.key;
+				}
+				return member.value;
+			}
+		}
+	}
+	else if (nodes[node].kind == Kind::ARRAY) {
+		const Array& array = *arrays[nodes[node].container];
+		if (index < array.count) {
+			size_t block, offset;
+			locate(array.blocks, index, block, offset);
+			return array.blocks[block][offset];
+		}
+	}
+	return npos;
+}
+
+PatchOverlay::NodeId PatchOverlay::find(NodeId node, std::string_view token, size_t& index) const {
+	if (nodes[node].kind == Kind::OBJECT) {
+		const Object& object = *objects[nodes[node].container];
+		const size_t slot = find_member(object, token);
+		if (slot == SIZE_MAX) {
+			return npos;
+		}
+		index = size_t(std::count_if(object.members.begin(), object.members.begin() + ptrdiff_t(slot), [](const Member& member) { return !member.removed; }));
+		return object.members[slot].value;
+	}
+	if (nodes[node].kind == Kind::ARRAY && array_index(token, size(node), false, index)) {
+		return child_at(node, index);
+	}
+	return npos;
+}
+
+simdjson::error_code PatchOverlay::split_pointer(std::string_view pointer, std::vector<std::string>& tokens) {
+	tokens.clear();
+	if (pointer.empty()) {
+		return simdjson::SUCCESS;
+	}
+	if (pointer[0] != '/') {
+		return simdjson::INVALID_JSON_POINTER;
+	}
+	std::string token;
+	for (size_t i = 1; i <= pointer.size(); i++) {
+		if (i == pointer.size() || pointer[i] == '/') {
+			tokens.push_back(std::move(token));
+			token.clear();
+		}
+		else if (pointer[i] == '~') {
+			if (i + 1 == pointer.size() || (pointer[i + 1] != '0' && pointer[i + 1] != '1')) {
+				return simdjson::INVALID_JSON_POINTER;
+			}
+			token += pointer[++i] == '1' ? '/' : '~';
+		}
+		else {
+			token += pointer[i];
+		}
+	}
+	return simdjson::SUCCESS;
+}
+
+bool PatchOverlay::array_index(std::string_view token, size_t count, bool allowEnd, size_t& index) {
+	if (token == "-") {
+		index = count;
+		return allowEnd;
+	}
+	if (token.empty() || (token.size() > 1 && token[0] == '0')) {
+		return false;
+	}
+	index = 0;
+	for (const char c : token) {
+		if (c < '0' || c > '9' || index > (SIZE_MAX - 9) / 10) {
+			return false;
+		}
+		index = index * 10 + size_t(c - '0');
+	}
+	return index < count || (allowEnd && index == count);
+}
+
+simdjson::error_code PatchOverlay::child_of(NodeId node, std::string_view token, NodeId& child) {
+	const Node& parent = nodes[node];
+	size_t index;
+	if (parent.kind == Kind::VALUE) {
+		simdjson::dom::element value;
+		const simdjson::error_code error = element_child(parent.element, token, value);
+		if (error) {
+			return error;
+		}
+		child = add_value(value);
+		return simdjson::SUCCESS;
+	}
+	child = find(node, token, index);
+	if (child == npos) {
+		return parent.kind == Kind::OBJECT ? simdjson::NO_SUCH_FIELD : simdjson::INDEX_OUT_OF_BOUNDS;
+	}
+	return simdjson::SUCCESS;
+}
+
+simdjson::error_code PatchOverlay::element_child(simdjson::dom::element parent, std::string_view token, simdjson::dom::element& child) {
+	size_t index;
+	if (parent.type() == element_type::OBJECT) {
+		return parent.at_key(token).get(child) ? simdjson::NO_SUCH_FIELD : simdjson::SUCCESS;
+	}
+	if (parent.type() == element_type::ARRAY) {
+		return !array_index(token, SIZE_MAX, false, index) || parent.at(index).get(child) ? simdjson::INDEX_OUT_OF_BOUNDS : simdjson::SUCCESS;
+	}
+	return simdjson::INCORRECT_TYPE;
+}
+
+// Method: Overlay containers are followed through their children and values through their elements, so that a
+// pointer that only reads, as for "test", leaves the overlay as it is
+simdjson::error_code PatchOverlay::lookup(const std::vector<std::string>& tokens, NodeId& node, simdjson::dom::element& element) const {
+	node = rootNode;
+	size_t i = 0;
+	for (; i < tokens.size() && nodes[node].kind != Kind::VALUE; i++) {
+		size_t index;
+		const NodeId child = find(node, tokens[i], index);
+		if (child == npos) {
+			return nodes[node].kind == Kind::OBJECT ? simdjson::NO_SUCH_FIELD : simdjson::INDEX_OUT_OF_BOUNDS;
+		}
+		node = child;
+	}
+	element = nodes[node].element;
+	if (i == tokens.size()) {
+		return simdjson::SUCCESS;
+	}
+	node = npos;
+	for (; i < tokens.size(); i++) {
+		const simdjson::error_code error = element_child(element, tokens[i], element);
+		if (error) {
+			return error;
+		}
+	}
+	return simdjson::SUCCESS;
+}
+
+void PatchOverlay::set_child(NodeId parent, std::string_view token, NodeId child) {
+	if (nodes[parent].kind == Kind::OBJECT) {
+		Object& object = object_for_write(parent);
+		object.members[find_member(object, token)].value = child;
+	}
+	else {
+		Array& array = array_for_write(parent);
+		size_t index, block, offset;
+		array_index(token, array.count, false, index);
+		locate(array.blocks, index, block, offset);
+		array.blocks[block][offset] = child;
+	}
+}
+
+// Method: Copying a container replaces the node of its value in its parent, which was copied just before
+simdjson::error_code PatchOverlay::resolve(const std::vector<std::string>& tokens, size_t count, bool write, NodeId& node) {
+	if (write) {
+		rootNode = materialize(rootNode);
+	}
+	node = rootNode;
+	for (size_t i = 0; i < count; i++) {
+		NodeId child;
+		simdjson::error_code error = child_of(node, tokens[i], child);
+		if (error) {
+			return error;
+		}
+		if (write) {
+			const NodeId copy = materialize(child);
+			if (copy != child) {
+				set_child(node, tokens[i], copy);
+			}
+			child = copy;
+		}
+		node = child;
+	}
+	return simdjson::SUCCESS;
+}
+
+std::string_view PatchOverlay::keep_key(const std::string& key) {
+	keys.push_back(std::make_shared<std::string>(key));
+	return *keys.back();
+}
+
+// Method: Members are indexed once the object grows past INDEXED_MEMBERS, and the index kept up to date after that
+void PatchOverlay::set_member(NodeId node, std::string_view key, NodeId value) {
+	Object& object = object_for_write(node);
+	const size_t slot = find_member(object, key);
+	if (slot != SIZE_MAX) {
+		object.members[slot].value = value;
+		return;
+	}
+	object.members.push_back(Member{ key, value, false });
+	object.live++;
+	if (object.index.empty() && object.members.size() > INDEXED_MEMBERS) {
+		for (size_t i = 0; i < object.members.size(); i++) {
+			if (!object.members[i].removed) {
+				object.index[object.members[i].key] = uint32_t(i);
+			}
+		}
+	}
+	else if (!object.index.empty()) {
+		object.index[key] = uint32_t(object.members.size() - 1);
+	}
+}
+
+// Method: Removed members are marked, and the members compacted once most of them are removed
+bool PatchOverlay::remove_member(NodeId node, std::string_view key, NodeId* removed) {
+	if (find_member(*objects[nodes[node].container], key) == SIZE_MAX) {
+		return false;
+	}
+	Object& object = object_for_write(node);
+	const size_t slot = find_member(object, key);
+	if (removed != nullptr) {
+		*removed = object.members[slot].value;
+	}
+	object.members[slot].removed = true;
+	object.index.erase(key);
+	object.live--;
+	if (object.members.size() > 2 * object.live + INDEXED_MEMBERS) {
+		object.members.erase(std::remove_if(object.members.begin(), object.members.end(), [](const Member& member) { return member.removed; }), object.members.end());
+		if (!object.index.empty()) {
+			for (size_t i = 0; i < object.members.size(); i++) {
+				object.index[object.members[i].key] = uint32_t(i);
+			}
+		}
+	}
+	return true;
+}
+
+simdjson::error_code PatchOverlay::add(const std::vector<std::string>& tokens, NodeId value) {
+	if (tokens.empty()) {
+		rootNode = value;
+		return simdjson::SUCCESS;
+	}
+	NodeId parent;
+	simdjson::error_code error = resolve(tokens, tokens.size() - 1, true, parent);
+	if (error) {
+		return error;
+	}
+	const std::string& last = tokens.back();
+	if (nodes[parent].kind == Kind::OBJECT) {
+		const Object& object = *objects[nodes[parent].container];
+		set_member(parent, find_member(object, last) == SIZE_MAX ? keep_key(last) : std::string_view(last), value);
+		return simdjson::SUCCESS;
+	}
+	if (nodes[parent].kind == Kind::ARRAY) {
+		Array& array = array_for_write(parent);
+		size_t index;
+		if (!array_index(last, array.count, true, index)) {
+			return simdjson::INDEX_OUT_OF_BOUNDS;
+		}
+		if (array.blocks.empty()) {
+			array.blocks.emplace_back();
+		}
+		size_t block, offset;
+		locate(array.blocks, index, block, offset);
+		std::vector<NodeId>& target = array.blocks[block];
+		target.insert(target.begin() + ptrdiff_t(offset), value);
+		if (target.size() >= 2 * ARRAY_BLOCK) {
+			std::vector<NodeId> second(target.begin() + ptrdiff_t(ARRAY_BLOCK), target.end());
+			target.resize(ARRAY_BLOCK);
+			array.blocks.insert(array.blocks.begin() + ptrdiff_t(block) + 1, std::move(second));
+		}
+		array.count++;
+		return simdjson::SUCCESS;
+	}
+	return simdjson::INCORRECT_TYPE;
+}
+
+simdjson::error_code PatchOverlay::remove(const std::vector<std::string>& tokens, NodeId* removed) {
+	if (tokens.empty()) {
+		return simdjson::INVALID_JSON_POINTER;
+	}
+	NodeId parent;
+	simdjson::error_code error = resolve(tokens, tokens.size() - 1, true, parent);
+	if (error) {
+		return error;
+	}
+	const std::string& last = tokens.back();
+	if (nodes[parent].kind == Kind::OBJECT) {
+		return remove_member(parent, last, removed) ? simdjson::SUCCESS : simdjson::NO_SUCH_FIELD;
+	}
+	if (nodes[parent].kind == Kind::ARRAY) {
+		Array& array = array_for_write(parent);
+		size_t index, block, offset;
+		if (!array_index(last, array.count, false, index)) {
+			return simdjson::INDEX_OUT_OF_BOUNDS;
+		}
+		locate(array.blocks, index, block, offset);
+		if (removed != nullptr) {
+			*removed = array.blocks[block][offset];
+		}
+		array.blocks[block].erase(array.blocks[block].begin() + ptrdiff_t(offset));
+		if (array.blocks[block].empty()) {
+			array.blocks.erase(array.blocks.begin() + ptrdiff_t(block));
+		}
+		array.count--;
+		return simdjson::SUCCESS;
+	}
+	return simdjson::INCORRECT_TYPE;
+}
+
+// Method: Values are shared, as nodes never change; overlay containers are copied with their overlay descendants
+PatchOverlay::NodeId PatchOverlay::clone(NodeId node) {
+	if (nodes[node].kind == Kind::OBJECT) {
+		const NodeId copy = add_object();
+		Object object = *objects[nodes[node].container];
+		for (Member& member : object.members) {
+			if (!member.removed) {
+				member.value = clone(member.value);
+			}
+		}
+		*objects[nodes[copy].container] = std::move(object);
+		return copy;
+	}
+	if (nodes[node].kind == Kind::ARRAY) {
+		const NodeId copy = add_array();
+		Array array = *arrays[nodes[node].container];
+		for (std::vector<NodeId>& block : array.blocks) {
+			for (NodeId& child : block) {
+				child = clone(child);
+			}
+		}
+		*arrays[nodes[copy].container] = std::move(array);
+		return copy;
+	}
+	return node;
+}
+
+bool PatchOverlay::equal(NodeId node, simdjson::dom::element value) const {
+	if (nodes[node].kind == Kind::VALUE) {
+		return equal_elements(nodes[node].element, value);
+	}
+	if (nodes[node].kind == Kind::OBJECT) {
+		if (value.type() != element_type::OBJECT) {
+			return false;
+		}
+		size_t count = 0;
+		for (auto [key, child] : simdjson::dom::object(value)) {
+			size_t index;
+			const NodeId member = find(node, key, index);
+			if (member == npos || !equal(member, child)) {
+				return false;
+			}
+			count++;
+		}
+		return count == size(node);
+	}
+	if (value.type() != element_type::ARRAY) {
+		return false;
+	}
+	size_t index = 0;
+	for (simdjson::dom::element child : simdjson::dom::array(value)) {
+		const NodeId element = child_at(node, index++);
+		if (element == npos || !equal(element, child)) {
+			return false;
+		}
+	}
+	return index == size(node);
+}
+
+simdjson::error_code PatchOverlay::apply_operation(simdjson::dom::element operation) {
+	std::string_view op, path;
+	if (operation["op"].get(op) || operation["path"].get(path)) {
+		errorMessage = "missing \"op\" or \"path\"";
+		return simdjson::INCORRECT_TYPE;
+	}
+	std::vector<std::string> tokens;
+	simdjson::error_code error = split_pointer(path, tokens);
+	if (error) {
+		return error;
+	}
+	simdjson::dom::element value;
+	const bool hasValue = !operation["value"].get(value);
+	std::string_view from;
+	std::vector<std::string> fromTokens;
+	if (op == "move" || op == "copy") {
+		if (operation["from"].get(from)) {
+			errorMessage = "missing \"from\"";
+			return simdjson::INCORRECT_TYPE;
+		}
+		error = split_pointer(from, fromTokens);
+		if (error) {
+			return error;
+		}
+	}
+
+	if (op == "add" || op == "replace" || op == "test") {
+		if (!hasValue) {
+			errorMessage = "missing \"value\"";
+			return simdjson::INCORRECT_TYPE;
+		}
+	}
+	if (op == "add") {
+		return add(tokens, add_value(value));
+	}
+	if (op == "remove") {
+		return remove(tokens, nullptr);
+	}
+	if (op == "replace") {
+		// The value must exist; its parent is copied and the new value put in its place
+		NodeId existing;
+		simdjson::dom::element existingElement;
+		error = lookup(tokens, existing, existingElement);
+		if (error) {
+			return error;
+		}
+		if (tokens.empty()) {
+			rootNode = add_value(value);
+			return simdjson::SUCCESS;
+		}
+		NodeId parent;
+		error = resolve(tokens, tokens.size() - 1, true, parent);
+		if (error) {
+			return error;
+		}
+		set_child(parent, tokens.back(), add_value(value));
+		return simdjson::SUCCESS;
+	}
+	if (op == "move") {
+		if (path.size() > from.size() && path.substr(0, from.size()) == from && path[from.size()] == '/') {
+			errorMessage = "cannot move a value into itself";
+			return simdjson::INCORRECT_TYPE;
+		}
+		if (path == from) {
+			NodeId existing;
+			simdjson::dom::element existingElement;
+			return lookup(tokens, existing, existingElement);
+		}
+		NodeId moved;
+		error = remove(fromTokens, &moved);
+		return error ? error : add(tokens, moved);
+	}
+	if (op == "copy") {
+		NodeId copied;
+		simdjson::dom::element copiedElement;
+		error = lookup(fromTokens, copied, copiedElement);
+		return error ? error : add(tokens, copied != npos ? clone(copied) : add_value(copiedElement));
+	}
+	if (op == "test") {
+		NodeId existing;
+		simdjson::dom::element existingElement;
+		error = lookup(tokens, existing, existingElement);
+		if (error) {
+			return error;
+		}
+		if (existing != npos ? !equal(existing, value) : !equal_elements(existingElement, value)) {
+			errorMessage = "test failed";
+			return simdjson::INCORRECT_TYPE;
+		}
+		return simdjson::SUCCESS;
+	}
+	errorMessage = "unknown op";
+	return simdjson::INCORRECT_TYPE;
+}
+
+PatchOverlay::NodeId PatchOverlay::merge(NodeId target, simdjson::dom::element patch) {
+	if (patch.type() != element_type::OBJECT) {
+		return add_value(patch);
+	}
+	const bool isObject = target != npos && (nodes[target].kind == Kind::OBJECT
+		|| (nodes[target].kind == Kind::VALUE && nodes[target].element.type() == element_type::OBJECT));
+	const NodeId object = isObject ? materialize(target) : add_object();
+	for (auto [key, value] : simdjson::dom::object(patch)) {
+		if (value.type() == element_type::NULL_VALUE) {
+			remove_member(object, key, nullptr);
+			continue;
+		}
+		size_t index;
+		const NodeId existing = find(object, key, index);
+		set_member(object, key, merge(existing, value));
+	}
+	return object;
+}
+
+simdjson::error_code PatchOverlay::apply_file(const std::string& path, Format format) {
+	simdjson::padded_string text;
+	simdjson::error_code error = simdjson::padded_string::load(path).get(text);
+	if (error) {
+		errorMessage = "cannot read " + path;
+		return error;
+	}
+	return apply(text, format);
+}
+
+// Method: Containers changed by the patch are copied first, as the saved state still shares them; nodes are only
+// ever appended, so dropping the ones added restores the rest
+simdjson::error_code PatchOverlay::apply(const simdjson::padded_string& text, Format format) {
+	const auto start = std::chrono::steady_clock::now();
+	errorMessage.clear();
+	auto parser = std::make_shared<simdjson::dom::parser>();
+	simdjson::dom::element patch;
+	simdjson::error_code error = parser->parse(text).get(patch);
+	if (error) {
+		errorMessage = "the patch is not valid JSON";
+		return error;
+	}
+	if (format == Format::AUTO) {
+		simdjson::dom::array operations;
+		simdjson::dom::element first;
+		const bool isJsonPatch = !patch.get(operations) && (operations.begin() == operations.end()
+			|| (!operations.at(0).get(first) && first.type() == element_type::OBJECT && !first["op"].error()));
+		format = isJsonPatch ? Format::JSON_PATCH : Format::MERGE_PATCH;
+	}
+
+	const std::vector<std::shared_ptr<Object>> savedObjects = objects;
+	const std::vector<std::shared_ptr<Array>> savedArrays = arrays;
+	const size_t savedNodes = nodes.size();
+	const size_t savedKeys = keys.size();
+	const NodeId savedRoot = rootNode;
+	uint64_t applied = 0;
+	if (format == Format::MERGE_PATCH) {
+		rootNode = merge(rootNode, patch);
+		applied = 1;
+	}
+	else {
+		simdjson::dom::array operations;
+		error = patch.get(operations);
+		for (simdjson::dom::element operation : operations) {
+			if (error) {
+				break;
+			}
+			error = apply_operation(operation);
+			if (error) {
+				errorMessage = "operation " + std::to_string(applied) + ": " + (errorMessage.empty() ? simdjson::error_message(error) : errorMessage);
+			}
+			else {
+				applied++;
+			}
+		}
+	}
+	if (error) {
+		objects = savedObjects;
+		arrays = savedArrays;
+		nodes.resize(savedNodes);
+		keys.resize(savedKeys);
+		rootNode = savedRoot;
+	}
+	else {
+		patches.push_back(parser);
+		operationCount += applied;
+	}
+	elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return error;
+}
+
+void PatchOverlay::serialize(NodeId node, std::string& out) const {
+	const Node& current = nodes[node];
+	if (current.kind == Kind::VALUE) {
+		out += simdjson::minify(current.element);
+		return;
+	}
+	const bool isObject = current.kind == Kind::OBJECT;
+	out += isObject ? '{' : '[';
+	bool first = true;
+	for_each_child(node, [&](std::string_view key, NodeId child) {
+		if (!first) {
+			out += ',';
+		}
+		first = false;
+		if (isObject) {
+			simdjson::internal::mini_formatter format;
+			format.key(key);
+			const std::string_view text = format.str();
+			out.append(text.data(), text.size());
+		}
+		serialize(child, out);
+	});
+	out += isObject ? '}' : ']';
+}
+
+simdjson::error_code PatchOverlay::write(const std::string& path) const {
+	std::FILE* fp = std::fopen(path.c_str(), "wb");
+	if (fp == nullptr) {
+		return simdjson::IO_ERROR;
+	}
+	std::string out;
+	serialize(rootNode, out);
+	const bool written = std::fwrite(out.data(), 1, out.size(), fp) == out.size();
+	return std::fclose(fp) == 0 && written ? simdjson::SUCCESS : simdjson::IO_ERROR;
+}
+
+size_t PatchOverlay::memory_usage() const {
+	size_t bytes = nodes.capacity() * sizeof(Node);
+	for (const auto& object : objects) {
+		bytes += object->members.capacity() * sizeof(Member) + object->index.size() * (sizeof(std::string_view) + 2 * sizeof(void*));
+	}
+	for (const auto& array : arrays) {
+		bytes += array->count * sizeof(NodeId) + array->blocks.capacity() * sizeof(std::vector<NodeId>);
+	}
+	return bytes;
+}
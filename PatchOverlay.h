@@ -0,0 +1,165 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "simdjson.h"
+
+// PatchOverlay class, the result of applying JSON Patch (RFC 6902) and JSON Merge Patch (RFC 7386) documents to a
+// parsed document without changing or copying it. The result is a tree of nodes in which untouched values are the
+// elements of the base document (or of the patches, for values they add), shared as they are; only the containers
+// on the paths that operations touch are copied into the overlay, one level at a time, the first time they are
+// changed. Applying an operation costs the depth of its path, plus the size of the containers it copies the first
+// time. Overlay containers are shared between copies of an overlay and copied again when changed, so that a patch is
+// applied to a copy and dropped if one of its operations fails, as the RFCs require.
+class PatchOverlay
+{
+public:
+    using NodeId = uint32_t;
+    static constexpr NodeId npos = UINT32_MAX;
+
+    // An element of the base document or of a patch, or a container of the overlay
+    enum class Kind : uint8_t { VALUE, OBJECT, ARRAY };
+
+    enum class Format { AUTO, JSON_PATCH, MERGE_PATCH };
+
+    // Children per block of an overlay array; blocks are split when they grow to twice this size
+    static constexpr size_t ARRAY_BLOCK = 1024;
+
+    // Objects with more members than this get a hash index
+    static constexpr size_t INDEXED_MEMBERS = 16;
+
+    // 'base' must stay valid while the overlay is used
+    explicit PatchOverlay(simdjson::dom::element base);
+
+    // Applies a patch, all or nothing. With AUTO, an array of objects with an "op" member is a JSON Patch and anything
+    // else a merge patch. Returns the parse error, INVALID_JSON_POINTER for a malformed path, NO_SUCH_FIELD or
+    // INDEX_OUT_OF_BOUNDS for a path that does not exist, INCORRECT_TYPE for a malformed operation or a failed "test";
+    // message() tells which operation.
+    simdjson::error_code apply_file(const std::string& path, Format format = Format::AUTO);
+    simdjson::error_code apply(const simdjson::padded_string& text, Format format = Format::AUTO);
+
+    // The patched document
+    NodeId root() const { return rootNode; }
+    Kind kind(NodeId node) const { return nodes[node].kind; }
+    simdjson::dom::element element(NodeId node) const { return nodes[node].element; }
+
+    // Children of an overlay container, in order, with their keys (empty for arrays)
+    size_t size(NodeId node) const;
+    void for_each_child(NodeId node, const std::function<void(std::string_view key, NodeId child)>& visit) const;
+
+    // The child at 'index' and, for objects, its key; npos if there is none
+    NodeId child_at(NodeId node, size_t index, std::string_view* key = nullptr) const;
+
+    // The child of an overlay container for a key or an index (as a decoded pointer token), and its index; npos if
+    // there is none
+    NodeId find(NodeId node, std::string_view token, size_t& index) const;
+
+    // Writes the patched document as minified JSON
+    void serialize(NodeId node, std::string& out) const;
+    simdjson::error_code write(const std::string& path) const;
+
+    // Statistics: operations applied, containers and values copied into the overlay, approximate memory, and the
+    // duration of the last apply in seconds
+    uint64_t operations() const { return operationCount; }
+    size_t copied_containers() const { return objects.size() + arrays.size(); }
+    size_t copied_values() const { return nodes.size(); }
+    size_t memory_usage() const;
+    double seconds() const { return elapsed; }
+
+    // Description of the last error
+    const std::string& message() const { return errorMessage; }
+
+private:
+    // Nodes are never changed once added: changes add nodes or change containers, so that a failed patch is undone
+    // by dropping the nodes it added and putting back the containers it changed
+    struct Node {
+        Kind kind;
+        uint32_t container;
+        simdjson::dom::element element;
+    };
+    std::vector<Node> nodes;
+    NodeId rootNode = npos;
+
+    // Members in insertion order, removed ones marked so that the others keep their places
+    struct Member {
+        std::string_view key;
+        NodeId value;
+        bool removed;
+    };
+    struct Object {
+        std::vector<Member> members;
+        size_t live = 0;
+        std::unordered_map<std::string_view, uint32_t> index;
+    };
+    struct Array {
+        std::vector<std::vector<NodeId>> blocks;
+        size_t count = 0;
+    };
+    std::vector<std::shared_ptr<Object>> objects;
+    std::vector<std::shared_ptr<Array>> arrays;
+
+    // Patch documents, which added values refer to, and keys of paths, which added members refer to
+    std::vector<std::shared_ptr<simdjson::dom::parser>> patches;
+    std::vector<std::shared_ptr<std::string>> keys;
+
+    uint64_t operationCount = 0;
+    double elapsed = 0;
+    std::string errorMessage;
+
+    NodeId add_value(simdjson::dom::element value);
+    NodeId add_object();
+    NodeId add_array();
+
+    // The container of a node, copied first if a copy of the overlay shares it
+    Object& object_for_write(NodeId node);
+    Array& array_for_write(NodeId node);
+
+    // Copies a container of the base or of a patch into the overlay, as a node whose children are its values;
+    // overlay containers and scalars are returned as they are
+    NodeId materialize(NodeId node);
+
+    // Decodes a JSON Pointer into tokens
+    static simdjson::error_code split_pointer(std::string_view pointer, std::vector<std::string>& tokens);
+
+    // Reads a token as an array index, for an array of 'count' elements; '-' is 'count' if 'allowEnd' is set
+    static bool array_index(std::string_view token, size_t count, bool allowEnd, size_t& index);
+
+    // Follows the tokens from the root, copying the containers on the way if 'write' is set; with 'write', the
+    // returned node is the overlay container itself
+    simdjson::error_code resolve(const std::vector<std::string>& tokens, size_t count, bool write, NodeId& node);
+
+    // Child of any node for a token, without copying it
+    simdjson::error_code child_of(NodeId node, std::string_view token, NodeId& child);
+
+    // Child of a base or patch value for a token
+    static simdjson::error_code element_child(simdjson::dom::element parent, std::string_view token, simdjson::dom::element& child);
+
+    // Follows the tokens from the root without adding nodes, for operations that only read. 'node' is the overlay
+    // node reached, or npos if the value lies inside a base or patch value, in which case 'element' is that value.
+    simdjson::error_code lookup(const std::vector<std::string>& tokens, NodeId& node, simdjson::dom::element& element) const;
+
+    // Replaces the child of an overlay container for a token, which must exist
+    void set_child(NodeId parent, std::string_view token, NodeId child);
+
+    // Operations of RFC 6902
+    simdjson::error_code add(const std::vector<std::string>& tokens, NodeId value);
+    simdjson::error_code remove(const std::vector<std::string>& tokens, NodeId* removed);
+    NodeId clone(NodeId node);
+    bool equal(NodeId node, simdjson::dom::element value) const;
+    simdjson::error_code apply_operation(simdjson::dom::element operation);
+
+    // Sets or removes a member of an overlay object; 'key' must outlive the overlay
+    void set_member(NodeId node, std::string_view key, NodeId value);
+    bool remove_member(NodeId node, std::string_view key, NodeId* removed);
+
+    // RFC 7386, returning the merged node
+    NodeId merge(NodeId target, simdjson::dom::element patch);
+
+    // Key kept with the overlay
+    std::string_view keep_key(const std::string& key);
+};
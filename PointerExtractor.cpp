@@ -0,0 +1,378 @@
+#include "PointerExtractor.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+	inline bool is_space(char c) {
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+	}
+
+	// Bytes that matter inside a nested value, and inside a string
+	struct ByteTables {
+		bool nesting[256] = {};
+		bool string[256] = {};
+		ByteTables() {
+			for (unsigned char c : { '"', '{', '}', '[', ']' }) {
+				nesting[c] = true;
+			}
+			string[uint8_t('"')] = true;
+			string[uint8_t('\\')] = true;
+		}
+	};
+	const ByteTables tables;
+
+	// Appends 's' as a JSON string literal
+	void append_json_string(std::string& out, std::string_view s) {
+		static const char hex[] = "0123456789abcdef";
+		out += '"';
+		for (const char c : s) {
+			if (c == '"' || c == '\\') {
+				out += '\\';
+				out += c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20) {
+				out += "\\u00";
+				out += hex[(c >> 4) & 0xF];
+				out += hex[c & 0xF];
+			}
+			else {
+				out += c;
+			}
+		}
+		out += '"';
+	}
+}
+
+// Method: Decodes ~1 and ~0 in each token, and reads tokens made of digits (without leading zeros) as indices
+simdjson::error_code PointerExtractor::set_pointer(std::string_view pointer) {
+	tokens.clear();
+	tokenIndexes.clear();
+	if (pointer.empty()) {
+		return simdjson::SUCCESS;
+	}
+	if (pointer[0] != '/') {
+		return simdjson::INVALID_JSON_POINTER;
+	}
+	size_t start = 1;
+	while (true) {
+		const size_t end = std::min(pointer.find('/', start), pointer.size());
+		std::string token;
+		for (size_t i = start; i < end; i++) {
+			if (pointer[i] == '~') {
+				if (i + 1 == end || (pointer[i + 1] != '0' && pointer[i + 1] != '1')) {
+					return simdjson::INVALID_JSON_POINTER;
+				}
+				token += pointer[++i] == '1' ? '/' : '~';
+			}
+			else {
+				token += pointer[i];
+			}
+		}
+
+		size_t tokenIndex = token.empty() || (token.size() > 1 && token[0] == '0') ? SIZE_MAX : 0;
+		for (const char c : token) {
+			if (c < '0' || c > '9' || tokenIndex > (SIZE_MAX - 9) / 10) {
+				tokenIndex = SIZE_MAX;
+				break;
+			}
+			tokenIndex = tokenIndex * 10 + size_t(c - '0');
+		}
+		tokens.push_back(std::move(token));
+		tokenIndexes.push_back(tokenIndex);
+		if (end == pointer.size()) {
+			return simdjson::SUCCESS;
+		}
+		start = end + 1;
+	}
+}
+
+// Method: Keys without escapes are compared as they are; the rare escaped key is decoded by parsing it as a string
+bool PointerExtractor::key_matches() {
+	if (key.find('\\') == std::string::npos) {
+		return key == tokens[matched];
+	}
+	std::string_view decoded;
+	if (keyParser.parse("\"" + key + "\"").get(decoded)) {
+		return false;
+	}
+	return decoded == tokens[matched];
+}
+
+// Method: Streams the file through the scan until the target has been copied out
+simdjson::error_code PointerExtractor::extract(const std::string& path, std::string_view pointer, const std::function<void(std::string_view)>& write) {
+	const auto start = std::chrono::steady_clock::now();
+	state = State::VALUE;
+	matched = 0;
+	key.clear();
+	inString = false;
+	escaped = false;
+	depth = 0;
+	scanned = 0;
+	extracted = 0;
+	targetOffset = 0;
+	elapsed = 0;
+
+	simdjson::error_code error = set_pointer(pointer);
+	if (error) {
+		return error;
+	}
+	std::FILE* fp = std::fopen(path.c_str(), "rb");
+	if (fp == nullptr) {
+		return simdjson::IO_ERROR;
+	}
+
+	std::vector<char> buffer(READ_SIZE);
+	size_t bytesRead;
+	while (state != State::DONE && (bytesRead = std::fread(buffer.data(), 1, buffer.size(), fp)) > 0) {
+		scanned += scan(buffer.data(), bytesRead, write, error);
+		if (error) {
+			break;
+		}
+	}
+	const bool readFailed = std::ferror(fp) != 0;
+	std::fclose(fp);
+	elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (error) {
+		return error;
+	}
+	if (readFailed) {
+		return simdjson::IO_ERROR;
+	}
+
+	// A scalar target ends with the file
+	if (state == State::COPY && depth == 0 && !inString && extracted > 0) {
+		state = State::DONE;
+	}
+	if (state != State::DONE) {
+		return scanned == 0 ? simdjson::EMPTY : simdjson::TAPE_ERROR;
+	}
+	return simdjson::SUCCESS;
+}
+
+simdjson::simdjson_result<simdjson::dom::element> PointerExtractor::load(simdjson::dom::parser& parser, const std::string& path, std::string_view pointer) {
+	std::string value;
+	append_json_string(value, pointer);
+	value.insert(0, 1, '{');
+	value += ':';
+	simdjson::error_code error = extract(path, pointer, [&value](std::string_view piece) { value.append(piece); });
+	if (error) {
+		return error;
+	}
+	value += '}';
+	value.reserve(value.size() + simdjson::SIMDJSON_PADDING);
+	return parser.parse(value);
+}
+
+// Method: Runs the state machine over a chunk. Only one container is followed at a time: once a member or element
+// matches, the scan enters it and never comes back, so no stack is needed. Skipped and copied values are delimited
+// by tracking strings and nesting; a scalar ends at the first delimiter outside strings.
+size_t PointerExtractor::scan(const char* input, size_t size, const std::function<void(std::string_view)>& write, simdjson::error_code& error) {
+	size_t pos = 0;
+
+	// Advances over a skipped or copied value. Returns true once it has ended.
+	auto skip_value = [&]() {
+		while (pos < size) {
+			const char c = input[pos];
+			if (inString) {
+				if (escaped) {
+					escaped = false;
+					pos++;
+					continue;
+				}
+				while (pos < size && !tables.string[uint8_t(input[pos])]) {
+					pos++;
+				}
+				if (pos == size) {
+					break;
+				}
+				if (input[pos++] == '\\') {
+					escaped = true;
+				}
+				else {
+					inString = false;
+					if (depth == 0) {
+						return true;
+					}
+				}
+			}
+			else if (depth > 0 && !tables.nesting[uint8_t(c)]) {
+				do {
+					pos++;
+				} while (pos < size && !tables.nesting[uint8_t(input[pos])]);
+			}
+			else if (!started && is_space(c)) {
+				pos++;
+			}
+			else if (c == '"') {
+				inString = true;
+				started = true;
+				pos++;
+			}
+			else if (c == '{' || c == '[') {
+				depth++;
+				started = true;
+				pos++;
+			}
+			else if (c == '}' || c == ']') {
+				if (depth == 0) {
+					return true;
+				}
+				pos++;
+				if (--depth == 0) {
+					return true;
+				}
+			}
+			else if (depth == 0 && (c == ',' || is_space(c))) {
+				return true;
+			}
+			else {
+				started = true;
+				pos++;
+			}
+		}
+		return false;
+	};
+	auto start_skip = [&](State next) {
+		depth = 0;
+		inString = false;
+		escaped = false;
+		started = false;
+		state = next;
+	};
+	auto not_found = [&]() {
+		error = inObject ? simdjson::NO_SUCH_FIELD : simdjson::INDEX_OUT_OF_BOUNDS;
+	};
+
+	while (pos < size && !error && state != State::DONE) {
+		const char c = input[pos];
+		switch (state) {
+		case State::VALUE:
+			if (is_space(c)) {
+				pos++;
+			}
+			else if (matched == tokens.size()) {
+				targetOffset = scanned + pos;
+				start_skip(State::COPY);
+			}
+			else if (c == '{' || c == '[') {
+				inObject = c == '{';
+				firstItem = true;
+				index = 0;
+				pos++;
+				state = State::BEFORE_ITEM;
+				if (!inObject && tokenIndexes[matched] == SIZE_MAX) {
+					error = simdjson::INCORRECT_TYPE;
+				}
+			}
+			else {
+				error = simdjson::INCORRECT_TYPE;
+			}
+			break;
+
+		case State::BEFORE_ITEM:
+			if (is_space(c)) {
+				pos++;
+			}
+			else if ((c == '}' || c == ']') && firstItem) {
+				not_found();
+			}
+			else if (inObject) {
+				if (c != '"') {
+					error = simdjson::TAPE_ERROR;
+					break;
+				}
+				pos++;
+				key.clear();
+				escaped = false;
+				state = State::KEY;
+			}
+			else {
+				firstItem = false;
+				if (index == tokenIndexes[matched]) {
+					matched++;
+					state = State::VALUE;
+				}
+				else {
+					start_skip(State::SKIP);
+				}
+			}
+			break;
+
+		case State::KEY: {
+			const size_t keyStart = pos;
+			while (pos < size && (escaped || input[pos] != '"')) {
+				escaped = !escaped && input[pos] == '\\';
+				pos++;
+			}
+			key.append(input + keyStart, pos - keyStart);
+			if (pos < size) {
+				pos++;
+				itemMatches = key_matches();
+				state = State::BEFORE_COLON;
+			}
+			break;
+		}
+
+		case State::BEFORE_COLON:
+			if (is_space(c)) {
+				pos++;
+			}
+			else if (c == ':') {
+				pos++;
+				firstItem = false;
+				if (itemMatches) {
+					matched++;
+					state = State::VALUE;
+				}
+				else {
+					start_skip(State::SKIP);
+				}
+			}
+			else {
+				error = simdjson::TAPE_ERROR;
+			}
+			break;
+
+		case State::SKIP:
+			if (skip_value()) {
+				state = State::AFTER_ITEM;
+			}
+			break;
+
+		case State::AFTER_ITEM:
+			if (is_space(c)) {
+				pos++;
+			}
+			else if (c == ',') {
+				pos++;
+				index++;
+				state = State::BEFORE_ITEM;
+			}
+			else if (c == '}' || c == ']') {
+				not_found();
+			}
+			else {
+				error = simdjson::TAPE_ERROR;
+			}
+			break;
+
+		case State::COPY: {
+			const size_t copyStart = pos;
+			if (skip_value()) {
+				state = State::DONE;
+			}
+			if (pos > copyStart) {
+				write(std::string_view(input + copyStart, pos - copyStart));
+				extracted += pos - copyStart;
+			}
+			break;
+		}
+
+		default:
+			break;
+		}
+	}
+	return pos;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "simdjson.h"
+
+// PointerExtractor class, pulls the value at one JSON Pointer (such as "/config/routes") out of a file without
+// loading the rest. The file is streamed in chunks through a quote-aware scan that follows the pointer down one
+// branch: values before the target are skipped by tracking strings and nesting only, the target's bytes are passed
+// on as they are scanned, and reading stops as soon as the target ends. Memory use is one read buffer and the
+// current key, whatever the size of the file. Skipped values are delimited, not validated.
+class PointerExtractor
+{
+public:
+    // Bytes read and scanned at a time
+    static constexpr size_t READ_SIZE = 4 * 1024 * 1024;
+
+    // Streams the raw JSON text of the value at 'pointer' to 'write', in pieces. Returns NO_SUCH_FIELD or
+    // INDEX_OUT_OF_BOUNDS if the value does not exist, INCORRECT_TYPE if the pointer goes through a scalar and
+    // INVALID_JSON_POINTER if 'pointer' is neither empty nor starts with '/'.
+    simdjson::error_code extract(const std::string& path, std::string_view pointer, const std::function<void(std::string_view)>& write);
+
+    // Extracts the value at 'pointer' and parses it with 'parser', so the DOM only holds the target. The value is
+    // parsed as the only member of an object keyed by the pointer, which gives a scalar target a parent to be shown
+    // under and its rows pointers within the returned document.
+    simdjson::simdjson_result<simdjson::dom::element> load(simdjson::dom::parser& parser, const std::string& path, std::string_view pointer);
+
+    // Offset in the file of the value found by the last call; it spans bytes_extracted() bytes from there
+    uint64_t target_offset() const { return targetOffset; }
+
+    // Input bytes scanned and value bytes extracted by the last call, and its duration in seconds
+    uint64_t bytes_scanned() const { return scanned; }
+    uint64_t bytes_extracted() const { return extracted; }
+    double seconds() const { return elapsed; }
+
+private:
+    enum class State { VALUE, BEFORE_ITEM, KEY, BEFORE_COLON, AFTER_ITEM, SKIP, COPY, DONE };
+
+    // Decoded pointer tokens, their values as array indices (SIZE_MAX if not an index), and how many of them the
+    // current container has matched
+    std::vector<std::string> tokens;
+    std::vector<size_t> tokenIndexes;
+    size_t matched = 0;
+
+    State state = State::VALUE;
+    bool inObject = false;      // Whether the current container is an object (otherwise an array)
+    bool firstItem = true;      // No member or element seen yet in the current container
+    size_t index = 0;           // Index of the current element or member
+    bool itemMatches = false;   // Whether the key or index of the current item is the next token
+
+    // Current key (raw, escapes not decoded), and the state of the value being skipped or copied
+    std::string key;
+    bool inString = false;
+    bool escaped = false;
+    bool started = false;
+    size_t depth = 0;
+
+    // Parses keys containing escapes
+    simdjson::dom::parser keyParser;
+
+    uint64_t scanned = 0;
+    uint64_t extracted = 0;
+    uint64_t targetOffset = 0;
+    double elapsed = 0;
+
+    // Splits and decodes 'pointer' into 'tokens'
+    simdjson::error_code set_pointer(std::string_view pointer);
+
+    // Runs the scan over input[0, size) and returns the number of bytes consumed. Sets 'error' when the pointer
+    // cannot be resolved or the input is malformed.
+    size_t scan(const char* input, size_t size, const std::function<void(std::string_view)>& write, simdjson::error_code& error);
+
+    // Whether the raw 'key' of the current member is the next token
+    bool key_matches();
+};
@@ -0,0 +1,391 @@
+#include "Projection.h"
+#include <algorithm>
+#include <filesystem>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+	// A file mapped read-only and followed by SIMDJSON_PADDING readable zero bytes, so that simdjson reads it in place
+	// from the page cache instead of a copy in memory. Falls back to reading the file where it cannot be mapped so.
+	class MappedInput {
+	public:
+		~MappedInput() {
+#ifdef _WIN32
+			if (view != nullptr) {
+				UnmapViewOfFile(view);
+			}
+#else
+			if (view != nullptr) {
+				munmap(view, mappedSize);
+			}
+#endif
+		}
+
+		simdjson::error_code open(const std::string& path) {
+			std::error_code ec;
+			length = size_t(std::filesystem::file_size(path, ec));
+			if (ec) {
+				return simdjson::IO_ERROR;
+			}
+			if (length > 0 && map(path)) {
+				return simdjson::SUCCESS;
+			}
+			return simdjson::padded_string::load(path).get(copy);
+		}
+
+		simdjson::padded_string_view data() const {
+			return view != nullptr
+				? simdjson::padded_string_view(static_cast<const char*>(view), length, length + simdjson::SIMDJSON_PADDING)
+				: simdjson::padded_string_view(copy);
+		}
+
+	private:
+		void* view = nullptr;
+		size_t mappedSize = 0;
+		size_t length = 0;
+		simdjson::padded_string copy;
+
+#ifdef _WIN32
+		// The bytes after the end of the file up to the end of its last page read as zeros; a view cannot be extended
+		// past them, so the file is only mapped if the padding fits there
+		bool map(const std::string& path) {
+			SYSTEM_INFO info;
+			GetSystemInfo(&info);
+			const size_t tail = length % info.dwPageSize;
+			if (tail == 0 || info.dwPageSize - tail < simdjson::SIMDJSON_PADDING) {
+				return false;
+			}
+			HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file == INVALID_HANDLE_VALUE) {
+				return false;
+			}
+			HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			CloseHandle(file);
+			view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+			if (mapping) {
+				CloseHandle(mapping);
+			}
+			return view != nullptr;
+		}
+#else
+		// Reserves zero pages for the file and its padding, then maps the file over the start of them
+		bool map(const std::string& path) {
+			const size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+			mappedSize = (length + simdjson::SIMDJSON_PADDING + pageSize - 1) / pageSize * pageSize;
+			void* reserved = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (reserved == MAP_FAILED) {
+				return false;
+			}
+			const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			void* mapped = fd >= 0 ? mmap(reserved, length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) : MAP_FAILED;
+			if (fd >= 0) {
+				close(fd);
+			}
+			if (mapped == MAP_FAILED) {
+				munmap(reserved, mappedSize);
+				return false;
+			}
+			madvise(mapped, length, MADV_SEQUENTIAL);
+			view = mapped;
+			return true;
+		}
+#endif
+	};
+
+	// Appends 's' as a JSON string literal
+	void append_json_string(std::string& out, std::string_view s) {
+		static const char hex[] = "0123456789abcdef";
+		out += '"';
+		for (const char c : s) {
+			switch (c) {
+			case '"': out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\n': out += "\\n"; break;
+			case '\r': out += "\\r"; break;
+			case '\t': out += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20) {
+					out += "\\u00";
+					out += hex[(c >> 4) & 0xF];
+					out += hex[c & 0xF];
+				}
+				else {
+					out += c;
+				}
+			}
+		}
+		out += '"';
+	}
+}
+
+// Method: Builds the trie, decoding the JSON Pointer escapes ~1 and ~0 in each segment
+simdjson::error_code Projection::set_patterns(const std::vector<std::string>& patterns) {
+	nodes.assign(1, Node());
+	for (const std::string& pattern : patterns) {
+		if (pattern.empty()) {
+			nodes[0].terminal = true;
+			continue;
+		}
+		if (pattern[0] != '/') {
+			return simdjson::INVALID_JSON_POINTER;
+		}
+		size_t node = 0;
+		size_t start = 1;
+		while (true) {
+			size_t end = pattern.find('/', start);
+			if (end == std::string::npos) {
+				end = pattern.size();
+			}
+			std::string segment;
+			for (size_t i = start; i < end; i++) {
+				if (pattern[i] == '~' && i + 1 < end && (pattern[i + 1] == '0' || pattern[i + 1] == '1')) {
+					segment += pattern[++i] == '1' ? '/' : '~';
+				}
+				else {
+					segment += pattern[i];
+				}
+			}
+
+			// A bare "*" is the wildcard; "~2a" is not special, so a literal "*" key cannot be selected
+			size_t& child = segment == "*" ? nodes[node].wildcard : nodes[node].children[segment];
+			if (child == SIZE_MAX || child == 0) {
+				child = nodes.size();
+				nodes.emplace_back();
+			}
+			node = child;
+			if (end == pattern.size()) {
+				break;
+			}
+			start = end + 1;
+		}
+		nodes[node].terminal = true;
+	}
+	return simdjson::SUCCESS;
+}
+
+std::vector<std::string> Projection::split_patterns(std::string_view text) {
+	std::vector<std::string> patterns;
+	size_t start = 0;
+	while (start < text.size()) {
+		const size_t end = std::min(text.find_first_of(", \t\r\n", start), text.size());
+		if (end > start) {
+			patterns.emplace_back(text.substr(start, end - start));
+		}
+		start = end + 1;
+	}
+	return patterns;
+}
+
+void Projection::step(const std::vector<size_t>& states, std::string_view key, std::vector<size_t>& next, bool& terminal) const {
+	next.clear();
+	terminal = false;
+	for (const size_t state : states) {
+		const Node& node = nodes[state];
+		const auto child = node.children.find(key);
+		for (const size_t target : { child != node.children.end() ? child->second : SIZE_MAX, node.wildcard }) {
+			if (target != SIZE_MAX && std::find(next.begin(), next.end(), target) == next.end()) {
+				next.push_back(target);
+				terminal = terminal || nodes[target].terminal;
+			}
+		}
+	}
+}
+
+// Method: Iterates the document on demand and writes the projection of its root container
+simdjson::error_code Projection::project(simdjson::padded_string_view input, std::string& out) const {
+	simdjson::ondemand::parser parser;
+	simdjson::ondemand::document doc;
+	simdjson::error_code error = parser.iterate(input).get(doc);
+	if (error) {
+		return error;
+	}
+	simdjson::ondemand::json_type type;
+	error = doc.type().get(type);
+	if (error) {
+		return error;
+	}
+
+	out.clear();
+	if (nodes[0].terminal) {
+		std::string_view json;
+		error = simdjson::to_json_string(doc).get(json);
+		out.append(json);
+		return error;
+	}
+
+	const std::vector<size_t> root{ 0 };
+	bool emitted = false;
+	if (type == simdjson::ondemand::json_type::object) {
+		simdjson::ondemand::object object;
+		error = doc.get_object().get(object);
+		if (!error) {
+			error = project_object(object, root, out, emitted);
+		}
+		if (!emitted && !error) {
+			out = "{}";
+		}
+	}
+	else if (type == simdjson::ondemand::json_type::array) {
+		simdjson::ondemand::array array;
+		error = doc.get_array().get(array);
+		if (!error) {
+			error = project_array(array, root, out, emitted);
+		}
+		if (!emitted && !error) {
+			out = "[]";
+		}
+	}
+	else {
+		return simdjson::INCORRECT_TYPE;
+	}
+	return error;
+}
+
+// Method: Members no pattern can reach are never looked at, so the on-demand iterator skips them unparsed
+simdjson::error_code Projection::project_object(simdjson::ondemand::object object, const std::vector<size_t>& states, std::string& out, bool& emitted) const {
+	const size_t mark = out.size();
+	out += '{';
+	std::vector<size_t> next;
+	bool terminal;
+	bool any = false;
+	for (auto field : object) {
+		std::string_view key;
+		simdjson::error_code error = field.unescaped_key(false).get(key);
+		if (error) {
+			return error;
+		}
+		step(states, key, next, terminal);
+		if (next.empty()) {
+			continue;
+		}
+
+		const size_t memberMark = out.size();
+		if (any) {
+			out += ',';
+		}
+		append_json_string(out, key);
+		out += ':';
+		bool memberEmitted = false;
+		error = project_member(field.value(), next, terminal, out, memberEmitted);
+		if (error) {
+			return error;
+		}
+		if (memberEmitted) {
+			any = true;
+		}
+		else {
+			out.resize(memberMark);
+		}
+	}
+	if (!any) {
+		out.resize(mark);
+		emitted = false;
+		return simdjson::SUCCESS;
+	}
+	out += '}';
+	emitted = true;
+	return simdjson::SUCCESS;
+}
+
+simdjson::error_code Projection::project_array(simdjson::ondemand::array array, const std::vector<size_t>& states, std::string& out, bool& emitted) const {
+	const size_t mark = out.size();
+	out += '[';
+	std::vector<size_t> next;
+	bool terminal;
+	bool any = false;
+	size_t index = 0;
+	for (auto elementResult : array) {
+		simdjson::ondemand::value element;
+		simdjson::error_code error = elementResult.get(element);
+		if (error) {
+			return error;
+		}
+		step(states, std::to_string(index++), next, terminal);
+		if (next.empty()) {
+			continue;
+		}
+
+		const size_t elementMark = out.size();
+		if (any) {
+			out += ',';
+		}
+		bool elementEmitted = false;
+		error = project_member(element, next, terminal, out, elementEmitted);
+		if (error) {
+			return error;
+		}
+		if (elementEmitted) {
+			any = true;
+		}
+		else {
+			out.resize(elementMark);
+		}
+	}
+	if (!any) {
+		out.resize(mark);
+		emitted = false;
+		return simdjson::SUCCESS;
+	}
+	out += ']';
+	emitted = true;
+	return simdjson::SUCCESS;
+}
+
+simdjson::error_code Projection::project_member(simdjson::ondemand::value value, const std::vector<size_t>& next, bool terminal, std::string& out, bool& emitted) const {
+	emitted = false;
+	if (terminal) {
+		std::string_view json;
+		simdjson::error_code error = simdjson::to_json_string(value).get(json);
+		if (error) {
+			return error;
+		}
+		out.append(json);
+		emitted = true;
+		return simdjson::SUCCESS;
+	}
+
+	// Patterns continue below this value, which only matters if it is a container
+	simdjson::ondemand::json_type type;
+	simdjson::error_code error = value.type().get(type);
+	if (error) {
+		return error;
+	}
+	if (type == simdjson::ondemand::json_type::object) {
+		simdjson::ondemand::object object;
+		error = value.get_object().get(object);
+		return error ? error : project_object(object, next, out, emitted);
+	}
+	if (type == simdjson::ondemand::json_type::array) {
+		simdjson::ondemand::array array;
+		error = value.get_array().get(array);
+		return error ? error : project_array(array, next, out, emitted);
+	}
+	return simdjson::SUCCESS;
+}
+
+// Method: Projects the mapped file into a string with room for simdjson's padding, so that it is parsed in place
+simdjson::simdjson_result<simdjson::dom::element> Projection::load(simdjson::dom::parser& parser, const std::string& path, size_t& projectedBytes) const {
+	std::string projected;
+	{
+		MappedInput input;
+		simdjson::error_code error = input.open(path);
+		if (error) {
+			return error;
+		}
+		error = project(input.data(), projected);
+		if (error) {
+			return error;
+		}
+	}
+	projectedBytes = projected.size();
+	projected.reserve(projected.size() + simdjson::SIMDJSON_PADDING);
+	return parser.parse(projected);
+}
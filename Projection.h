@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "simdjson.h"
+
+// Projection class, a set of path patterns selecting the parts of a document to keep, such as "/events/*/id".
+// Patterns are JSON Pointers in which a "*" segment matches any member or element. The input is iterated with
+// simdjson::ondemand, which skips subtrees that no pattern can reach without parsing them, and only the matched
+// values, with the members and elements leading to them, are written out and parsed into a reduced document.
+class Projection
+{
+public:
+    // Replaces the patterns. Returns INVALID_JSON_POINTER if a pattern is neither empty (the whole document) nor
+    // starts with '/'.
+    simdjson::error_code set_patterns(const std::vector<std::string>& patterns);
+
+    // Splits a list of patterns separated by commas, spaces or line breaks
+    static std::vector<std::string> split_patterns(std::string_view text);
+
+    // Writes the projected document to 'out' as JSON. Objects keep the members leading to a match and arrays the
+    // elements leading to a match, in document order (so array indices are not preserved); containers without
+    // any match are left out, and the root is kept even if empty.
+    simdjson::error_code project(simdjson::padded_string_view input, std::string& out) const;
+
+    // Maps 'path', projects it and parses the projection with 'parser'. The input is read from the page cache rather
+    // than copied into memory, and it is unmapped with the on-demand parser's index before the reduced document is
+    // parsed. 'projectedBytes' receives the projection's size.
+    simdjson::simdjson_result<simdjson::dom::element> load(simdjson::dom::parser& parser, const std::string& path, size_t& projectedBytes) const;
+
+private:
+    // Patterns as a trie over path segments; node 0 is the root
+    struct Node {
+        std::map<std::string, size_t, std::less<>> children;
+        size_t wildcard = SIZE_MAX;
+        bool terminal = false;
+    };
+    std::vector<Node> nodes{ Node() };
+
+    // Trie nodes reached after following 'key' from every node in 'states'; sets 'terminal' if one is a pattern end
+    void step(const std::vector<size_t>& states, std::string_view key, std::vector<size_t>& next, bool& terminal) const;
+
+    // Write the projection of a container reached in 'states'; 'emitted' tells whether anything matched
+    simdjson::error_code project_object(simdjson::ondemand::object object, const std::vector<size_t>& states, std::string& out, bool& emitted) const;
+    simdjson::error_code project_array(simdjson::ondemand::array array, const std::vector<size_t>& states, std::string& out, bool& emitted) const;
+
+    // Writes 'value' whole if a pattern ends at it, or its projection if patterns continue below it
+    simdjson::error_code project_member(simdjson::ondemand::value value, const std::vector<size_t>& next, bool terminal, std::string& out, bool& emitted) const;
+};
@@ -0,0 +1,752 @@
+#include "Redactor.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+	uint64_t rotate(uint64_t x, int bits) {
+		return (x << bits) | (x >> (64 - bits));
+	}
+
+	// SipHash-2-4 of 'data' under a 128-bit key
+	uint64_t siphash(const uint64_t key[2], std::string_view data) {
+		uint64_t v0 = 0x736f6d6570736575ULL ^ key[0];
+		uint64_t v1 = 0x646f72616e646f6dULL ^ key[1];
+		uint64_t v2 = 0x6c7967656e657261ULL ^ key[0];
+		uint64_t v3 = 0x7465646279746573ULL ^ key[1];
+		auto round = [&]() {
+			v0 += v1; v1 = rotate(v1, 13); v1 ^= v0; v0 = rotate(v0, 32);
+			v2 += v3; v3 = rotate(v3, 16); v3 ^= v2;
+			v0 += v3; v3 = rotate(v3, 21); v3 ^= v0;
+			v2 += v1; v1 = rotate(v1, 17); v1 ^= v2; v2 = rotate(v2, 32);
+		};
+		const size_t blocks = data.size() / 8;
+		for (size_t i = 0; i < blocks; i++) {
+			uint64_t m = 0;
+			for (int b = 0; b < 8; b++) {
+				m |= uint64_t(static_cast<unsigned char>(data[i * 8 + b])) << (8 * b);
+			}
+			v3 ^= m;
+			round();
+			round();
+			v0 ^= m;
+		}
+		uint64_t last = uint64_t(data.size()) << 56;
+		for (size_t b = 0; b < data.size() % 8; b++) {
+			last |= uint64_t(static_cast<unsigned char>(data[blocks * 8 + b])) << (8 * b);
+		}
+		v3 ^= last;
+		round();
+		round();
+		v0 ^= last;
+		v2 ^= 0xff;
+		for (int i = 0; i < 4; i++) {
+			round();
+		}
+		return v0 ^ v1 ^ v2 ^ v3;
+	}
+
+	// Number of code points of a UTF-8 string: the bytes that do not continue a sequence
+	size_t code_points(std::string_view text) {
+		size_t count = 0;
+		for (unsigned char c : text) {
+			count += (c & 0xC0) != 0x80 ? 1 : 0;
+		}
+		return count;
+	}
+
+	// The longest run of text every match of an expression contains, or nothing if none could be found. Only
+	// characters outside groups and classes and not made optional by a quantifier count; expressions with
+	// alternatives have none.
+	std::string required_literal(std::string_view pattern) {
+		if (pattern.find('|') != std::string_view::npos) {
+			return std::string();
+		}
+		std::string best, run;
+		auto end_run = [&]() {
+			if (run.size() > best.size()) {
+				best = run;
+			}
+			run.clear();
+		};
+		auto optional_next = [&](size_t i) {
+			return i < pattern.size() && (pattern[i] == '*' || pattern[i] == '?' || pattern[i] == '{');
+		};
+		int depth = 0;
+		for (size_t i = 0; i < pattern.size(); i++) {
+			const char c = pattern[i];
+			if (c == '[') {
+				end_run();
+				for (i++; i < pattern.size() && pattern[i] != ']'; i++) {
+					i += pattern[i] == '\\' ? 1 : 0;
+				}
+			}
+			else if (c == '(' || c == ')') {
+				end_run();
+				depth += c == '(' ? 1 : -1;
+			}
+			else if (c == '\\' && i + 1 < pattern.size()) {
+				const char escaped = pattern[++i];
+				if (std::isalnum(static_cast<unsigned char>(escaped)) || depth > 0 || optional_next(i + 1)) {
+					end_run();
+				}
+				else {
+					run += escaped;
+				}
+			}
+			else if (std::strchr(".^$*+?{}", c) != nullptr) {
+				end_run();
+			}
+			else if (depth > 0 || optional_next(i + 1)) {
+				end_run();
+			}
+			else {
+				run += c;
+			}
+		}
+		end_run();
+		return best;
+	}
+}
+
+// Writer class, formats the pieces of a chunk with the rules applied
+class Redactor::Writer
+{
+public:
+	explicit Writer(const Redactor& redactor) : redactor(redactor) {}
+
+	void piece(const Piece& piece) {
+		flush();
+		out += piece.text;
+		if (piece.hasValue) {
+			const Output output = decide(piece.value, piece.action, piece.masked);
+			emit(output, piece.value, piece.states, piece.action, piece.masked, 0);
+		}
+	}
+
+	// The formatted text, and the values dropped, hashed and masked in it
+	std::string take() {
+		flush();
+		return std::move(out);
+	}
+	uint64_t dropped = 0, hashed = 0, masked = 0;
+
+private:
+	enum class Output { KEEP, DROP, STRING, ZERO };
+
+	const Redactor& redactor;
+	simdjson::internal::mini_formatter format;
+	std::string out;
+	std::string replacement;
+	std::string key;
+	std::deque<std::vector<size_t>> stateStack;    // Trie states by depth; a deque, as growing it keeps them in place
+
+	void flush() {
+		const std::string_view text = format.str();
+		out.append(text.data(), text.size());
+		format.clear();
+	}
+
+	// Method: Decides how a value is written; a replacement string is left in 'replacement'
+	Output decide(simdjson::dom::element value, Action action, bool masked) {
+		if (action == DROP) {
+			dropped++;
+			return Output::DROP;
+		}
+		if (action == HASH) {
+			hashed++;
+			replacement = value.is_string() ? redactor.hash_text(std::string_view(value)) : redactor.hash_text(simdjson::minify(value));
+			return Output::STRING;
+		}
+		const bool maskAll = masked || action == MASK;
+		switch (value.type()) {
+		case simdjson::dom::element_type::STRING: {
+			const std::string_view text(value);
+			if (maskAll) {
+				this->masked++;
+				replacement.assign(code_points(text), '*');
+				return Output::STRING;
+			}
+			return apply_value_rules(text);
+		}
+		case simdjson::dom::element_type::INT64:
+		case simdjson::dom::element_type::UINT64:
+		case simdjson::dom::element_type::DOUBLE:
+			if (maskAll) {
+				this->masked++;
+				return Output::ZERO;
+			}
+			return Output::KEEP;
+		default:
+			return Output::KEEP;
+		}
+	}
+
+	// Method: Expressions are applied in order of precedence; each replaces its matches in the result of the
+	// previous ones
+	Output apply_value_rules(std::string_view text) {
+		bool replaced = false;
+		for (const ValueRule& rule : redactor.valueRules) {
+			const std::string_view current = replaced ? std::string_view(replacement) : text;
+			if (!rule.literal.empty() && current.find(rule.literal) == std::string_view::npos) {
+				continue;
+			}
+			if (rule.action == DROP) {
+				if (std::regex_search(current.begin(), current.end(), *rule.pattern)) {
+					dropped++;
+					return Output::DROP;
+				}
+				continue;
+			}
+			std::string result;
+			auto last = current.begin();
+			bool matched = false;
+			for (std::regex_iterator<std::string_view::const_iterator> match(current.begin(), current.end(), *rule.pattern), end; match != end; ++match) {
+				const auto& whole = (*match)[0];
+				if (whole.length() == 0) {
+					continue;
+				}
+				result.append(last, whole.first);
+				const std::string_view found(&*whole.first, size_t(whole.length()));
+				if (rule.action == HASH) {
+					result += redactor.hash_text(found);
+					hashed++;
+				}
+				else {
+					result.append(code_points(found), '*');
+					masked++;
+				}
+				last = whole.second;
+				matched = true;
+			}
+			if (matched) {
+				result.append(last, current.end());
+				replacement = std::move(result);
+				replaced = true;
+			}
+		}
+		return replaced ? Output::STRING : Output::KEEP;
+	}
+
+	void emit(Output output, simdjson::dom::element value, const std::vector<size_t>& states, Action action, bool masked, size_t depth) {
+		switch (output) {
+		case Output::DROP:
+			return;
+		case Output::STRING:
+			format.string(replacement);
+			return;
+		case Output::ZERO:
+			format.number(int64_t(0));
+			return;
+		case Output::KEEP:
+			break;
+		}
+		const bool maskChildren = masked || action == MASK;
+		if (stateStack.size() <= depth + 1) {
+			stateStack.resize(depth + 2);
+		}
+		std::vector<size_t>& next = stateStack[depth + 1];
+		switch (value.type()) {
+		case simdjson::dom::element_type::ARRAY: {
+			format.start_array();
+			bool first = true;
+			size_t index = 0;
+			const bool keyed = redactor.keyedSteps && std::any_of(states.begin(), states.end(), [&](size_t state) { return !redactor.nodes[state].children.empty(); });
+			for (simdjson::dom::element child : simdjson::dom::array(value)) {
+				Action childAction = NONE;
+				if (!states.empty()) {
+					if (keyed) {
+						key = std::to_string(index);
+					}
+					redactor.step(states, key, next, childAction);
+				}
+				else {
+					next.clear();
+				}
+				index++;
+				const Output childOutput = decide(child, childAction, maskChildren);
+				if (childOutput == Output::DROP) {
+					continue;
+				}
+				if (!first) {
+					format.comma();
+				}
+				first = false;
+				emit(childOutput, child, next, childAction, maskChildren, depth + 1);
+			}
+			format.end_array();
+			break;
+		}
+		case simdjson::dom::element_type::OBJECT: {
+			format.start_object();
+			bool first = true;
+			for (auto [name, child] : simdjson::dom::object(value)) {
+				Action childAction = NONE;
+				if (!states.empty()) {
+					redactor.step(states, name, next, childAction);
+				}
+				else {
+					next.clear();
+				}
+				const Output childOutput = decide(child, childAction, maskChildren);
+				if (childOutput == Output::DROP) {
+					continue;
+				}
+				if (!first) {
+					format.comma();
+				}
+				first = false;
+				format.key(name);
+				emit(childOutput, child, next, childAction, maskChildren, depth + 1);
+			}
+			format.end_object();
+			break;
+		}
+		case simdjson::dom::element_type::INT64:
+			format.number(int64_t(value));
+			break;
+		case simdjson::dom::element_type::UINT64:
+			format.number(uint64_t(value));
+			break;
+		case simdjson::dom::element_type::DOUBLE:
+			format.number(double(value));
+			break;
+		case simdjson::dom::element_type::STRING:
+			format.string(std::string_view(value));
+			break;
+		case simdjson::dom::element_type::BOOL:
+			if (bool(value)) {
+				format.true_atom();
+			}
+			else {
+				format.false_atom();
+			}
+			break;
+		case simdjson::dom::element_type::NULL_VALUE:
+			format.null_atom();
+			break;
+		}
+	}
+};
+
+simdjson::error_code Redactor::load_rules(const std::string& path) {
+	simdjson::padded_string text;
+	simdjson::error_code error = simdjson::padded_string::load(path).get(text);
+	if (error) {
+		errorMessage = "cannot read the rules";
+		return error;
+	}
+	return set_rules(std::string_view(text.data(), text.size()));
+}
+
+// Method: Path patterns go into the trie like Projection's, with the JSON Pointer escapes ~1 and ~0 decoded in
+// each segment. Blank lines and lines starting with '#' are skipped.
+simdjson::error_code Redactor::set_rules(std::string_view text) {
+	nodes.assign(1, Node());
+	valueRules.clear();
+	keyedSteps = false;
+	hashKey[0] = hashKey[1] = 0;
+	errorMessage.clear();
+
+	size_t lineNumber = 0;
+	size_t start = 0;
+	while (start <= text.size()) {
+		size_t end = text.find('\n', start);
+		if (end == std::string_view::npos) {
+			end = text.size();
+		}
+		std::string_view line = text.substr(start, end - start);
+		start = end + 1;
+		lineNumber++;
+		while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) {
+			line.remove_suffix(1);
+		}
+		while (!line.empty() && (line.front() == ' ' || line.front() == '\t')) {
+			line.remove_prefix(1);
+		}
+		if (line.empty() || line.front() == '#') {
+			continue;
+		}
+		const size_t space = std::min(line.find(' '), line.find('\t'));
+		const std::string_view word = line.substr(0, space);
+		std::string_view target = space == std::string_view::npos ? std::string_view() : line.substr(space + 1);
+		while (!target.empty() && (target.front() == ' ' || target.front() == '\t')) {
+			target.remove_prefix(1);
+		}
+		auto fail = [&](const std::string& reason, simdjson::error_code error) {
+			errorMessage = "line " + std::to_string(lineNumber) + ": " + reason;
+			return error;
+		};
+
+		if (word == "salt") {
+			// Short salts are the key; longer ones are hashed into one
+			const uint64_t zero[2] = { 0, 0 };
+			if (target.size() <= sizeof(hashKey)) {
+				std::memcpy(hashKey, target.data(), target.size());
+			}
+			else {
+				hashKey[0] = siphash(zero, target);
+				hashKey[1] = siphash(hashKey, target);
+			}
+			continue;
+		}
+		const Action action = word == "drop" ? DROP : word == "hash" ? HASH : word == "mask" ? MASK : NONE;
+		if (action == NONE) {
+			return fail("unknown action \"" + std::string(word) + "\"", simdjson::INCORRECT_TYPE);
+		}
+
+		if (!target.empty() && target.front() == '~') {
+			ValueRule rule;
+			rule.action = action;
+			try {
+				rule.pattern = std::make_shared<std::regex>(std::string(target.substr(1)), std::regex::ECMAScript | std::regex::optimize);
+			}
+			catch (const std::regex_error&) {
+				return fail("invalid expression", simdjson::INCORRECT_TYPE);
+			}
+			rule.literal = required_literal(target.substr(1));
+			valueRules.push_back(std::move(rule));
+			continue;
+		}
+		if (!target.empty() && target.front() != '/') {
+			return fail("a path must start with '/'", simdjson::INVALID_JSON_POINTER);
+		}
+
+		size_t node = 0;
+		size_t segmentStart = 1;
+		while (segmentStart <= target.size()) {
+			size_t segmentEnd = target.find('/', segmentStart);
+			if (segmentEnd == std::string_view::npos) {
+				segmentEnd = target.size();
+			}
+			std::string segment;
+			for (size_t i = segmentStart; i < segmentEnd; i++) {
+				if (target[i] == '~' && i + 1 < segmentEnd && (target[i + 1] == '0' || target[i + 1] == '1')) {
+					segment += target[++i] == '1' ? '/' : '~';
+				}
+				else {
+					segment += target[i];
+				}
+			}
+			size_t child;
+			if (segment == "*" || segment == "**") {
+				const bool globstar = segment == "**";
+				child = globstar ? nodes[node].globstar : nodes[node].wildcard;
+				if (child == SIZE_MAX) {
+					child = nodes.size();
+					(globstar ? nodes[node].globstar : nodes[node].wildcard) = child;
+					nodes.emplace_back();
+					nodes.back().isGlobstar = globstar;
+				}
+			}
+			else {
+				auto found = nodes[node].children.find(segment);
+				if (found == nodes[node].children.end()) {
+					child = nodes.size();
+					nodes[node].children.emplace(segment, child);
+					nodes.emplace_back();
+				}
+				else {
+					child = found->second;
+				}
+				keyedSteps = true;
+			}
+			node = child;
+			segmentStart = segmentEnd + 1;
+		}
+		nodes[node].action = std::max(nodes[node].action, action);
+	}
+
+	// Drops first, so that dropped strings are not hashed or masked in vain
+	std::stable_sort(valueRules.begin(), valueRules.end(), [](const ValueRule& a, const ValueRule& b) { return a.action > b.action; });
+	return simdjson::SUCCESS;
+}
+
+// Method: "**" states are kept on every step and also entered without consuming a segment
+void Redactor::step(const std::vector<size_t>& states, std::string_view key, std::vector<size_t>& next, Action& action) const {
+	next.clear();
+	auto add = [&](size_t state) {
+		if (std::find(next.begin(), next.end(), state) == next.end()) {
+			next.push_back(state);
+		}
+	};
+	for (size_t state : states) {
+		const Node& node = nodes[state];
+		if (node.isGlobstar) {
+			add(state);
+		}
+		if (!node.children.empty()) {
+			auto found = node.children.find(key);
+			if (found != node.children.end()) {
+				add(found->second);
+			}
+		}
+		if (node.wildcard != SIZE_MAX) {
+			add(node.wildcard);
+		}
+	}
+	close_states(next);
+	action = NONE;
+	for (size_t state : next) {
+		action = std::max(action, nodes[state].action);
+	}
+}
+
+void Redactor::close_states(std::vector<size_t>& states) const {
+	for (size_t i = 0; i < states.size(); i++) {
+		const size_t globstar = nodes[states[i]].globstar;
+		if (globstar != SIZE_MAX && std::find(states.begin(), states.end(), globstar) == states.end()) {
+			states.push_back(globstar);
+		}
+	}
+}
+
+bool Redactor::drops(simdjson::dom::element value, Action action) const {
+	bool dropped = action == DROP;
+	if (!dropped && action != HASH && value.is_string()) {
+		const std::string_view text(value);
+		for (const ValueRule& rule : valueRules) {
+			if (rule.action == DROP && (rule.literal.empty() || text.find(rule.literal) != std::string_view::npos)
+				&& std::regex_search(text.begin(), text.end(), *rule.pattern)) {
+				dropped = true;
+				break;
+			}
+		}
+	}
+	droppedCount += dropped ? 1 : 0;
+	return dropped;
+}
+
+simdjson::error_code Redactor::write(simdjson::dom::element root, const std::string& path, unsigned threads) {
+	return export_values(std::vector<simdjson::dom::element>{ root }, false, path, threads);
+}
+
+simdjson::error_code Redactor::write_each(const std::vector<simdjson::dom::element>& records, const std::string& path, unsigned threads) {
+	return export_values(records, true, path, threads);
+}
+
+// Method: Chunks cover about an eighth of a thread's share of the document, so that threads finishing early can
+// take more, but no more than MAX_CHUNK_WORDS, which bounds the memory of the chunks waiting to be written
+simdjson::error_code Redactor::export_values(const std::vector<simdjson::dom::element>& values, bool lines, const std::string& path, unsigned threads) {
+	const auto start = std::chrono::steady_clock::now();
+	threads = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+	droppedCount = 0;
+	hashedCount = 0;
+	maskedCount = 0;
+	bytesWritten = 0;
+
+	size_t totalWords = 0;
+	for (simdjson::dom::element value : values) {
+		totalWords += words_of(value);
+	}
+	const size_t budget = std::clamp<size_t>(totalWords / (size_t(threads) * 8), 4096, MAX_CHUNK_WORDS);
+	std::vector<Chunk> chunks(1);
+	size_t chunkWords = 0;
+	std::string text;
+	std::vector<size_t> rootStates{ 0 };
+	close_states(rootStates);
+	Action rootAction = NONE;
+	for (size_t state : rootStates) {
+		rootAction = std::max(rootAction, nodes[state].action);
+	}
+	for (simdjson::dom::element value : values) {
+		// A dropped document is written as null, so that the output stays JSON and records keep their lines
+		if (drops(value, rootAction)) {
+			text += "null";
+		}
+		else {
+			plan(value, rootStates, rootAction, false, text, budget, chunks, chunkWords);
+		}
+		if (lines) {
+			text += '\n';
+		}
+	}
+	if (!text.empty()) {
+		Piece piece;
+		piece.text = std::move(text);
+		chunks.back().push_back(std::move(piece));
+	}
+
+	simdjson::error_code error = write_chunks(chunks, path, threads);
+	elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return error;
+}
+
+// Method: Keys and commas of the containers split are written here, so their children dropped are decided here
+void Redactor::plan(simdjson::dom::element value, const std::vector<size_t>& states, Action action, bool masked, std::string& text, size_t budget, std::vector<Chunk>& chunks, size_t& chunkWords) {
+	const bool isArray = value.is_array();
+	const bool isObject = value.is_object();
+	const size_t words = isArray || isObject ? words_of(value) : 1;
+	if (words <= budget || action != NONE) {
+		Piece piece;
+		piece.text = std::move(text);
+		text.clear();
+		piece.hasValue = true;
+		piece.value = value;
+		piece.states = states;
+		piece.action = action;
+		piece.masked = masked;
+		chunks.back().push_back(std::move(piece));
+		chunkWords += words;
+		if (chunkWords >= budget) {
+			chunks.emplace_back();
+			chunkWords = 0;
+		}
+		return;
+	}
+
+	std::vector<size_t> next;
+	Action childAction = NONE;
+	bool first = true;
+	auto add_child = [&](std::string_view key, simdjson::dom::element child, bool named) {
+		next.clear();
+		childAction = NONE;
+		if (!states.empty()) {
+			step(states, key, next, childAction);
+		}
+		if (drops(child, childAction)) {
+			return;
+		}
+		if (!first) {
+			text += ',';
+		}
+		first = false;
+		if (named) {
+			simdjson::internal::mini_formatter format;
+			format.key(key);
+			text += format.str();
+		}
+		plan(child, next, childAction, masked, text, budget, chunks, chunkWords);
+	};
+	if (isArray) {
+		text += '[';
+		size_t index = 0;
+		std::string key;
+		for (simdjson::dom::element child : simdjson::dom::array(value)) {
+			if (keyedSteps) {
+				key = std::to_string(index++);
+			}
+			add_child(key, child, false);
+		}
+		text += ']';
+	}
+	else {
+		text += '{';
+		for (auto [key, child] : simdjson::dom::object(value)) {
+			add_child(key, child, true);
+		}
+		text += '}';
+	}
+}
+
+// Method: Threads take the chunks in turn, at most two per thread ahead of the one being written, and this thread
+// appends them to the file in order as they are done
+simdjson::error_code Redactor::write_chunks(std::vector<Chunk>& chunks, const std::string& path, unsigned threads) {
+	std::FILE* file = std::fopen(path.c_str(), "wb");
+	if (file == nullptr) {
+		return simdjson::IO_ERROR;
+	}
+	const size_t window = size_t(threads) * 2;
+	std::vector<std::string> outputs(chunks.size());
+	std::vector<char> done(chunks.size(), 0);
+	std::mutex mutex;
+	std::condition_variable changed;
+	size_t written = 0;
+	size_t next = 0;
+	auto worker = [&]() {
+		while (true) {
+			size_t chunk;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [&]() { return cancelled || next >= chunks.size() || next < written + window; });
+				if (cancelled || next >= chunks.size()) {
+					return;
+				}
+				chunk = next++;
+			}
+			Writer writer(*this);
+			for (const Piece& piece : chunks[chunk]) {
+				writer.piece(piece);
+			}
+			droppedCount += writer.dropped;
+			hashedCount += writer.hashed;
+			maskedCount += writer.masked;
+			std::string output = writer.take();
+			Chunk().swap(chunks[chunk]);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				outputs[chunk] = std::move(output);
+				done[chunk] = 1;
+			}
+			changed.notify_all();
+		}
+	};
+	std::vector<std::thread> workers;
+	for (unsigned i = 0; i < threads; i++) {
+		workers.emplace_back(worker);
+	}
+
+	bool ok = true;
+	for (size_t chunk = 0; chunk < chunks.size() && ok; chunk++) {
+		std::string output;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&]() { return cancelled || done[chunk]; });
+			if (cancelled) {
+				break;
+			}
+			output = std::move(outputs[chunk]);
+			written = chunk + 1;
+		}
+		changed.notify_all();
+		ok = std::fwrite(output.data(), 1, output.size(), file) == output.size();
+		bytesWritten += output.size();
+	}
+	if (!ok) {
+		cancelled = true;
+		changed.notify_all();
+	}
+	for (std::thread& thread : workers) {
+		thread.join();
+	}
+	ok = std::fclose(file) == 0 && ok && !cancelled;
+	if (!ok) {
+		std::remove(path.c_str());
+		return simdjson::IO_ERROR;
+	}
+	return simdjson::SUCCESS;
+}
+
+std::string Redactor::hash_text(std::string_view text) const {
+	char hex[20];
+	std::snprintf(hex, sizeof(hex), "#%016llx", static_cast<unsigned long long>(siphash(hashKey, text)));
+	return hex;
+}
+
+// Method: Arrays know their extent on the tape; objects are summed over their members, which only descends into
+// nested objects
+size_t Redactor::words_of(simdjson::dom::element value) {
+	switch (value.type()) {
+	case simdjson::dom::element_type::ARRAY:
+		return simdjson::dom::array(value).number_of_slots() + 1;
+	case simdjson::dom::element_type::OBJECT: {
+		size_t words = 2;
+		for (auto [key, child] : simdjson::dom::object(value)) {
+			words += 1 + words_of(child);
+		}
+		return words;
+	}
+	case simdjson::dom::element_type::INT64:
+	case simdjson::dom::element_type::UINT64:
+	case simdjson::dom::element_type::DOUBLE:
+		return 2;
+	default:
+		return 1;
+	}
+}
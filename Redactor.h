@@ -0,0 +1,126 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "simdjson.h"
+
+// Redactor class, writes a copy of a document with sensitive values removed or disguised, for sharing. Rules are read
+// from text, one per line: an action ("drop", "hash" or "mask") followed by a path pattern or by '~' and a regular
+// expression, for instance:
+//     drop /users/*/password
+//     hash /users/*/id
+//     mask /**/token
+//     mask ~[A-Za-z0-9._%+-]+@[A-Za-z0-9.-]+\.[A-Za-z]+
+//     salt some secret text
+// Path patterns are JSON Pointers in which "*" matches any one member or element and "**" any number of them, as
+// in Projection; a rule applies to the values its pattern ends at, whole. Expressions apply to every string value:
+// "drop" removes the strings they match, "hash" and "mask" replace the matched text only. "drop" removes a value
+// with its key, "hash" replaces it with a keyed hash of its JSON text (SipHash, keyed by the salt, so that equal
+// values stay equal without being guessable), and "mask" replaces the characters of strings with '*' and numbers
+// with 0, in all the values below a container. When several rules apply, drop wins over hash and hash over mask.
+// The document is written in chunks formatted on several threads and appended to the file in order.
+class Redactor
+{
+public:
+    // Values a chunk covers at most, in tape words; larger containers are split between chunks
+    static constexpr size_t MAX_CHUNK_WORDS = size_t(1) << 20;
+
+    // Reads the rules. Returns INVALID_JSON_POINTER for a malformed path pattern and INCORRECT_TYPE for an unknown
+    // action or an invalid expression; message() tells on which line.
+    simdjson::error_code set_rules(std::string_view text);
+    simdjson::error_code load_rules(const std::string& path);
+
+    // Writes the redacted document, or the redacted records as NDJSON, to 'path'. 'threads' is the number of
+    // formatting threads, 0 for one per core. Returns IO_ERROR if the file cannot be written or the export is
+    // cancelled, in which case the file is removed.
+    simdjson::error_code write(simdjson::dom::element root, const std::string& path, unsigned threads = 0);
+    simdjson::error_code write_each(const std::vector<simdjson::dom::element>& records, const std::string& path, unsigned threads = 0);
+
+    // Stops an export running on another thread; later exports with this redactor fail as cancelled
+    void cancel() { cancelled = true; }
+
+    // Statistics of the last export: values dropped, hashed and masked (by path or expression), bytes written, and
+    // its duration in seconds
+    uint64_t dropped() const { return droppedCount; }
+    uint64_t hashed() const { return hashedCount; }
+    uint64_t masked() const { return maskedCount; }
+    uint64_t bytes_written() const { return bytesWritten; }
+    double seconds() const { return elapsed; }
+
+    // Description of the last rule error
+    const std::string& message() const { return errorMessage; }
+
+private:
+    // Actions in increasing precedence
+    enum Action : int8_t { NONE = 0, MASK = 1, HASH = 2, DROP = 3 };
+
+    // Path patterns as a trie over path segments; node 0 is the root. A "**" node matches any number of segments.
+    struct Node {
+        std::map<std::string, size_t, std::less<>> children;
+        size_t wildcard = SIZE_MAX;
+        size_t globstar = SIZE_MAX;
+        bool isGlobstar = false;
+        Action action = NONE;
+    };
+    std::vector<Node> nodes{ Node() };
+    bool keyedSteps = false;   // Whether some pattern names a member or element, which needs the key to step
+
+    // Rules on string values, with a literal every match contains (if one could be found) to skip strings quickly
+    struct ValueRule {
+        Action action;
+        std::shared_ptr<std::regex> pattern;
+        std::string literal;
+    };
+    std::vector<ValueRule> valueRules;
+
+    uint64_t hashKey[2] = { 0, 0 };
+    std::string errorMessage;
+
+    std::atomic<bool> cancelled{ false };
+    mutable std::atomic<uint64_t> droppedCount{ 0 }, hashedCount{ 0 }, maskedCount{ 0 };
+    uint64_t bytesWritten = 0;
+    double elapsed = 0;
+
+    // A value to write, preceded by the text leading to it (commas, brackets, keys); a piece without a value is text
+    struct Piece {
+        std::string text;
+        bool hasValue = false;
+        simdjson::dom::element value;
+        std::vector<size_t> states;
+        Action action = NONE;
+        bool masked = false;
+    };
+    using Chunk = std::vector<Piece>;
+
+    class Writer;
+    friend class Writer;
+
+    // Trie states reached after following 'key' from 'states', with the strongest action of a pattern ending there
+    void step(const std::vector<size_t>& states, std::string_view key, std::vector<size_t>& next, Action& action) const;
+    void close_states(std::vector<size_t>& states) const;
+
+    // Writes the values, each followed by a line break if 'lines' is set
+    simdjson::error_code export_values(const std::vector<simdjson::dom::element>& values, bool lines, const std::string& path, unsigned threads);
+
+    // Splits a value into chunks: containers larger than 'budget' are opened and their children grouped, others
+    // become a piece of the current chunk. 'text' is the text leading to the value, taken by the next piece.
+    void plan(simdjson::dom::element value, const std::vector<size_t>& states, Action action, bool masked, std::string& text, size_t budget, std::vector<Chunk>& chunks, size_t& chunkWords);
+
+    // Formats the chunks on 'threads' threads and appends them to 'path' in order
+    simdjson::error_code write_chunks(std::vector<Chunk>& chunks, const std::string& path, unsigned threads);
+
+    // Whether a value is removed, by its path's action or by an expression; counts it if so
+    bool drops(simdjson::dom::element value, Action action) const;
+
+    // Keyed hash of some text, as written in place of hashed values
+    std::string hash_text(std::string_view text) const;
+
+    // Approximate size of a value on the tape
+    static size_t words_of(simdjson::dom::element value);
+};
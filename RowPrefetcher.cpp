@@ -0,0 +1,163 @@
+#include "RowPrefetcher.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+RowPrefetcher::RowPrefetcher(Formatter formatter)
+	: formatter(std::move(formatter))
+{
+	worker = std::thread([this]() { run(); });
+}
+
+RowPrefetcher::~RowPrefetcher() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		pending.clear();
+	}
+	changed.notify_all();
+	worker.join();
+}
+
+bool RowPrefetcher::request(const void* key, simdjson::dom::element element) {
+	size_t count;
+	if (element.is_object()) {
+		count = simdjson::dom::object(element).size();
+	}
+	else if (element.is_array()) {
+		count = simdjson::dom::array(element).size();
+	}
+	else {
+		return false;
+	}
+	if (count == 0 || count > MAX_ROWS_PER_REQUEST) {
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto queued = std::find_if(pending.begin(), pending.end(), [key](const Request& request) { return request.key == key; });
+		if (cache.count(key) || running == key || queued != pending.end()) {
+			return false;
+		}
+		pending.push_back(Request{ key, element });
+		if (pending.size() > MAX_PENDING) {
+			pending.pop_front();
+		}
+	}
+	changed.notify_all();
+	return true;
+}
+
+bool RowPrefetcher::take(const void* key, std::vector<Row>& rows) {
+	std::lock_guard<std::mutex> lock(mutex);
+	const auto found = cache.find(key);
+	if (found == cache.end()) {
+		// Rows still queued or being formatted would arrive after the item has been filled
+		pending.erase(std::remove_if(pending.begin(), pending.end(), [key](const Request& request) { return request.key == key; }), pending.end());
+		if (running == key) {
+			generation++;
+		}
+		missCount++;
+		return false;
+	}
+	rows = std::move(found->second);
+	cachedRows -= rows.size();
+	cache.erase(found);
+	cacheOrder.erase(std::find(cacheOrder.begin(), cacheOrder.end(), key));
+	hitCount++;
+	return true;
+}
+
+void RowPrefetcher::forget(const void* key) {
+	std::lock_guard<std::mutex> lock(mutex);
+	pending.erase(std::remove_if(pending.begin(), pending.end(), [key](const Request& request) { return request.key == key; }), pending.end());
+	const auto found = cache.find(key);
+	if (found != cache.end()) {
+		cachedRows -= found->second.size();
+		wastedRows += found->second.size();
+		cache.erase(found);
+		cacheOrder.erase(std::find(cacheOrder.begin(), cacheOrder.end(), key));
+	}
+
+	// The item's address may be reused by a new item, so rows being formatted for it are dropped
+	if (running == key) {
+		generation++;
+	}
+}
+
+// Method: Invalidates the request in progress and waits for it, so that its element is no longer read afterwards
+size_t RowPrefetcher::clear() {
+	std::unique_lock<std::mutex> lock(mutex);
+	const size_t rows = cachedRows;
+	wastedRows += rows;
+	pending.clear();
+	cache.clear();
+	cacheOrder.clear();
+	cachedRows = 0;
+	generation++;
+	changed.wait(lock, [this]() { return running == nullptr; });
+	return rows * ROW_BYTES_ESTIMATE;
+}
+
+void RowPrefetcher::trim_cache() {
+	while (cachedRows > MAX_CACHED_ROWS && !cacheOrder.empty()) {
+		const auto oldest = cache.find(cacheOrder.front());
+		cachedRows -= oldest->second.size();
+		wastedRows += oldest->second.size();
+		cache.erase(oldest);
+		cacheOrder.pop_front();
+	}
+}
+
+// Method: Runs at idle priority, so prefetching never competes with the UI thread or a parse for a core
+void RowPrefetcher::run() {
+#ifdef _WIN32
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_IDLE);
+#elif defined(__linux__)
+	sched_param parameters{};
+	pthread_setschedparam(pthread_self(), SCHED_IDLE, &parameters);
+#endif
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		changed.wait(lock, [this]() { return stopping || !pending.empty(); });
+		if (stopping) {
+			return;
+		}
+		const Request request = pending.back();
+		pending.pop_back();
+		running = request.key;
+		const uint64_t requestGeneration = generation;
+		lock.unlock();
+
+		std::vector<Row> rows;
+		if (request.element.is_object()) {
+			for (auto [key, value] : simdjson::dom::object(request.element)) {
+				rows.push_back(Row{ formatter(std::string(key), value), value });
+			}
+		}
+		else {
+			size_t index = 0;
+			for (simdjson::dom::element value : simdjson::dom::array(request.element)) {
+				rows.push_back(Row{ formatter(std::to_string(index++), value), value });
+			}
+		}
+
+		lock.lock();
+		running = nullptr;
+		if (generation == requestGeneration) {
+			cachedRows += rows.size();
+			cache[request.key] = std::move(rows);
+			cacheOrder.push_back(request.key);
+			trim_cache();
+		}
+		changed.notify_all();
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <QString>
+#include "simdjson.h"
+
+// RowPrefetcher class, formats the rows of elements that are likely to be expanded soon (under the mouse, or in the
+// pages the view is scrolling towards) on a low-priority background thread, so that expanding them only has to
+// create the items. Requests are keyed by the tree item that will show the rows; the latest requests are served
+// first and speculative work is capped by the number of requests queued, the size of a request and the number of
+// rows kept.
+// Elements must stay valid while requested: clear() has to be called before the documents they belong to are
+// released.
+class RowPrefetcher
+{
+public:
+    // Requests kept in the queue; older ones are dropped first
+    static constexpr size_t MAX_PENDING = 64;
+
+    // Containers with more children are not prefetched
+    static constexpr size_t MAX_ROWS_PER_REQUEST = 10000;
+
+    // Rows kept ready at most; the oldest prefetched containers are dropped first
+    static constexpr size_t MAX_CACHED_ROWS = 200000;
+
+    // Approximate memory of a prefetched row, used to report what clear() releases
+    static constexpr size_t ROW_BYTES_ESTIMATE = 96;
+
+    // A formatted child: its text and the element it shows
+    struct Row {
+        QString text;
+        simdjson::dom::element element;
+    };
+
+    // Formats the row of a child from its key (or index) and value
+    using Formatter = std::function<QString(const std::string& key, simdjson::dom::element value)>;
+
+    explicit RowPrefetcher(Formatter formatter);
+    ~RowPrefetcher();
+
+    // Queues the children of 'element' for 'key'. Returns false if they are already prefetched or queued, or if
+    // the element is not a container or is too large.
+    bool request(const void* key, simdjson::dom::element element);
+
+    // Moves the rows prefetched for 'key' into 'rows' and counts a hit; counts a miss if there are none
+    bool take(const void* key, std::vector<Row>& rows);
+
+    // Drops the rows and requests of 'key', whose item is going away
+    void forget(const void* key);
+
+    // Drops all rows and requests and waits for the one being formatted. Returns the approximate bytes released.
+    size_t clear();
+
+    // Expansions served from prefetched rows, expansions that were not, and prefetched rows dropped unused
+    uint64_t hits() const { return hitCount; }
+    uint64_t misses() const { return missCount; }
+    uint64_t wasted_rows() const { return wastedRows; }
+
+private:
+    struct Request {
+        const void* key;
+        simdjson::dom::element element;
+    };
+
+    Formatter formatter;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Request> pending;
+    std::map<const void*, std::vector<Row>> cache;
+    std::deque<const void*> cacheOrder;
+    size_t cachedRows = 0;
+    const void* running = nullptr;
+    uint64_t generation = 0;
+    bool stopping = false;
+
+    uint64_t hitCount = 0;
+    uint64_t missCount = 0;
+    uint64_t wastedRows = 0;
+
+    // Serves the latest requests until stopped
+    void run();
+
+    // Drops the oldest prefetched containers until at most MAX_CACHED_ROWS rows are kept; called with 'mutex' held
+    void trim_cache();
+};
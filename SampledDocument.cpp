@@ -0,0 +1,298 @@
+#include "SampledDocument.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include <set>
+#include "TopLevelScanner.h"
+
+namespace {
+
+	inline bool is_space(char c) {
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+	}
+
+	inline bool is_bracket(char c) {
+		return c == '{' || c == '[' || c == '}' || c == ']';
+	}
+
+	// End of the value starting at 'text[start]', or npos if 'text' ends first. Containers end at their matching
+	// bracket, scalars at the first delimiter outside strings.
+	size_t value_end(std::string_view text, size_t start) {
+		size_t depth = 0;
+		bool inString = false;
+		for (size_t pos = start; pos < text.size(); pos++) {
+			const char c = text[pos];
+			if (inString) {
+				if (c == '\\') {
+					pos++;
+				}
+				else if (c == '"') {
+					inString = false;
+					if (depth == 0) {
+						return pos + 1;
+					}
+				}
+			}
+			else if (c == '"') {
+				inString = true;
+			}
+			else if (c == '{' || c == '[') {
+				depth++;
+			}
+			else if (c == '}' || c == ']') {
+				if (depth == 0) {
+					return pos;
+				}
+				if (--depth == 0) {
+					return pos + 1;
+				}
+			}
+			else if (depth == 0 && (c == ',' || is_space(c))) {
+				return pos;
+			}
+		}
+		return std::string_view::npos;
+	}
+
+	std::string_view trim(std::string_view text) {
+		while (!text.empty() && is_space(text.front())) {
+			text.remove_prefix(1);
+		}
+		while (!text.empty() && is_space(text.back())) {
+			text.remove_suffix(1);
+		}
+		return text;
+	}
+}
+
+std::string SampledDocument::read_at(std::FILE* fp, uint64_t offset, size_t size) {
+#ifdef _WIN32
+	const bool seeked = _fseeki64(fp, int64_t(offset), SEEK_SET) == 0;
+#else
+	const bool seeked = fseeko(fp, off_t(offset), SEEK_SET) == 0;
+#endif
+	std::string data;
+	if (seeked) {
+		data.resize(size);
+		data.resize(std::fread(data.data(), 1, size, fp));
+	}
+	return data;
+}
+
+// Method: Resynchronizes on the next line break, or on the next occurrence of the array's separator, and checks that
+// the value found there is followed by the end of a line, or by a comma or the end of the array
+bool SampledDocument::find_record(std::string_view window, uint64_t base, Candidate& candidate, bool& incomplete) {
+	const bool atEnd = base + window.size() >= fileSize;
+	incomplete = false;
+	size_t start;
+	size_t end;
+	if (ndjson) {
+		size_t lineBreak = window.find('\n');
+		while (true) {
+			if (lineBreak == std::string_view::npos) {
+				incomplete = !atEnd;
+				return false;
+			}
+			start = lineBreak + 1;
+			lineBreak = window.find('\n', start);
+			if (lineBreak == std::string_view::npos && !atEnd) {
+				incomplete = true;
+				return false;
+			}
+			end = std::min(lineBreak, window.size());
+			const std::string_view line = trim(window.substr(start, end - start));
+			if (!line.empty()) {
+				start = size_t(line.data() - window.data());
+				end = start + line.size();
+				break;
+			}
+		}
+	}
+	else {
+		const size_t found = window.find(separator);
+		if (found == std::string_view::npos) {
+			incomplete = !atEnd;
+			return false;
+		}
+		start = found + separator.size() - (is_bracket(separator.back()) ? 1 : 0);
+		end = value_end(window, start);
+		if (end == std::string_view::npos) {
+			incomplete = !atEnd;
+			return false;
+		}
+		size_t next = end;
+		while (next < window.size() && is_space(window[next])) {
+			next++;
+		}
+		if (next >= window.size()) {
+			incomplete = !atEnd;
+			return false;
+		}
+		if ((window[next] != ',' && window[next] != ']') || window.substr(start, end - start).substr(0, recordPrefix.size()) != recordPrefix) {
+			return false;
+		}
+	}
+
+	const std::string_view text = window.substr(start, end - start);
+	if (validator.parse(text.data(), text.size()).error()) {
+		return false;
+	}
+	candidate.offset = base + start;
+	candidate.text.assign(text);
+	return true;
+}
+
+// Method: Reads the head of the file to tell arrays from NDJSON and to learn the array's separator. Files whose
+// records all lie in the head are sampled exactly; others are sampled at random offsets in file order.
+simdjson::error_code SampledDocument::load(const std::string& path, size_t count, uint64_t seed) {
+	const auto startTime = std::chrono::steady_clock::now();
+	records.clear();
+	offsets.clear();
+	exact = false;
+	std::error_code ec;
+	fileSize = uint64_t(std::filesystem::file_size(path, ec));
+	if (ec) {
+		return simdjson::IO_ERROR;
+	}
+	std::FILE* fp = std::fopen(path.c_str(), "rb");
+	if (fp == nullptr) {
+		return simdjson::IO_ERROR;
+	}
+
+	// Scan the head, growing it until the first two elements of an array, or the first two values of NDJSON, are
+	// delimited. A single value other than an array cannot be sampled.
+	TopLevelScanner scanner;
+	std::string head;
+	size_t secondValue = std::string::npos;
+	for (size_t headSize = WINDOW_SIZE; ; headSize *= 2) {
+		head = read_at(fp, 0, headSize);
+		scanner.feed(head.data(), head.size(), head.size() >= fileSize);
+		if (scanner.root_type() != TopLevelScanner::RootType::ARRAY) {
+			const size_t first = head.find_first_not_of(" \t\r\n");
+			const size_t end = first == std::string::npos ? first : value_end(head, first);
+			secondValue = end == std::string::npos ? end : head.find_first_not_of(" \t\r\n", end);
+		}
+		if (scanner.entries().size() >= 2 || scanner.done() || secondValue != std::string::npos
+			|| scanner.failed() || head.size() >= fileSize || headSize >= MAX_RECORD_SIZE) {
+			break;
+		}
+	}
+	ndjson = scanner.root_type() != TopLevelScanner::RootType::ARRAY;
+	if (ndjson && secondValue == std::string::npos) {
+		std::fclose(fp);
+		return head.size() >= fileSize ? simdjson::INCORRECT_TYPE : simdjson::CAPACITY;
+	}
+
+	std::vector<Candidate> candidates;
+	std::mt19937_64 random(seed);
+	if (ndjson ? head.size() >= fileSize : scanner.done()) {
+		// Every record is in the head: pick 'count' of them uniformly
+		exact = true;
+		if (ndjson) {
+			size_t start = 0;
+			while (start < head.size()) {
+				const size_t end = std::min(head.find('\n', start), head.size());
+				const std::string_view line = trim(std::string_view(head).substr(start, end - start));
+				if (!line.empty() && !validator.parse(line.data(), line.size()).error()) {
+					candidates.push_back(Candidate{ uint64_t(line.data() - head.data()), std::string(line) });
+				}
+				start = end + 1;
+			}
+		}
+		else {
+			for (const TopLevelScanner::Entry& entry : scanner.entries()) {
+				candidates.push_back(Candidate{ entry.start, head.substr(entry.start, entry.end - entry.start) });
+			}
+		}
+		std::shuffle(candidates.begin(), candidates.end(), random);
+		candidates.resize(std::min(count, candidates.size()));
+	}
+	else {
+		uint64_t first = 0;
+		if (!ndjson) {
+			if (scanner.entries().size() < 2) {
+				std::fclose(fp);
+				return scanner.failed() ? simdjson::TAPE_ERROR : simdjson::CAPACITY;
+			}
+
+			// Separator between the first two elements, with the brackets around it when the elements are containers
+			const TopLevelScanner::Entry& a = scanner.entries()[0];
+			const TopLevelScanner::Entry& b = scanner.entries()[1];
+			const size_t from = is_bracket(head[a.end - 1]) ? a.end - 1 : a.end;
+			const size_t to = is_bracket(head[b.start]) ? b.start + 1 : b.start;
+			separator = head.substr(from, to - from);
+			first = a.start;
+
+			// Objects nested in elements can be separated like elements; elements also have to start with the first
+			// key of the first element, which records of an array usually share
+			recordPrefix.clear();
+			const size_t key = head.find_first_not_of(" \t\r\n", a.start + 1);
+			if (head[a.start] == '{' && key < a.end && head[key] == '"') {
+				const size_t keyEnd = value_end(head, key);
+				const size_t colon = keyEnd == std::string::npos ? keyEnd : head.find(':', keyEnd);
+				if (colon < a.end) {
+					recordPrefix = head.substr(a.start, colon + 1 - a.start);
+				}
+			}
+		}
+
+		// Draw offsets, read a window at each and keep the record found there; duplicates are drawn again
+		std::set<uint64_t> seen;
+		std::uniform_int_distribution<uint64_t> distribution(first, fileSize - 1);
+		for (int round = 0; round < MAX_ROUNDS && candidates.size() < count; round++) {
+			std::vector<uint64_t> draws(count - candidates.size());
+			for (uint64_t& draw : draws) {
+				draw = distribution(random);
+			}
+			std::sort(draws.begin(), draws.end());
+			for (const uint64_t draw : draws) {
+				Candidate candidate;
+				bool found = false;
+				bool incomplete = true;
+				for (size_t windowSize = WINDOW_SIZE; incomplete && windowSize <= MAX_RECORD_SIZE; windowSize *= 2) {
+					found = find_record(read_at(fp, draw, windowSize), draw, candidate, incomplete);
+				}
+				if (found && seen.insert(candidate.offset).second) {
+					candidates.push_back(std::move(candidate));
+				}
+			}
+		}
+	}
+	std::fclose(fp);
+
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.offset < b.offset; });
+	simdjson::error_code error = parse_records(candidates);
+	elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	return error;
+}
+
+// Method: Joins the records into a JSON array and parses it once; each record was validated when it was picked
+simdjson::error_code SampledDocument::parse_records(std::vector<Candidate>& candidates) {
+	if (candidates.empty()) {
+		return simdjson::INCORRECT_TYPE;
+	}
+	std::string array;
+	array += '[';
+	for (const Candidate& candidate : candidates) {
+		if (array.size() > 1) {
+			array += ',';
+		}
+		array += candidate.text;
+		offsets.push_back(candidate.offset);
+	}
+	array += ']';
+	candidates.clear();
+
+	simdjson::dom::array sample;
+	simdjson::error_code error = parser.parse(array).get(sample);
+	if (error) {
+		offsets.clear();
+		return error;
+	}
+	records.reserve(sample.size());
+	for (simdjson::dom::element record : sample) {
+		records.push_back(record);
+	}
+	return simdjson::SUCCESS;
+}
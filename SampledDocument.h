@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "simdjson.h"
+
+// SampledDocument class, a preview made of randomly chosen records of a large root array or NDJSON file.
+// Records are found by seeking to random offsets and resynchronizing on the next record boundary: a line break in
+// NDJSON, or in an array the separator seen between its first two elements (such as "},\n  {") followed by the
+// first key of the first element. Each candidate is parsed on its own and dropped if it is not valid JSON, so only
+// the sampled records are ever read and parsed, and the cost depends on the sample size, not on the file size.
+// The choice is reproducible for a given seed. Records following long ones are more likely to be picked, so the
+// sample is only uniform when record sizes are similar, except for files that fit in the first read, whose
+// records are all known and sampled exactly.
+class SampledDocument
+{
+public:
+    // Default number of records in a preview
+    static constexpr size_t DEFAULT_COUNT = 10000;
+
+    // Bytes read at each random offset; doubled until the record ends, up to MAX_RECORD_SIZE
+    static constexpr size_t WINDOW_SIZE = 16 * 1024;
+    static constexpr size_t MAX_RECORD_SIZE = 16 * 1024 * 1024;
+
+    // Rounds of random offsets drawn to replace duplicates and rejected candidates
+    static constexpr int MAX_ROUNDS = 4;
+
+    // Samples up to 'count' records of 'path'. Returns INCORRECT_TYPE if the file is neither a root array nor a
+    // sequence of JSON values, one per line.
+    simdjson::error_code load(const std::string& path, size_t count, uint64_t seed);
+
+    // Sampled records in file order, with the byte offset at which each one starts
+    size_t size() const { return records.size(); }
+    simdjson::dom::element record(size_t index) const { return records[index]; }
+    uint64_t offset(size_t index) const { return offsets[index]; }
+
+    // Whether the file is NDJSON, whether every record was known (small files), and the time taken in seconds
+    bool is_ndjson() const { return ndjson; }
+    bool is_exact() const { return exact; }
+    double seconds() const { return elapsed; }
+
+private:
+    // A record found in the file: its offset and JSON text
+    struct Candidate {
+        uint64_t offset;
+        std::string text;
+    };
+
+    simdjson::dom::parser parser;
+    simdjson::dom::parser validator;
+    std::vector<simdjson::dom::element> records;
+    std::vector<uint64_t> offsets;
+    uint64_t fileSize = 0;
+    bool ndjson = false;
+    bool exact = false;
+    double elapsed = 0;
+
+    // Bytes between the first two elements of the root array, with their closing and opening brackets, and the
+    // first element up to its first key if it is an object
+    std::string separator;
+    std::string recordPrefix;
+
+    // Reads up to 'size' bytes at 'offset'
+    static std::string read_at(std::FILE* fp, uint64_t offset, size_t size);
+
+    // Finds the first record starting in 'window', which was read at 'base'. Returns false with 'incomplete' set
+    // if the window ends first, so that a larger one is read.
+    bool find_record(std::string_view window, uint64_t base, Candidate& candidate, bool& incomplete);
+
+    // Parses the accepted records as one array
+    simdjson::error_code parse_records(std::vector<Candidate>& candidates);
+};
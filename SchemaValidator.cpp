@@ -0,0 +1,955 @@
+#include "SchemaValidator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+	std::string format_number(double value) {
+		char text[32];
+		std::snprintf(text, sizeof(text), "%.17g", value);
+		return text;
+	}
+
+	// Number of code points of a UTF-8 string: the bytes that do not continue a sequence
+	uint64_t code_points(std::string_view text) {
+		uint64_t count = 0;
+		for (unsigned char c : text) {
+			count += (c & 0xC0) != 0x80 ? 1 : 0;
+		}
+		return count;
+	}
+
+	// Numeric value of a number element
+	double number_of(simdjson::dom::element value) {
+		switch (value.type()) {
+		case simdjson::dom::element_type::INT64:
+			return double(int64_t(value));
+		case simdjson::dom::element_type::UINT64:
+			return double(uint64_t(value));
+		default:
+			return double(value);
+		}
+	}
+
+	bool is_number(simdjson::dom::element value) {
+		const auto type = value.type();
+		return type == simdjson::dom::element_type::INT64 || type == simdjson::dom::element_type::UINT64 || type == simdjson::dom::element_type::DOUBLE;
+	}
+}
+
+simdjson::error_code SchemaValidator::compile(const std::string& schemaPath) {
+	simdjson::padded_string schema;
+	simdjson::error_code error = simdjson::padded_string::load(schemaPath).get(schema);
+	if (error) {
+		errorMessage = "cannot read the schema";
+		return error;
+	}
+	return compile(schema);
+}
+
+// Method: The root is compiled first, as node 0; subschemas reached through $ref are compiled once, by pointer
+simdjson::error_code SchemaValidator::compile(const simdjson::padded_string& schema) {
+	nodes.clear();
+	compiledPointers.clear();
+	errorMessage.clear();
+	cancelled = false;
+	simdjson::dom::element root;
+	simdjson::error_code error = schemaParser.parse(schema).get(root);
+	if (error) {
+		errorMessage = "the schema is not valid JSON";
+		return error;
+	}
+	int node;
+	return compile_node(root, root, "", node);
+}
+
+simdjson::error_code SchemaValidator::compile_pointer(simdjson::dom::element root, const std::string& pointer, int& node) {
+	for (const auto& compiled : compiledPointers) {
+		if (compiled.first == pointer) {
+			node = compiled.second;
+			return simdjson::SUCCESS;
+		}
+	}
+	simdjson::dom::element schema;
+	if (root.at_pointer(pointer).get(schema)) {
+		errorMessage = "$ref \"#" + pointer + "\" does not point into the schema";
+		return simdjson::INVALID_JSON_POINTER;
+	}
+	return compile_node(root, schema, pointer, node);
+}
+
+// Method: Reserves the node's index before compiling its subschemas, so that references back to it resolve to it
+simdjson::error_code SchemaValidator::compile_node(simdjson::dom::element root, simdjson::dom::element schema, const std::string& pointer, int& node) {
+	node = int(nodes.size());
+	nodes.emplace_back();
+	compiledPointers.emplace_back(pointer, node);
+	Node compiled;
+	auto wrong_type = [&](std::string_view keyword) {
+		errorMessage = "\"" + std::string(keyword) + "\" has a value of the wrong type at \"" + pointer + "\"";
+		return simdjson::INCORRECT_TYPE;
+	};
+
+	if (schema.is_bool()) {
+		compiled.alwaysValid = bool(schema);
+		compiled.alwaysInvalid = !bool(schema);
+		nodes[size_t(node)] = std::move(compiled);
+		return simdjson::SUCCESS;
+	}
+	simdjson::dom::object object;
+	if (schema.get(object)) {
+		errorMessage = "subschema at \"" + pointer + "\" is neither an object nor a boolean";
+		return simdjson::INCORRECT_TYPE;
+	}
+
+	// Subschemas under a keyword, compiled at their own pointers
+	auto escape = [](std::string_view key) {
+		std::string escaped;
+		for (char c : key) {
+			escaped += c == '~' ? std::string("~0") : c == '/' ? std::string("~1") : std::string(1, c);
+		}
+		return escaped;
+	};
+	auto subschema = [&](simdjson::dom::element value, const std::string& at, int& child) {
+		return compile_node(root, value, at, child);
+	};
+	auto subschema_list = [&](std::string_view keyword, simdjson::dom::element value, std::vector<int>& list) {
+		simdjson::dom::array array;
+		if (value.get(array)) {
+			return wrong_type(keyword);
+		}
+		size_t index = 0;
+		for (simdjson::dom::element item : array) {
+			int child;
+			simdjson::error_code error = subschema(item, pointer + "/" + std::string(keyword) + "/" + std::to_string(index++), child);
+			if (error) {
+				return error;
+			}
+			list.push_back(child);
+		}
+		return simdjson::SUCCESS;
+	};
+	auto number = [&](std::string_view keyword, simdjson::dom::element value, double& target, uint32_t flag) {
+		if (!is_number(value)) {
+			return wrong_type(keyword);
+		}
+		target = number_of(value);
+		compiled.keywords |= flag;
+		return simdjson::SUCCESS;
+	};
+	auto count = [&](std::string_view keyword, simdjson::dom::element value, uint64_t& target, uint32_t flag) {
+		if (!is_number(value) || number_of(value) < 0) {
+			return wrong_type(keyword);
+		}
+		target = uint64_t(number_of(value));
+		compiled.keywords |= flag;
+		return simdjson::SUCCESS;
+	};
+
+	std::vector<std::string> required;
+	for (auto [key, value] : object) {
+		simdjson::error_code error = simdjson::SUCCESS;
+		if (key == "type") {
+			auto type_bit = [](std::string_view name) -> uint8_t {
+				if (name == "null") return TYPE_NULL;
+				if (name == "boolean") return TYPE_BOOLEAN;
+				if (name == "object") return TYPE_OBJECT;
+				if (name == "array") return TYPE_ARRAY;
+				if (name == "number") return TYPE_NUMBER | TYPE_INTEGER;
+				if (name == "string") return TYPE_STRING;
+				if (name == "integer") return TYPE_INTEGER;
+				return 0;
+			};
+			if (value.is_string()) {
+				compiled.types = type_bit(std::string_view(value));
+			}
+			else if (value.is_array()) {
+				for (simdjson::dom::element name : simdjson::dom::array(value)) {
+					compiled.types |= name.is_string() ? type_bit(std::string_view(name)) : 0;
+				}
+			}
+			else {
+				error = wrong_type(key);
+			}
+			compiled.keywords |= KW_TYPE;
+		}
+		else if (key == "enum") {
+			if (!value.is_array()) {
+				error = wrong_type(key);
+			}
+			else {
+				for (simdjson::dom::element item : simdjson::dom::array(value)) {
+					compiled.enumValues.push_back(item);
+				}
+				compiled.keywords |= KW_ENUM;
+			}
+		}
+		else if (key == "const") {
+			compiled.constValue = value;
+			compiled.keywords |= KW_CONST;
+		}
+		else if (key == "minimum") {
+			error = number(key, value, compiled.minimum, KW_MINIMUM);
+		}
+		else if (key == "maximum") {
+			error = number(key, value, compiled.maximum, KW_MAXIMUM);
+		}
+		else if (key == "exclusiveMinimum") {
+			error = number(key, value, compiled.exclusiveMinimum, KW_EXCLUSIVE_MINIMUM);
+		}
+		else if (key == "exclusiveMaximum") {
+			error = number(key, value, compiled.exclusiveMaximum, KW_EXCLUSIVE_MAXIMUM);
+		}
+		else if (key == "multipleOf") {
+			error = number(key, value, compiled.multipleOf, KW_MULTIPLE_OF);
+			if (!error && compiled.multipleOf <= 0) {
+				error = wrong_type(key);
+			}
+		}
+		else if (key == "minLength") {
+			error = count(key, value, compiled.minLength, KW_MIN_LENGTH);
+		}
+		else if (key == "maxLength") {
+			error = count(key, value, compiled.maxLength, KW_MAX_LENGTH);
+		}
+		else if (key == "minItems") {
+			error = count(key, value, compiled.minItems, KW_MIN_ITEMS);
+		}
+		else if (key == "maxItems") {
+			error = count(key, value, compiled.maxItems, KW_MAX_ITEMS);
+		}
+		else if (key == "minProperties") {
+			error = count(key, value, compiled.minProperties, KW_MIN_PROPERTIES);
+		}
+		else if (key == "maxProperties") {
+			error = count(key, value, compiled.maxProperties, KW_MAX_PROPERTIES);
+		}
+		else if (key == "uniqueItems") {
+			if (!value.is_bool()) {
+				error = wrong_type(key);
+			}
+			else if (bool(value)) {
+				compiled.keywords |= KW_UNIQUE_ITEMS;
+			}
+		}
+		else if (key == "pattern") {
+			if (!value.is_string()) {
+				error = wrong_type(key);
+			}
+			else {
+				compiled.patternText = std::string(std::string_view(value));
+				try {
+					compiled.pattern = std::make_shared<std::regex>(compiled.patternText, std::regex::ECMAScript | std::regex::optimize);
+					compiled.keywords |= KW_PATTERN;
+				}
+				catch (const std::regex_error&) {
+					error = wrong_type(key);
+				}
+			}
+		}
+		else if (key == "properties") {
+			if (!value.is_object()) {
+				error = wrong_type(key);
+			}
+			else {
+				for (auto [name, property] : simdjson::dom::object(value)) {
+					Property entry;
+					entry.name = std::string(name);
+					error = subschema(property, pointer + "/properties/" + escape(name), entry.schema);
+					if (error) {
+						break;
+					}
+					compiled.properties.push_back(std::move(entry));
+				}
+			}
+		}
+		else if (key == "patternProperties") {
+			if (!value.is_object()) {
+				error = wrong_type(key);
+			}
+			else {
+				for (auto [pattern, property] : simdjson::dom::object(value)) {
+					int child;
+					error = subschema(property, pointer + "/patternProperties/" + escape(pattern), child);
+					if (error) {
+						break;
+					}
+					try {
+						compiled.patternProperties.emplace_back(std::make_shared<std::regex>(std::string(pattern), std::regex::ECMAScript | std::regex::optimize), child);
+					}
+					catch (const std::regex_error&) {
+						error = wrong_type(key);
+						break;
+					}
+				}
+			}
+		}
+		else if (key == "additionalProperties") {
+			error = subschema(value, pointer + "/additionalProperties", compiled.additionalProperties);
+		}
+		else if (key == "required") {
+			if (!value.is_array()) {
+				error = wrong_type(key);
+			}
+			else {
+				for (simdjson::dom::element name : simdjson::dom::array(value)) {
+					if (!name.is_string()) {
+						error = wrong_type(key);
+						break;
+					}
+					required.emplace_back(std::string_view(name));
+				}
+			}
+		}
+		else if (key == "prefixItems") {
+			error = subschema_list(key, value, compiled.prefixItems);
+		}
+		else if (key == "items") {
+			error = subschema(value, pointer + "/items", compiled.items);
+		}
+		else if (key == "allOf") {
+			error = subschema_list(key, value, compiled.allOf);
+		}
+		else if (key == "anyOf") {
+			error = subschema_list(key, value, compiled.anyOf);
+		}
+		else if (key == "oneOf") {
+			error = subschema_list(key, value, compiled.oneOf);
+		}
+		else if (key == "not") {
+			error = subschema(value, pointer + "/not", compiled.notSchema);
+		}
+		else if (key == "$defs") {
+			// Compiled when referred to
+		}
+		else if (key == "$ref") {
+			const std::string_view target = value.is_string() ? std::string_view(value) : std::string_view();
+			if (target.empty() || target[0] != '#') {
+				errorMessage = "$ref \"" + std::string(target) + "\" at \"" + pointer + "\" is not within the schema";
+				error = simdjson::INVALID_JSON_POINTER;
+			}
+			else {
+				error = compile_pointer(root, std::string(target.substr(1)), compiled.ref);
+			}
+		}
+		if (error) {
+			return error;
+		}
+	}
+
+	// Required names get a bit each; names only required are added to the property table without a subschema
+	std::sort(compiled.properties.begin(), compiled.properties.end(), [](const Property& a, const Property& b) { return a.name < b.name; });
+	std::sort(required.begin(), required.end());
+	required.erase(std::unique(required.begin(), required.end()), required.end());
+	for (const std::string& name : required) {
+		auto found = std::lower_bound(compiled.properties.begin(), compiled.properties.end(), name, [](const Property& a, const std::string& b) { return a.name < b; });
+		if (found == compiled.properties.end() || found->name != name) {
+			Property entry;
+			entry.name = name;
+			found = compiled.properties.insert(found, std::move(entry));
+		}
+		found->requiredSlot = int(compiled.requiredCount++);
+	}
+	nodes[size_t(node)] = std::move(compiled);
+	return simdjson::SUCCESS;
+}
+
+std::vector<SchemaValidator::Violation> SchemaValidator::validate(simdjson::dom::element value, unsigned threads) {
+	return run(std::vector<simdjson::dom::element>{ value }, false, threads);
+}
+
+std::vector<SchemaValidator::Violation> SchemaValidator::validate_each(const std::vector<simdjson::dom::element>& values, unsigned threads) {
+	return run(values, true, threads);
+}
+
+// Method: Many values are split across threads as the elements of a large array are
+std::vector<SchemaValidator::Violation> SchemaValidator::run(const std::vector<simdjson::dom::element>& values, bool indexed, unsigned threads) {
+	const auto start = std::chrono::steady_clock::now();
+	threadCount = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+	violationCount = 0;
+	std::vector<Violation> violations;
+	Context context{ &violations, {}, true, true };
+	if (!nodes.empty()) {
+		auto check_range = [&](size_t first, size_t last, Context& local) {
+			bool valid = true;
+			for (size_t i = first; i < last && !stopping(local); i++) {
+				if (indexed) {
+					local.path.push_back({ {}, i, true });
+				}
+				valid = check(0, values[i], local) && valid;
+				if (indexed) {
+					local.path.pop_back();
+				}
+			}
+			return valid;
+		};
+		if (indexed && threadCount > 1 && values.size() >= PARALLEL_THRESHOLD) {
+			const size_t chunks = std::min(values.size(), size_t(threadCount) * 4);
+			const size_t chunkSize = (values.size() + chunks - 1) / chunks;
+			run_chunks(chunks, context, [&](size_t chunk, Context& local) {
+				return check_range(chunk * chunkSize, std::min(values.size(), (chunk + 1) * chunkSize), local);
+			});
+		}
+		else {
+			check_range(0, values.size(), context);
+		}
+	}
+	stopped = should_stop();
+	elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return violations;
+}
+
+// Method: Chunks are taken in turn by the threads; each records its violations apart, and they are appended in chunk
+// order so that the result does not depend on the scheduling. Nested arrays are checked on the chunk's thread.
+bool SchemaValidator::run_chunks(size_t chunks, Context& context, const std::function<bool(size_t, Context&)>& body) {
+	std::vector<std::vector<Violation>> results(chunks);
+	std::vector<char> valid(chunks, 1);
+	std::vector<char> interrupted(chunks, 0);
+	std::atomic<size_t> next{ 0 };
+	auto worker = [&]() {
+		for (size_t chunk; (chunk = next++) < chunks;) {
+			Context local{ &results[chunk], context.path, true, false, context.refDepth };
+			valid[chunk] = body(chunk, local);
+			interrupted[chunk] = local.interrupted;
+		}
+	};
+	std::vector<std::thread> workers;
+	for (unsigned i = 1; i < std::min<size_t>(threadCount, chunks); i++) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (std::thread& thread : workers) {
+		thread.join();
+	}
+	bool allValid = true;
+	for (size_t chunk = 0; chunk < chunks; chunk++) {
+		allValid = allValid && valid[chunk];
+		context.interrupted = context.interrupted || interrupted[chunk];
+		context.violations->insert(context.violations->end(), std::make_move_iterator(results[chunk].begin()), std::make_move_iterator(results[chunk].end()));
+	}
+	return allValid;
+}
+
+// Method: Applies the keywords in the order they are cheapest; without 'collect', returns at the first violation
+bool SchemaValidator::check(int index, simdjson::dom::element value, Context& context) {
+	const Node& node = nodes[size_t(index)];
+	if (node.alwaysValid || stopping(context)) {
+		return true;
+	}
+	if (node.alwaysInvalid) {
+		return fail(context, "no value is allowed here");
+	}
+	bool valid = true;
+	auto reject = [&](std::string message) {
+		valid = fail(context, std::move(message));
+		return !context.collect;
+	};
+
+	const simdjson::dom::element_type type = value.type();
+	if (node.keywords & KW_TYPE) {
+		uint8_t bits = 0;
+		switch (type) {
+		case simdjson::dom::element_type::NULL_VALUE: bits = TYPE_NULL; break;
+		case simdjson::dom::element_type::BOOL: bits = TYPE_BOOLEAN; break;
+		case simdjson::dom::element_type::OBJECT: bits = TYPE_OBJECT; break;
+		case simdjson::dom::element_type::ARRAY: bits = TYPE_ARRAY; break;
+		case simdjson::dom::element_type::STRING: bits = TYPE_STRING; break;
+		case simdjson::dom::element_type::INT64:
+		case simdjson::dom::element_type::UINT64: bits = TYPE_NUMBER | TYPE_INTEGER; break;
+		case simdjson::dom::element_type::DOUBLE: {
+			const double number = double(value);
+			bits = std::isfinite(number) && number == std::floor(number) ? TYPE_NUMBER | TYPE_INTEGER : TYPE_NUMBER;
+			break;
+		}
+		}
+		if (!(node.types & bits) && reject("expected " + type_names(node.types) + ", found " + type_name(value))) {
+			return false;
+		}
+	}
+	if ((node.keywords & KW_CONST) && !equal(value, node.constValue) && reject("does not equal the constant value")) {
+		return false;
+	}
+	if (node.keywords & KW_ENUM) {
+		bool found = false;
+		for (simdjson::dom::element allowed : node.enumValues) {
+			if (equal(value, allowed)) {
+				found = true;
+				break;
+			}
+		}
+		if (!found && reject("is not one of the values of \"enum\"")) {
+			return false;
+		}
+	}
+
+	switch (type) {
+	case simdjson::dom::element_type::INT64:
+	case simdjson::dom::element_type::UINT64:
+	case simdjson::dom::element_type::DOUBLE: {
+		if (!(node.keywords & (KW_MINIMUM | KW_MAXIMUM | KW_EXCLUSIVE_MINIMUM | KW_EXCLUSIVE_MAXIMUM | KW_MULTIPLE_OF))) {
+			break;
+		}
+		const double number = number_of(value);
+		if ((node.keywords & KW_MINIMUM) && number < node.minimum && reject(format_number(number) + " is less than the minimum " + format_number(node.minimum))) {
+			return false;
+		}
+		if ((node.keywords & KW_MAXIMUM) && number > node.maximum && reject(format_number(number) + " is greater than the maximum " + format_number(node.maximum))) {
+			return false;
+		}
+		if ((node.keywords & KW_EXCLUSIVE_MINIMUM) && number <= node.exclusiveMinimum && reject(format_number(number) + " is not greater than " + format_number(node.exclusiveMinimum))) {
+			return false;
+		}
+		if ((node.keywords & KW_EXCLUSIVE_MAXIMUM) && number >= node.exclusiveMaximum && reject(format_number(number) + " is not less than " + format_number(node.exclusiveMaximum))) {
+			return false;
+		}
+		if (node.keywords & KW_MULTIPLE_OF) {
+			const double quotient = number / node.multipleOf;
+			if (std::isfinite(quotient) && std::fabs(quotient - std::round(quotient)) > 1e-9 * std::max(1.0, std::fabs(quotient))
+				&& reject(format_number(number) + " is not a multiple of " + format_number(node.multipleOf))) {
+				return false;
+			}
+		}
+		break;
+	}
+	case simdjson::dom::element_type::STRING: {
+		if (!(node.keywords & (KW_MIN_LENGTH | KW_MAX_LENGTH | KW_PATTERN))) {
+			break;
+		}
+		const std::string_view text(value);
+		if (node.keywords & (KW_MIN_LENGTH | KW_MAX_LENGTH)) {
+			const uint64_t length = code_points(text);
+			if ((node.keywords & KW_MIN_LENGTH) && length < node.minLength && reject("is shorter than " + std::to_string(node.minLength) + " characters")) {
+				return false;
+			}
+			if ((node.keywords & KW_MAX_LENGTH) && length > node.maxLength && reject("is longer than " + std::to_string(node.maxLength) + " characters")) {
+				return false;
+			}
+		}
+		if ((node.keywords & KW_PATTERN) && !std::regex_search(text.begin(), text.end(), *node.pattern) && reject("does not match the pattern \"" + node.patternText + "\"")) {
+			return false;
+		}
+		break;
+	}
+	case simdjson::dom::element_type::OBJECT:
+		if (!check_object(node, simdjson::dom::object(value), context)) {
+			valid = false;
+			if (!context.collect) {
+				return false;
+			}
+		}
+		break;
+	case simdjson::dom::element_type::ARRAY:
+		if (!check_array(node, simdjson::dom::array(value), context)) {
+			valid = false;
+			if (!context.collect) {
+				return false;
+			}
+		}
+		break;
+	default:
+		break;
+	}
+
+	for (int child : node.allOf) {
+		if (!check(child, value, context)) {
+			valid = false;
+			if (!context.collect) {
+				return false;
+			}
+		}
+	}
+	if (node.ref >= 0) {
+		if (context.refDepth >= MAX_REF_DEPTH) {
+			if (reject("the schema refers to itself too deeply")) {
+				return false;
+			}
+		}
+		else {
+			context.refDepth++;
+			const bool matched = check(node.ref, value, context);
+			context.refDepth--;
+			if (!matched) {
+				valid = false;
+				if (!context.collect) {
+					return false;
+				}
+			}
+		}
+	}
+
+	// Alternatives are tried without recording their violations; only the outcome is reported. A walk interrupted
+	// meanwhile leaves values unchecked, which would read as matches, so nothing is reported then.
+	if (!node.anyOf.empty() || !node.oneOf.empty() || node.notSchema >= 0) {
+		const bool collect = context.collect;
+		const bool parallel = context.parallel;
+		context.collect = false;
+		context.parallel = false;
+		bool anyMatched = node.anyOf.empty();
+		for (int child : node.anyOf) {
+			if (check(child, value, context)) {
+				anyMatched = true;
+				break;
+			}
+		}
+		size_t oneMatched = 0;
+		for (size_t i = 0; i < node.oneOf.size() && oneMatched < 2; i++) {
+			oneMatched += check(node.oneOf[i], value, context) ? 1 : 0;
+		}
+		const bool notMatched = node.notSchema >= 0 && check(node.notSchema, value, context);
+		context.collect = collect;
+		context.parallel = parallel;
+		if (context.interrupted) {
+			return valid;
+		}
+		if (!anyMatched && reject("does not match any schema of \"anyOf\"")) {
+			return false;
+		}
+		if (!node.oneOf.empty() && oneMatched != 1 && reject(oneMatched ? "matches more than one schema of \"oneOf\"" : "does not match any schema of \"oneOf\"")) {
+			return false;
+		}
+		if (notMatched && reject("matches the schema of \"not\"")) {
+			return false;
+		}
+	}
+	return valid;
+}
+
+// Method: Each member is looked up in the sorted property table; the required ones found are marked in a bit set,
+// so that only the missing ones are looked for at the end
+bool SchemaValidator::check_object(const Node& node, simdjson::dom::object object, Context& context) {
+	bool valid = true;
+	auto reject = [&](std::string message) {
+		valid = fail(context, std::move(message));
+		return !context.collect;
+	};
+	if (node.keywords & (KW_MIN_PROPERTIES | KW_MAX_PROPERTIES)) {
+		const uint64_t size = count_members(object);
+		if ((node.keywords & KW_MIN_PROPERTIES) && size < node.minProperties && reject("has fewer than " + std::to_string(node.minProperties) + " properties")) {
+			return false;
+		}
+		if ((node.keywords & KW_MAX_PROPERTIES) && size > node.maxProperties && reject("has more than " + std::to_string(node.maxProperties) + " properties")) {
+			return false;
+		}
+	}
+	if (node.properties.empty() && node.patternProperties.empty() && node.additionalProperties < 0) {
+		return valid;
+	}
+
+	uint64_t seenSmall = 0;
+	std::vector<uint64_t> seenLarge(node.requiredCount > 64 ? (node.requiredCount + 63) / 64 : 0);
+	uint64_t* seen = seenLarge.empty() ? &seenSmall : seenLarge.data();
+	size_t requiredSeen = 0;
+	for (auto [key, value] : object) {
+		bool matched = false;
+		context.path.push_back({ key, 0, false });
+		if (!node.properties.empty()) {
+			auto found = std::lower_bound(node.properties.begin(), node.properties.end(), key, [](const Property& a, std::string_view b) { return a.name < b; });
+			if (found != node.properties.end() && found->name == key) {
+				if (found->requiredSlot >= 0) {
+					uint64_t& word = seen[found->requiredSlot / 64];
+					const uint64_t bit = uint64_t(1) << (found->requiredSlot % 64);
+					requiredSeen += (word & bit) ? 0 : 1;
+					word |= bit;
+				}
+				if (found->schema >= 0) {
+					matched = true;
+					valid = check(found->schema, value, context) && valid;
+				}
+			}
+		}
+		for (const auto& pattern : node.patternProperties) {
+			if (std::regex_search(key.begin(), key.end(), *pattern.first)) {
+				matched = true;
+				valid = check(pattern.second, value, context) && valid;
+			}
+		}
+		if (!matched && node.additionalProperties >= 0) {
+			if (nodes[size_t(node.additionalProperties)].alwaysInvalid) {
+				valid = fail(context, "is not an allowed property");
+			}
+			else {
+				valid = check(node.additionalProperties, value, context) && valid;
+			}
+		}
+		context.path.pop_back();
+		if (!valid && !context.collect) {
+			return false;
+		}
+	}
+	if (requiredSeen < node.requiredCount) {
+		for (const Property& property : node.properties) {
+			if (property.requiredSlot >= 0 && !(seen[property.requiredSlot / 64] & (uint64_t(1) << (property.requiredSlot % 64)))
+				&& reject("is missing the required property \"" + property.name + "\"")) {
+				return false;
+			}
+		}
+	}
+	return valid;
+}
+
+bool SchemaValidator::check_array(const Node& node, simdjson::dom::array array, Context& context) {
+	bool valid = true;
+	auto reject = [&](std::string message) {
+		valid = fail(context, std::move(message));
+		return !context.collect;
+	};
+	if (node.keywords & (KW_MIN_ITEMS | KW_MAX_ITEMS)) {
+		const uint64_t size = count_elements(array);
+		if ((node.keywords & KW_MIN_ITEMS) && size < node.minItems && reject("has fewer than " + std::to_string(node.minItems) + " items")) {
+			return false;
+		}
+		if ((node.keywords & KW_MAX_ITEMS) && size > node.maxItems && reject("has more than " + std::to_string(node.maxItems) + " items")) {
+			return false;
+		}
+	}
+
+	auto item = array.begin();
+	size_t index = 0;
+	for (; index < node.prefixItems.size() && item != array.end(); ++item, index++) {
+		context.path.push_back({ {}, index, true });
+		valid = check(node.prefixItems[index], *item, context) && valid;
+		context.path.pop_back();
+		if (!valid && !context.collect) {
+			return false;
+		}
+	}
+	if (node.items >= 0 && item != array.end()) {
+		valid = check_items(node.items, array, item, index, context) && valid;
+		if (!valid && !context.collect) {
+			return false;
+		}
+	}
+
+	// Short arrays are compared pairwise; in longer ones, equal values have equal hashes, so only the values sharing
+	// one are compared
+	if ((node.keywords & KW_UNIQUE_ITEMS) && count_elements(array) <= 16) {
+		for (auto value = array.begin(); value != array.end(); ++value) {
+			auto other = value;
+			for (++other; other != array.end(); ++other) {
+				if (equal(*value, *other)) {
+					return reject("has duplicate items") ? false : valid;
+				}
+			}
+		}
+	}
+	else if (node.keywords & KW_UNIQUE_ITEMS) {
+		std::unordered_multimap<size_t, simdjson::dom::element> byHash;
+		for (simdjson::dom::element value : array) {
+			const size_t hash = hash_of(value);
+			auto range = byHash.equal_range(hash);
+			for (auto other = range.first; other != range.second; ++other) {
+				if (equal(value, other->second)) {
+					return reject("has duplicate items") ? false : valid;
+				}
+			}
+			byHash.emplace(hash, value);
+		}
+	}
+	return valid;
+}
+
+// Method: The remaining elements are split into chunks of about equal count when there are enough of them; the
+// chunks' first elements are found by stepping over the elements, which skips their contents on the tape
+bool SchemaValidator::check_items(int node, simdjson::dom::array array, simdjson::dom::array::iterator item, size_t index, Context& context) {
+	const size_t remaining = context.parallel && context.collect && threadCount > 1 ? count_elements(array) - index : 0;
+	if (remaining < PARALLEL_THRESHOLD) {
+		bool valid = true;
+		for (; item != array.end() && !stopping(context); ++item, index++) {
+			context.path.push_back({ {}, index, true });
+			valid = check(node, *item, context) && valid;
+			context.path.pop_back();
+			if (!valid && !context.collect) {
+				return false;
+			}
+		}
+		return valid;
+	}
+
+	const size_t chunks = std::min(remaining, size_t(threadCount) * 4);
+	const size_t chunkSize = (remaining + chunks - 1) / chunks;
+	std::vector<simdjson::dom::array::iterator> starts;
+	starts.reserve(chunks);
+	for (size_t i = 0; i < remaining; ++item, i++) {
+		if (i % chunkSize == 0) {
+			starts.push_back(item);
+		}
+	}
+	return run_chunks(starts.size(), context, [&](size_t chunk, Context& local) {
+		bool valid = true;
+		auto value = starts[chunk];
+		const size_t first = chunk * chunkSize;
+		const size_t last = std::min(remaining, first + chunkSize);
+		for (size_t i = first; i < last && !stopping(local); ++value, i++) {
+			local.path.push_back({ {}, index + i, true });
+			valid = check(node, *value, local) && valid;
+			local.path.pop_back();
+		}
+		return valid;
+	});
+}
+
+bool SchemaValidator::fail(Context& context, std::string message) {
+	if (context.collect && violationCount++ < MAX_VIOLATIONS) {
+		context.violations->push_back({ pointer_of(context.path), std::move(message) });
+	}
+	return false;
+}
+
+// Method: Integers beyond 2^53 lose precision as doubles, so int64 and uint64 values are compared as integers; an
+// integer and a double are compared as doubles
+bool SchemaValidator::equal(simdjson::dom::element a, simdjson::dom::element b) {
+	if (is_number(a) || is_number(b)) {
+		if (!is_number(a) || !is_number(b)) {
+			return false;
+		}
+		const auto left = a.type(), right = b.type();
+		if (left == simdjson::dom::element_type::INT64 && right == simdjson::dom::element_type::INT64) {
+			return int64_t(a) == int64_t(b);
+		}
+		if (left == simdjson::dom::element_type::UINT64 && right == simdjson::dom::element_type::UINT64) {
+			return uint64_t(a) == uint64_t(b);
+		}
+		if (left == simdjson::dom::element_type::INT64 && right == simdjson::dom::element_type::UINT64) {
+			return int64_t(a) >= 0 && uint64_t(int64_t(a)) == uint64_t(b);
+		}
+		if (left == simdjson::dom::element_type::UINT64 && right == simdjson::dom::element_type::INT64) {
+			return int64_t(b) >= 0 && uint64_t(a) == uint64_t(int64_t(b));
+		}
+		return number_of(a) == number_of(b);
+	}
+	if (a.type() != b.type()) {
+		return false;
+	}
+	switch (a.type()) {
+	case simdjson::dom::element_type::STRING:
+		return std::string_view(a) == std::string_view(b);
+	case simdjson::dom::element_type::BOOL:
+		return bool(a) == bool(b);
+	case simdjson::dom::element_type::ARRAY: {
+		simdjson::dom::array left(a), right(b);
+		auto other = right.begin();
+		for (simdjson::dom::element value : left) {
+			if (other == right.end() || !equal(value, *other)) {
+				return false;
+			}
+			++other;
+		}
+		return other == right.end();
+	}
+	case simdjson::dom::element_type::OBJECT: {
+		simdjson::dom::object left(a), right(b);
+		if (count_members(left) != count_members(right)) {
+			return false;
+		}
+		for (auto [key, value] : left) {
+			simdjson::dom::element other;
+			if (right.at_key(key).get(other) || !equal(value, other)) {
+				return false;
+			}
+		}
+		return true;
+	}
+	default:
+		return true;
+	}
+}
+
+size_t SchemaValidator::hash_of(simdjson::dom::element value) {
+	switch (value.type()) {
+	case simdjson::dom::element_type::STRING:
+		return std::hash<std::string_view>()(std::string_view(value));
+	case simdjson::dom::element_type::INT64:
+	case simdjson::dom::element_type::UINT64:
+	case simdjson::dom::element_type::DOUBLE:
+		return std::hash<double>()(number_of(value) + 0.0);
+	case simdjson::dom::element_type::BOOL:
+		return bool(value) ? 1 : 2;
+	case simdjson::dom::element_type::NULL_VALUE:
+		return 3;
+	case simdjson::dom::element_type::ARRAY:
+		return count_elements(simdjson::dom::array(value)) * 31 + 4;
+	case simdjson::dom::element_type::OBJECT:
+		return count_members(simdjson::dom::object(value)) * 31 + 5;
+	}
+	return 0;
+}
+
+// Method: The tape stores counts up to 0xFFFFFF; larger containers are counted by stepping over their elements
+uint64_t SchemaValidator::count_elements(simdjson::dom::array array) {
+	const size_t size = array.size();
+	if (size < 0xFFFFFF) {
+		return size;
+	}
+	uint64_t count = 0;
+	for (auto item = array.begin(); item != array.end(); ++item) {
+		count++;
+	}
+	return count;
+}
+
+uint64_t SchemaValidator::count_members(simdjson::dom::object object) {
+	const size_t size = object.size();
+	if (size < 0xFFFFFF) {
+		return size;
+	}
+	uint64_t count = 0;
+	for (auto member = object.begin(); member != object.end(); ++member) {
+		count++;
+	}
+	return count;
+}
+
+std::string SchemaValidator::pointer_of(const std::vector<PathToken>& path) {
+	std::string pointer;
+	for (const PathToken& token : path) {
+		pointer += '/';
+		if (token.isIndex) {
+			pointer += std::to_string(token.index);
+			continue;
+		}
+		for (char c : token.key) {
+			if (c == '~') {
+				pointer += "~0";
+			}
+			else if (c == '/') {
+				pointer += "~1";
+			}
+			else {
+				pointer += c;
+			}
+		}
+	}
+	return pointer;
+}
+
+std::string SchemaValidator::type_name(simdjson::dom::element value) {
+	switch (value.type()) {
+	case simdjson::dom::element_type::NULL_VALUE: return "null";
+	case simdjson::dom::element_type::BOOL: return "boolean";
+	case simdjson::dom::element_type::OBJECT: return "object";
+	case simdjson::dom::element_type::ARRAY: return "array";
+	case simdjson::dom::element_type::STRING: return "string";
+	case simdjson::dom::element_type::INT64:
+	case simdjson::dom::element_type::UINT64: return "integer";
+	case simdjson::dom::element_type::DOUBLE: return "number";
+	}
+	return "value";
+}
+
+std::string SchemaValidator::type_names(uint8_t types) {
+	static const std::pair<uint8_t, const char*> names[] = {
+		{ TYPE_NULL, "null" }, { TYPE_BOOLEAN, "boolean" }, { TYPE_OBJECT, "object" }, { TYPE_ARRAY, "array" },
+		{ TYPE_NUMBER, "number" }, { TYPE_STRING, "string" }, { TYPE_INTEGER, "integer" }
+	};
+	std::string text;
+	for (const auto& name : names) {
+		// "number" includes "integer"
+		if ((types & name.first) && !(name.first == TYPE_INTEGER && (types & TYPE_NUMBER))) {
+			text += text.empty() ? name.second : std::string(" or ") + name.second;
+		}
+	}
+	return text.empty() ? "nothing" : text;
+}
@@ -0,0 +1,174 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "simdjson.h"
+
+// SchemaValidator class, checks documents against a JSON Schema (draft 2020-12). The schema is compiled once into a
+// table of nodes, one per subschema, with its keywords turned into flags, bounds, sorted property tables and
+// compiled patterns, so that validation is a walk over the document's elements with no lookups in the schema.
+// Large arrays are split into ranges checked on several threads; violations are reported with the JSON Pointer of
+// the value, in document order.
+// Supported keywords: type, enum, const, minimum, maximum, exclusiveMinimum, exclusiveMaximum, multipleOf,
+// minLength, maxLength, pattern, properties, patternProperties, additionalProperties, required, minProperties,
+// maxProperties, prefixItems, items, minItems, maxItems, uniqueItems, allOf, anyOf, oneOf, not, $ref (to "#" and
+// JSON Pointers within the schema, such as "#/$defs/name") and boolean schemas. Other keywords are ignored, as
+// annotations are.
+class SchemaValidator
+{
+public:
+    // Arrays with at least this many elements are checked in parallel
+    static constexpr size_t PARALLEL_THRESHOLD = 4096;
+
+    // Violations reported at most; validation stops once they are reached
+    static constexpr size_t MAX_VIOLATIONS = 10000;
+
+    // Subschemas applied to a value through $ref at most, which stops schemas that refer to themselves endlessly
+    static constexpr size_t MAX_REF_DEPTH = 1024;
+
+    struct Violation {
+        std::string pointer;
+        std::string message;
+    };
+
+    // Loads and compiles a schema. Returns INCORRECT_TYPE for a keyword with a value of the wrong type and
+    // INVALID_JSON_POINTER for a $ref that cannot be resolved; message() tells which.
+    simdjson::error_code compile(const std::string& schemaPath);
+    simdjson::error_code compile(const simdjson::padded_string& schema);
+
+    // Checks a value, or each of several values (such as the records of an NDJSON document, whose pointers then
+    // start with their index). 'threads' is the number of threads to use, 0 for one per core.
+    std::vector<Violation> validate(simdjson::dom::element value, unsigned threads = 0);
+    std::vector<Violation> validate_each(const std::vector<simdjson::dom::element>& values, unsigned threads = 0);
+
+    // Stops a validation running on another thread; it then returns the violations found so far. The validator
+    // stays cancelled until a schema is compiled again.
+    void cancel() { cancelled = true; }
+
+    // Whether the last validation stopped at MAX_VIOLATIONS or was cancelled, and its duration in seconds
+    bool truncated() const { return stopped; }
+    double seconds() const { return elapsed; }
+
+    // Description of the last compile error
+    const std::string& message() const { return errorMessage; }
+
+private:
+    // Value types, as a mask; integers are numbers too
+    enum TypeBits : uint8_t {
+        TYPE_NULL = 1, TYPE_BOOLEAN = 2, TYPE_OBJECT = 4, TYPE_ARRAY = 8, TYPE_NUMBER = 16, TYPE_STRING = 32, TYPE_INTEGER = 64
+    };
+
+    // Keywords present in a node
+    enum Keyword : uint32_t {
+        KW_TYPE = 1u << 0, KW_ENUM = 1u << 1, KW_CONST = 1u << 2, KW_MINIMUM = 1u << 3, KW_MAXIMUM = 1u << 4,
+        KW_EXCLUSIVE_MINIMUM = 1u << 5, KW_EXCLUSIVE_MAXIMUM = 1u << 6, KW_MULTIPLE_OF = 1u << 7,
+        KW_MIN_LENGTH = 1u << 8, KW_MAX_LENGTH = 1u << 9, KW_PATTERN = 1u << 10, KW_MIN_ITEMS = 1u << 11,
+        KW_MAX_ITEMS = 1u << 12, KW_UNIQUE_ITEMS = 1u << 13, KW_MIN_PROPERTIES = 1u << 14, KW_MAX_PROPERTIES = 1u << 15
+    };
+
+    // A property named in 'properties' or 'required': its subschema (-1 if none) and its bit among the required ones
+    // (-1 if not required)
+    struct Property {
+        std::string name;
+        int schema = -1;
+        int requiredSlot = -1;
+    };
+
+    // A compiled subschema. Subschemas are referred to by index in 'nodes'.
+    struct Node {
+        bool alwaysValid = false;
+        bool alwaysInvalid = false;
+        uint32_t keywords = 0;
+        uint8_t types = 0;
+        std::vector<simdjson::dom::element> enumValues;
+        simdjson::dom::element constValue;
+        double minimum = 0, maximum = 0, exclusiveMinimum = 0, exclusiveMaximum = 0, multipleOf = 0;
+        uint64_t minLength = 0, maxLength = 0, minItems = 0, maxItems = 0, minProperties = 0, maxProperties = 0;
+        std::shared_ptr<std::regex> pattern;
+        std::string patternText;
+        std::vector<Property> properties;       // Sorted by name
+        std::vector<std::pair<std::shared_ptr<std::regex>, int>> patternProperties;
+        int additionalProperties = -1;
+        size_t requiredCount = 0;
+        std::vector<int> prefixItems;
+        int items = -1;
+        std::vector<int> allOf, anyOf, oneOf;
+        int notSchema = -1;
+        int ref = -1;
+    };
+
+    // A step of the path to the value being checked
+    struct PathToken {
+        std::string_view key;
+        size_t index;
+        bool isIndex;
+    };
+
+    // State of one thread's walk: where it is, whether violations are recorded (not under anyOf, oneOf or not),
+    // whether it may split arrays across threads, and whether it stopped before checking everything, in which case
+    // the outcomes of the values left unchecked mean nothing
+    struct Context {
+        std::vector<Violation>* violations;
+        std::vector<PathToken> path;
+        bool collect;
+        bool parallel;
+        size_t refDepth = 0;
+        bool interrupted = false;
+    };
+
+    simdjson::dom::parser schemaParser;
+    std::vector<Node> nodes;
+    std::vector<std::pair<std::string, int>> compiledPointers;
+    std::string errorMessage;
+
+    unsigned threadCount = 1;
+    std::atomic<bool> cancelled{ false };
+    std::atomic<size_t> violationCount{ 0 };
+    bool stopped = false;
+    double elapsed = 0;
+
+    // Compiles the subschema at 'pointer' of the schema document, or returns its node if already compiled
+    simdjson::error_code compile_pointer(simdjson::dom::element root, const std::string& pointer, int& node);
+    simdjson::error_code compile_node(simdjson::dom::element root, simdjson::dom::element schema, const std::string& pointer, int& node);
+
+    std::vector<Violation> run(const std::vector<simdjson::dom::element>& values, bool indexed, unsigned threads);
+
+    // Runs 'body' for each chunk on up to 'threadCount' threads, and appends the chunks' violations in order
+    bool run_chunks(size_t chunks, Context& context, const std::function<bool(size_t, Context&)>& body);
+
+    // Checks 'value' against 'node'; returns false on a violation. With 'collect' set, all violations are recorded;
+    // otherwise the first one ends the walk.
+    bool check(int node, simdjson::dom::element value, Context& context);
+    bool check_object(const Node& node, simdjson::dom::object object, Context& context);
+    bool check_array(const Node& node, simdjson::dom::array array, Context& context);
+
+    // Checks the elements from 'item' (at 'index') against 'node', in parallel if there are enough of them
+    bool check_items(int node, simdjson::dom::array array, simdjson::dom::array::iterator item, size_t index, Context& context);
+
+    // Records a violation at the current path
+    bool fail(Context& context, std::string message);
+
+    // Whether the walk should stop: cancelled, or enough violations found. stopping() also marks the context as
+    // interrupted when it should.
+    bool should_stop() const { return cancelled || violationCount >= MAX_VIOLATIONS; }
+    bool stopping(Context& context) const { return context.interrupted = context.interrupted || should_stop(); }
+
+    // JSON equality, with numbers compared by value: exactly between integers, as doubles otherwise
+    static bool equal(simdjson::dom::element a, simdjson::dom::element b);
+
+    static size_t hash_of(simdjson::dom::element value);
+
+    // Number of elements or members, also past the 0xFFFFFF the tape can count
+    static uint64_t count_elements(simdjson::dom::array array);
+    static uint64_t count_members(simdjson::dom::object object);
+
+    static std::string pointer_of(const std::vector<PathToken>& path);
+    static std::string type_name(simdjson::dom::element value);
+    static std::string type_names(uint8_t types);
+};
@@ -0,0 +1,205 @@
+#include "SeriesChartWidget.h"
+#include <algorithm>
+#include <cmath>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QToolTip>
+#include <QWheelEvent>
+
+namespace {
+
+	const QColor LINE_COLOR(25, 65, 150);
+	const QColor AXIS_COLOR(120, 120, 120);
+
+	// Room for the value labels on the left and the index labels below
+	constexpr int LEFT_MARGIN = 70;
+	constexpr int BOTTOM_MARGIN = 20;
+	constexpr int MARGIN = 6;
+
+	// Zoom factor per wheel step
+	constexpr double ZOOM_STEP = 1.25;
+
+	QString format_value(double value) {
+		return std::isnan(value) ? QString("-") : QString::number(value, 'g', 6);
+	}
+}
+
+SeriesChartWidget::SeriesChartWidget(QWidget* parent)
+	: QWidget(parent)
+{
+	setMouseTracking(true);
+	setMinimumHeight(80);
+}
+
+QSize SeriesChartWidget::sizeHint() const {
+	return QSize(600, 200);
+}
+
+void SeriesChartWidget::set_series(std::shared_ptr<const NumericSeries> newSeries, const QString& newTitle) {
+	shown = std::move(newSeries);
+	title = newTitle;
+	first = 0;
+	last = shown ? shown->size() : 0;
+	dragging = false;
+	update();
+}
+
+QRect SeriesChartWidget::plot_area() const {
+	return QRect(LEFT_MARGIN, MARGIN + fontMetrics().height(), std::max(1, width() - LEFT_MARGIN - MARGIN),
+		std::max(1, height() - BOTTOM_MARGIN - 2 * MARGIN - fontMetrics().height()));
+}
+
+size_t SeriesChartWidget::index_at(int x) const {
+	const QRect area = plot_area();
+	const double ratio = std::clamp(double(x - area.left()) / double(area.width()), 0.0, 1.0);
+	return std::min(last - 1, first + size_t(ratio * double(last - first)));
+}
+
+void SeriesChartWidget::show_range(double newFirst, double length) {
+	const size_t count = shown ? shown->size() : 0;
+	const size_t visible = std::clamp(size_t(std::llround(length)), std::min(MIN_VISIBLE, count), count);
+	first = size_t(std::clamp(std::llround(newFirst), 0LL, (long long)(count - visible)));
+	last = first + visible;
+	update();
+}
+
+// Method: The vertical scale fits the values in view. Columns holding no value are left empty, and so are the gaps
+// they make in the line.
+void SeriesChartWidget::paintEvent(QPaintEvent* event) {
+	Q_UNUSED(event);
+	QPainter painter(this);
+	painter.fillRect(rect(), palette().color(QPalette::Base));
+	if (!shown || last <= first) {
+		painter.setPen(AXIS_COLOR);
+		painter.drawText(rect(), Qt::AlignCenter, shown ? "No values" : "Choose \"Plot numeric field...\" to draw the values of a field");
+		return;
+	}
+	const QRect area = plot_area();
+	const NumericSeries::Span extremes = shown->range(first, last);
+	painter.setPen(palette().color(QPalette::Text));
+	painter.drawText(LEFT_MARGIN, MARGIN, width() - LEFT_MARGIN - MARGIN, fontMetrics().height(), Qt::AlignLeft,
+		QString("%1 (%2 of %3 values)").arg(title).arg(last - first).arg(shown->size()));
+	painter.setPen(AXIS_COLOR);
+	painter.drawRect(area.adjusted(0, 0, -1, -1));
+	painter.drawText(0, area.top(), LEFT_MARGIN - MARGIN, fontMetrics().height(), Qt::AlignRight, format_value(extremes.max));
+	painter.drawText(0, area.bottom() - fontMetrics().height(), LEFT_MARGIN - MARGIN, fontMetrics().height(), Qt::AlignRight, format_value(extremes.min));
+	painter.drawText(area.left(), area.bottom() + MARGIN, area.width(), fontMetrics().height(), Qt::AlignLeft, QString::number(first));
+	painter.drawText(area.left(), area.bottom() + MARGIN, area.width(), fontMetrics().height(), Qt::AlignRight, QString::number(last - 1));
+	if (std::isnan(extremes.min)) {
+		return;
+	}
+
+	const double low = extremes.min;
+	const double spread = extremes.max - extremes.min;
+	auto y_of = [&](double value) {
+		const double ratio = spread > 0 ? (value - low) / spread : 0.5;
+		return area.bottom() - 1 - int(ratio * double(area.height() - 2));
+	};
+	painter.setPen(LINE_COLOR);
+	const size_t columns = size_t(area.width());
+	if (last - first <= columns) {
+		auto x_of = [&](size_t index) {
+			return area.left() + int(double(index - first) * double(area.width() - 1) / double(std::max<size_t>(1, last - first - 1)));
+		};
+		for (size_t i = first; i < last; i++) {
+			const double value = shown->value(i);
+			if (std::isnan(value)) {
+				continue;
+			}
+			if (i + 1 < last && !std::isnan(shown->value(i + 1))) {
+				painter.drawLine(x_of(i), y_of(value), x_of(i + 1), y_of(shown->value(i + 1)));
+			}
+			else {
+				painter.drawPoint(x_of(i), y_of(value));
+			}
+		}
+		return;
+	}
+	shown->downsample(first, last, columns, spans);
+	for (size_t column = 0; column < columns; column++) {
+		const NumericSeries::Span& span = spans[column];
+		if (std::isnan(span.min)) {
+			continue;
+		}
+		const int x = area.left() + int(column);
+		int top = y_of(span.max);
+		int bottom = y_of(span.min);
+		// Joins the column to the previous one so that steep changes do not leave gaps
+		if (column > 0 && !std::isnan(spans[column - 1].min)) {
+			top = std::min(top, y_of(spans[column - 1].min));
+			bottom = std::max(bottom, y_of(spans[column - 1].max));
+		}
+		painter.drawLine(x, top, x, bottom);
+	}
+}
+
+void SeriesChartWidget::wheelEvent(QWheelEvent* event) {
+	if (!shown || last <= first) {
+		return;
+	}
+	const double steps = event->angleDelta().y() / 120.0;
+	const size_t anchor = index_at(int(event->position().x()));
+	const double ratio = double(anchor - first) / double(last - first);
+	const double length = double(last - first) * std::pow(ZOOM_STEP, -steps);
+	show_range(double(anchor) - ratio * length, length);
+	event->accept();
+}
+
+void SeriesChartWidget::mousePressEvent(QMouseEvent* event) {
+	if (event->button() != Qt::LeftButton || !shown || last <= first) {
+		QWidget::mousePressEvent(event);
+		return;
+	}
+	dragging = true;
+	dragged = false;
+	dragX = event->position().toPoint().x();
+	dragFirst = first;
+}
+
+// Method: Pans while dragging; otherwise describes the column under the mouse in a tooltip
+void SeriesChartWidget::mouseMoveEvent(QMouseEvent* event) {
+	if (!shown || last <= first) {
+		return;
+	}
+	const int x = event->position().toPoint().x();
+	if (dragging) {
+		dragged = dragged || std::abs(x - dragX) > 2;
+		const double perPixel = double(last - first) / double(plot_area().width());
+		show_range(double(dragFirst) - double(x - dragX) * perPixel, double(last - first));
+		return;
+	}
+	const QRect area = plot_area();
+	if (x < area.left() || x > area.right()) {
+		QToolTip::hideText();
+		return;
+	}
+	const size_t index = index_at(x);
+	const size_t columnEnd = std::max(index + 1, index_at(x + 1));
+	QString text;
+	if (columnEnd - index <= 1) {
+		text = QString("[%1]: %2").arg(index).arg(format_value(shown->value(index)));
+	}
+	else {
+		const NumericSeries::Span span = shown->range(index, columnEnd);
+		text = QString("[%1..%2]: %3 to %4").arg(index).arg(columnEnd - 1).arg(format_value(span.min), format_value(span.max));
+	}
+	QToolTip::showText(event->globalPosition().toPoint(), text, this);
+}
+
+void SeriesChartWidget::mouseReleaseEvent(QMouseEvent* event) {
+	if (event->button() != Qt::LeftButton || !dragging) {
+		QWidget::mouseReleaseEvent(event);
+		return;
+	}
+	dragging = false;
+	if (!dragged) {
+		emit index_clicked(index_at(event->position().toPoint().x()));
+	}
+}
+
+void SeriesChartWidget::mouseDoubleClickEvent(QMouseEvent* event) {
+	Q_UNUSED(event);
+	if (shown) {
+		show_range(0, double(shown->size()));
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <QString>
+#include <QWidget>
+#include "NumericSeries.h"
+
+// SeriesChartWidget class, draws a NumericSeries as a line chart of value by element index. Each pixel column of the
+// range in view is drawn as a vertical line from the least to the greatest of its values, read from the series'
+// min/max pyramid, so drawing costs the same at any zoom level; once there are fewer values than columns they are
+// joined by a line instead. The wheel zooms around the mouse, dragging pans, double-clicking shows the whole series,
+// and clicking reports the element under the mouse.
+class SeriesChartWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    // Fewest values the view can be zoomed in to
+    static constexpr size_t MIN_VISIBLE = 8;
+
+    explicit SeriesChartWidget(QWidget* parent = nullptr);
+
+    // Shows a series, or nothing, with its whole range in view
+    void set_series(std::shared_ptr<const NumericSeries> newSeries, const QString& newTitle);
+    const std::shared_ptr<const NumericSeries>& series() const { return shown; }
+
+    QSize sizeHint() const override;
+
+signals:
+    void index_clicked(size_t index);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+    void mouseDoubleClickEvent(QMouseEvent* event) override;
+
+private:
+    std::shared_ptr<const NumericSeries> shown;
+    QString title;
+
+    // Elements in view, [first, last)
+    size_t first = 0;
+    size_t last = 0;
+
+    // Extremes of each column drawn last, reused between paints
+    std::vector<NumericSeries::Span> spans;
+
+    // Drag in progress: where it started, and the first element in view then
+    bool dragging = false;
+    bool dragged = false;
+    int dragX = 0;
+    size_t dragFirst = 0;
+
+    // Area of the plot inside the axis labels
+    QRect plot_area() const;
+
+    // Element under a horizontal position
+    size_t index_at(int x) const;
+
+    // Moves the view to [newFirst, newFirst + length), kept inside the series
+    void show_range(double newFirst, double length);
+};
@@ -0,0 +1,322 @@
+#include "SoakTest.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <queue>
+#include <sstream>
+#include <QTemporaryFile>
+#include "JsonReader.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+	using Clock = std::chrono::steady_clock;
+
+	const char* OPERATION_NAMES[SoakTest::OPERATIONS] = { "load", "expand", "search", "copy", "ndjson", "sample" };
+
+	// Resident memory of the process, or 0 where it is not known
+	uint64_t resident_bytes() {
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS pmc;
+		return GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)) ? uint64_t(pmc.WorkingSetSize) : 0;
+#else
+		std::ifstream statm("/proc/self/statm");
+		uint64_t size = 0, resident = 0;
+		if (!(statm >> size >> resident)) {
+			return 0;
+		}
+		return resident * uint64_t(sysconf(_SC_PAGESIZE));
+#endif
+	}
+
+	size_t count_rows(QTreeWidgetItem* item) {
+		size_t count = 1;
+		for (int i = 0; i < item->childCount(); i++) {
+			count += count_rows(item->child(i));
+		}
+		return count;
+	}
+
+	double median(std::vector<double> values) {
+		if (values.empty()) {
+			return 0;
+		}
+		std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+		return values[values.size() / 2];
+	}
+
+	double megabytes(uint64_t bytes) {
+		return double(bytes) / (1024 * 1024);
+	}
+
+	// Delivers what the operation posted back to the window, such as minimap and prefetch results
+	void settle() {
+		QCoreApplication::processEvents();
+	}
+}
+
+SoakTest::SoakTest(JsonReader& reader)
+	: reader(reader)
+{
+}
+
+// Method: Each operation is timed with the events it leaves to be processed
+int SoakTest::run(const QString& path, int cycles, std::ostream& out) {
+	if (cycles < WARMUP_CYCLES + 2 * WINDOW_CYCLES) {
+		out << "Error: at least " << WARMUP_CYCLES + 2 * WINDOW_CYCLES << " cycles are needed\n";
+		return 1;
+	}
+	QTemporaryFile records(QDir::tempPath() + "/jsonreader-soak-XXXXXX.ndjson");
+	if (!records.open()) {
+		out << "Error: cannot create a temporary file\n";
+		return 1;
+	}
+	records.close();
+	const QString recordsPath = write_records(path, records.fileName());
+	if (recordsPath.isEmpty()) {
+		out << "Error: " << path.toStdString() << " holds neither an array, an object nor NDJSON\n";
+		return 1;
+	}
+	out << "Soak test of " << path.toStdString() << ": " << cycles << " cycles of load, " << EXPANDS_PER_CYCLE
+		<< " expands, search and " << SEARCH_NEXT_PER_CYCLE << " next hits, copy of " << COPIED_ROWS
+		<< " rows, NDJSON load and sample of " << SAMPLED_RECORDS << " records\n";
+	history.clear();
+	for (int cycle = 1; cycle <= cycles; cycle++) {
+		Sample sample;
+		auto start = Clock::now();
+		auto lap = [&start](double& milliseconds) {
+			settle();
+			const auto now = Clock::now();
+			milliseconds = std::chrono::duration<double, std::milli>(now - start).count();
+			start = now;
+		};
+
+		QTreeWidgetItem* root = load(path);
+		if (root == nullptr) {
+			out << "Error: " << path.toStdString() << " could not be loaded\n";
+			return 1;
+		}
+		lap(sample.milliseconds[LOAD]);
+		const QString text = expand(root);
+		lap(sample.milliseconds[EXPAND]);
+		search(text);
+		lap(sample.milliseconds[SEARCH]);
+		copy(root);
+		lap(sample.milliseconds[COPY]);
+
+		// A main file that is NDJSON is a document of its own too
+		if (reader.sessionDocuments[root].doc != &reader.parser.doc) {
+			reader.close_document(root);
+		}
+		for (const bool sampled : { false, true }) {
+			QTreeWidgetItem* opened = load_records(recordsPath, sampled, cycle);
+			if (opened == nullptr) {
+				out << "Error: " << recordsPath.toStdString() << " could not be " << (sampled ? "sampled" : "loaded as NDJSON") << "\n";
+				return 1;
+			}
+			expand(opened);
+			reader.close_document(opened);
+			lap(sample.milliseconds[sampled ? SAMPLE : NDJSON]);
+		}
+
+		sample.residentBytes = resident_bytes();
+		sample.rows = live_rows();
+		sample.mapEntries = map_entries();
+		sample.documents = open_documents();
+		history.push_back(sample);
+
+		out << "cycle " << cycle << ": " << megabytes(sample.residentBytes) << " MB, " << sample.rows << " rows, "
+			<< sample.mapEntries << " map entries, " << sample.documents << " documents;";
+		for (int operation = 0; operation < OPERATIONS; operation++) {
+			out << " " << OPERATION_NAMES[operation] << " " << sample.milliseconds[operation] << " ms";
+		}
+		out << "\n";
+	}
+	return check(out) ? 0 : 1;
+}
+
+// Method: Loads go through the strategy chosen in the View menu. A progressive load shows its root at once and
+// registers it when the background parse ends, so the events are processed until then.
+QTreeWidgetItem* SoakTest::load(const QString& path) {
+	reader.load_file(path);
+	QTreeWidgetItem* root = reader.ui.treeWidget->topLevelItem(0);
+	const auto start = Clock::now();
+	while (root != nullptr && root == reader.progressiveRoot && reader.progressiveThread.joinable()) {
+		if (std::chrono::duration<double, std::milli>(Clock::now() - start).count() > LOAD_TIMEOUT_MS) {
+			return nullptr;
+		}
+		QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+	}
+	return root != nullptr && reader.sessionDocuments.contains(root) ? root : nullptr;
+}
+
+// Method: The values are written minified, one per line; a file that does not parse as one document is taken to be
+// NDJSON already
+QString SoakTest::write_records(const QString& path, const QString& recordsPath) {
+	simdjson::dom::parser parser;
+	simdjson::dom::element root;
+	if (parser.load(path.toStdString()).get(root)) {
+		return path;
+	}
+	std::ofstream file(recordsPath.toStdString(), std::ios::binary);
+	size_t written = 0;
+	auto write = [&file, &written](simdjson::dom::element value) {
+		file << simdjson::minify(value) << '\n';
+		written++;
+	};
+	if (root.is_array()) {
+		for (simdjson::dom::element value : simdjson::dom::array(root)) {
+			if (written == NDJSON_RECORDS) {
+				break;
+			}
+			write(value);
+		}
+	}
+	else if (root.is_object()) {
+		for (auto [key, value] : simdjson::dom::object(root)) {
+			if (written == NDJSON_RECORDS) {
+				break;
+			}
+			write(value);
+		}
+	}
+	file.close();
+	return written > 0 && file ? recordsPath : QString();
+}
+
+QTreeWidgetItem* SoakTest::load_records(const QString& path, bool sample, int seed) {
+	const bool loaded = sample ? reader.load_sample(path, SAMPLED_RECORDS, seed) : reader.load_ndjson(path);
+	return loaded ? reader.ui.treeWidget->topLevelItem(0) : nullptr;
+}
+
+QString SoakTest::expand(QTreeWidgetItem* root) {
+	QString text;
+	std::queue<QTreeWidgetItem*> queue;
+	queue.push(root);
+	for (int expanded = 0; !queue.empty() && expanded < EXPANDS_PER_CYCLE; ) {
+		QTreeWidgetItem* item = queue.front();
+		queue.pop();
+		if (item->childCount() == 0) {
+			continue;
+		}
+		item->setExpanded(true);
+		expanded++;
+		for (int i = 0; i < item->childCount(); i++) {
+			QTreeWidgetItem* child = item->child(i);
+			if (child->childCount() > 0) {
+				queue.push(child);
+			}
+			else if (text.isEmpty() && !child->text(0).isEmpty()) {
+				const int separator = child->text(0).indexOf(": ");
+				text = separator > 0 ? child->text(0).left(separator + 2) : child->text(0);
+			}
+		}
+	}
+	return text;
+}
+
+// Method: The text is cleared first, so that setting the same text as the last cycle searches again
+void SoakTest::search(const QString& text) {
+	reader.ui.treeWidget->setCurrentItem(nullptr);
+	reader.ui.textEdit->clear();
+	if (text.isEmpty()) {
+		return;
+	}
+	reader.ui.textEdit->setPlainText(text);
+	for (int i = 0; i < SEARCH_NEXT_PER_CYCLE; i++) {
+		reader.on_searchNextBtn_clicked();
+	}
+}
+
+void SoakTest::copy(QTreeWidgetItem* root) {
+	QTreeWidget* tree = reader.ui.treeWidget;
+	tree->clearSelection();
+	QTreeWidgetItem* item = reader.lastMatch != nullptr ? reader.lastMatch : root;
+	for (int i = 0; i < COPIED_ROWS && item != nullptr; i++, item = tree->itemBelow(item)) {
+		item->setSelected(true);
+	}
+	reader.on_copyBtn_clicked();
+	if (const QMimeData* data = QApplication::clipboard()->mimeData()) {
+		data->text();
+	}
+}
+
+size_t SoakTest::live_rows() const {
+	size_t rows = 0;
+	for (QTreeWidget* tree : { reader.ui.treeWidget, reader.splitTree }) {
+		for (int i = 0; tree != nullptr && i < tree->topLevelItemCount(); i++) {
+			rows += count_rows(tree->topLevelItem(i));
+		}
+	}
+	return rows;
+}
+
+size_t SoakTest::map_entries() const {
+	return size_t(reader.itemElementMap.size() + reader.expandedElementMap.size() + reader.itemCompactMap.size()
+		+ reader.expandedCompactMap.size() + reader.itemEmbeddedMap.size() + reader.embeddedDocuments.size()
+		+ reader.itemRangeMap.size() + reader.itemOverlayMap.size() + reader.expandedOverlayMap.size());
+}
+
+size_t SoakTest::open_documents() const {
+	QSet<QTreeWidgetItem*> roots;
+	for (auto it = reader.sessionDocuments.begin(); it != reader.sessionDocuments.end(); ++it) {
+		roots.insert(it.key());
+	}
+	for (auto it = reader.documentOwners.begin(); it != reader.documentOwners.end(); ++it) {
+		roots.insert(it.key());
+	}
+	return size_t(roots.size());
+}
+
+// Method: The baseline is the last warm-up cycle; durations are compared as medians over a window, which a single
+// slow cycle (a page cache miss, a memory pressure release) does not move
+bool SoakTest::check(std::ostream& out) const {
+	const Sample& baseline = history[WARMUP_CYCLES - 1];
+	const Sample& last = history.back();
+	bool passed = true;
+	auto report = [&out, &passed](bool ok, const std::ostringstream& line) {
+		out << (ok ? "PASS " : "FAIL ") << line.str() << "\n";
+		passed = passed && ok;
+	};
+
+	std::ostringstream line;
+	if (baseline.residentBytes != 0 && last.residentBytes != 0) {
+		const uint64_t allowed = std::max(RESIDENT_SLACK_BYTES, uint64_t(double(baseline.residentBytes) * MAX_RESIDENT_GROWTH));
+		line << "resident memory: " << megabytes(baseline.residentBytes) << " MB after warm-up, " << megabytes(last.residentBytes)
+			<< " MB at the end (" << megabytes(allowed) << " MB allowed)";
+		report(last.residentBytes <= baseline.residentBytes + allowed, line);
+	}
+	else {
+		out << "SKIP resident memory: not reported on this platform\n";
+	}
+	line.str("");
+	line << "rows: " << baseline.rows << " after warm-up, " << last.rows << " at the end";
+	report(double(last.rows) <= double(baseline.rows) * (1 + MAX_ROW_GROWTH), line);
+	line.str("");
+	line << "item map entries: " << baseline.mapEntries << " after warm-up, " << last.mapEntries << " at the end";
+	report(double(last.mapEntries) <= double(baseline.mapEntries) * (1 + MAX_ROW_GROWTH), line);
+	line.str("");
+	line << "documents: " << baseline.documents << " after warm-up, " << last.documents << " at the end";
+	report(last.documents <= baseline.documents, line);
+
+	for (int operation = 0; operation < OPERATIONS; operation++) {
+		std::vector<double> early, late;
+		for (int i = 0; i < WINDOW_CYCLES; i++) {
+			early.push_back(history[size_t(WARMUP_CYCLES + i)].milliseconds[operation]);
+			late.push_back(history[history.size() - 1 - size_t(i)].milliseconds[operation]);
+		}
+		const double before = median(early);
+		const double after = median(late);
+		line.str("");
+		line << OPERATION_NAMES[operation] << " latency: median " << before << " ms after warm-up, " << after << " ms at the end";
+		report(after <= before * (1 + MAX_LATENCY_DRIFT) + LATENCY_SLACK_MS, line);
+	}
+	return passed;
+}
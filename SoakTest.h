@@ -0,0 +1,112 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include <QString>
+
+class JsonReader;
+class QTreeWidgetItem;
+
+// SoakTest class, drives a JsonReader window through the cycles of a long session: load a file, expand rows, search
+// and step through the hits, copy rows, then open the file's top-level values as an NDJSON document and as a sampled
+// preview and close both. After each cycle it records the resident memory of the process, the rows alive in the
+// trees, the entries of the item maps and the documents open, and the duration of each operation. The run fails if,
+// between the end of the warm-up and the last cycle, memory, rows or documents grow past the thresholds below, or if
+// the operations of the last cycles are slower than those of the first ones. The main file replaces the main
+// parser's document, and documents of their own are closed in the cycle that opened them, so a session that releases
+// what it no longer shows stays flat whichever way a document was loaded. Run with "JsonReader --soak <file>
+// [cycles]", on Qt's offscreen platform unless another is set.
+class SoakTest
+{
+public:
+    static constexpr int DEFAULT_CYCLES = 50;
+
+    // Cycles run before the baseline is taken, while allocators and caches settle
+    static constexpr int WARMUP_CYCLES = 3;
+
+    // Cycles whose median durations are compared, right after the warm-up and at the end
+    static constexpr int WINDOW_CYCLES = 5;
+
+    // Work done per cycle
+    static constexpr int EXPANDS_PER_CYCLE = 200;
+    static constexpr int SEARCH_NEXT_PER_CYCLE = 10;
+    static constexpr int COPIED_ROWS = 100;
+
+    // Top-level values written to the NDJSON file loaded each cycle, and records sampled from it
+    static constexpr size_t NDJSON_RECORDS = 10000;
+    static constexpr int SAMPLED_RECORDS = 1000;
+
+    // Growth allowed from the baseline: resident memory as a fraction or in bytes, whichever is larger, and rows and
+    // item map entries as a fraction
+    static constexpr double MAX_RESIDENT_GROWTH = 0.10;
+    static constexpr uint64_t RESIDENT_SLACK_BYTES = uint64_t(32) * 1024 * 1024;
+    static constexpr double MAX_ROW_GROWTH = 0.01;
+
+    // Slowdown allowed for each operation: as a fraction of its first duration, plus a constant for short operations
+    static constexpr double MAX_LATENCY_DRIFT = 0.5;
+    static constexpr double LATENCY_SLACK_MS = 5.0;
+
+    // Longest wait for a load in the background to finish
+    static constexpr int LOAD_TIMEOUT_MS = 10 * 60 * 1000;
+
+    enum Operation {
+        LOAD,
+        EXPAND,
+        SEARCH,
+        COPY,
+        NDJSON,
+        SAMPLE,
+        OPERATIONS
+    };
+
+    // State after a cycle; 'residentBytes' is 0 where the OS does not report it
+    struct Sample {
+        uint64_t residentBytes = 0;
+        size_t rows = 0;
+        size_t mapEntries = 0;
+        size_t documents = 0;
+        double milliseconds[OPERATIONS] = {};
+    };
+
+    explicit SoakTest(JsonReader& reader);
+
+    // Runs the cycles on a file, printing a line per cycle and the checks. Returns a process exit code: 0 if all
+    // checks pass.
+    int run(const QString& path, int cycles, std::ostream& out);
+
+    const std::vector<Sample>& samples() const { return history; }
+
+private:
+    JsonReader& reader;
+    std::vector<Sample> history;
+
+    // Loads the file and waits until its document is registered; nullptr if it could not be loaded
+    QTreeWidgetItem* load(const QString& path);
+
+    // Writes the top-level values of the file to 'recordsPath' as NDJSON, at most NDJSON_RECORDS of them. Returns the
+    // file to load records from, which is the file itself if it is not a single document, or an empty string.
+    QString write_records(const QString& path, const QString& recordsPath);
+
+    // Opens an NDJSON file, or a sample of it, as a document of its own; nullptr if it could not be opened
+    QTreeWidgetItem* load_records(const QString& path, bool sample, int seed);
+
+    // Expands rows breadth-first from the root, as a user opening the first levels, and returns the text to search:
+    // the key of the first value reached, which recurs in arrays of records
+    QString expand(QTreeWidgetItem* root);
+
+    // Searches from the top, then steps to the next hits
+    void search(const QString& text);
+
+    // Copies the rows from the current hit down, and reads the clipboard so that they are serialized
+    void copy(QTreeWidgetItem* root);
+
+    // Rows in the trees, entries of the maps from rows to what they show, and documents open: registered or held for
+    // their rows
+    size_t live_rows() const;
+    size_t map_entries() const;
+    size_t open_documents() const;
+
+    // Compares the last cycles with the baseline, printing a line per check
+    bool check(std::ostream& out) const;
+};
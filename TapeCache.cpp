@@ -0,0 +1,171 @@
+#include "TapeCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+
+namespace {
+
+	// Tape word layout (see simdjson's tape.md): the type in the top byte, the payload below
+	constexpr uint64_t PAYLOAD_MASK = 0x00FFFFFFFFFFFFFF;
+
+	struct FileCloser {
+		void operator()(std::FILE* fp) const { std::fclose(fp); }
+	};
+}
+
+constexpr char TapeCache::MAGIC[8];
+
+// Method: Names the cache after a hash of the absolute source path, so that caches of different files never collide
+// in practice and the same file always maps to the same cache
+std::string TapeCache::cache_path(const std::string& directory, const std::string& sourcePath) {
+	std::error_code ec;
+	const std::string absolute = std::filesystem::absolute(sourcePath, ec).string();
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.tape", static_cast<unsigned long long>(std::hash<std::string>()(ec ? sourcePath : absolute)));
+	return (std::filesystem::path(directory) / name).string();
+}
+
+// Method: The size and time come from the file system, and the hashes from reading at most CHECK_BYTES at each end of
+// the file, which overlap for small files
+bool TapeCache::source_identity(const std::string& sourcePath, Header& header) {
+	std::error_code ec;
+	header.sourceSize = uint64_t(std::filesystem::file_size(sourcePath, ec));
+	if (ec) {
+		return false;
+	}
+	const auto modified = std::filesystem::last_write_time(sourcePath, ec);
+	if (ec) {
+		return false;
+	}
+	header.sourceTime = int64_t(modified.time_since_epoch().count());
+
+	std::unique_ptr<std::FILE, FileCloser> fp(std::fopen(sourcePath.c_str(), "rb"));
+	if (!fp) {
+		return false;
+	}
+	const size_t length = size_t(std::min<uint64_t>(header.sourceSize, CHECK_BYTES));
+	std::string block(length, '\0');
+	if (std::fread(block.data(), 1, length, fp.get()) != length) {
+		return false;
+	}
+	header.sourceHead = uint64_t(std::hash<std::string>()(block));
+	if (header.sourceSize > length) {
+#ifdef _WIN32
+		const bool sought = _fseeki64(fp.get(), int64_t(header.sourceSize - length), SEEK_SET) == 0;
+#else
+		const bool sought = fseeko(fp.get(), off_t(header.sourceSize - length), SEEK_SET) == 0;
+#endif
+		if (!sought || std::fread(block.data(), 1, length, fp.get()) != length) {
+			return false;
+		}
+	}
+	header.sourceTail = uint64_t(std::hash<std::string>()(block));
+	return true;
+}
+
+bool TapeCache::read_header(std::FILE* fp, const std::string& sourcePath, Header& header) {
+	Header source{};
+	return std::fread(&header, sizeof(header), 1, fp) == 1
+		&& std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+		&& source_identity(sourcePath, source)
+		&& header.sourceSize == source.sourceSize && header.sourceTime == source.sourceTime
+		&& header.sourceHead == source.sourceHead && header.sourceTail == source.sourceTail
+		&& header.tapeWords > 1;
+}
+
+bool TapeCache::is_valid(const std::string& cachePath, const std::string& sourcePath) {
+	std::unique_ptr<std::FILE, FileCloser> fp(std::fopen(cachePath.c_str(), "rb"));
+	Header header;
+	return fp && read_header(fp.get(), sourcePath, header);
+}
+
+// Method: The root word's payload is the number of tape words, up to and including the closing root word. The used part of the string buffer ends after
+// the string stored last, so the tape is walked for the string with the highest offset; strings are stored as a
+// 32-bit length, the bytes and a terminating null.
+simdjson::error_code TapeCache::save(const simdjson::dom::document& doc, const std::string& sourcePath, const std::string& cachePath, const std::atomic<bool>* cancelled) {
+	if (!doc.tape) {
+		return simdjson::UNINITIALIZED;
+	}
+	Header header{};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	if (!source_identity(sourcePath, header)) {
+		return simdjson::IO_ERROR;
+	}
+	header.tapeWords = doc.tape[0] & PAYLOAD_MASK;
+	for (uint64_t i = 1; i < header.tapeWords; i++) {
+		const uint64_t word = doc.tape[i];
+		const char type = char(word >> 56);
+		if (type == '"') {
+			const uint64_t offset = word & PAYLOAD_MASK;
+			uint32_t length;
+			std::memcpy(&length, doc.string_buf.get() + offset, sizeof(length));
+			header.stringBytes = std::max(header.stringBytes, offset + sizeof(length) + length + 1);
+		}
+		else if (type == 'l' || type == 'u' || type == 'd') {
+			// Numbers take a second word holding the raw value
+			i++;
+		}
+	}
+
+	// Write to a temporary name and rename, so that an interrupted write never leaves a cache that looks valid
+	const std::string temporaryPath = cachePath + ".tmp";
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), ec);
+	{
+		std::unique_ptr<std::FILE, FileCloser> fp(std::fopen(temporaryPath.c_str(), "wb"));
+		if (!fp) {
+			return simdjson::IO_ERROR;
+		}
+		// Both buffers are written in pieces, so that a cancellation is noticed soon
+		const auto write = [&](const void* data, size_t bytes) {
+			for (size_t offset = 0; offset < bytes; offset += WRITE_BYTES) {
+				const size_t length = std::min(WRITE_BYTES, bytes - offset);
+				if ((cancelled && *cancelled) || std::fwrite(static_cast<const char*>(data) + offset, 1, length, fp.get()) != length) {
+					return false;
+				}
+			}
+			return true;
+		};
+		const bool written = std::fwrite(&header, sizeof(header), 1, fp.get()) == 1
+			&& write(doc.tape.get(), size_t(header.tapeWords) * sizeof(uint64_t))
+			&& write(doc.string_buf.get(), size_t(header.stringBytes))
+			&& std::fflush(fp.get()) == 0;
+		if (!written) {
+			fp.reset();
+			std::filesystem::remove(temporaryPath, ec);
+			return simdjson::IO_ERROR;
+		}
+	}
+	std::filesystem::rename(temporaryPath, cachePath, ec);
+	return ec ? simdjson::IO_ERROR : simdjson::SUCCESS;
+}
+
+// Method: Reads both buffers into new arrays owned by the document, with the padding simdjson expects after strings
+simdjson::error_code TapeCache::load(simdjson::dom::document& doc, const std::string& sourcePath, const std::string& cachePath) {
+	std::unique_ptr<std::FILE, FileCloser> fp(std::fopen(cachePath.c_str(), "rb"));
+	Header header;
+	if (!fp || !read_header(fp.get(), sourcePath, header)) {
+		return simdjson::IO_ERROR;
+	}
+
+	decltype(doc.tape) tape(new (std::nothrow) uint64_t[size_t(header.tapeWords)]);
+	decltype(doc.string_buf) strings(new (std::nothrow) uint8_t[size_t(header.stringBytes) + simdjson::SIMDJSON_PADDING]);
+	if (!tape || !strings) {
+		return simdjson::MEMALLOC;
+	}
+	if (std::fread(tape.get(), sizeof(uint64_t), size_t(header.tapeWords), fp.get()) != size_t(header.tapeWords)
+		|| std::fread(strings.get(), 1, size_t(header.stringBytes), fp.get()) != size_t(header.stringBytes)) {
+		return simdjson::IO_ERROR;
+	}
+	std::memset(strings.get() + header.stringBytes, 0, simdjson::SIMDJSON_PADDING);
+
+	// A tape that does not end with the root word it starts with is corrupt
+	if (char(tape[0] >> 56) != 'r' || (tape[0] & PAYLOAD_MASK) != header.tapeWords || char(tape[header.tapeWords - 1] >> 56) != 'r') {
+		return simdjson::TAPE_ERROR;
+	}
+	doc.tape = std::move(tape);
+	doc.string_buf = std::move(strings);
+	return simdjson::SUCCESS;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "simdjson.h"
+
+// TapeCache class, keeps the parsed form of a document on disk: its tape and string buffer, written as they are
+// after a header identifying the source file by size, modification time and hashes of its first and last
+// CHECK_BYTES, so that a file rewritten within the timestamp's resolution, or with its time restored, is still told
+// apart. Loading a valid cache is a sequential read of both buffers into a document, with no parsing, so a large
+// file can be shown again in a fraction of the time a parse takes. A cache whose source has changed is ignored.
+// Tape words hold offsets into the string buffer, never addresses, so the buffers can be stored as they are; the
+// format follows the machine's byte order and is only meant to be read back on the machine that wrote it.
+class TapeCache
+{
+public:
+    // File name for the cache of 'sourcePath' in 'directory'
+    static std::string cache_path(const std::string& directory, const std::string& sourcePath);
+
+    // Whether 'cachePath' holds a cache for the current version of 'sourcePath'
+    static bool is_valid(const std::string& cachePath, const std::string& sourcePath);
+
+    // Writes the tape and string buffer of 'doc', parsed from 'sourcePath', to 'cachePath'. Returns IO_ERROR, leaving
+    // no file behind, if 'cancelled' is set meanwhile.
+    static simdjson::error_code save(const simdjson::dom::document& doc, const std::string& sourcePath, const std::string& cachePath, const std::atomic<bool>* cancelled = nullptr);
+
+    // Reads a cache written by save() into 'doc', replacing its buffers. Returns IO_ERROR if the cache is missing
+    // or out of date.
+    static simdjson::error_code load(simdjson::dom::document& doc, const std::string& sourcePath, const std::string& cachePath);
+
+private:
+    // Written at the start of the cache file
+    struct Header {
+        char magic[8];
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        uint64_t sourceHead;
+        uint64_t sourceTail;
+        uint64_t tapeWords;
+        uint64_t stringBytes;
+    };
+
+    static constexpr char MAGIC[8] = { 'J', 'R', 'T', 'A', 'P', 'E', '2', '\0' };
+
+    // Bytes hashed at each end of the source, and written per call while saving
+    static constexpr size_t CHECK_BYTES = 64 * 1024;
+    static constexpr size_t WRITE_BYTES = 16 * 1024 * 1024;
+
+    // Fills the source fields of 'header' from 'sourcePath'; false if it cannot be read
+    static bool source_identity(const std::string& sourcePath, Header& header);
+
+    // Reads the header of 'cachePath' and checks it against the source
+    static bool read_header(std::FILE* fp, const std::string& sourcePath, Header& header);
+};
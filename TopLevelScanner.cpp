@@ -0,0 +1,185 @@
+#include "TopLevelScanner.h"
+#include <cstring>
+
+namespace {
+
+	inline bool is_space(char c) {
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+	}
+
+	// Bytes that matter inside a nested value: quotes and brackets
+	struct NestingTable {
+		bool special[256] = {};
+		NestingTable() {
+			for (unsigned char c : { '"', '{', '}', '[', ']' }) {
+				special[c] = true;
+			}
+		}
+	};
+	const NestingTable nesting;
+}
+
+// Method: Skips to the closing quote with memchr, checking the backslashes before each quote found
+bool TopLevelScanner::skip_string(const char* input, size_t available) {
+	while (pos < available) {
+		const void* quote = std::memchr(input + pos, '"', available - pos);
+		if (quote == nullptr) {
+			pos = available;
+			return false;
+		}
+		const size_t quotePos = size_t(static_cast<const char*>(quote) - input);
+		size_t backslashes = 0;
+		while (quotePos - backslashes > stringStart && input[quotePos - backslashes - 1] == '\\') {
+			backslashes++;
+		}
+		pos = quotePos + 1;
+		if (backslashes % 2 == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Method: Runs the state machine over the newly available bytes. Inside values only strings and nesting are
+// tracked, which is enough to find the comma or bracket that ends the value.
+size_t TopLevelScanner::feed(const char* input, size_t available, bool complete) {
+	const size_t before = found.size();
+
+	auto start_value = [&]() {
+		current.start = pos;
+		lastNonSpace = pos;
+		depth = 0;
+		inString = false;
+		state = State::IN_VALUE;
+	};
+	auto finish_value = [&]() {
+		current.end = lastNonSpace;
+		if (current.end == current.start) {
+			state = State::FAILED;
+			return false;
+		}
+		found.push_back(current);
+		current = Entry{};
+		return true;
+	};
+
+	while (pos < available && state != State::DONE && state != State::FAILED) {
+		const char c = input[pos];
+		const char close = rootType == RootType::OBJECT ? '}' : ']';
+		switch (state) {
+		case State::START:
+			if (is_space(c)) {
+				pos++;
+			}
+			else if (c == '{' || c == '[') {
+				rootType = c == '{' ? RootType::OBJECT : RootType::ARRAY;
+				pos++;
+				state = State::BEFORE_ITEM;
+			}
+			else {
+				rootType = RootType::SCALAR;
+				state = State::DONE;
+			}
+			break;
+
+		case State::BEFORE_ITEM:
+			if (is_space(c)) {
+				pos++;
+			}
+			else if (c == close) {
+				pos++;
+				state = State::DONE;
+			}
+			else if (rootType == RootType::ARRAY) {
+				start_value();
+			}
+			else if (c == '"') {
+				pos++;
+				stringStart = pos;
+				state = State::IN_KEY;
+			}
+			else {
+				state = State::FAILED;
+			}
+			break;
+
+		case State::IN_KEY:
+			if (skip_string(input, available)) {
+				current.key.assign(input + stringStart, pos - 1 - stringStart);
+				state = State::BEFORE_COLON;
+			}
+			break;
+
+		case State::BEFORE_COLON:
+			if (is_space(c)) {
+				pos++;
+			}
+			else if (c == ':') {
+				pos++;
+				state = State::BEFORE_VALUE;
+			}
+			else {
+				state = State::FAILED;
+			}
+			break;
+
+		case State::BEFORE_VALUE:
+			if (is_space(c)) {
+				pos++;
+			}
+			else {
+				start_value();
+			}
+			break;
+
+		case State::IN_VALUE:
+			if (!inString && depth > 0 && !nesting.special[uint8_t(c)]) {
+				// Numbers, literals, commas and whitespace inside a nested value need no attention
+				do {
+					pos++;
+				} while (pos < available && !nesting.special[uint8_t(input[pos])]);
+			}
+			else if (inString) {
+				if (skip_string(input, available)) {
+					inString = false;
+					lastNonSpace = pos;
+				}
+			}
+			else if (c == '"') {
+				pos++;
+				stringStart = pos;
+				inString = true;
+			}
+			else if (c == '{' || c == '[') {
+				depth++;
+				lastNonSpace = ++pos;
+			}
+			else if ((c == '}' || c == ']') && depth > 0) {
+				depth--;
+				lastNonSpace = ++pos;
+			}
+			else if ((c == ',' || c == close) && depth == 0) {
+				pos++;
+				if (finish_value()) {
+					state = c == ',' ? State::BEFORE_ITEM : State::DONE;
+				}
+			}
+			else {
+				pos++;
+				if (!is_space(c)) {
+					lastNonSpace = pos;
+				}
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	// A complete input must end the root
+	if (complete && pos >= available && state != State::DONE) {
+		state = State::FAILED;
+	}
+	return found.size() - before;
+}
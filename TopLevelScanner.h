@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// TopLevelScanner class, a quote-aware structural scan that finds the members of the root object, or the elements
+// of the root array, and their byte ranges without parsing them. The scan is resumable: it is fed a prefix of the
+// input that grows as the file is read and picks up where it stopped, so the first entries are known long before
+// the whole input is available. Values are only delimited, not validated; a full parse does that.
+class TopLevelScanner
+{
+public:
+    enum class RootType { UNKNOWN, OBJECT, ARRAY, SCALAR };
+
+    // A member or element of the root. 'key' is the raw key text between the quotes (escapes not decoded) and is
+    // empty for array elements. The value spans [start, end) of the input.
+    struct Entry {
+        std::string key;
+        size_t start;
+        size_t end;
+    };
+
+    // Scans input[0, available). 'input' must hold the same bytes on every call, with 'available' not decreasing;
+    // 'complete' tells that 'available' is the whole input. Returns the number of entries found by this call.
+    size_t feed(const char* input, size_t available, bool complete);
+
+    RootType root_type() const { return rootType; }
+    const std::vector<Entry>& entries() const { return found; }
+
+    // The entry whose value is being scanned, if any: its key and start are known, its end is not yet
+    const Entry* open_entry() const { return state == State::IN_VALUE ? &current : nullptr; }
+
+    // Whether the end of the root has been reached, and whether the input turned out to be malformed
+    bool done() const { return state == State::DONE; }
+    bool failed() const { return state == State::FAILED; }
+
+private:
+    enum class State { START, BEFORE_ITEM, IN_KEY, BEFORE_COLON, BEFORE_VALUE, IN_VALUE, DONE, FAILED };
+
+    State state = State::START;
+    RootType rootType = RootType::UNKNOWN;
+    size_t pos = 0;
+    std::vector<Entry> found;
+
+    // Entry being scanned, the start of the current key or string, and nesting inside the current value
+    Entry current{};
+    size_t stringStart = 0;
+    bool inString = false;
+    size_t depth = 0;
+    size_t lastNonSpace = 0;
+
+    // Finds the closing quote of the string whose contents start at 'stringStart', searching from 'pos'.
+    // Returns false if it is not within the available bytes yet.
+    bool skip_string(const char* input, size_t available);
+};
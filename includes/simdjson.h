@@ -4374,6 +4374,45 @@ namespace dom {
 
 class element;
 
+// JsonReader patch (buffer_allocator) begin: see includes/simdjson-buffer-allocator.patch
+/**
+ * Allocator for the tape and string buffer of a document.
+ *
+ * Lets the application place these buffers in memory it manages itself (for example a
+ * file-backed mapping) instead of the default new[]/delete[].
+ */
+struct buffer_allocator {
+  /** Returns at least `bytes` bytes aligned for uint64_t, or nullptr on failure. */
+  void *(*allocate)(size_t bytes, void *context);
+  /** Releases a buffer returned by allocate(). */
+  void (*deallocate)(void *ptr, size_t bytes, void *context);
+  /** Passed back to allocate() and deallocate(). */
+  void *context;
+};
+
+} // namespace dom
+
+namespace internal {
+
+/** @private Deleter for document buffers, routing to the document's buffer_allocator if any. */
+template<typename T>
+struct buffer_deleter {
+  const dom::buffer_allocator *allocator{nullptr};
+  size_t bytes{0};
+  void operator()(T *ptr) const noexcept {
+    if (allocator) {
+      allocator->deallocate(ptr, bytes, allocator->context);
+    } else {
+      delete[] ptr;
+    }
+  }
+};
+
+} // namespace internal
+
+namespace dom {
+
+// JsonReader patch (buffer_allocator) end
 /**
  * A parsed JSON document.
  *
@@ -4419,14 +4458,27 @@ public:
    */
   bool dump_raw_tape(std::ostream &os) const noexcept;
 
+  // JsonReader patch (buffer_allocator) begin: see includes/simdjson-buffer-allocator.patch
   /** @private Structural values. */
-  std::unique_ptr<uint64_t[]> tape{};
+  std::unique_ptr<uint64_t[], internal::buffer_deleter<uint64_t>> tape{};
 
   /** @private String values.
    *
    * Should be at least byte_capacity.
    */
-  std::unique_ptr<uint8_t[]> string_buf{};
+  std::unique_ptr<uint8_t[], internal::buffer_deleter<uint8_t>> string_buf{};
+
+  /**
+   * Use a custom allocator for the tape and string buffer, or nullptr for new[]/delete[].
+   *
+   * The current buffers are released; the next parse allocates new ones. The allocator
+   * must outlive the document's buffers.
+   */
+  inline void set_allocator(const buffer_allocator *allocator) noexcept;
+  /** The custom allocator in use, or nullptr. */
+  inline const buffer_allocator *get_allocator() const noexcept;
+
+  // JsonReader patch (buffer_allocator) end
   /** @private Allocate memory to support
    * input JSON documents of up to len bytes.
    *
@@ -4447,7 +4499,15 @@ public:
 
 
 private:
+  // JsonReader patch (buffer_allocator) begin: see includes/simdjson-buffer-allocator.patch
+  template<typename T>
+  inline std::unique_ptr<T[], internal::buffer_deleter<T>> allocate_buffer(size_t count) const noexcept;
+
+  // JsonReader patch (buffer_allocator) end
   size_t allocated_capacity{0};
+  // JsonReader patch (buffer_allocator) begin: see includes/simdjson-buffer-allocator.patch
+  const buffer_allocator *custom_allocator{nullptr};
+  // JsonReader patch (buffer_allocator) end
   friend class parser;
 }; // class document
 
@@ -7905,8 +7965,12 @@ inline error_code document::allocate(size_t capacity) noexcept {
   // a document with only zero-length strings... could have capacity/3 string
   // and we would need capacity/3 * 5 bytes on the string buffer
   size_t string_capacity = SIMDJSON_ROUNDUP_N(5 * capacity / 3 + SIMDJSON_PADDING, 64);
-  string_buf.reset( new (std::nothrow) uint8_t[string_capacity]);
-  tape.reset(new (std::nothrow) uint64_t[tape_capacity]);
+  // JsonReader patch (buffer_allocator) begin: see includes/simdjson-buffer-allocator.patch
+  string_buf.reset();
+  tape.reset();
+  string_buf = allocate_buffer<uint8_t>(string_capacity);
+  tape = allocate_buffer<uint64_t>(tape_capacity);
+  // JsonReader patch (buffer_allocator) end
   if(!(string_buf && tape)) {
     allocated_capacity = 0;
     string_buf.reset();
@@ -7919,6 +7983,28 @@ inline error_code document::allocate(size_t capacity) noexcept {
   return SUCCESS;
 }
 
+// JsonReader patch (buffer_allocator) begin: see includes/simdjson-buffer-allocator.patch
+template<typename T>
+inline std::unique_ptr<T[], internal::buffer_deleter<T>> document::allocate_buffer(size_t count) const noexcept {
+  using buffer_ptr = std::unique_ptr<T[], internal::buffer_deleter<T>>;
+  if (!custom_allocator) {
+    return buffer_ptr(new (std::nothrow) T[count]);
+  }
+  void *ptr = custom_allocator->allocate(count * sizeof(T), custom_allocator->context);
+  return buffer_ptr(static_cast<T *>(ptr), internal::buffer_deleter<T>{custom_allocator, count * sizeof(T)});
+}
+
+inline void document::set_allocator(const buffer_allocator *allocator) noexcept {
+  error_code err = allocate(0); // releasing memory cannot fail
+  (void)err;
+  custom_allocator = allocator;
+}
+
+inline const buffer_allocator *document::get_allocator() const noexcept {
+  return custom_allocator;
+}
+
+// JsonReader patch (buffer_allocator) end
 inline bool document::dump_raw_tape(std::ostream &os) const noexcept {
   uint32_t string_length;
   size_t tape_idx = 0;
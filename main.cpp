@@ -1,8 +1,196 @@
 #include "JsonReader.h"
+#include "Benchmark.h"
+#include "FileProbe.h"
+#include "PatchJournal.h"
+#include "PatchOverlay.h"
+#include "PointerExtractor.h"
+#include "Redactor.h"
+#include "SchemaValidator.h"
+#include "SoakTest.h"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
 #include <QtWidgets/QApplication>
 
 int main(int argc, char *argv[])
 {
+    // Command-line benchmarks, the probe, extraction, validation, redaction, patching and overlays run without opening the window
+    if (argc == 3 && std::string(argv[1]) == "--bench-locality") {
+        return run_locality_benchmark(argv[2], std::cout);
+    }
+    if (argc == 3 && std::string(argv[1]) == "--bench-hugepages") {
+        return run_hugepage_benchmark(argv[2], std::cout);
+    }
+    if (argc == 3 && std::string(argv[1]) == "--bench-reads") {
+        return run_read_benchmark(argv[2], std::cout);
+    }
+    if (argc == 4 && std::string(argv[1]) == "--bench-plot") {
+        return run_plot_benchmark(argv[2], argv[3], std::cout);
+    }
+    if (argc == 3 && std::string(argv[1]) == "--probe") {
+        FileProbe probe;
+        simdjson::error_code error = probe.run(argv[2]);
+        if (error) {
+            std::cout << "Error: " << error << "\n";
+            return 1;
+        }
+        std::cout << probe.summary() << "\n";
+        return 0;
+    }
+
+    if (argc == 4 && std::string(argv[1]) == "--extract") {
+        PointerExtractor extractor;
+        simdjson::error_code error = extractor.extract(argv[3], argv[2], [](std::string_view piece) { std::cout.write(piece.data(), std::streamsize(piece.size())); });
+        if (error) {
+            std::cerr << "Error: " << error << "\n";
+            return 1;
+        }
+        std::cout << "\n";
+        return 0;
+    }
+
+    if (argc == 4 && std::string(argv[1]) == "--validate") {
+        SchemaValidator validator;
+        simdjson::error_code error = validator.compile(std::string(argv[2]));
+        if (error) {
+            std::cerr << "Error: " << error << " (" << validator.message() << ")\n";
+            return 1;
+        }
+        simdjson::dom::parser parser;
+        NdjsonDocument records;
+        std::vector<SchemaValidator::Violation> violations;
+        if (NdjsonDocument::has_ndjson_extension(argv[3])) {
+            error = records.load(argv[3]);
+            if (!error) {
+                std::vector<simdjson::dom::element> values;
+                for (size_t i = 0; i < records.size(); i++) {
+                    values.push_back(records.record(i));
+                }
+                violations = validator.validate_each(values);
+            }
+        }
+        else {
+            simdjson::dom::element root;
+            error = parser.load(argv[3]).get(root);
+            if (!error) {
+                violations = validator.validate(root);
+            }
+        }
+        if (error) {
+            std::cerr << "Error: " << error << "\n";
+            return 1;
+        }
+        for (const SchemaValidator::Violation& violation : violations) {
+            std::cout << (violation.pointer.empty() ? "(root)" : violation.pointer) << ": " << violation.message << "\n";
+        }
+        const double megabytes = double(std::filesystem::file_size(argv[3])) / (1024 * 1024);
+        std::cerr << violations.size() << (validator.truncated() ? "+" : "") << " violations, validated in " << validator.seconds() * 1000 << " ms ("
+            << megabytes / validator.seconds() << " MB/s)\n";
+        return violations.empty() ? 0 : 1;
+    }
+
+    if (argc == 5 && std::string(argv[1]) == "--redact") {
+        Redactor redactor;
+        simdjson::error_code error = redactor.load_rules(argv[2]);
+        if (error) {
+            std::cerr << "Error: " << error << " (" << redactor.message() << ")\n";
+            return 1;
+        }
+        simdjson::dom::parser parser;
+        NdjsonDocument records;
+        const auto start = std::chrono::steady_clock::now();
+        if (NdjsonDocument::has_ndjson_extension(argv[3])) {
+            error = records.load(argv[3]);
+            if (!error) {
+                std::vector<simdjson::dom::element> values;
+                for (size_t i = 0; i < records.size(); i++) {
+                    values.push_back(records.record(i));
+                }
+                error = redactor.write_each(values, argv[4]);
+            }
+        }
+        else {
+            simdjson::dom::element root;
+            error = parser.load(argv[3]).get(root);
+            if (!error) {
+                error = redactor.write(root, argv[4]);
+            }
+        }
+        if (error) {
+            std::cerr << "Error: " << error << "\n";
+            return 1;
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double megabytes = double(std::filesystem::file_size(argv[3])) / (1024 * 1024);
+        std::cerr << redactor.dropped() << " dropped, " << redactor.hashed() << " hashed, " << redactor.masked() << " masked; "
+            << megabytes << " MB in " << seconds * 1000 << " ms (" << megabytes / seconds << " MB/s, " << redactor.seconds() * 1000 << " ms writing)\n";
+        return 0;
+    }
+
+    if (argc == 5 && std::string(argv[1]) == "--patch") {
+        PatchJournal journal;
+        const auto start = std::chrono::steady_clock::now();
+        simdjson::error_code error = journal.set_source(argv[3]);
+        if (!error) {
+            error = journal.import_patch(argv[2]);
+        }
+        if (error) {
+            std::cerr << "Error: " << error << " (" << journal.message() << ")\n";
+            return 1;
+        }
+        const double located = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        error = journal.save(argv[4]);
+        if (error) {
+            std::cerr << "Error: " << error << "\n";
+            return 1;
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << journal.edits().size() << " values replaced; " << journal.bytes_copied() << " bytes copied" << (journal.kernel_copies() ? " by the kernel" : "")
+            << ", " << journal.bytes_replaced() << " written; located in " << located * 1000 << " ms, saved in " << (seconds - located) * 1000 << " ms\n";
+        return 0;
+    }
+
+    if (argc == 5 && std::string(argv[1]) == "--apply-patch") {
+        simdjson::dom::parser parser;
+        simdjson::dom::element root;
+        const auto start = std::chrono::steady_clock::now();
+        simdjson::error_code error = parser.load(argv[2]).get(root);
+        if (error) {
+            std::cerr << "Error: " << error << "\n";
+            return 1;
+        }
+        const double parsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        PatchOverlay overlay(root);
+        error = overlay.apply_file(argv[3]);
+        if (error) {
+            std::cerr << "Error: " << error << " (" << overlay.message() << ")\n";
+            return 1;
+        }
+        const auto written = std::chrono::steady_clock::now();
+        error = overlay.write(argv[4]);
+        if (error) {
+            std::cerr << "Error: " << error << "\n";
+            return 1;
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - written).count();
+        std::cerr << overlay.operations() << " operations applied in " << overlay.seconds() * 1000 << " ms; " << overlay.copied_containers() << " containers and "
+            << overlay.copied_values() << " nodes in the overlay (" << overlay.memory_usage() / 1024 << " KB); parsed in " << parsed * 1000 << " ms, written in " << seconds * 1000 << " ms\n";
+        return 0;
+    }
+
+    // The soak test drives a window without the saved session, off screen unless a platform is chosen
+    if ((argc == 3 || argc == 4) && std::string(argv[1]) == "--soak") {
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+        QApplication application(argc, argv);
+        JsonReader reader(nullptr, false);
+        reader.show();
+        SoakTest soak(reader);
+        return soak.run(QString::fromLocal8Bit(argv[2]), argc == 4 ? std::atoi(argv[3]) : SoakTest::DEFAULT_CYCLES, std::cout);
+    }
+
     QApplication a(argc, argv);
     JsonReader w;
     w.show();